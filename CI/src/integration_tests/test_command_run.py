@@ -86,6 +86,33 @@ class TestCommandRun(unittest.TestCase):
         assert util.run_image_and_get_prettyname(is_centralized_repository=False,
                                                  image=self.DEFAULT_IMAGE).startswith("Alpine Linux")
 
+    def test_run_does_not_write_to_repository(self):
+        util.pull_image_if_necessary(is_centralized_repository=False, image=self.DEFAULT_IMAGE)
+        repository = self._get_local_repository_dir()
+
+        # creations, removals and updates of files (e.g. of lock files) change the stat data of their directory
+        before = self._get_stat_data_of_tree(repository)
+        util.run_command_in_container(is_centralized_repository=False,
+                                      image=self.DEFAULT_IMAGE,
+                                      command=["true"])
+        after = self._get_stat_data_of_tree(repository)
+        self.assertEqual(before, after)
+
+    def _get_local_repository_dir(self):
+        import json, os, pwd, pathlib
+        with open(os.environ["CMAKE_INSTALL_PREFIX"] + "/etc/sarus.json") as sarus_json:
+            repo_base = json.load(sarus_json)["localRepositoryBaseDir"]
+        username = pwd.getpwuid(os.geteuid()).pw_name
+        return pathlib.Path(repo_base, username, ".sarus")
+
+    def _get_stat_data_of_tree(self, root):
+        import os
+        stat_data = {}
+        for path in [root] + list(root.rglob("*")):
+            st = os.lstat(path)
+            stat_data[str(path)] = (st.st_ino, st.st_size, st.st_mode, st.st_mtime_ns, st.st_ctime_ns)
+        return stat_data
+
     def _test_command_run(self, is_centralized_repository):
         images = {"quay.io/ethcscs/alpine:3.14": "Alpine Linux",
                   "quay.io/ethcscs/debian:buster": "Debian GNU/Linux",
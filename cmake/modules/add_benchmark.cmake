@@ -0,0 +1,8 @@
+
+# Micro-benchmarks are plain executables printing their measurements to stdout.
+# They are not registered with ctest, since their outcome depends on the machine.
+function(add_benchmark benchmark_name benchmark_src_file link_libraries)
+    set(benchmark_bin_file benchmark_${benchmark_name})
+    add_executable(${benchmark_bin_file} ${benchmark_src_file})
+    target_link_libraries(${benchmark_bin_file} ${link_libraries})
+endfunction()
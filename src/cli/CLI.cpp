@@ -29,6 +29,18 @@
 namespace sarus {
 namespace cli {
 
+/**
+ * The configuration initializer sets up the expensive parts of the configuration (e.g. reading
+ * and validating sarus.json), which are needed only by some commands: it is called once the
+ * command is known and only if the command requires the configuration. Without initializer,
+ * the configuration passed to parseCommandLine() is expected to be complete.
+ */
+CLI::CLI(ConfigInitializer configInitializer)
+    : CLI{}
+{
+    this->configInitializer = std::move(configInitializer);
+}
+
 CLI::CLI() {
     optionsDescription.add_options()
         ("help", "Print help")
@@ -94,6 +106,10 @@ std::unique_ptr<cli::Command> CLI::parseCommandLine(const common::CLIArguments&
         return parseCommandHelpOfCommand(positionalArgs);
     }
 
+    if(configInitializer && factory.requiresConfiguration(commandName)) {
+        configInitializer(conf);
+    }
+
     return factory.makeCommandObject(commandName, positionalArgs, std::move(conf));
 }
 
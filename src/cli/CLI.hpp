@@ -11,6 +11,7 @@
 #ifndef cli_CLI_hpp
 #define cli_CLI_hpp
 
+#include <functional>
 #include <memory>
 #include <deque>
 
@@ -28,8 +29,12 @@ namespace sarus {
 namespace cli {
 
 class CLI {
+public:
+    using ConfigInitializer = std::function<void(const std::shared_ptr<common::Config>&)>;
+
 public:
     CLI();
+    CLI(ConfigInitializer configInitializer);
     std::unique_ptr<cli::Command> parseCommandLine(const common::CLIArguments&, std::shared_ptr<common::Config>) const;
 
 // these methods are public for test purpose
@@ -41,6 +46,7 @@ private:
 
 private:
     boost::program_options::options_description optionsDescription{"Options"};
+    ConfigInitializer configInitializer;
 };
 
 }
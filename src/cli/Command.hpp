@@ -21,6 +21,10 @@ public:
     virtual ~Command() {}
     virtual void execute() = 0;
     virtual bool requiresRootPrivileges() const = 0;
+    // whether the configuration (e.g. sarus.json) must be set up before parsing the command's arguments.
+    // The set up is all or nothing: a command which needs it gets the whole of it (validation of sarus.json,
+    // security checks, metrics), even if it only uses some of the sections
+    virtual bool requiresConfiguration() const { return true; }
     virtual std::string getBriefDescription() const = 0;
     virtual void printHelpMessage() const = 0;
 };
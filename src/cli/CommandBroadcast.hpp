@@ -0,0 +1,268 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef cli_CommandBroadcast_hpp
+#define cli_CommandBroadcast_hpp
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "cli/Utility.hpp"
+#include "common/Config.hpp"
+#include "common/Utility.hpp"
+#include "common/Sha256.hpp"
+#include "cli/Command.hpp"
+#include "common/CLIArguments.hpp"
+#include "cli/HelpMessage.hpp"
+#include "image_manager/ImageStore.hpp"
+#include "image_manager/ImageBroadcast.hpp"
+
+
+namespace sarus {
+namespace cli {
+
+class CommandBroadcast : public Command {
+public:
+    CommandBroadcast() {
+        initializeOptionsDescription();
+    }
+
+    CommandBroadcast(const common::CLIArguments& args, std::shared_ptr<common::Config> conf)
+        : conf{std::move(conf)}
+    {
+        initializeOptionsDescription();
+        parseCommandArguments(args);
+    }
+
+    void execute() override {
+        auto peers = image_manager::ImageBroadcast::parsePeers(nodes.empty() ? getNodesOfSlurmStep() : nodes,
+                                                                static_cast<std::uint16_t>(port));
+        auto rank = getRank(peers);
+        auto broadcast = image_manager::ImageBroadcast{peers, rank, getSecretOfJob(), fanout};
+        broadcast.setTimeout(std::chrono::seconds{timeout});
+
+        auto userStagingDir = stagingDir / std::to_string(conf->userIdentity.uid);
+        common::createFoldersIfNecessary(userStagingDir);
+        boost::filesystem::permissions(userStagingDir, boost::filesystem::owner_all);
+
+        auto stagedName = boost::filesystem::path{conf->imageReference.getUniqueKey() + ".squashfs"};
+
+        // every node looks the image up, so that the receivers only accept the image in the repository
+        auto imageStore = image_manager::ImageStore{conf};
+        auto image = imageStore.findImage(conf->imageReference);
+        if(!image) {
+            auto message = boost::format("Image %s is not available") % conf->imageReference;
+            cli::utility::printLog(message.str(), common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        auto staged = image_manager::ImageBroadcast::StagedFile{};
+        if(rank == 0) {
+            staged = broadcast.send(image->imageFile, stagedName, image->id, userStagingDir);
+            recordDigestOfImage(imageStore, *image, staged.digest);
+        }
+        else {
+            staged = broadcast.receive(stagedName, image->id, userStagingDir);
+        }
+
+        cli::utility::printLog(boost::format("Staged image %s at %s") % conf->imageReference % staged.path,
+                               common::LogLevel::GENERAL);
+    }
+
+    bool requiresRootPrivileges() const override {
+        return false;
+    }
+
+    std::string getBriefDescription() const override {
+        return "Broadcast an image to node-local storage of the job's nodes";
+    }
+
+    void printHelpMessage() const override {
+        auto printer = cli::HelpMessage()
+            .setUsage("sarus broadcast [OPTIONS] REPOSITORY[:TAG]\n"
+                "\n"
+                "Note: the command has to be launched once on each node, for example\n"
+                "      with 'srun --ntasks-per-node=1'. The node with rank 0 reads the\n"
+                "      image from the repository and sends it to the other nodes, which\n"
+                "      forward it along a spanning tree. 'sarus run' automatically uses\n"
+                "      the staged copies when they match the image in the repository.\n"
+                "      The nodes authenticate each other with a key only readable by\n"
+                "      the user, which is created in the local repository if missing.")
+            .setDescription(getBriefDescription())
+            .setOptionsDescription(optionsDescription);
+        std::cout << printer;
+    }
+
+private:
+    void initializeOptionsDescription() {
+        optionsDescription.add_options()
+            ("nodes", boost::program_options::value<std::string>(&nodes),
+                "Comma-separated list of nodes (HOST[:PORT]) taking part in the broadcast. "
+                "Defaults to the nodes of the current Slurm job step")
+            ("rank", boost::program_options::value<int>(&rankFromCLI)->default_value(-1),
+                "Rank of this node in the list of nodes. "
+                "Defaults to the position of the local hostname in the list")
+            ("port", boost::program_options::value<unsigned int>(&port)->default_value(40417),
+                "TCP port used by nodes without an explicit port in the list")
+            ("fanout", boost::program_options::value<std::size_t>(&fanout)->default_value(2),
+                "Number of nodes each node forwards the image to")
+            ("timeout", boost::program_options::value<unsigned int>(&timeout)->default_value(300),
+                "Seconds to wait for other nodes before failing")
+            ("key-file", boost::program_options::value<std::string>(&keyFileFromCLI),
+                "File with the key authenticating the nodes, which must be readable by all the nodes "
+                "and by nobody but the user. Defaults to 'broadcast.key' in the local repository")
+            ("staging-dir", boost::program_options::value<std::string>(&stagingDirFromCLI),
+                "Node-local directory where the image is staged. "
+                "Defaults to the 'imageStagingDir' parameter of the Sarus configuration")
+            ("centralized-repository", "Use centralized repository instead of the local one");
+    }
+
+    void parseCommandArguments(const common::CLIArguments& args) {
+        cli::utility::printLog(boost::format("parsing CLI arguments of broadcast command"), common::LogLevel::DEBUG);
+
+        common::CLIArguments nameAndOptionArgs, positionalArgs;
+        std::tie(nameAndOptionArgs, positionalArgs) = cli::utility::groupOptionsAndPositionalArguments(args, optionsDescription);
+
+        // the broadcast command expects exactly one positional argument
+        cli::utility::validateNumberOfPositionalArguments(positionalArgs, 1, 1, "broadcast");
+
+        try {
+            boost::program_options::variables_map values;
+            boost::program_options::store(
+                boost::program_options::command_line_parser(nameAndOptionArgs.argc(), nameAndOptionArgs.argv())
+                        .options(optionsDescription)
+                        .style(boost::program_options::command_line_style::unix_style)
+                        .run(), values);
+            boost::program_options::notify(values);
+
+            conf->imageReference = cli::utility::parseImageReference(positionalArgs.argv()[0]).normalize();
+            conf->useCentralizedRepository = values.count("centralized-repository");
+            conf->directories.initialize(conf->useCentralizedRepository, *conf);
+
+            if(port == 0 || port > 65535) {
+                SARUS_THROW_ERROR("the port must be in the range [1, 65535]");
+            }
+            if(fanout == 0) {
+                SARUS_THROW_ERROR("the fanout must be greater than zero");
+            }
+
+            keyFile = keyFileFromCLI.empty()
+                ? common::getLocalRepositoryDirectory(*conf) / "broadcast.key"
+                : boost::filesystem::absolute(keyFileFromCLI);
+
+            if(!stagingDirFromCLI.empty()) {
+                stagingDir = boost::filesystem::absolute(stagingDirFromCLI);
+            }
+            else if(const auto* value = rapidjson::Pointer("/imageStagingDir").Get(conf->json)) {
+                stagingDir = value->GetString();
+            }
+            else {
+                SARUS_THROW_ERROR("no staging directory specified with the --staging-dir option "
+                                  "and no 'imageStagingDir' parameter in the Sarus configuration");
+            }
+        }
+        catch (std::exception& e) {
+            auto message = boost::format("%s\nSee 'sarus help broadcast'") % e.what();
+            cli::utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        cli::utility::printLog(boost::format("successfully parsed CLI arguments"), common::LogLevel::DEBUG);
+    }
+
+    std::string getNodesOfSlurmStep() const {
+        auto nodeList = std::string{};
+        try {
+            nodeList = common::getEnvironmentVariable("SLURM_STEP_NODELIST");
+        }
+        catch(common::Error&) {
+            try {
+                nodeList = common::getEnvironmentVariable("SLURM_JOB_NODELIST");
+            }
+            catch(common::Error& e) {
+                SARUS_RETHROW_ERROR(e, "Failed to determine the nodes taking part in the broadcast: "
+                                       "use the --nodes option or run within a Slurm job");
+            }
+        }
+        // expand compressed Slurm node lists, e.g. "nid[001-004]"
+        return common::executeCommand("scontrol show hostnames " + nodeList);
+    }
+
+    /**
+     * The secret authenticating the nodes is derived from the user's key, thus the streams of
+     * other users are rejected, and from the job and the image, thus concurrent broadcasts of
+     * the same user don't mix up.
+     */
+    std::string getSecretOfJob() const {
+        common::createFoldersIfNecessary(keyFile.parent_path());
+        auto key = image_manager::ImageBroadcast::readOrCreateKeyFile(keyFile, conf->userIdentity.uid);
+        auto job = std::string{};
+        try {
+            job = common::getEnvironmentVariable("SLURM_JOB_ID");
+        }
+        catch(common::Error&) {}
+        return common::Sha256::hmacHexDigest(key, "sarus-broadcast:" + job + ":" + conf->imageReference.getUniqueKey());
+    }
+
+    // the staged copies are only used by "sarus run" if they match the digest recorded in the repository
+    void recordDigestOfImage(const image_manager::ImageStore& imageStore, const common::SarusImage& image,
+                             const std::string& digest) const {
+        try {
+            imageStore.recordImageFileDigest(image.reference, image.id, digest);
+        }
+        catch(common::Error& e) {
+            auto message = boost::format("Failed to record the digest of image %s in the repository,"
+                                         " 'sarus run' won't use the staged copies: %s") % image.reference % e.what();
+            cli::utility::printLog(message, common::LogLevel::WARN, std::cerr);
+        }
+    }
+
+    std::size_t getRank(const std::vector<image_manager::ImageBroadcast::Peer>& peers) const {
+        if(rankFromCLI >= 0) {
+            return rankFromCLI;
+        }
+
+        auto hostname = common::getHostname();
+        auto shortHostname = hostname.substr(0, hostname.find('.'));
+        auto it = std::find_if(peers.cbegin(), peers.cend(), [&](const image_manager::ImageBroadcast::Peer& peer) {
+            return peer.host == hostname || peer.host == shortHostname;
+        });
+        if(it == peers.cend()) {
+            auto message = boost::format("Failed to determine the broadcast rank: hostname %s is not in the list of nodes."
+                                         " Use the --rank option") % hostname;
+            SARUS_THROW_ERROR(message.str());
+        }
+        return std::distance(peers.cbegin(), it);
+    }
+
+private:
+    boost::program_options::options_description optionsDescription{"Options"};
+    std::shared_ptr<common::Config> conf;
+    std::string nodes;
+    int rankFromCLI;
+    unsigned int port;
+    std::size_t fanout;
+    unsigned int timeout;
+    std::string keyFileFromCLI;
+    boost::filesystem::path keyFile;
+    std::string stagingDirFromCLI;
+    boost::filesystem::path stagingDir;
+};
+
+}
+}
+
+#endif
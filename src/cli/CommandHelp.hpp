@@ -53,6 +53,10 @@ public:
         return false;
     }
 
+    bool requiresConfiguration() const override {
+        return false;
+    }
+
     std::string getBriefDescription() const override {
         return "Print help message about a command";
     }
@@ -38,6 +38,10 @@ public:
         return false;
     }
 
+    bool requiresConfiguration() const override {
+        return false;
+    }
+
     std::string getBriefDescription() const override {
         SARUS_THROW_ERROR("This function must not be executed."
                             " The developer should review the program's logic.");
@@ -86,6 +86,18 @@ public:
         fieldGetters["SIZE"] = [](const common::SarusImage& image) {
             return image.datasize;
         };
+        fieldGetters["LAST USED"] = [this](const common::SarusImage& image) {
+            if (!this->printUsage) {
+                return std::string{};
+            }
+            return image.launchCount > 0 ? common::SarusImage::createTimeString(image.lastUsed) : std::string{"<never>"};
+        };
+        fieldGetters["LAUNCHES"] = [this](const common::SarusImage& image) {
+            return this->printUsage ? std::to_string(image.launchCount) : std::string{};
+        };
+        fieldGetters["NODES"] = [this](const common::SarusImage& image) {
+            return this->printUsage ? std::to_string(image.numberOfNodes) : std::string{};
+        };
 
         auto imageManager = image_manager::ImageManager{conf};
         auto images = imageManager.listImages();
@@ -116,6 +128,7 @@ private:
     void initializeOptionsDescription() {
         optionsDescription.add_options()
             ("digests", "Show digests")
+            ("usage", "Show the time of the last launch, the number of launches and the number of nodes which launched each image")
             ("centralized-repository", "Use centralized repository instead of the local one");
     }
 
@@ -141,6 +154,7 @@ private:
             conf->directories.initialize(conf->useCentralizedRepository, *conf);
 
             printDigests = values.count("digests") ? true : false;
+            printUsage = values.count("usage") ? true : false;
         }
         catch(std::exception& e) {
             auto message = boost::format("%s\nSee 'sarus help images'") % e.what();
@@ -187,6 +201,17 @@ private:
         width = std::max(width, minFieldWidth);
         formatString += "   %-" + std::to_string(width) + "." + std::to_string(width) + "s";
 
+        if (printUsage) {
+            for(const auto* field : {"LAST USED", "LAUNCHES", "NODES"}) {
+                width = maxFieldLength(images, fieldGetters[field]);
+                width = std::max(width, minFieldWidth);
+                formatString += "   %-" + std::to_string(width) + "." + std::to_string(width) + "s";
+            }
+        }
+        else {
+            formatString += "%s%s%s";
+        }
+
         formatString += "   %-s";
 
         return boost::format{formatString};
@@ -204,7 +229,9 @@ private:
     void printImages(   const std::vector<common::SarusImage>& images,
                         std::unordered_map<std::string, field_getter_t>& fieldGetters,
                         boost::format format) {
-        std::cout << format % "REPOSITORY" % "TAG" % (printDigests ? "DIGEST" : "") % "IMAGE ID" % "CREATED" % "SIZE" % "SERVER\n";
+        std::cout << format % "REPOSITORY" % "TAG" % (printDigests ? "DIGEST" : "") % "IMAGE ID" % "CREATED" % "SIZE"
+                  % (printUsage ? "LAST USED" : "") % (printUsage ? "LAUNCHES" : "") % (printUsage ? "NODES" : "")
+                  % "SERVER\n";
 
         for(const auto& image : images) {
             // For some weird reason we need to create a copy of the strings retrieved through
@@ -216,6 +243,9 @@ private:
                         % std::string(fieldGetters["IMAGE ID"](image))
                         % std::string(fieldGetters["CREATED"](image))
                         % std::string(fieldGetters["SIZE"](image))
+                        % std::string(fieldGetters["LAST USED"](image))
+                        % std::string(fieldGetters["LAUNCHES"](image))
+                        % std::string(fieldGetters["NODES"](image))
                         % std::string(fieldGetters["SERVER"](image))
                         << std::endl;
         }
@@ -226,6 +256,7 @@ private:
     std::shared_ptr<common::Config> conf;
     std::unique_ptr<image_manager::ImageManager> imageManager;
     bool printDigests;
+    bool printUsage;
 };
 
 } // namespace
@@ -59,7 +59,9 @@ public:
     void printHelpMessage() const override {
         auto printer = cli::HelpMessage()
             .setUsage("sarus load [OPTIONS] FILE NAME[:TAG]")
-            .setDescription(getBriefDescription())
+            .setDescription(getBriefDescription() + "\n"
+                            "FILE can also be a named pipe, or '-' to read the archive from the standard input.\n"
+                            "Streamed archives are read only once and are not staged in the image repository.")
             .setOptionsDescription(visibleOptionsDescription);
         std::cout << printer;
     }
@@ -69,6 +71,10 @@ private:
         visibleOptionsDescription.add_options()
             ("temp-dir",   boost::program_options::value<std::string>(&conf->directories.tempFromCLI),
                 "Temporary directory where the image is unpacked")
+            ("tier",
+                boost::program_options::value<std::string>(&conf->imageTier),
+                "Image tier where the image is stored. "
+                "Defaults to the tier selected by the placement policy of the Sarus configuration")
             ("centralized-repository", "Use centralized repository instead of the local one");
         hiddenOptionsDescription.add_options()
             ("source-format", boost::program_options::value<std::string>(&sourceFormat)->default_value("docker-archive"),
@@ -118,6 +124,13 @@ private:
     }
 
     void parsePathOfArchiveToBeLoaded(const boost::filesystem::path& archiveArg) {
+        // '-' follows the usual convention of reading the archive from the standard input,
+        // which is inherited by the Skopeo process performing the copy
+        if(archiveArg == "-") {
+            conf->archivePath = "/dev/stdin";
+            return;
+        }
+
         try {
             conf->archivePath = boost::filesystem::absolute(archiveArg);
         } catch(const std::exception& e) {
@@ -0,0 +1,118 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef cli_CommandMigrate_hpp
+#define cli_CommandMigrate_hpp
+
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include "cli/Utility.hpp"
+#include "common/Config.hpp"
+#include "cli/Command.hpp"
+#include "common/CLIArguments.hpp"
+#include "cli/HelpMessage.hpp"
+#include "image_manager/ImageManager.hpp"
+
+
+namespace sarus {
+namespace cli {
+
+class CommandMigrate : public Command {
+public:
+    CommandMigrate() {
+        initializeOptionsDescription();
+    }
+
+    CommandMigrate(const common::CLIArguments& args, std::shared_ptr<common::Config> conf)
+        : conf{std::move(conf)}
+    {
+        initializeOptionsDescription();
+        parseCommandArguments(args);
+    }
+
+    void execute() override {
+        auto imageManager = image_manager::ImageManager{conf};
+        imageManager.migrateImage();
+    }
+
+    bool requiresRootPrivileges() const override {
+        return false;
+    }
+
+    std::string getBriefDescription() const override {
+        return  "Move an image to another storage tier";
+    }
+
+    void printHelpMessage() const override {
+        auto printer = cli::HelpMessage()
+            .setUsage("sarus migrate [OPTIONS] REPOSITORY[:TAG]\n"
+                "\n"
+                "Note: REPOSITORY[:TAG] has to be specified as\n"
+                "      displayed by the \"sarus images\" command.\n"
+                "      The available tiers are defined by the 'imageTiers' parameter\n"
+                "      of the Sarus configuration, plus the 'default' tier.")
+            .setDescription(getBriefDescription())
+            .setOptionsDescription(optionsDescription);
+        std::cout << printer;
+    }
+
+private:
+    void initializeOptionsDescription() {
+        optionsDescription.add_options()
+            ("tier", boost::program_options::value<std::string>(&tier)->required(),
+                "Image tier where the image is moved to")
+            ("centralized-repository", "Use centralized repository instead of the local one");
+    }
+
+    void parseCommandArguments(const common::CLIArguments& args) {
+        cli::utility::printLog(boost::format("parsing CLI arguments of migrate command"), common::LogLevel::DEBUG);
+
+        common::CLIArguments nameAndOptionArgs, positionalArgs;
+        std::tie(nameAndOptionArgs, positionalArgs) = cli::utility::groupOptionsAndPositionalArguments(args, optionsDescription);
+
+        // the migrate command expects exactly one positional argument
+        cli::utility::validateNumberOfPositionalArguments(positionalArgs, 1, 1, "migrate");
+
+        try {
+            boost::program_options::variables_map values;
+            boost::program_options::store(
+                boost::program_options::command_line_parser(nameAndOptionArgs.argc(), nameAndOptionArgs.argv())
+                        .options(optionsDescription)
+                        .style(boost::program_options::command_line_style::unix_style)
+                        .run(), values);
+            boost::program_options::notify(values);
+
+            conf->imageReference = cli::utility::parseImageReference(positionalArgs.argv()[0]).normalize();
+            conf->imageTier = tier;
+            conf->useCentralizedRepository = values.count("centralized-repository");
+            conf->directories.initialize(conf->useCentralizedRepository, *conf);
+        }
+        catch (std::exception& e) {
+            auto message = boost::format("%s\nSee 'sarus help migrate'") % e.what();
+            cli::utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        cli::utility::printLog(boost::format("successfully parsed CLI arguments"), common::LogLevel::DEBUG);
+    }
+
+private:
+    boost::program_options::options_description optionsDescription{"Options"};
+    std::shared_ptr<common::Config> conf;
+    std::string tier;
+};
+
+}
+}
+
+#endif
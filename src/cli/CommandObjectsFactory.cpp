@@ -11,29 +11,39 @@
 #include "CommandObjectsFactory.hpp"
 
 #include "cli/Utility.hpp"
+#include "cli/CommandBroadcast.hpp"
 #include "cli/CommandHelp.hpp"
 #include "cli/CommandHelpOfCommand.hpp"
 #include "cli/CommandImages.hpp"
 #include "cli/CommandLoad.hpp"
+#include "cli/CommandMigrate.hpp"
+#include "cli/CommandPrune.hpp"
 #include "cli/CommandPull.hpp"
 #include "cli/CommandRmi.hpp"
 #include "cli/CommandRun.hpp"
+#include "cli/CommandSession.hpp"
 #include "cli/CommandSshKeygen.hpp"
 #include "cli/CommandVersion.hpp"
+#include "cli/CommandWaitTeardowns.hpp"
 
 
 namespace sarus {
 namespace cli {
 
 CommandObjectsFactory::CommandObjectsFactory() {
+    addCommand<cli::CommandBroadcast>("broadcast");
     addCommand<cli::CommandHelp>("help");
     addCommand<cli::CommandImages>("images");
     addCommand<cli::CommandLoad>("load");
+    addCommand<cli::CommandMigrate>("migrate");
+    addCommand<cli::CommandPrune>("prune");
     addCommand<cli::CommandPull>("pull");
     addCommand<cli::CommandRmi>("rmi");
     addCommand<cli::CommandRun>("run");
+    addCommand<cli::CommandSession>("session");
     addCommand<cli::CommandSshKeygen>("ssh-keygen");
     addCommand<cli::CommandVersion>("version");
+    addCommand<cli::CommandWaitTeardowns>("wait-teardowns");
 }
 
 bool CommandObjectsFactory::isValidCommandName(const std::string& commandName) const {
@@ -49,6 +59,13 @@ std::vector<std::string> CommandObjectsFactory::getCommandNames() const {
     return names;
 }
 
+/**
+ * Asks a default-constructed command, which doesn't parse arguments nor access the configuration
+ */
+bool CommandObjectsFactory::requiresConfiguration(const std::string& commandName) const {
+    return makeCommandObject(commandName)->requiresConfiguration();
+}
+
 std::unique_ptr<cli::Command> CommandObjectsFactory::makeCommandObject(const std::string& commandName) const {
     if(!isValidCommandName(commandName)) {
         auto message = boost::format("'%s' is not a Sarus command\nSee 'sarus help'")
@@ -40,6 +40,7 @@ public:
 
     bool isValidCommandName(const std::string& commandName) const;
     std::vector<std::string> getCommandNames() const;
+    bool requiresConfiguration(const std::string& commandName) const;
     std::unique_ptr<cli::Command> makeCommandObject(const std::string& commandName) const;
     std::unique_ptr<cli::Command> makeCommandObject(const std::string& commandName,
                                                     const common::CLIArguments& commandArgs,
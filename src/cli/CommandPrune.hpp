@@ -0,0 +1,131 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef cli_CommandPrune_hpp
+#define cli_CommandPrune_hpp
+
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include "cli/Utility.hpp"
+#include "common/Config.hpp"
+#include "cli/Command.hpp"
+#include "common/CLIArguments.hpp"
+#include "cli/HelpMessage.hpp"
+#include "image_manager/ImageManager.hpp"
+
+
+namespace sarus {
+namespace cli {
+
+class CommandPrune : public Command {
+public:
+    CommandPrune() {
+        initializeOptionsDescription();
+    }
+
+    CommandPrune(const common::CLIArguments& args, std::shared_ptr<common::Config> conf)
+        : conf{std::move(conf)}
+    {
+        initializeOptionsDescription();
+        parseCommandArguments(args);
+    }
+
+    void execute() override {
+        auto imageManager = image_manager::ImageManager{conf};
+        imageManager.pruneImages();
+    }
+
+    bool requiresRootPrivileges() const override {
+        return false;
+    }
+
+    std::string getBriefDescription() const override {
+        return  "Remove unused images and leftovers of interrupted pulls";
+    }
+
+    void printHelpMessage() const override {
+        auto printer = cli::HelpMessage()
+            .setUsage("sarus prune [OPTIONS]")
+            .setDescription("Remove the images matching all the given options, with a single update of"
+                            " the repository metadata. Without options, no image is removed.\n"
+                            "Also remove the temporary files left in the repository, cache and temporary"
+                            " directories by the pulls and loads which were interrupted more than one day"
+                            " ago, and the files of the repository's file store which are no longer"
+                            " referenced by any image.\n"
+                            "DURATION is an integer followed by a unit of time among 's' (seconds),"
+                            " 'm' (minutes), 'h' (hours) and 'd' (days), e.g. '30d'")
+            .setOptionsDescription(optionsDescription);
+        std::cout << printer;
+    }
+
+private:
+    void initializeOptionsDescription() {
+        optionsDescription.add_options()
+            ("older-than", boost::program_options::value<std::string>(),
+                "Remove the images pulled or loaded more than DURATION ago")
+            ("unused-for", boost::program_options::value<std::string>(),
+                "Remove the images which were not used by a container for DURATION")
+            ("reference", boost::program_options::value<std::string>(),
+                "Remove the images whose SERVER/NAMESPACE/IMAGE[:TAG] matches the wildcard pattern,"
+                " e.g. 'docker.io/library/*:rc*'")
+            ("centralized-repository", "Use centralized repository instead of the local one");
+    }
+
+    void parseCommandArguments(const common::CLIArguments& args) {
+        cli::utility::printLog(boost::format("parsing CLI arguments of prune command"), common::LogLevel::DEBUG);
+
+        common::CLIArguments nameAndOptionArgs, positionalArgs;
+        std::tie(nameAndOptionArgs, positionalArgs) = cli::utility::groupOptionsAndPositionalArguments(args, optionsDescription);
+
+        // the prune command doesn't support positional arguments
+        cli::utility::validateNumberOfPositionalArguments(positionalArgs, 0, 0, "prune");
+
+        try {
+            boost::program_options::variables_map values;
+            boost::program_options::store(
+                boost::program_options::command_line_parser(nameAndOptionArgs.argc(), nameAndOptionArgs.argv())
+                        .options(optionsDescription)
+                        .style(boost::program_options::command_line_style::unix_style)
+                        .run(), values);
+            boost::program_options::notify(values);
+
+            if(values.count("older-than")) {
+                conf->commandPrune.olderThan = cli::utility::parseDuration(values["older-than"].as<std::string>());
+            }
+            if(values.count("unused-for")) {
+                conf->commandPrune.unusedFor = cli::utility::parseDuration(values["unused-for"].as<std::string>());
+            }
+            if(values.count("reference")) {
+                conf->commandPrune.referencePattern = values["reference"].as<std::string>();
+            }
+            conf->useCentralizedRepository = values.count("centralized-repository");
+            conf->directories.initialize(conf->useCentralizedRepository, *conf);
+        }
+        catch (std::exception& e) {
+            auto message = boost::format("%s\nSee 'sarus help prune'") % e.what();
+            cli::utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        cli::utility::printLog(boost::format("successfully parsed CLI arguments"), common::LogLevel::DEBUG);
+    }
+
+private:
+    boost::program_options::options_description optionsDescription{"Options"};
+    std::shared_ptr<common::Config> conf;
+};
+
+}
+}
+
+#endif
@@ -77,6 +77,10 @@ private:
             ("username,u",
                 boost::program_options::value<std::string>(&username),
                 "Username for private repository")
+            ("tier",
+                boost::program_options::value<std::string>(&conf->imageTier),
+                "Image tier where the image is stored. "
+                "Defaults to the tier selected by the placement policy of the Sarus configuration")
             ("centralized-repository", "Use centralized repository instead of the local one");
         hiddenOptionsDescription.add_options()
             ("containers-storage", "Pull from a local containers/storage image store");
@@ -11,6 +11,7 @@
 #ifndef cli_CommandRmi_hpp
 #define cli_CommandRmi_hpp
 
+#include <climits>
 #include <iostream>
 #include <stdexcept>
 
@@ -42,7 +43,7 @@ public:
 
     void execute() override {
         auto imageManager = image_manager::ImageManager{conf};
-        imageManager.removeImage();
+        imageManager.removeImages();
         // TODO: print to stdout (image manager shouldn't do it for the sake of testability)
     }
 
@@ -51,12 +52,12 @@ public:
     }
 
     std::string getBriefDescription() const override {
-        return  "Remove an image";
+        return  "Remove images";
     }
 
     void printHelpMessage() const override {
         auto printer = cli::HelpMessage()
-            .setUsage("sarus rmi REPOSITORY[:TAG]\n"
+            .setUsage("sarus rmi REPOSITORY[:TAG] [REPOSITORY[:TAG]...]\n"
                 "\n"
                 "Note: REPOSITORY[:TAG] has to be specified as\n"
                 "      displayed by the \"sarus images\" command.")
@@ -76,8 +77,8 @@ private:
         common::CLIArguments nameAndOptionArgs, positionalArgs;
         std::tie(nameAndOptionArgs, positionalArgs) = cli::utility::groupOptionsAndPositionalArguments(args, optionsDescription);
 
-        // the rmi command expects exactly one positional argument
-        cli::utility::validateNumberOfPositionalArguments(positionalArgs, 1, 1, "rmi");
+        // the rmi command expects at least one positional argument
+        cli::utility::validateNumberOfPositionalArguments(positionalArgs, 1, INT_MAX, "rmi");
 
         try {
             boost::program_options::variables_map values;
@@ -88,7 +89,10 @@ private:
                         .run(), values);
             boost::program_options::notify(values);
 
-            conf->imageReference = cli::utility::parseImageReference(positionalArgs.argv()[0]).normalize();
+            for(const auto& arg : positionalArgs) {
+                conf->imageReferences.push_back(cli::utility::parseImageReference(arg).normalize());
+            }
+            conf->imageReference = conf->imageReferences.front();
             conf->useCentralizedRepository = values.count("centralized-repository");
             conf->directories.initialize(conf->useCentralizedRepository, *conf);
         }
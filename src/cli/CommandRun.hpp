@@ -22,14 +22,17 @@
 #include "common/Utility.hpp"
 #include "common/Config.hpp"
 #include "common/CLIArguments.hpp"
+#include "common/Metrics.hpp"
 #include "cli/Utility.hpp"
 #include "cli/Command.hpp"
 #include "cli/MountParser.hpp"
 #include "cli/DeviceParser.hpp"
 #include "cli/HelpMessage.hpp"
 #include "image_manager/ImageStore.hpp"
+#include "image_manager/ImageBroadcast.hpp"
 #include "runtime/Runtime.hpp"
 #include "runtime/DeviceMount.hpp"
+#include "runtime/LaunchAdmission.hpp"
 
 
 namespace sarus {
@@ -58,6 +61,10 @@ public:
             SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
         }
 
+        // the I/O-heavy phases of the launch, i.e. the lookup of the image and the setup
+        // of the bundle, wait for the admission of the launch (if configured)
+        runtime::LaunchAdmission admission{conf};
+
         verifyThatImageIsAvailable();
 
         auto setupBegin = std::chrono::high_resolution_clock::now();
@@ -67,12 +74,31 @@ public:
 
         auto runtime = runtime::Runtime{conf};
         runtime.setupOCIBundle();
+        admission.release();
 
         auto setupEnd = std::chrono::high_resolution_clock::now();
         auto setupTime = std::chrono::duration<double>(setupEnd - setupBegin);
         message = boost::format("Successfully set up container in %.6f seconds") % setupTime.count();
         cli::utility::printLog(message, common::LogLevel::INFO);
 
+        // export the launch metrics now: the container may run for a long time
+        // or the process may be killed (e.g. by the workload manager) before returning
+        auto& metrics = common::Metrics::getInstance();
+        metrics.observe("sarus_launch_phase", cliTime.count(), {{"phase", "cli"}});
+        metrics.observe("sarus_launch_phase", setupTime.count(), {{"phase", "setup"}});
+        if(admission.isEnabled()) {
+            metrics.observe("sarus_launch_phase", admission.getWaitTime(), {{"phase", "admission"}});
+        }
+        metrics.observe("sarus_launch", std::chrono::duration<double>(setupEnd - conf->program_start).count());
+        metrics.incrementCounter("sarus_containers_launched");
+        metrics.flush();
+
+        if(conf->commandRun.startSession) {
+            auto sessionID = runtime.startSession();
+            cli::utility::printLog(sessionID, common::LogLevel::GENERAL);
+            return;
+        }
+
         runtime.executeContainer();
 
         cli::utility::printLog("Successfully executed run command", common::LogLevel::INFO);
@@ -121,6 +147,9 @@ private:
                 boost::program_options::value<std::string>(&pid),
                 "Set the PID namespace mode for the container. Supported values: 'host', 'private'. "
                 "Default: use the host’s PID namespace for the container")
+            ("read-only", "Mount the image as a read-only root filesystem, without a writable layer. "
+                          "Incompatible with '--glibc', '--mpi' and '--ssh'")
+            ("read-write", "Mount the image with a writable layer, overriding the site default")
             ("ssh", "Enable SSH in the container. Implies '--pid=private'")
             ("tty,t", "Allocate a pseudo-TTY in the container")
             ("workdir,w",
@@ -151,7 +180,8 @@ private:
             // Parse the image reference and normalize it for consistency with Docker, Podman, Buildah
             conf->imageReference = cli::utility::parseImageReference(positionalArgs.argv()[0]).normalize();
             conf->useCentralizedRepository = values.count("centralized-repository");
-            conf->directories.initialize(conf->useCentralizedRepository, *conf);
+            // the launch doesn't write to the repository, which may sit on a shared filesystem
+            conf->directories.initialize(conf->useCentralizedRepository, *conf, false);
             // the remaining arguments (after image) are all part of the command to be executed in the container
             conf->commandRun.execArgs = common::CLIArguments(positionalArgs.begin()+1, positionalArgs.end());
 
@@ -214,6 +244,8 @@ private:
                 conf->commandRun.enableSSH = false;
             }
 
+            setReadOnlyRootfs(values);
+
             if(values.count("tty")) {
                 conf->commandRun.allocatePseudoTTY = true;
             }
@@ -245,6 +277,38 @@ private:
         cli::utility::printLog("successfully parsed CLI arguments", common::LogLevel::DEBUG);
     }
 
+    /**
+     * The hooks which modify the container's rootfs (e.g. by mounting host libraries on top of the
+     * container's ones) need a writable rootfs: they override the site default of a read-only rootfs
+     */
+    void setReadOnlyRootfs(const boost::program_options::variables_map& values) const {
+        auto needsWritableRootfs = conf->commandRun.useMPI
+            || conf->commandRun.enableGlibcReplacement
+            || conf->commandRun.enableSSH;
+
+        if(values.count("read-only") && values.count("read-write")) {
+            SARUS_THROW_ERROR("The options '--read-only' and '--read-write' are mutually exclusive");
+        }
+        else if(values.count("read-only")) {
+            if(needsWritableRootfs) {
+                SARUS_THROW_ERROR("The use of '--read-only' is incompatible with '--glibc', '--mpi' and '--ssh'. "
+                                  "The hooks of these options modify the container's root filesystem");
+            }
+            conf->commandRun.readOnlyRootfs = true;
+        }
+        else if(values.count("read-write")) {
+            conf->commandRun.readOnlyRootfs = false;
+        }
+        else {
+            const auto* siteDefault = rapidjson::Pointer("/readOnlyRootfs").Get(conf->json);
+            conf->commandRun.readOnlyRootfs = siteDefault && siteDefault->GetBool() && !needsWritableRootfs;
+            if(siteDefault && siteDefault->GetBool() && needsWritableRootfs) {
+                cli::utility::printLog("Using a writable root filesystem, as needed by the requested hooks",
+                                       common::LogLevel::INFO);
+            }
+        }
+    }
+
     void makeUserEnvironment() {
         for(const auto& variable : env) {
             auto message = boost::format("Parsing environment variable requested from CLI '%s'") % variable;
@@ -452,6 +516,31 @@ private:
         return common::forkExecWait(args, std::function<void()>{setUserIdentity}) == 0;
     }
 
+    /**
+     * The only write of the launch to the repository, if enabled with the "recordImageLaunches" parameter.
+     * Failures are not fatal, since the access log only feeds the usage statistics of the images.
+     * The access log of the centralized repository is written by root, like the rest of the repository.
+     */
+    void recordImageAccess(const image_manager::ImageStore& imageStore, const common::UserIdentity& rootIdentity) const {
+        const auto* recordImageLaunches = rapidjson::Pointer("/recordImageLaunches").Get(conf->json);
+        if(!recordImageLaunches || !recordImageLaunches->GetBool()) {
+            return;
+        }
+        if(conf->useCentralizedRepository) {
+            common::setFilesystemUid(rootIdentity);
+        }
+        try {
+            imageStore.recordImageAccess(conf->imageReference);
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to record access to image %s: %s") % conf->imageReference % e.what();
+            cli::utility::printLog(message, common::LogLevel::INFO);
+        }
+        if(conf->useCentralizedRepository) {
+            common::setFilesystemUid(conf->userIdentity);
+        }
+    }
+
     void verifyThatImageIsAvailable() const {
         cli::utility::printLog( boost::format("Verifying that image %s is available") % conf->imageReference,
                                 common::LogLevel::INFO);
@@ -470,10 +559,17 @@ private:
                 image = imageStore.findImage(conf->imageReference);
             }
             if(!image) {
+                // throw rather than exit, so that the launch admission is released (e.g. its job token removed)
                 auto message = boost::format("Image %s is not available") % conf->imageReference;
                 cli::utility::printLog(message.str(), common::LogLevel::GENERAL, std::cerr);
-                exit(EXIT_FAILURE);
+                SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
             }
+            recordImageAccess(imageStore, rootIdentity);
+            // the backing files may be stored in any of the image tiers (checked by the ImageStore)
+            conf->commandRun.imageFile = image->imageFile;
+            conf->commandRun.imageMetadataFile = image->metadataFile;
+            conf->commandRun.lowerImageFiles = image->lowerImageFiles;
+            useStagedImageIfAvailable(*image);
         }
         catch(const std::exception& e) {
             SARUS_RETHROW_ERROR(e, "Failed to verify that image is available");
@@ -485,6 +581,33 @@ private:
                                common::LogLevel::INFO);
     }
 
+    /**
+     * The staged copy is not hashed at launch: its sidecar only tells that it was verified when it
+     * was received. A staged copy belongs to the user, thus it is only trusted as much as the files of
+     * the user's local repository, and is never used in place of an image of the centralized repository.
+     */
+    void useStagedImageIfAvailable(const common::SarusImage& image) const {
+        const auto* stagingDir = rapidjson::Pointer("/imageStagingDir").Get(conf->json);
+        if(!stagingDir || conf->useCentralizedRepository) {
+            return;
+        }
+
+        auto userStagingDir = boost::filesystem::path{stagingDir->GetString()} / std::to_string(conf->userIdentity.uid);
+        auto stagedName = boost::filesystem::path{conf->imageReference.getUniqueKey() + ".squashfs"};
+        auto staged = image_manager::ImageBroadcast::findStagedFile(userStagingDir, stagedName, image.id,
+                                                                    conf->userIdentity.uid);
+        if(staged && staged->digest != image.imageFileDigest) {
+            cli::utility::printLog(boost::format("Ignoring node-local staged copy %s, which doesn't match the digest"
+                                                 " of the image recorded in the repository") % staged->path,
+                                   common::LogLevel::INFO);
+        }
+        else if(staged) {
+            conf->commandRun.imageFile = staged->path;
+            cli::utility::printLog(boost::format("Using node-local staged copy %s of image") % staged->path,
+                                   common::LogLevel::INFO);
+        }
+    }
+
 private:
     boost::program_options::options_description optionsDescription{"Options"};
     std::vector<std::string> env;
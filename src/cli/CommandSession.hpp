@@ -0,0 +1,185 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_cli_CommandSession_hpp
+#define sarus_cli_CommandSession_hpp
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+#include <boost/format.hpp>
+
+#include "common/Config.hpp"
+#include "common/CLIArguments.hpp"
+#include "common/Utility.hpp"
+#include "cli/Command.hpp"
+#include "cli/CommandRun.hpp"
+#include "cli/Utility.hpp"
+#include "cli/HelpMessage.hpp"
+#include "runtime/TeardownRecord.hpp"
+#include "runtime/Utility.hpp"
+
+
+namespace sarus {
+namespace cli {
+
+/**
+ * Sessions for workflows which run many short commands in the same container: "start" sets up
+ * the container once (see runtime::Runtime::startSession), "exec" launches a command into it
+ * through the OCI runtime and "stop" deletes it.
+ */
+class CommandSession : public Command {
+public:
+    CommandSession() = default;
+
+    CommandSession(const common::CLIArguments& args, std::shared_ptr<common::Config> config)
+        : conf{std::move(config)}
+    {
+        parseCommandArguments(args);
+    }
+
+    void execute() override {
+        if(subcommand == "start") {
+            commandRun->execute();
+        }
+        else if(subcommand == "exec") {
+            auto session = findSessionOfUser();
+            // the options of the OCI runtime end before the container's ID, which can't be mistaken for one
+            auto args = common::CLIArguments{conf->json["runcPath"].GetString(), "exec", "--", session.containerID};
+            args += execArgs;
+
+            // terminate the process in the session should Sarus die
+            auto setParentDeathSignal = [](pid_t parentPid) {
+                if(prctl(PR_SET_PDEATHSIG, SIGHUP) == -1 || getppid() != parentPid) {
+                    SARUS_THROW_ERROR("Failed to set parent death signal in subprocess for OCI runtime");
+                }
+            };
+            auto status = common::forkExecWait(args,
+                                               std::function<void()>{std::bind(setParentDeathSignal, getpid())},
+                                               std::function<void(pid_t)>{runtime::utility::setupSignalProxying});
+            if(status != 0) {
+                auto message = boost::format("%s exited with code %d") % args % status;
+                cli::utility::printLog(message, common::LogLevel::INFO);
+                exit(status);
+            }
+        }
+        else {
+            auto session = findSessionOfUser();
+            auto args = common::CLIArguments{conf->json["runcPath"].GetString(), "delete", "--force", "--", session.containerID};
+            if(common::forkExecWait(args) != 0) {
+                auto message = boost::format("Failed to stop session %s") % session.containerID;
+                SARUS_THROW_ERROR(message.str());
+            }
+            cli::utility::printLog(boost::format("Stopped session %s") % session.containerID, common::LogLevel::INFO);
+        }
+    }
+
+    bool requiresRootPrivileges() const override {
+        return true;
+    }
+
+    std::string getBriefDescription() const override {
+        return "Run many commands in the same container";
+    }
+
+    void printHelpMessage() const override {
+        auto printer = cli::HelpMessage()
+            .setUsage("sarus session start [RUN OPTIONS] REPOSITORY[:TAG]\n"
+                      "       sarus session exec SESSION COMMAND [ARG...]\n"
+                      "       sarus session stop SESSION")
+            .setDescription("'start' sets up a container like 'sarus run' (accepting the same options) and prints"
+                            " the ID of the session without starting a process in the container.\n"
+                            "'exec' runs a command in the container of the session, skipping the container's setup."
+                            " The command inherits the environment, working directory and user of the session.\n"
+                            "'stop' terminates the processes of the session and releases its container.\n"
+                            "A session can only be used by the user who started it and, if started within a Slurm"
+                            " job confined in a cgroup, within the same job. Start it from the job's batch script,"
+                            " so that it is released together with the job");
+        std::cout << printer;
+    }
+
+private:
+    void parseCommandArguments(const common::CLIArguments& args) {
+        cli::utility::printLog(boost::format("parsing CLI arguments of session command"), common::LogLevel::DEBUG);
+
+        if(args.argc() < 2) {
+            auto message = boost::format("Command 'session' requires a subcommand: 'start', 'exec' or 'stop'"
+                                         "\nSee 'sarus help session'");
+            utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        subcommand = args.argv()[1];
+        if(subcommand == "start") {
+            // the run command parses the options and the image, the container's process is never started
+            auto runArgs = common::CLIArguments{"run"};
+            runArgs += common::CLIArguments(args.begin()+2, args.end());
+            commandRun.reset(new cli::CommandRun{runArgs, conf});
+            if(!conf->commandRun.execArgs.empty() || conf->commandRun.allocatePseudoTTY) {
+                auto message = boost::format("'session start' doesn't accept a command nor the '--tty' option"
+                                             "\nSee 'sarus help session'");
+                utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+                SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+            }
+            conf->commandRun.startSession = true;
+            conf->commandRun.addInitProcess = true;
+            conf->commandRun.entrypoint = common::CLIArguments{};
+            conf->commandRun.execArgs = common::CLIArguments{"/dev/init"}; // must exist, though never executed
+        }
+        else if(subcommand == "exec" && args.argc() >= 4) {
+            sessionID = args.argv()[2];
+            execArgs = common::CLIArguments(args.begin()+3, args.end());
+        }
+        else if(subcommand == "stop" && args.argc() == 3) {
+            sessionID = args.argv()[2];
+        }
+        else {
+            auto message = boost::format("Invalid arguments of command 'session'\nSee 'sarus help session'");
+            utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        cli::utility::printLog(boost::format("successfully parsed CLI arguments"), common::LogLevel::DEBUG);
+    }
+
+    /**
+     * The job is identified by the cgroup of the process rather than by the environment, which the
+     * user controls.
+     */
+    runtime::TeardownRecord::Session findSessionOfUser() const {
+        auto recordsDir = runtime::TeardownRecord::getRecordsDirectory(*conf);
+        auto session = runtime::TeardownRecord::findSessionOfUser(recordsDir, sessionID, conf->userIdentity.uid,
+                                                                  runtime::utility::getJobIDOfProcess());
+        if(!session) {
+            auto message = boost::format("Session %s not found") % sessionID;
+            utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+        return *session;
+    }
+
+private:
+    std::shared_ptr<common::Config> conf;
+    std::string subcommand;
+    std::string sessionID;
+    common::CLIArguments execArgs;
+    std::unique_ptr<cli::CommandRun> commandRun;
+};
+
+}
+}
+
+#endif
@@ -41,6 +41,10 @@ public:
         return false;
     }
 
+    bool requiresConfiguration() const override {
+        return false;
+    }
+
     std::string getBriefDescription() const override {
         return "Show the Sarus version information";
     }
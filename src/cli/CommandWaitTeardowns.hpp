@@ -0,0 +1,90 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_cli_CommandWaitTeardowns_hpp
+#define sarus_cli_CommandWaitTeardowns_hpp
+
+#include <memory>
+
+#include "common/Config.hpp"
+#include "common/CLIArguments.hpp"
+#include "cli/Command.hpp"
+#include "cli/Utility.hpp"
+#include "cli/HelpMessage.hpp"
+#include "runtime/TeardownRecord.hpp"
+
+
+namespace sarus {
+namespace cli {
+
+class CommandWaitTeardowns : public Command {
+public:
+    CommandWaitTeardowns() = default;
+
+    CommandWaitTeardowns(const common::CLIArguments& args, std::shared_ptr<common::Config> config)
+        : conf{std::move(config)}
+    {
+        parseCommandArguments(args);
+    }
+
+    void execute() override {
+        runtime::TeardownRecord::waitForTeardowns(runtime::TeardownRecord::getRecordsDirectory(*conf),
+                                                  conf->json["runcPath"].GetString());
+        cli::utility::printLog("Successfully waited for the teardowns of the exited containers", common::LogLevel::INFO);
+    }
+
+    bool requiresRootPrivileges() const override {
+        return true;
+    }
+
+    std::string getBriefDescription() const override {
+        return "Wait for the teardowns of the exited containers to complete";
+    }
+
+    void printHelpMessage() const override {
+        auto printer = cli::HelpMessage()
+            .setUsage("sarus wait-teardowns")
+            .setDescription("After a container exits, 'sarus run' returns its exit status and releases"
+                            " the container's resources (e.g. mounts, loop device, writable layer) in the"
+                            " background. This command waits for the releases of the containers which"
+                            " already exited and completes those interrupted, e.g. by the workload manager");
+        std::cout << printer;
+    }
+
+private:
+    void parseCommandArguments(const common::CLIArguments& args) {
+        cli::utility::printLog(boost::format("parsing CLI arguments of wait-teardowns command"), common::LogLevel::DEBUG);
+
+        auto optionsDescription = boost::program_options::options_description();
+        common::CLIArguments nameAndOptionArgs, positionalArgs;
+        std::tie(nameAndOptionArgs, positionalArgs) = cli::utility::groupOptionsAndPositionalArguments(args, optionsDescription);
+
+        // the wait-teardowns command doesn't support positional arguments
+        cli::utility::validateNumberOfPositionalArguments(positionalArgs, 0, 0, "wait-teardowns");
+
+        // the wait-teardowns command doesn't support options
+        if(nameAndOptionArgs.argc() > 1) {
+            auto message = boost::format("Command 'wait-teardowns' doesn't support options"
+                                         "\nSee 'sarus help wait-teardowns'");
+            utility::printLog(message, common::LogLevel::GENERAL, std::cerr);
+            SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+        }
+
+        cli::utility::printLog(boost::format("successfully parsed CLI arguments"), common::LogLevel::DEBUG);
+    }
+
+private:
+    std::shared_ptr<common::Config> conf;
+};
+
+}
+}
+
+#endif
@@ -140,6 +140,32 @@ common::ImageReference parseImageReference(const std::string &input) {
     return imageReference;
 }
 
+/**
+ * Parse a duration made of a positive integer and a unit of time,
+ * i.e. "s" (seconds), "m" (minutes), "h" (hours) or "d" (days), e.g. "30d"
+ */
+std::chrono::seconds parseDuration(const std::string& input) {
+    boost::smatch matches;
+    if(!boost::regex_match(input, matches, boost::regex{"([0-9]{1,9})([smhd])"})) {
+        auto message = boost::format("Invalid duration '%s'. Expected an integer followed by a unit of time"
+                                     " among 's' (seconds), 'm' (minutes), 'h' (hours) and 'd' (days), e.g. '30d'") % input;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto value = std::stoll(matches[1].str());
+    auto unit = matches[2].str();
+    if(unit == "m") {
+        return std::chrono::minutes{value};
+    }
+    else if(unit == "h") {
+        return std::chrono::hours{value};
+    }
+    else if(unit == "d") {
+        return std::chrono::hours{24 * value};
+    }
+    return std::chrono::seconds{value};
+}
+
 static bool hasDashPrefix(const char* s) {
     bool result = strlen(s) > 1 && s[0]=='-' && s[1]!='-';
     return result;
@@ -11,6 +11,7 @@
 #ifndef cli_Utility_hpp
 #define cli_Utility_hpp
 
+#include <chrono>
 #include <string>
 
 #include <boost/filesystem.hpp>
@@ -32,6 +33,8 @@ common::ImageReference parseImageReference(const common::CLIArguments& imageArgs
 
 common::ImageReference parseImageReference(const std::string& input);
 
+std::chrono::seconds parseDuration(const std::string& input);
+
 std::tuple<common::CLIArguments, common::CLIArguments> groupOptionsAndPositionalArguments(
         const common::CLIArguments&,
         const boost::program_options::options_description& optionsDescription);
@@ -0,0 +1,80 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+/**
+ * Measures the startup of the CLI, i.e. the time from the creation of the configuration
+ * to a command object ready to be executed, for commands which scripts typically invoke
+ * in loops. The set up of the configuration before dispatching (as done for every command
+ * by earlier versions) is compared with the set up driven by the command, see
+ * cli::Command::requiresConfiguration. The security checks are left out of the set up,
+ * since they require a root-owned installation: the savings in production are larger.
+ */
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "common/CLIArguments.hpp"
+#include "common/Config.hpp"
+#include "common/Utility.hpp"
+#include "cli/CLI.hpp"
+#include "test_utility/Benchmark.hpp"
+#include "test_utility/config.hpp"
+
+using namespace sarus;
+
+int main(int argc, char* argv[]) {
+    auto configRAII = test_utility::config::makeConfig();
+    auto prefixDir = boost::filesystem::path{configRAII.config->json["prefixDir"].GetString()};
+    auto configFile = prefixDir / "etc/sarus.json";
+    auto configSchemaFile = prefixDir / "etc/sarus.schema.json";
+    common::writeJSON(configRAII.config->json, configFile);
+
+    auto initializeConfig = [&configFile, &configSchemaFile](const std::shared_ptr<common::Config>& config) {
+        config->json = common::readAndValidateJSON(configFile, configSchemaFile);
+        config->commandRun.hostEnvironment = common::parseEnvironmentVariables(environ);
+    };
+
+    struct Case {
+        std::string name;
+        common::CLIArguments args;
+    };
+    auto cases = std::vector<Case>{
+        {"version", {"sarus", "version"}},
+        {"--version", {"sarus", "--version"}},
+        {"help", {"sarus", "help"}},
+        {"help run", {"sarus", "help", "run"}},
+        {"images", {"sarus", "images"}},
+        {"rmi", {"sarus", "rmi", "alpine"}},
+        {"run", {"sarus", "run", "--mount=type=bind,src=/tmp,dst=/tmp", "alpine", "true"}}
+    };
+
+    test_utility::benchmark::printHeader();
+    for(const auto& c : cases) {
+        auto eager = test_utility::benchmark::run(c.name + " (configuration before dispatch)", 500, [&]() {
+            auto config = std::make_shared<common::Config>();
+            initializeConfig(config);
+            cli::CLI{}.parseCommandLine(c.args, config);
+        });
+        auto onDemand = test_utility::benchmark::run(c.name + " (configuration on demand)", 500, [&]() {
+            auto config = std::make_shared<common::Config>();
+            cli::CLI{initializeConfig}.parseCommandLine(c.args, config);
+        });
+        test_utility::benchmark::print(eager);
+        test_utility::benchmark::print(onDemand);
+    }
+
+    return 0;
+}
@@ -23,11 +23,15 @@
 #include "cli/CommandHelpOfCommand.hpp"
 #include "cli/CommandImages.hpp"
 #include "cli/CommandLoad.hpp"
+#include "cli/CommandMigrate.hpp"
+#include "cli/CommandPrune.hpp"
 #include "cli/CommandPull.hpp"
 #include "cli/CommandRmi.hpp"
 #include "cli/CommandRun.hpp"
+#include "cli/CommandSession.hpp"
 #include "cli/CommandSshKeygen.hpp"
 #include "cli/CommandVersion.hpp"
+#include "cli/CommandWaitTeardowns.hpp"
 #include "runtime/Mount.hpp"
 #include "test_utility/config.hpp"
 #include "test_utility/filesystem.hpp"
@@ -81,6 +85,12 @@ TEST(CLITestGroup, CommandTypes) {
     command = generateCommandFromCLIArguments({"sarus", "load", "archive.tar", "image"});
     checkCommandDynamicType<cli::CommandLoad>(*command);
 
+    command = generateCommandFromCLIArguments({"sarus", "migrate", "--tier", "default", "image"});
+    checkCommandDynamicType<cli::CommandMigrate>(*command);
+
+    command = generateCommandFromCLIArguments({"sarus", "prune"});
+    checkCommandDynamicType<cli::CommandPrune>(*command);
+
     command = generateCommandFromCLIArguments({"sarus", "pull", "image"});
     checkCommandDynamicType<cli::CommandPull>(*command);
 
@@ -90,6 +100,9 @@ TEST(CLITestGroup, CommandTypes) {
     command = generateCommandFromCLIArguments({"sarus", "run", "image"});
     checkCommandDynamicType<cli::CommandRun>(*command);
 
+    command = generateCommandFromCLIArguments({"sarus", "session", "stop", "session-id"});
+    checkCommandDynamicType<cli::CommandSession>(*command);
+
     command = generateCommandFromCLIArguments({"sarus", "ssh-keygen"});
     checkCommandDynamicType<cli::CommandSshKeygen>(*command);
 
@@ -98,6 +111,9 @@ TEST(CLITestGroup, CommandTypes) {
 
     command = generateCommandFromCLIArguments({"sarus", "--version"});
     checkCommandDynamicType<cli::CommandVersion>(*command);
+
+    command = generateCommandFromCLIArguments({"sarus", "wait-teardowns"});
+    checkCommandDynamicType<cli::CommandWaitTeardowns>(*command);
 }
 
 TEST(CLITestGroup, UnrecognizedGlobalOptions) {
@@ -105,6 +121,30 @@ TEST(CLITestGroup, UnrecognizedGlobalOptions) {
     CHECK_THROWS(common::Error, generateCommandFromCLIArguments({"sarus", "---run"}));
 }
 
+TEST(CLITestGroup, ConfigurationOnDemand) {
+    auto configRAII = test_utility::config::makeConfig();
+    auto numberOfInitializations = 0;
+    auto cli = cli::CLI{[&numberOfInitializations](const std::shared_ptr<common::Config>&) {
+        ++numberOfInitializations;
+    }};
+
+    // commands which don't need the configuration
+    cli.parseCommandLine({"sarus"}, configRAII.config);
+    cli.parseCommandLine({"sarus", "--version"}, configRAII.config);
+    cli.parseCommandLine({"sarus", "version"}, configRAII.config);
+    cli.parseCommandLine({"sarus", "help"}, configRAII.config);
+    cli.parseCommandLine({"sarus", "help", "run"}, configRAII.config);
+    CHECK_EQUAL(numberOfInitializations, 0);
+    CHECK_THROWS(common::Error, cli.parseCommandLine({"sarus", "invalid-command"}, configRAII.config));
+    CHECK_EQUAL(numberOfInitializations, 0);
+
+    // commands which need the configuration
+    cli.parseCommandLine({"sarus", "images"}, configRAII.config);
+    CHECK_EQUAL(numberOfInitializations, 1);
+    cli.parseCommandLine({"sarus", "run", "image"}, configRAII.config);
+    CHECK_EQUAL(numberOfInitializations, 2);
+}
+
 std::shared_ptr<common::Config> generateConfig(const common::CLIArguments& args) {
     auto commandName = args.argv()[0];
     auto configRAII = test_utility::config::makeConfig();
@@ -143,6 +183,13 @@ TEST(CLITestGroup, generated_config_for_CommandLoad) {
         CHECK_EQUAL(conf->imageReference.image, std::string{"image"});
         CHECK_EQUAL(conf->imageReference.tag, std::string{"tag"});
     }
+    // archive from standard input
+    {
+        auto conf = generateConfig({"load", "-", "library/image:tag"});
+        CHECK_EQUAL(conf->archivePath.string(), std::string{"/dev/stdin"});
+        CHECK_EQUAL(conf->imageReference.server, std::string{"load"});
+        CHECK_EQUAL(conf->imageReference.image, std::string{"image"});
+    }
 }
 
 TEST(CLITestGroup, generated_config_for_CommandPull) {
@@ -190,6 +237,14 @@ TEST(CLITestGroup, generated_config_for_CommandPull) {
         CHECK(conf->imageReference.image == "image");
         CHECK(conf->imageReference.tag == "tag");
     }
+    // tier
+    {
+        auto conf = generateConfig({"pull", "ubuntu"});
+        CHECK(conf->imageTier.empty());
+
+        conf = generateConfig({"pull", "--tier", "flash", "ubuntu"});
+        CHECK(conf->imageTier == "flash");
+    }
     // username
     {
         auto conf = generateConfig({"pull", "--username", "alice", "ubuntu"});
@@ -221,6 +276,56 @@ TEST(CLITestGroup, generated_config_for_CommandRmi) {
         CHECK_EQUAL(conf->imageReference.image, std::string{"ubuntu"});
         CHECK_EQUAL(conf->imageReference.tag, std::string{"latest"});
     }
+    // multiple images
+    {
+        auto conf = generateConfig({"rmi", "ubuntu", "quay.io/ethcscs/alpine:3.14"});
+        CHECK_EQUAL(conf->imageReferences.size(), std::size_t{2});
+        CHECK_EQUAL(conf->imageReferences[0].image, std::string{"ubuntu"});
+        CHECK_EQUAL(conf->imageReferences[1].server, std::string{"quay.io"});
+        CHECK_EQUAL(conf->imageReferences[1].repositoryNamespace, std::string{"ethcscs"});
+        CHECK_EQUAL(conf->imageReferences[1].image, std::string{"alpine"});
+        CHECK_EQUAL(conf->imageReferences[1].tag, std::string{"3.14"});
+    }
+    // no images
+    CHECK_THROWS(common::Error, generateConfig({"rmi"}));
+}
+
+TEST(CLITestGroup, generated_config_for_CommandPrune) {
+    // defaults
+    {
+        auto conf = generateConfig({"prune"});
+        CHECK_EQUAL(conf->useCentralizedRepository, false);
+        CHECK(!conf->commandPrune.olderThan);
+        CHECK(!conf->commandPrune.unusedFor);
+        CHECK(!conf->commandPrune.referencePattern);
+    }
+    // criteria
+    {
+        auto conf = generateConfig({"prune", "--older-than", "30d", "--unused-for=12h",
+                                    "--reference", "docker.io/library/*", "--centralized-repository"});
+        CHECK_EQUAL(conf->useCentralizedRepository, true);
+        CHECK(*conf->commandPrune.olderThan == std::chrono::hours{30*24});
+        CHECK(*conf->commandPrune.unusedFor == std::chrono::hours{12});
+        CHECK_EQUAL(*conf->commandPrune.referencePattern, std::string{"docker.io/library/*"});
+    }
+    // invalid duration
+    CHECK_THROWS(common::Error, generateConfig({"prune", "--older-than", "30"}));
+    // positional arguments
+    CHECK_THROWS(common::Error, generateConfig({"prune", "ubuntu"}));
+}
+
+TEST(CLITestGroup, generated_config_for_CommandMigrate) {
+    {
+        auto conf = generateConfig({"migrate", "--tier", "flash", "ubuntu"});
+        CHECK_EQUAL(conf->imageTier, std::string{"flash"});
+        CHECK_EQUAL(conf->useCentralizedRepository, false);
+        CHECK_EQUAL(conf->imageReference.server, std::string{"docker.io"});
+        CHECK_EQUAL(conf->imageReference.repositoryNamespace, std::string{"library"});
+        CHECK_EQUAL(conf->imageReference.image, std::string{"ubuntu"});
+        CHECK_EQUAL(conf->imageReference.tag, std::string{"latest"});
+    }
+    // the tier is mandatory
+    CHECK_THROWS(common::Error, generateConfig({"migrate", "ubuntu"}));
 }
 
 TEST(CLITestGroup, generated_config_for_CommandRun) {
@@ -240,6 +345,7 @@ TEST(CLITestGroup, generated_config_for_CommandRun) {
         CHECK_EQUAL(conf->commandRun.enableGlibcReplacement, 0);
         CHECK_EQUAL(conf->commandRun.enableSSH, false);
         CHECK_EQUAL(conf->commandRun.allocatePseudoTTY, false);
+        CHECK_EQUAL(conf->commandRun.readOnlyRootfs, false);
         CHECK(conf->commandRun.execArgs.argc() == 0);
     }
     // centralized repository
@@ -312,6 +418,17 @@ TEST(CLITestGroup, generated_config_for_CommandRun) {
         conf = generateConfig({"run", "--pid", "private", "image"});
         CHECK_EQUAL(conf->commandRun.createNewPIDNamespace, true);
     }
+    // read-only
+    {
+        auto conf = generateConfig({"run", "--read-only", "image"});
+        CHECK_EQUAL(conf->commandRun.readOnlyRootfs, true);
+
+        conf = generateConfig({"run", "--read-write", "image"});
+        CHECK_EQUAL(conf->commandRun.readOnlyRootfs, false);
+
+        CHECK_THROWS(common::Error, generateConfig({"run", "--read-only", "--read-write", "image"}));
+        CHECK_THROWS(common::Error, generateConfig({"run", "--read-only", "--mpi", "image"}));
+    }
     // ssh
     {
         auto conf = generateConfig({"run", "--ssh", "image"});
@@ -504,4 +621,24 @@ IGNORE_TEST(CLITestGroup, device_mounts_for_CommandRun) {
     }
 }
 
+TEST(CLITestGroup, generated_config_for_CommandSession) {
+    // start
+    {
+        auto conf = generateConfig({"session", "start", "--workdir=/workdir", "image"});
+        CHECK(conf->commandRun.startSession);
+        CHECK(conf->commandRun.addInitProcess);
+        CHECK_EQUAL(conf->commandRun.workdir->string(), std::string{"/workdir"});
+        CHECK_EQUAL(conf->imageReference.image, std::string{"image"});
+        CHECK(*conf->commandRun.entrypoint == common::CLIArguments{});
+        CHECK(conf->commandRun.execArgs == common::CLIArguments{"/dev/init"});
+    }
+    // start doesn't accept a command
+    CHECK_THROWS(common::Error, generateConfig({"session", "start", "image", "command"}));
+    // missing subcommand or arguments
+    CHECK_THROWS(common::Error, generateConfig({"session"}));
+    CHECK_THROWS(common::Error, generateConfig({"session", "exec", "session-id"}));
+    CHECK_THROWS(common::Error, generateConfig({"session", "stop"}));
+    CHECK_THROWS(common::Error, generateConfig({"session", "kill", "session-id"}));
+}
+
 SARUS_UNITTEST_MAIN_FUNCTION();
@@ -103,6 +103,21 @@ std::tuple<common::CLIArguments, common::CLIArguments> generateGroupedArguments(
     return cli::utility::groupOptionsAndPositionalArguments(args, optionsDescription);
 }
 
+TEST(CLIUtilityTestGroup, parseDuration) {
+    CHECK(cli::utility::parseDuration("3600s") == std::chrono::seconds{3600});
+    CHECK(cli::utility::parseDuration("90m") == std::chrono::minutes{90});
+    CHECK(cli::utility::parseDuration("12h") == std::chrono::hours{12});
+    CHECK(cli::utility::parseDuration("30d") == std::chrono::hours{30*24});
+    CHECK(cli::utility::parseDuration("0d") == std::chrono::seconds{0});
+
+    CHECK_THROWS(common::Error, cli::utility::parseDuration(""));
+    CHECK_THROWS(common::Error, cli::utility::parseDuration("30"));
+    CHECK_THROWS(common::Error, cli::utility::parseDuration("d"));
+    CHECK_THROWS(common::Error, cli::utility::parseDuration("-1d"));
+    CHECK_THROWS(common::Error, cli::utility::parseDuration("1w"));
+    CHECK_THROWS(common::Error, cli::utility::parseDuration("1d 2h"));
+}
+
 TEST(CLIUtilityTestGroup, groupOptionsAndPositionalArguments) {
     // one argument
     {
@@ -0,0 +1,65 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "common/AbiVersion.hpp"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace sarus {
+namespace common {
+
+constexpr std::size_t AbiVersion::capacity;
+
+AbiVersion AbiVersion::parse(const std::string& version) {
+    auto abi = AbiVersion{};
+    auto it = version.cbegin();
+    while(it != version.cend() && abi.numberOfComponents < capacity) {
+        if(*it < '0' || *it > '9') {
+            break;
+        }
+        auto value = std::uint64_t{0};
+        for(; it != version.cend() && *it >= '0' && *it <= '9'; ++it) {
+            value = std::min<std::uint64_t>(value * 10 + (*it - '0'), std::numeric_limits<Component>::max());
+        }
+        abi.components[abi.numberOfComponents++] = static_cast<Component>(value);
+
+        // skip the non-numeric suffix of the component, e.g. "rc1" in "3rc1"
+        while(it != version.cend() && *it != '.') {
+            ++it;
+        }
+        if(it != version.cend()) {
+            ++it;
+        }
+    }
+    return abi;
+}
+
+bool AbiVersion::append(Component component) {
+    if(numberOfComponents == capacity) {
+        return false;
+    }
+    components[numberOfComponents++] = component;
+    return true;
+}
+
+std::string AbiVersion::toString() const {
+    auto s = std::string{};
+    for(std::size_t i = 0; i < numberOfComponents; ++i) {
+        if(i > 0) {
+            s += ".";
+        }
+        s += std::to_string(components[i]);
+    }
+    return s;
+}
+
+}}
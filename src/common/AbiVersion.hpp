@@ -0,0 +1,114 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_AbiVersion_hpp
+#define sarus_common_AbiVersion_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "common/AbiCompatibility.hpp"
+
+
+namespace sarus {
+namespace common {
+
+/**
+ * The ABI version of a shared library, i.e. the numbers following ".so" in the library's
+ * filename (e.g. 12.5.5 for libmpi.so.12.5.5), stored as a fixed-capacity array of numbers.
+ *
+ * The version is a value type which doesn't allocate, thus libraries can be compared in
+ * bulk (e.g. all the libraries of a container against the host's MPI libraries) cheaply.
+ * The comparisons are constexpr, so that they can be checked at compile time.
+ */
+class AbiVersion {
+public:
+    using Component = std::uint32_t;
+    static constexpr std::size_t capacity = 6;
+
+public:
+    /**
+     * Parses a dot-separated version, e.g. "12.5.5". The value of each component is given by its
+     * leading digits (e.g. "3rc1" is 3). The parsing stops at the first component without leading
+     * digits and the components beyond the capacity are ignored.
+     */
+    static AbiVersion parse(const std::string& version);
+
+public:
+    constexpr AbiVersion()
+        : components{0, 0, 0, 0, 0, 0}, numberOfComponents{0}
+    {}
+    constexpr explicit AbiVersion(Component major)
+        : components{major, 0, 0, 0, 0, 0}, numberOfComponents{1}
+    {}
+    constexpr AbiVersion(Component major, Component minor)
+        : components{major, minor, 0, 0, 0, 0}, numberOfComponents{2}
+    {}
+    constexpr AbiVersion(Component major, Component minor, Component patch)
+        : components{major, minor, patch, 0, 0, 0}, numberOfComponents{3}
+    {}
+
+    constexpr std::size_t size() const { return numberOfComponents; }
+    constexpr bool empty() const { return numberOfComponents == 0; }
+    // missing components are zero, e.g. the minor of libfoo.so.1
+    constexpr Component operator[](std::size_t i) const { return i < numberOfComponents ? components[i] : 0; }
+    constexpr Component getMajor() const { return (*this)[0]; }
+    constexpr Component getMinor() const { return (*this)[1]; }
+    constexpr Component getPatch() const { return (*this)[2]; }
+
+    // returns false if the version is already at capacity
+    bool append(Component component);
+    std::string toString() const;
+
+    constexpr bool isPrefixOf(const AbiVersion& other) const {
+        return numberOfComponents <= other.numberOfComponents
+            && haveEqualComponents(*this, other, 0, numberOfComponents);
+    }
+
+    // lexicographic comparison, a version is smaller than the versions it is a proper prefix of
+    constexpr int compare(const AbiVersion& other) const {
+        return compareFrom(*this, other, 0);
+    }
+
+private:
+    static constexpr bool haveEqualComponents(const AbiVersion& lhs, const AbiVersion& rhs,
+                                              std::size_t i, std::size_t end) {
+        return i >= end || (lhs.components[i] == rhs.components[i] && haveEqualComponents(lhs, rhs, i+1, end));
+    }
+    static constexpr int compareFrom(const AbiVersion& lhs, const AbiVersion& rhs, std::size_t i) {
+        return (i >= lhs.numberOfComponents || i >= rhs.numberOfComponents)
+            ? (lhs.numberOfComponents < rhs.numberOfComponents ? -1 : lhs.numberOfComponents > rhs.numberOfComponents ? 1 : 0)
+            : (lhs.components[i] < rhs.components[i] ? -1 : lhs.components[i] > rhs.components[i] ? 1
+                : compareFrom(lhs, rhs, i+1));
+    }
+
+private:
+    Component components[capacity];
+    std::size_t numberOfComponents;
+};
+
+constexpr bool operator==(const AbiVersion& lhs, const AbiVersion& rhs) { return lhs.compare(rhs) == 0; }
+constexpr bool operator!=(const AbiVersion& lhs, const AbiVersion& rhs) { return lhs.compare(rhs) != 0; }
+constexpr bool operator<(const AbiVersion& lhs, const AbiVersion& rhs) { return lhs.compare(rhs) < 0; }
+
+/**
+ * Whether a library with ABI version "provided" can replace a library with ABI version "required",
+ * i.e. the major versions are equal and the provided minor version is not older than the required one
+ */
+constexpr AbiCompatibility getAbiCompatibility(const AbiVersion& provided, const AbiVersion& required) {
+    return provided.getMajor() != required.getMajor() ? AbiCompatibility::MAJOR_NOT_COMPATIBLE
+        : provided.getMinor() < required.getMinor() ? AbiCompatibility::MINOR_NOT_COMPATIBLE
+        : AbiCompatibility::COMPATIBLE;
+}
+
+}}
+
+#endif
@@ -29,26 +29,26 @@ Config::Config(const boost::filesystem::path& configFilename,
     : json{ common::readAndValidateJSON(configFilename, configSchemaFilename) }
 {}
 
-void Config::Directories::initialize(bool useCentralizedRepository, const common::Config& config) {
+void Config::Directories::initialize(bool useCentralizedRepository, const common::Config& config, bool createDirectories) {
     if (useCentralizedRepository) {
         common::logMessage( boost::format("initializing CLI config's directories for centralized repository"),
                             common::LogLevel::DEBUG);
         repository = common::getCentralizedRepositoryDirectory(config);
-        images = repository / "images";
-        common::createFoldersIfNecessary(images,config.userIdentity.uid, config.userIdentity.gid);
     }
     else {
         common::logMessage( boost::format("initializing CLI config's directories for local repository"),
                             common::LogLevel::DEBUG);
         repository = common::getLocalRepositoryDirectory(config);
-        images = repository / "images";
-        common::createFoldersIfNecessary(images, config.userIdentity.uid, config.userIdentity.gid);
     }
-
+    images = repository / "images";
     cache = repository / "cache";
-    common::createFoldersIfNecessary(cache, config.userIdentity.uid, config.userIdentity.gid);
-    common::createFoldersIfNecessary(cache / "ociImages", config.userIdentity.uid, config.userIdentity.gid);
-    common::createFoldersIfNecessary(cache / "blobs", config.userIdentity.uid, config.userIdentity.gid);
+
+    if (createDirectories) {
+        common::createFoldersIfNecessary(images, config.userIdentity.uid, config.userIdentity.gid);
+        common::createFoldersIfNecessary(cache, config.userIdentity.uid, config.userIdentity.gid);
+        common::createFoldersIfNecessary(cache / "ociImages", config.userIdentity.uid, config.userIdentity.gid);
+        common::createFoldersIfNecessary(cache / "blobs", config.userIdentity.uid, config.userIdentity.gid);
+    }
 
     bool tempDirWasSpecifiedThroughCLI = !tempFromCLI.empty();
     if(tempDirWasSpecifiedThroughCLI) {
@@ -65,12 +65,18 @@ void Config::Directories::initialize(bool useCentralizedRepository, const common
 }
 
 boost::filesystem::path Config::getImageFile() const {
+    if(commandRun.imageFile) {
+        return *commandRun.imageFile;
+    }
     auto key = imageReference.getUniqueKey();
     auto file = boost::filesystem::path(directories.images.string() + "/" + key + ".squashfs");
     return file;
 }
 
 boost::filesystem::path Config::getMetadataFileOfImage() const {
+    if(commandRun.imageMetadataFile) {
+        return *commandRun.imageMetadataFile;
+    }
     auto key = imageReference.getUniqueKey();
     auto file = boost::filesystem::path(directories.images.string() + "/" + key + ".meta");
     return file;
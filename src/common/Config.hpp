@@ -47,7 +47,8 @@ class Config {
         };
 
         struct Directories {
-            void initialize(bool useCentralizedRepository, const common::Config& config);
+            // without createDirectories the directories are only computed, e.g. for the read-only launch path of "sarus run"
+            void initialize(bool useCentralizedRepository, const common::Config& config, bool createDirectories = true);
             boost::filesystem::path repository;
             boost::filesystem::path cache;
             boost::filesystem::path temp;
@@ -66,11 +67,15 @@ class Config {
             std::unordered_map<std::string, std::string> userEnvironment;
             std::unordered_map<std::string, std::string> bundleAnnotations;
             std::vector<int> cpuAffinity;
+            std::vector<int> memoryNodes; // NUMA nodes for memory placement (empty = no restriction)
             std::vector<std::string> userMounts;
             std::vector<std::shared_ptr<runtime::Mount>> mounts;
             std::vector<std::shared_ptr<runtime::DeviceMount>> deviceMounts;
             boost::optional<boost::filesystem::path> workdir;
             boost::optional<CLIArguments> entrypoint;
+            boost::optional<boost::filesystem::path> imageFile; // e.g. image stored in a tier or node-local staged copy
+            boost::optional<boost::filesystem::path> imageMetadataFile;
+            std::vector<boost::filesystem::path> lowerImageFiles; // images stacked below imageFile, topmost first
             CLIArguments execArgs;
             bool createNewPIDNamespace = false;
             bool allocatePseudoTTY = false;
@@ -78,6 +83,14 @@ class Config {
             bool useMPI = false;
             bool enableGlibcReplacement = false;
             bool enableSSH = false;
+            bool startSession = false; // "sarus session start": create the container and keep it alive
+            bool readOnlyRootfs = false; // mount the image as rootfs without the overlay and its writable layer
+        };
+
+        struct CommandPrune {
+            boost::optional<std::chrono::seconds> olderThan;
+            boost::optional<std::chrono::seconds> unusedFor;
+            boost::optional<std::string> referencePattern;
         };
 
         boost::filesystem::path getImageFile() const;
@@ -90,8 +103,11 @@ class Config {
         UserIdentity userIdentity;
         Authentication authentication;
         CommandRun commandRun;
+        CommandPrune commandPrune;
 
+        std::vector<common::ImageReference> imageReferences; // for CommandRmi
         boost::filesystem::path archivePath; // for CommandLoad
+        std::string imageTier; // for CommandPull and CommandLoad
 
         bool useCentralizedRepository = false;
 
@@ -0,0 +1,19 @@
+// THIS FILE IS GENERATED AUTOMATICALLY AT BUILD TIME
+
+#include "common/Config.hpp"
+
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace common {
+
+Config::BuildTime::BuildTime()
+    : version{"9df2e93-dirty"}
+    // path the the dropbearmulti binary in the CMake's build directory
+    // (only needed for tests porpuses)
+    , dropbearmultiBuildArtifact{boost::filesystem::absolute("/tmp/cfg/dep/dropbearmulti")}
+{}
+
+}
+}
@@ -0,0 +1,376 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "FileStore.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <boost/format.hpp>
+
+#include "common/Error.hpp"
+#include "common/Sha256.hpp"
+#include "common/TreeRemoval.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace common {
+
+constexpr const char* FileStore::directoryInImage;
+constexpr const char* FileStore::viewsDirectory;
+
+boost::filesystem::path FileStore::getDirectory(const boost::filesystem::path& repositoryDir) {
+    return repositoryDir / "store";
+}
+
+FileStore::FileStore(const boost::filesystem::path& directory, std::uintmax_t minFileSize)
+    : directory{directory}
+    , minFileSize{minFileSize}
+{}
+
+boost::filesystem::path FileStore::getObjectFile(const std::string& objectName) const {
+    return directory / objectName;
+}
+
+// the view names come from the image metadata, which may be written by the user
+boost::filesystem::path FileStore::getViewDirectory(const std::string& viewName) const {
+    if(viewName.empty() || viewName == "." || viewName == ".." || viewName.find('/') != std::string::npos) {
+        auto message = boost::format("Invalid name '%s' of view of the file store %s") % viewName % directory;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return directory / viewsDirectory / viewName;
+}
+
+/**
+ * Checks that the view is a directory of the store itself, and not a symlink (or a symlinked
+ * "views" directory) leading somewhere else, before it gets mounted into a container.
+ */
+void FileStore::checkViewDirectory(const std::string& viewName) const {
+    auto viewDir = getViewDirectory(viewName);
+    auto fd = open(viewDir.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(fd < 0) {
+        auto message = boost::format("Failed to open view %s of the file store as a directory: %s")
+                       % viewDir % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    close(fd);
+
+    auto realViewDir = boost::filesystem::canonical(viewDir);
+    if(realViewDir != boost::filesystem::canonical(directory) / viewsDirectory / viewName) {
+        auto message = boost::format("View %s resolves to %s, outside of the file store %s")
+                       % viewDir % realViewDir % directory;
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+// the directories which can't be read are skipped, their files are just not deduplicated
+static void findLargeRegularFiles(const boost::filesystem::path& dir,
+                                  std::uintmax_t minFileSize,
+                                  std::vector<std::pair<boost::filesystem::path, struct stat>>& files) {
+    auto ec = boost::system::error_code{};
+    for(auto entry = boost::filesystem::directory_iterator{dir, ec};
+        !ec && entry != boost::filesystem::directory_iterator{};
+        entry.increment(ec)) {
+        struct stat sb;
+        if(lstat(entry->path().c_str(), &sb) != 0) {
+            continue;
+        }
+        if(S_ISDIR(sb.st_mode)) {
+            findLargeRegularFiles(entry->path(), minFileSize, files);
+        }
+        // setuid, setgid and sticky files are left in the image, where their mode is preserved
+        else if(S_ISREG(sb.st_mode)
+                && static_cast<std::uintmax_t>(sb.st_size) >= minFileSize
+                && (sb.st_mode & (S_ISUID | S_ISGID | S_ISVTX)) == 0) {
+            files.emplace_back(entry->path(), sb);
+        }
+    }
+}
+
+std::vector<std::string> FileStore::deduplicate(const boost::filesystem::path& rootfsDir,
+                                                const std::string& viewName,
+                                                const boost::optional<std::string>& baseViewName) {
+    auto viewDir = getViewDirectory(viewName);
+    logMessage(boost::format("Deduplicating files of %s into store %s (view %s)") % rootfsDir % directory % viewName,
+               LogLevel::INFO);
+
+    createFoldersIfNecessary(viewDir);
+    auto baseViewDir = boost::optional<boost::filesystem::path>{};
+    if(baseViewName) {
+        baseViewDir = getViewDirectory(*baseViewName);
+        linkBaseView(*baseViewDir, viewDir);
+    }
+
+    auto files = std::vector<std::pair<boost::filesystem::path, struct stat>>{};
+    findLargeRegularFiles(rootfsDir, minFileSize, files);
+
+    auto objects = std::set<std::string>{};
+    for(const auto& file : files) {
+        const auto& path = file.first;
+        const auto& sb = file.second;
+        if(access(path.parent_path().c_str(), W_OK) != 0) {
+            continue;
+        }
+
+        auto objectName = std::string{};
+        try {
+            objectName = addObject(path, sb);
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Not deduplicating %s: %s") % path % e.what();
+            logMessage(message, LogLevel::INFO);
+            continue;
+        }
+
+        try {
+            boost::filesystem::remove(path);
+            createPlaceholder(path, sb);
+            linkIntoView(getObjectFile(objectName), viewDir / path.lexically_relative(rootfsDir));
+            objects.insert(objectName);
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to replace %s with object %s of the store") % path % objectName;
+            SARUS_RETHROW_ERROR(e, message.str());
+        }
+        ++statistics.numberOfFiles;
+    }
+
+    copyAttributesOfViewDirectories(viewDir, rootfsDir, baseViewDir, true);
+
+    logMessage(boost::format("Deduplicated %d files: %d bytes added to the store, %d bytes already in the store")
+               % statistics.numberOfFiles % statistics.storedBytes % statistics.reusedBytes, LogLevel::INFO);
+
+    return std::vector<std::string>(objects.cbegin(), objects.cend());
+}
+
+/**
+ * The object is created under a temporary name and renamed, so that concurrent pulls
+ * adding the same content never see a partially written object
+ */
+std::string FileStore::addObject(const boost::filesystem::path& file, const struct stat& sb) {
+    auto digest = Sha256::digestOfFile(file);
+    auto objectName = (boost::format("%s/%s-%03o") % digest.substr(0, 2) % digest.substr(2) % (sb.st_mode & 0777)).str();
+    auto objectFile = getObjectFile(objectName);
+
+    struct stat objectSb;
+    if(lstat(objectFile.c_str(), &objectSb) == 0) {
+        // protects the object from a concurrent removal of the unreferenced objects,
+        // until the metadata of the image referencing it is written
+        auto isTouched = utime(objectFile.c_str(), nullptr) == 0;
+        if(isTouched || errno != ENOENT) {
+            if(!isTouched) {
+                auto message = boost::format("Failed to update modification time of %s: %s") % objectFile % strerror(errno);
+                logMessage(message, LogLevel::DEBUG);
+            }
+            statistics.reusedBytes += sb.st_size;
+            return objectName;
+        }
+        // the object was removed in the meantime: add it again
+    }
+
+    createFoldersIfNecessary(objectFile.parent_path());
+    auto temporaryFile = makeUniquePathWithRandomSuffix(objectFile);
+
+    // files with other hard links in the image are copied, to leave the mode of the other links untouched
+    auto isMoved = sb.st_nlink == 1 && rename(file.c_str(), temporaryFile.c_str()) == 0;
+    if(!isMoved) {
+        copyFile(file, temporaryFile);
+    }
+
+    // a moved file keeps the modification time it has in the image, which may be older than
+    // the grace period of the removal of the unreferenced objects
+    if(utime(temporaryFile.c_str(), nullptr) != 0
+       || chmod(temporaryFile.c_str(), sb.st_mode & 0555) != 0
+       || rename(temporaryFile.c_str(), objectFile.c_str()) != 0) {
+        auto message = boost::format("Failed to add %s to the store: %s") % objectFile % strerror(errno);
+        if(isMoved) {
+            rename(temporaryFile.c_str(), file.c_str());
+        }
+        else {
+            boost::filesystem::remove(temporaryFile);
+        }
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    statistics.storedBytes += sb.st_size;
+    return objectName;
+}
+
+/**
+ * The placeholder is sparse: mksquashfs stores it without data blocks
+ */
+void FileStore::createPlaceholder(const boost::filesystem::path& file, const struct stat& sb) const {
+    auto fd = open(file.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if(fd == -1) {
+        auto message = boost::format("Failed to create placeholder %s: %s") % file % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto isCreated = ftruncate(fd, sb.st_size) == 0;
+    close(fd);
+    if(!isCreated || chmod(file.c_str(), sb.st_mode & 0777) != 0) {
+        auto message = boost::format("Failed to set size and mode of placeholder %s: %s") % file % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+/**
+ * The object is copied if it can't be linked, e.g. because it reached the maximum number of
+ * hard links of the filesystem
+ */
+void FileStore::linkIntoView(const boost::filesystem::path& objectFile, const boost::filesystem::path& viewFile) const {
+    createFoldersIfNecessary(viewFile.parent_path());
+    if(link(objectFile.c_str(), viewFile.c_str()) == 0) {
+        return;
+    }
+    if(errno != EMLINK) {
+        auto message = boost::format("Failed to link %s into view %s: %s") % objectFile % viewFile % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    copyFile(objectFile, viewFile);
+}
+
+// the view of the image below a delta, whose files are also files of the delta
+void FileStore::linkBaseView(const boost::filesystem::path& baseViewDir, const boost::filesystem::path& viewDir) const {
+    for(const auto& entry : boost::filesystem::directory_iterator{baseViewDir}) {
+        auto target = viewDir / entry.path().filename();
+        struct stat sb;
+        if(lstat(entry.path().c_str(), &sb) != 0) {
+            auto message = boost::format("Failed to stat %s: %s") % entry.path() % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        if(S_ISDIR(sb.st_mode)) {
+            createFoldersIfNecessary(target);
+            linkBaseView(entry.path(), target);
+        }
+        else if(S_ISREG(sb.st_mode)) {
+            linkIntoView(entry.path(), target);
+        }
+    }
+}
+
+/**
+ * The view is the topmost lower layer of the container's rootfs, thus the attributes of its directories
+ * are those seen in the container: they are copied from the same directories of the root filesystem or,
+ * for the directories found only in the base view, from the base view. The top directory gets the current
+ * modification time instead, which keeps the view from being removed as unreferenced while the image is
+ * being pulled or loaded.
+ */
+void FileStore::copyAttributesOfViewDirectories(const boost::filesystem::path& viewDir,
+                                                const boost::filesystem::path& rootfsDir,
+                                                const boost::optional<boost::filesystem::path>& baseViewDir,
+                                                bool isTopDirectory) const {
+    for(const auto& entry : boost::filesystem::directory_iterator{viewDir}) {
+        if(boost::filesystem::is_directory(boost::filesystem::symlink_status(entry.path()))) {
+            auto name = entry.path().filename();
+            auto baseViewSubdir = baseViewDir ? boost::optional<boost::filesystem::path>{*baseViewDir / name} : boost::none;
+            copyAttributesOfViewDirectories(entry.path(), rootfsDir / name, baseViewSubdir, false);
+        }
+    }
+
+    struct stat sb;
+    auto hasSource = (lstat(rootfsDir.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode))
+                     || (baseViewDir && lstat(baseViewDir->c_str(), &sb) == 0 && S_ISDIR(sb.st_mode));
+    if(!hasSource) {
+        return;
+    }
+    if(lchown(viewDir.c_str(), sb.st_uid, sb.st_gid) != 0) {
+        // e.g. an unprivileged user's store, whose directories all belong to the user anyway
+        auto message = boost::format("Not setting owner of %s: %s") % viewDir % strerror(errno);
+        logMessage(message, LogLevel::DEBUG);
+    }
+    struct timespec times[2] = {sb.st_atim, sb.st_mtim};
+    if(chmod(viewDir.c_str(), sb.st_mode & 07777) != 0
+       || utimensat(AT_FDCWD, viewDir.c_str(), isTopDirectory ? nullptr : times, AT_SYMLINK_NOFOLLOW) != 0) {
+        auto message = boost::format("Failed to set mode and times of %s: %s") % viewDir % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+/**
+ * The objects modified after the given time are kept, because they may belong to
+ * pulls or loads still in progress. This also applies to the temporary files
+ * left by the interrupted pulls and loads.
+ */
+std::vector<boost::filesystem::path> FileStore::removeUnreferencedObjects(const std::unordered_set<std::string>& referencedObjects,
+                                                                          time_t modifiedBefore) const {
+    auto removed = std::vector<boost::filesystem::path>{};
+    if(!boost::filesystem::is_directory(directory)) {
+        return removed;
+    }
+
+    for(const auto& prefix : boost::filesystem::directory_iterator{directory}) {
+        if(!boost::filesystem::is_directory(prefix.path()) || prefix.path().filename() == viewsDirectory) {
+            continue;
+        }
+        for(const auto& entry : boost::filesystem::directory_iterator{prefix.path()}) {
+            auto objectName = prefix.path().filename().string() + "/" + entry.path().filename().string();
+            struct stat sb;
+            if(referencedObjects.count(objectName)
+               || lstat(entry.path().c_str(), &sb) != 0
+               || sb.st_mtime >= modifiedBefore) {
+                continue;
+            }
+            auto ec = boost::system::error_code{};
+            boost::filesystem::remove(entry.path(), ec);
+            if(ec) {
+                auto message = boost::format("Failed to remove object %s of the store: %s") % entry.path() % ec.message();
+                logMessage(message, LogLevel::WARN, std::cerr);
+                continue;
+            }
+            removed.push_back(entry.path());
+        }
+    }
+
+    return removed;
+}
+
+/**
+ * As for the objects, the views modified after the given time are kept, because they may belong
+ * to pulls or loads still in progress
+ */
+std::vector<boost::filesystem::path> FileStore::removeUnreferencedViews(const std::unordered_set<std::string>& referencedViews,
+                                                                        time_t modifiedBefore) const {
+    auto removed = std::vector<boost::filesystem::path>{};
+    auto viewsDir = directory / viewsDirectory;
+    if(!boost::filesystem::is_directory(viewsDir)) {
+        return removed;
+    }
+
+    for(const auto& entry : boost::filesystem::directory_iterator{viewsDir}) {
+        struct stat sb;
+        if(referencedViews.count(entry.path().filename().string())
+           || lstat(entry.path().c_str(), &sb) != 0
+           || sb.st_mtime >= modifiedBefore) {
+            continue;
+        }
+        try {
+            removeTree(entry.path());
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to remove view %s of the store: %s") % entry.path() % e.what();
+            logMessage(message, LogLevel::WARN, std::cerr);
+            continue;
+        }
+        removed.push_back(entry.path());
+    }
+
+    return removed;
+}
+
+}
+}
@@ -0,0 +1,111 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_FileStore_hpp
+#define sarus_common_FileStore_hpp
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace common {
+
+/**
+ * Content-addressed store of the large files of the images of a repository, shared by all the
+ * images of the repository, so that a file found in many images (e.g. the same CUDA or MPI
+ * libraries in the images of a software stack) is stored once.
+ *
+ * When an image is pulled or loaded, each large regular file of its unpacked root filesystem
+ * is moved into the store (unless the store already holds the same content with the same
+ * permissions) and replaced by a sparse placeholder with the size and permissions of the file.
+ * Thus the squashfs file of the image only holds the files which are not deduplicated, while
+ * the lookups of the hooks in the image (and the image's file index) still find regular files.
+ *
+ * The deduplicated files of an image are gathered in a view of the store: a directory tree with
+ * the layout of the image's root filesystem, whose files are hard links to the objects. At
+ * container launch, the view is stacked as topmost lower layer of the rootfs' overlay, on top of
+ * the placeholders. The files keep their original paths (e.g. for the $ORIGIN of the RPATH of a
+ * library, or programs which locate their resources relative to their own executable), while
+ * the images share the objects and their pages in the page cache.
+ *
+ * The objects are named after the SHA-256 digest of their content and their permissions,
+ * e.g. "ab/cdef...-755", and are read-only. The objects and the view referenced by an image are
+ * recorded in the image's metadata, which allows to remove the unreferenced ones. Since a view
+ * holds hard links, removing an object from the store never breaks the views linking it.
+ *
+ * The images deduplicated by previous versions of Sarus replaced the files with symlinks to
+ * /.sarus-store/<object>, on which the runtime still mounts the store for those images.
+ */
+class FileStore {
+public:
+    struct Statistics {
+        std::size_t numberOfFiles = 0;
+        std::uintmax_t storedBytes = 0;   // bytes of the objects added to the store
+        std::uintmax_t reusedBytes = 0;   // bytes of the files already in the store
+    };
+
+    // directory of the legacy images (and of their containers' rootfs) on which the store is mounted
+    static constexpr const char* directoryInImage = ".sarus-store";
+    // subdirectory of the store which holds the views of the images
+    static constexpr const char* viewsDirectory = "views";
+
+public:
+    static boost::filesystem::path getDirectory(const boost::filesystem::path& repositoryDir);
+
+    FileStore(const boost::filesystem::path& directory, std::uintmax_t minFileSize);
+
+    /**
+     * Moves the large files of the root filesystem into the store and links them into the view,
+     * which also gets the files of the base view (if any, e.g. the view of the image below a delta).
+     * Returns the names of the objects referenced by the root filesystem.
+     */
+    std::vector<std::string> deduplicate(const boost::filesystem::path& rootfsDir,
+                                         const std::string& viewName,
+                                         const boost::optional<std::string>& baseViewName = {});
+    // returns the removed objects
+    std::vector<boost::filesystem::path> removeUnreferencedObjects(const std::unordered_set<std::string>& referencedObjects,
+                                                                   time_t modifiedBefore) const;
+    // returns the removed views
+    std::vector<boost::filesystem::path> removeUnreferencedViews(const std::unordered_set<std::string>& referencedViews,
+                                                                 time_t modifiedBefore) const;
+    boost::filesystem::path getObjectFile(const std::string& objectName) const;
+    boost::filesystem::path getViewDirectory(const std::string& viewName) const;
+    void checkViewDirectory(const std::string& viewName) const;
+    const Statistics& getStatistics() const { return statistics; }
+
+private:
+    std::string addObject(const boost::filesystem::path& file, const struct stat& sb);
+    void createPlaceholder(const boost::filesystem::path& file, const struct stat& sb) const;
+    void linkIntoView(const boost::filesystem::path& objectFile, const boost::filesystem::path& viewFile) const;
+    void linkBaseView(const boost::filesystem::path& baseViewDir, const boost::filesystem::path& viewDir) const;
+    void copyAttributesOfViewDirectories(const boost::filesystem::path& viewDir,
+                                         const boost::filesystem::path& rootfsDir,
+                                         const boost::optional<boost::filesystem::path>& baseViewDir,
+                                         bool isTopDirectory) const;
+
+private:
+    boost::filesystem::path directory;
+    std::uintmax_t minFileSize;
+    Statistics statistics;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,423 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "ImageFileIndex.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/format.hpp>
+
+#include "common/Error.hpp"
+#include "common/Logger.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace common {
+
+constexpr const char* ImageFileIndex::fileNameInBundle;
+
+namespace {
+
+const char indexMagic[8] = {'S', 'A', 'R', 'U', 'S', 'I', 'D', 'X'};
+const std::uint32_t indexVersion = 1;
+const std::uint32_t emptyBucket = 0xFFFFFFFF;
+const unsigned int maxSymlinkDepth = 40; // same as the kernel's limit for nested symlinks (ELOOP)
+
+// the fields of the squashfs superblock which identify an image file
+struct SquashfsFingerprint {
+    std::uint32_t creationTime;
+    std::uint64_t bytesUsed;
+};
+
+SquashfsFingerprint readSquashfsFingerprint(const boost::filesystem::path& squashfsFile) {
+    // see struct squashfs_super_block in the Linux kernel (fs/squashfs/squashfs_fs.h)
+    const auto squashfsMagic = std::uint32_t{0x73717368};
+    unsigned char superblock[48];
+    std::ifstream is{squashfsFile.string(), std::ios::binary};
+    if(!is.read(reinterpret_cast<char*>(superblock), sizeof(superblock))) {
+        auto message = boost::format("Failed to read squashfs superblock of %s") % squashfsFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto magic = std::uint32_t{};
+    auto fingerprint = SquashfsFingerprint{};
+    std::memcpy(&magic, superblock, sizeof(magic));
+    std::memcpy(&fingerprint.creationTime, superblock + 8, sizeof(fingerprint.creationTime));
+    std::memcpy(&fingerprint.bytesUsed, superblock + 40, sizeof(fingerprint.bytesUsed));
+    if(magic != squashfsMagic) {
+        auto message = boost::format("Failed to read squashfs superblock of %s: not a squashfs file") % squashfsFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return fingerprint;
+}
+
+// FNV-1a
+std::uint64_t hash(const char* data, std::size_t size) {
+    auto value = std::uint64_t{14695981039346656037ULL};
+    for(std::size_t i=0; i<size; ++i) {
+        value ^= static_cast<unsigned char>(data[i]);
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+template<class T>
+void append(std::string& buffer, const T& value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}
+
+struct ImageFileIndex::Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t numberOfEntries;
+    std::uint32_t numberOfBuckets; // power of two
+    std::uint32_t squashfsCreationTime;
+    std::uint64_t squashfsBytesUsed;
+    std::uint64_t stringsSize;
+};
+
+struct ImageFileIndex::RawEntry {
+    std::uint32_t pathOffset;
+    std::uint32_t pathLength;
+    std::uint32_t targetOffset;
+    std::uint32_t targetLength;
+    std::uint32_t mode;
+    std::uint32_t padding;
+    std::uint64_t size;
+};
+
+// read-only memory mapping of the sidecar file, validated on construction
+class ImageFileIndex::MappedFile {
+public:
+    MappedFile(const boost::filesystem::path& file) {
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            auto message = boost::format("Failed to open image file index %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+            close(fd);
+            auto message = boost::format("Failed to open image file index %s: invalid file") % file;
+            SARUS_THROW_ERROR(message.str());
+        }
+        auto* address = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(address == MAP_FAILED) {
+            auto message = boost::format("Failed to mmap image file index %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        data = static_cast<const char*>(address);
+        size = st.st_size;
+
+        if(!isValid()) {
+            munmap(const_cast<char*>(data), size);
+            auto message = boost::format("Failed to open image file index %s: invalid or unsupported format") % file;
+            SARUS_THROW_ERROR(message.str());
+        }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    const Header& header() const {
+        return *reinterpret_cast<const Header*>(data);
+    }
+    const RawEntry* entries() const {
+        return reinterpret_cast<const RawEntry*>(data + sizeof(Header));
+    }
+    const std::uint32_t* buckets() const {
+        return reinterpret_cast<const std::uint32_t*>(entries() + header().numberOfEntries);
+    }
+    const char* strings() const {
+        return reinterpret_cast<const char*>(buckets() + header().numberOfBuckets);
+    }
+
+private:
+    // the sidecar is written by the owner of the image, thus all the offsets are checked once here
+    bool isValid() const {
+        const auto& h = header();
+        if(std::memcmp(h.magic, indexMagic, sizeof(indexMagic)) != 0 || h.version != indexVersion) {
+            return false;
+        }
+        if(h.numberOfBuckets == 0 || (h.numberOfBuckets & (h.numberOfBuckets - 1)) != 0
+           || h.numberOfBuckets <= h.numberOfEntries) {
+            return false;
+        }
+        auto expectedSize = std::uint64_t{sizeof(Header)}
+                          + std::uint64_t{h.numberOfEntries} * sizeof(RawEntry)
+                          + std::uint64_t{h.numberOfBuckets} * sizeof(std::uint32_t)
+                          + h.stringsSize;
+        if(expectedSize != size) {
+            return false;
+        }
+        for(std::uint32_t i=0; i<h.numberOfEntries; ++i) {
+            const auto& entry = entries()[i];
+            if(std::uint64_t{entry.pathOffset} + entry.pathLength > h.stringsSize
+               || std::uint64_t{entry.targetOffset} + entry.targetLength > h.stringsSize) {
+                return false;
+            }
+        }
+        for(std::uint32_t i=0; i<h.numberOfBuckets; ++i) {
+            if(buckets()[i] != emptyBucket && buckets()[i] >= h.numberOfEntries) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    const char* data;
+    std::size_t size;
+};
+
+boost::filesystem::path ImageFileIndex::getFileOfImage(const boost::filesystem::path& squashfsFile) {
+    auto file = squashfsFile;
+    return file.replace_extension(".index");
+}
+
+/**
+ * Walks the unpacked rootfs of the image (without following symlinks) and writes the sidecar.
+ * The squashfs file must already exist, because the index records its fingerprint.
+ */
+void ImageFileIndex::create(const boost::filesystem::path& rootfsDir,
+                            const boost::filesystem::path& squashfsFile,
+                            const boost::filesystem::path& indexFile,
+                            const boost::optional<ImageFileIndex>& lowerIndex) {
+    logMessage(boost::format("Creating image file index %s") % indexFile, LogLevel::INFO);
+
+    struct Record {
+        std::string path;
+        std::string target;
+        struct stat st;
+    };
+    auto records = std::vector<Record>{};
+
+    auto addRecord = [&records](const boost::filesystem::path& file, const std::string& pathInImage) {
+        auto record = Record{pathInImage, {}, {}};
+        if(lstat(file.c_str(), &record.st) != 0) {
+            auto message = boost::format("Failed to stat %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        if(S_ISLNK(record.st.st_mode)) {
+            record.target = boost::filesystem::read_symlink(file).string();
+        }
+        records.push_back(std::move(record));
+        return S_ISDIR(records.back().st.st_mode);
+    };
+
+    addRecord(rootfsDir, "/");
+    auto directories = std::vector<std::string>{"/"};
+    while(!directories.empty()) {
+        auto directory = std::move(directories.back());
+        directories.pop_back();
+        for(const auto& entry : boost::filesystem::directory_iterator{rootfsDir / directory}) {
+            auto pathInImage = (boost::filesystem::path{directory} / entry.path().filename()).string();
+            if(addRecord(entry.path(), pathInImage)) {
+                directories.push_back(std::move(pathInImage));
+            }
+        }
+    }
+
+    // the files of the rootfs hide the ones of the lower image with the same path
+    if(lowerIndex) {
+        auto paths = std::unordered_set<std::string>{};
+        for(const auto& record : records) {
+            paths.insert(record.path);
+        }
+        for(const auto& entry : lowerIndex->getEntries()) {
+            if(paths.count(entry.first)) {
+                continue;
+            }
+            auto record = Record{entry.first, entry.second.symlinkTarget, {}};
+            record.st.st_mode = entry.second.mode;
+            record.st.st_size = entry.second.size;
+            records.push_back(std::move(record));
+        }
+    }
+
+    auto numberOfBuckets = std::uint32_t{1};
+    while(numberOfBuckets < 2 * records.size()) {
+        numberOfBuckets *= 2;
+    }
+
+    auto strings = std::string{};
+    auto entries = std::string{};
+    auto buckets = std::vector<std::uint32_t>(numberOfBuckets, emptyBucket);
+    for(std::uint32_t i=0; i<records.size(); ++i) {
+        const auto& record = records[i];
+        auto entry = RawEntry{};
+        entry.pathOffset = strings.size();
+        entry.pathLength = record.path.size();
+        strings += record.path;
+        entry.targetOffset = strings.size();
+        entry.targetLength = record.target.size();
+        strings += record.target;
+        entry.mode = record.st.st_mode;
+        entry.size = record.st.st_size;
+        append(entries, entry);
+
+        auto bucket = hash(record.path.data(), record.path.size()) & (numberOfBuckets - 1);
+        while(buckets[bucket] != emptyBucket) {
+            bucket = (bucket + 1) & (numberOfBuckets - 1);
+        }
+        buckets[bucket] = i;
+    }
+
+    auto fingerprint = readSquashfsFingerprint(squashfsFile);
+    auto header = Header{};
+    std::memcpy(header.magic, indexMagic, sizeof(indexMagic));
+    header.version = indexVersion;
+    header.numberOfEntries = records.size();
+    header.numberOfBuckets = numberOfBuckets;
+    header.squashfsCreationTime = fingerprint.creationTime;
+    header.squashfsBytesUsed = fingerprint.bytesUsed;
+    header.stringsSize = strings.size();
+
+    // the previous index of the image may still be mapped, e.g. by a pull using it as lower index
+    auto temporaryFile = PathRAII{makeUniquePathWithRandomSuffix(indexFile)};
+    std::ofstream os{temporaryFile.getPath().string(), std::ios::binary | std::ios::trunc};
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(entries.data(), entries.size());
+    os.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(std::uint32_t));
+    os.write(strings.data(), strings.size());
+    if(!os.flush()) {
+        auto message = boost::format("Failed to write image file index %s") % indexFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+    os.close();
+    boost::filesystem::rename(temporaryFile.getPath(), indexFile);
+    temporaryFile.release();
+
+    logMessage(boost::format("Successfully created image file index (%d entries)") % records.size(), LogLevel::INFO);
+}
+
+ImageFileIndex::ImageFileIndex(const boost::filesystem::path& indexFile)
+    : file{std::make_shared<const MappedFile>(indexFile)}
+{}
+
+bool ImageFileIndex::matchesImage(const boost::filesystem::path& squashfsFile) const {
+    auto fingerprint = readSquashfsFingerprint(squashfsFile);
+    return fingerprint.creationTime == header().squashfsCreationTime
+        && fingerprint.bytesUsed == header().squashfsBytesUsed;
+}
+
+void ImageFileIndex::write(const boost::filesystem::path& destination) const {
+    std::ofstream os{destination.string(), std::ios::binary | std::ios::trunc};
+    if(!os.write(file->data, file->size) || !os.flush()) {
+        auto message = boost::format("Failed to write image file index %s") % destination;
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+std::size_t ImageFileIndex::size() const {
+    return header().numberOfEntries;
+}
+
+std::vector<std::pair<std::string, ImageFileIndex::Entry>> ImageFileIndex::getEntries() const {
+    auto entries = std::vector<std::pair<std::string, Entry>>{};
+    entries.reserve(header().numberOfEntries);
+    for(std::uint32_t i=0; i<header().numberOfEntries; ++i) {
+        const auto& entry = file->entries()[i];
+        entries.emplace_back(getString(entry.pathOffset, entry.pathLength),
+                             Entry{entry.mode, entry.size, getString(entry.targetOffset, entry.targetLength)});
+    }
+    return entries;
+}
+
+boost::optional<ImageFileIndex::Entry> ImageFileIndex::find(const boost::filesystem::path& path) const {
+    const auto* entry = findRawEntry(path.string());
+    if(!entry) {
+        return {};
+    }
+    return Entry{entry->mode, entry->size, getString(entry->targetOffset, entry->targetLength)};
+}
+
+boost::filesystem::path ImageFileIndex::realpath(const boost::filesystem::path& path) const {
+    if(!path.is_absolute()) {
+        auto message = boost::format("Failed to determine realpath within image. %s is not an absolute path.") % path;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return appendPaths("/", path, 0);
+}
+
+const ImageFileIndex::Header& ImageFileIndex::header() const {
+    return file->header();
+}
+
+const ImageFileIndex::RawEntry* ImageFileIndex::findRawEntry(const std::string& path) const {
+    const auto mask = header().numberOfBuckets - 1;
+    auto bucket = hash(path.data(), path.size()) & mask;
+    // the table is never full, thus there is always an empty bucket that ends the probing
+    while(file->buckets()[bucket] != emptyBucket) {
+        const auto* entry = file->entries() + file->buckets()[bucket];
+        if(entry->pathLength == path.size()
+           && std::memcmp(file->strings() + entry->pathOffset, path.data(), path.size()) == 0) {
+            return entry;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return nullptr;
+}
+
+std::string ImageFileIndex::getString(std::uint32_t offset, std::uint32_t length) const {
+    return std::string(file->strings() + offset, length);
+}
+
+// see appendPathsWithinRootfs in common/Utility.cpp
+boost::filesystem::path ImageFileIndex::appendPaths(const boost::filesystem::path& path0,
+                                                    const boost::filesystem::path& path1,
+                                                    unsigned int depth) const {
+    if(depth > maxSymlinkDepth) {
+        auto message = boost::format("Failed to determine realpath within image: too many levels of symbolic links");
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto current = path0;
+    for(const auto& element : path1) {
+        if(element == "/" || element == ".") {
+            continue;
+        }
+        else if(element == "..") {
+            if(current > "/") {
+                current = current.remove_trailing_separator().parent_path();
+            }
+            continue;
+        }
+
+        const auto* entry = findRawEntry((current / element).string());
+        if(entry && S_ISLNK(entry->mode)) {
+            auto target = boost::filesystem::path{getString(entry->targetOffset, entry->targetLength)};
+            current = appendPaths(target.is_absolute() ? "/" : current, target, depth + 1);
+        }
+        else {
+            current /= element;
+        }
+    }
+    return current;
+}
+
+}
+}
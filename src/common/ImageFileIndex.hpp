@@ -0,0 +1,94 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_ImageFileIndex_hpp
+#define sarus_common_ImageFileIndex_hpp
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace common {
+
+/**
+ * Index of the files of an image (path -> mode, size and symlink target), stored in a sidecar
+ * file next to the image's squashfs file. It is created when the image is pulled or loaded and
+ * answers path lookups within the image's root filesystem from a memory mapping of the sidecar,
+ * instead of faulting the squashfs metadata blocks in from the (possibly shared) filesystem
+ * where the image is stored.
+ *
+ * The index describes the read-only lower layer of the container's rootfs only: files written
+ * to the upper layer and mounts performed on top of the rootfs are not in the index.
+ *
+ * The sidecar is a hash table with open addressing, followed by the string table of the paths
+ * and symlink targets. It is bound to the squashfs file it was created for through the creation
+ * time and size recorded in the squashfs superblock.
+ */
+class ImageFileIndex {
+public:
+    struct Entry {
+        mode_t mode;
+        std::uint64_t size;
+        std::string symlinkTarget;
+    };
+
+    // file of the OCI bundle through which the runtime passes the index to the hooks
+    static constexpr const char* fileNameInBundle = "image-file-index";
+
+public:
+    static boost::filesystem::path getFileOfImage(const boost::filesystem::path& squashfsFile);
+    // with a lower index, the index describes the rootfs stacked on top of the lower image's files
+    static void create(const boost::filesystem::path& rootfsDir,
+                       const boost::filesystem::path& squashfsFile,
+                       const boost::filesystem::path& indexFile,
+                       const boost::optional<ImageFileIndex>& lowerIndex = {});
+
+    ImageFileIndex(const boost::filesystem::path& indexFile);
+
+    bool matchesImage(const boost::filesystem::path& squashfsFile) const;
+    void write(const boost::filesystem::path& file) const;
+    std::size_t size() const;
+    // in the order of creation, where directories precede their contents
+    std::vector<std::pair<std::string, Entry>> getEntries() const;
+
+    // lookup of an absolute path within the image, without resolving symlinks
+    boost::optional<Entry> find(const boost::filesystem::path& path) const;
+    // same as common::realpathWithinRootfs, with the lookups answered by the index
+    boost::filesystem::path realpath(const boost::filesystem::path& path) const;
+
+private:
+    class MappedFile;
+    struct Header;
+    struct RawEntry;
+
+    const Header& header() const;
+    const RawEntry* findRawEntry(const std::string& path) const;
+    std::string getString(std::uint32_t offset, std::uint32_t length) const;
+    boost::filesystem::path appendPaths(const boost::filesystem::path& path0,
+                                        const boost::filesystem::path& path1,
+                                        unsigned int depth) const;
+
+private:
+    std::shared_ptr<const MappedFile> file;
+};
+
+}
+}
+
+#endif
@@ -109,6 +109,28 @@ void ImageMetadata::write(const boost::filesystem::path& path) const {
         }
     }
 
+    if (libraryCatalogue) {
+        json.AddMember("LibraryCatalogue", libraryCatalogue->toJSON(allocator), allocator);
+    }
+
+    if (!fileStoreObjects.empty()) {
+        json.AddMember("FileStoreObjects", rapidjson::Value{rapidjson::kArrayType}, allocator);
+        for(const auto& object : fileStoreObjects) {
+            json["FileStoreObjects"].PushBack(rapidjson::Value{object.c_str(), allocator}, allocator);
+        }
+    }
+
+    if (fileStoreView) {
+        json.AddMember("FileStoreView", rapidjson::Value{fileStoreView->c_str(), allocator}, allocator);
+    }
+
+    if (!layers.empty()) {
+        json.AddMember("Layers", rapidjson::Value{rapidjson::kArrayType}, allocator);
+        for(const auto& layer : layers) {
+            json["Layers"].PushBack(rapidjson::Value{layer.c_str(), allocator}, allocator);
+        }
+    }
+
     common::writeJSON(json, path);
 
     logMessage("Successfully written image metadata file", LogLevel::INFO);
@@ -155,6 +177,29 @@ void ImageMetadata::parseJSON(const rapidjson::Value& json) {
             labels[label.name.GetString()] = label.value.GetString();
         }
     }
+    if (json.HasMember("LibraryCatalogue")) {
+        try {
+            libraryCatalogue = LibraryCatalogue{json["LibraryCatalogue"]};
+        }
+        catch (const common::Error& e) {
+            // e.g. written by a different version of Sarus: the hooks fall back to probing the rootfs
+            auto message = boost::format("Ignoring library catalogue in image metadata: %s") % e.what();
+            logMessage(message, LogLevel::INFO);
+        }
+    }
+    if (json.HasMember("FileStoreObjects")) {
+        for (const auto& v : json["FileStoreObjects"].GetArray()) {
+            fileStoreObjects.push_back(v.GetString());
+        }
+    }
+    if (json.HasMember("FileStoreView")) {
+        fileStoreView = json["FileStoreView"].GetString();
+    }
+    if (json.HasMember("Layers")) {
+        for (const auto& v : json["Layers"].GetArray()) {
+            layers.push_back(v.GetString());
+        }
+    }
 }
 
 bool operator==(const ImageMetadata& lhs, const ImageMetadata& rhs) {
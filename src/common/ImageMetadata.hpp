@@ -13,11 +13,13 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 #include <rapidjson/document.h>
 
 #include "common/CLIArguments.hpp"
+#include "common/LibraryCatalogue.hpp"
 #include "common/Utility.hpp"
 
 namespace sarus {
@@ -46,6 +48,27 @@ public:
      * class data member to avoid confusion about what the data member represents.
      */
     std::unordered_map<std::string, std::string> labels;
+    /**
+     * Computed by Sarus when the image is pulled or loaded (never taken from the image config).
+     * Missing for images created by older versions of Sarus.
+     */
+    boost::optional<LibraryCatalogue> libraryCatalogue;
+    /**
+     * Objects of the repository's file store referenced by the image (see common::FileStore).
+     * Computed by Sarus when the image is pulled or loaded.
+     */
+    std::vector<std::string> fileStoreObjects;
+    /**
+     * View of the repository's file store which holds the deduplicated files of the image at their
+     * original paths (see common::FileStore). Computed by Sarus when the image is pulled or loaded.
+     */
+    boost::optional<std::string> fileStoreView;
+    /**
+     * Digests of the layers the image was created from, which allow to store the next version
+     * of the image as a delta (see image_manager::ImageDelta). Computed by Sarus when the image
+     * is pulled or loaded.
+     */
+    std::vector<std::string> layers;
     void write(const boost::filesystem::path& path) const;
 
 private:
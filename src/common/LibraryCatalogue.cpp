@@ -0,0 +1,449 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "LibraryCatalogue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/format.hpp>
+#include <boost/regex.hpp>
+
+#include "common/Error.hpp"
+#include "common/Logger.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace common {
+
+constexpr int LibraryCatalogue::formatVersion;
+constexpr const char* LibraryCatalogue::fileNameInBundle;
+
+namespace {
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile(const boost::filesystem::path& file) {
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            auto message = boost::format("Failed to open %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        struct stat st;
+        if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            auto* address = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(address != MAP_FAILED) {
+                data = static_cast<const char*>(address);
+                size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+        if(data) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    // returns a pointer to an object of type T at the given offset, or nullptr if out of bounds
+    template<class T>
+    const T* at(std::uint64_t offset, std::uint64_t count = 1) const {
+        if(offset > size || count > (size - offset) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(data + offset);
+    }
+
+    // returns the NUL-terminated string at the given offset, or an empty string if out of bounds
+    std::string stringAt(std::uint64_t offset, std::uint64_t end) const {
+        end = std::min<std::uint64_t>(end, size);
+        if(offset >= end) {
+            return {};
+        }
+        const auto* begin = data + offset;
+        const auto* terminator = static_cast<const char*>(std::memchr(begin, '\0', end - offset));
+        return terminator ? std::string(begin, terminator) : std::string{};
+    }
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+};
+
+// layout of the linker cache written by glibc's ldconfig (see sysdeps/generic/dl-cache.h)
+const char oldCacheMagic[] = "ld.so-1.7.0";
+const char newCacheMagic[] = "glibc-ld.so.cache1.1";
+
+struct OldCacheHeader {
+    char magic[sizeof(oldCacheMagic) - 1];
+    std::uint32_t numberOfLibraries;
+};
+
+struct OldCacheEntry {
+    std::int32_t flags;
+    std::uint32_t key;
+    std::uint32_t value;
+};
+
+struct NewCacheHeader {
+    char magic[sizeof(newCacheMagic) - 1];
+    std::uint32_t numberOfLibraries;
+    std::uint32_t stringsSize;
+    std::uint8_t flags;
+    std::uint8_t padding[3];
+    std::uint32_t extensionOffset;
+    std::uint32_t unused[3];
+};
+
+struct NewCacheEntry {
+    std::int32_t flags;
+    std::uint32_t key;
+    std::uint32_t value;
+    std::uint32_t osVersion;
+    std::uint64_t hwcap;
+};
+
+template<class Ehdr, class Shdr, class Dyn>
+void parseElf(const MappedFile& file, ElfInformation& information) {
+    const auto* header = file.at<Ehdr>(0);
+    if(!header) {
+        return;
+    }
+    information.machine = header->e_machine;
+
+    // the SONAME is in the string table linked to the dynamic section
+    const auto* sections = file.at<Shdr>(header->e_shoff, header->e_shnum);
+    if(!sections || header->e_shentsize != sizeof(Shdr)) {
+        return;
+    }
+    for(std::size_t i=0; i<header->e_shnum; ++i) {
+        const auto& section = sections[i];
+        if(section.sh_type != SHT_DYNAMIC || section.sh_link >= header->e_shnum) {
+            continue;
+        }
+        const auto& strings = sections[section.sh_link];
+        const auto numberOfEntries = section.sh_size / sizeof(Dyn);
+        const auto* entries = file.at<Dyn>(section.sh_offset, numberOfEntries);
+        for(std::size_t j=0; entries && j<numberOfEntries && entries[j].d_tag != DT_NULL; ++j) {
+            if(entries[j].d_tag == DT_SONAME) {
+                information.soname = file.stringAt(strings.sh_offset + entries[j].d_un.d_val,
+                                                   strings.sh_offset + strings.sh_size);
+                return;
+            }
+        }
+    }
+}
+
+// the catalogue is read from files writable by the owner of the image, thus the paths
+// must not point outside of the container's rootfs once prefixed with it. The paths are
+// only hints for the lookups of the hooks, which resolve again within the rootfs the paths
+// where they mount or create files.
+boost::filesystem::path validateLibraryPath(const char* path) {
+    auto validated = boost::filesystem::path{path};
+    auto isDotOrDotDot = [](const boost::filesystem::path& element) {
+        return element == "." || element == "..";
+    };
+    if(!validated.is_absolute() || std::any_of(validated.begin(), validated.end(), isDotOrDotDot)) {
+        auto message = boost::format("Invalid library path %s in library catalogue") % validated;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return validated;
+}
+
+// the catalogue is read from a file writable by the owner of the image and rapidjson
+// asserts on accesses to values of the wrong type, thus each value is checked first
+const rapidjson::Value& getMember(const rapidjson::Value& object,
+                                  const char* name,
+                                  bool (rapidjson::Value::*hasExpectedType)() const) {
+    if(!object.IsObject() || !object.HasMember(name) || !(object[name].*hasExpectedType)()) {
+        auto message = boost::format("Invalid library catalogue: missing or mistyped member \"%s\"") % name;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return object[name];
+}
+
+const rapidjson::Value& getElement(const rapidjson::Value& array,
+                                   rapidjson::SizeType index,
+                                   bool (rapidjson::Value::*hasExpectedType)() const) {
+    if(!array.IsArray() || index >= array.Size() || !(array[index].*hasExpectedType)()) {
+        auto message = boost::format("Invalid library catalogue: missing or mistyped array element %d") % index;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return array[index];
+}
+
+}
+
+LibraryCatalogue::LibraryCatalogue(const rapidjson::Value& json) {
+    namespace rj = rapidjson;
+    if(!json.IsObject() || !json.HasMember("version") || !json["version"].IsInt()
+       || json["version"].GetInt() != formatVersion) {
+        SARUS_THROW_ERROR("Unsupported format of library catalogue");
+    }
+
+    const auto& linkerCache = getMember(json, "linkerCache", &rj::Value::IsObject);
+    linkerCacheSize = getMember(linkerCache, "size", &rj::Value::IsInt64).GetInt64();
+    linkerCacheModificationTime = getMember(linkerCache, "modificationTime", &rj::Value::IsInt64).GetInt64();
+
+    if(json.HasMember("libcVersion")) {
+        const auto& version = getMember(json, "libcVersion", &rj::Value::IsArray);
+        libcVersion = std::make_tuple(getElement(version, 0, &rj::Value::IsUint).GetUint(),
+                                      getElement(version, 1, &rj::Value::IsUint).GetUint());
+    }
+
+    for(const auto& entry : getMember(json, "libraries", &rj::Value::IsArray).GetArray()) {
+        auto library = Library{};
+        library.path = validateLibraryPath(getMember(entry, "path", &rj::Value::IsString).GetString());
+        library.realPath = validateLibraryPath(getMember(entry, "realPath", &rj::Value::IsString).GetString());
+        library.soname = getMember(entry, "soname", &rj::Value::IsString).GetString();
+        library.elfClass = getMember(entry, "elfClass", &rj::Value::IsInt).GetInt();
+        library.machine = getMember(entry, "machine", &rj::Value::IsInt).GetInt();
+        // the components of the version are stored as strings, as in the library's filename
+        const auto& abi = getMember(entry, "abi", &rj::Value::IsArray);
+        for(rj::SizeType i=0; i<abi.Size(); ++i) {
+            auto component = AbiVersion::parse(getElement(abi, i, &rj::Value::IsString).GetString());
+            if(component.empty() || !library.abi.append(component.getMajor())) {
+                break;
+            }
+        }
+        libraries.push_back(std::move(library));
+    }
+    index();
+}
+
+LibraryCatalogue LibraryCatalogue::create(const boost::filesystem::path& rootfsDir) {
+    logMessage(boost::format("Creating library catalogue of %s") % rootfsDir, LogLevel::INFO);
+
+    auto catalogue = LibraryCatalogue{};
+    auto cacheFile = rootfsDir / "etc/ld.so.cache";
+    if(!boost::filesystem::is_regular_file(boost::filesystem::symlink_status(cacheFile))) {
+        logMessage("No dynamic linker cache found (the image doesn't have glibc)", LogLevel::INFO);
+        return catalogue;
+    }
+
+    struct stat cacheStat;
+    if(lstat(cacheFile.c_str(), &cacheStat) != 0) {
+        auto message = boost::format("Failed to stat %s: %s") % cacheFile % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    catalogue.linkerCacheSize = cacheStat.st_size;
+    catalogue.linkerCacheModificationTime = cacheStat.st_mtime;
+
+    for(const auto& path : readDynamicLinkerCache(cacheFile)) {
+        auto library = Library{};
+        library.path = path;
+        try {
+            library.realPath = realpathWithinRootfs(rootfsDir, path);
+            if(!boost::filesystem::exists(rootfsDir / library.realPath)) {
+                auto message = boost::format("Library %s has an entry in the dynamic linker cache"
+                                             " but does not exist or is a broken symlink. Skipping...") % path;
+                logMessage(message, LogLevel::DEBUG);
+                continue;
+            }
+            if(auto information = readElfInformation(rootfsDir / library.realPath)) {
+                library.elfClass = information->elfClass;
+                library.machine = information->machine;
+                library.soname = information->soname;
+            }
+            if(isSharedLib(path)) {
+                library.abi = resolveSharedLibAbi(path, rootfsDir);
+            }
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to analyze library %s (%s). Skipping...") % path % e.what();
+            logMessage(message, LogLevel::DEBUG);
+            continue;
+        }
+
+        if(!catalogue.libcVersion && isLibc(path) && library.elfClass == 64) {
+            catalogue.libcVersion = readGlibcVersion(rootfsDir / library.realPath);
+        }
+        catalogue.libraries.push_back(std::move(library));
+    }
+    catalogue.index();
+
+    auto message = boost::format("Successfully created library catalogue (%d libraries)") % catalogue.libraries.size();
+    logMessage(message, LogLevel::INFO);
+    return catalogue;
+}
+
+rapidjson::Value LibraryCatalogue::toJSON(rapidjson::MemoryPoolAllocator<>& allocator) const {
+    namespace rj = rapidjson;
+    auto json = rj::Value{rj::kObjectType};
+    json.AddMember("version", rj::Value{formatVersion}, allocator);
+
+    auto linkerCache = rj::Value{rj::kObjectType};
+    linkerCache.AddMember("size", rj::Value{linkerCacheSize}, allocator);
+    linkerCache.AddMember("modificationTime", rj::Value{linkerCacheModificationTime}, allocator);
+    json.AddMember("linkerCache", linkerCache, allocator);
+
+    if(libcVersion) {
+        auto version = rj::Value{rj::kArrayType};
+        version.PushBack(rj::Value{std::get<0>(*libcVersion)}, allocator);
+        version.PushBack(rj::Value{std::get<1>(*libcVersion)}, allocator);
+        json.AddMember("libcVersion", version, allocator);
+    }
+
+    auto entries = rj::Value{rj::kArrayType};
+    for(const auto& library : libraries) {
+        auto entry = rj::Value{rj::kObjectType};
+        entry.AddMember("path", rj::Value{library.path.c_str(), allocator}, allocator);
+        entry.AddMember("realPath", rj::Value{library.realPath.c_str(), allocator}, allocator);
+        entry.AddMember("soname", rj::Value{library.soname.c_str(), allocator}, allocator);
+        entry.AddMember("elfClass", rj::Value{library.elfClass}, allocator);
+        entry.AddMember("machine", rj::Value{library.machine}, allocator);
+        auto abi = rj::Value{rj::kArrayType};
+        for(std::size_t i = 0; i < library.abi.size(); ++i) {
+            abi.PushBack(rj::Value{std::to_string(library.abi[i]).c_str(), allocator}, allocator);
+        }
+        entry.AddMember("abi", abi, allocator);
+        entries.PushBack(entry, allocator);
+    }
+    json.AddMember("libraries", entries, allocator);
+
+    return json;
+}
+
+void LibraryCatalogue::write(const boost::filesystem::path& file) const {
+    auto json = rapidjson::Document{};
+    json.CopyFrom(toJSON(json.GetAllocator()), json.GetAllocator());
+    writeJSON(json, file, false);
+}
+
+const LibraryCatalogue::Library* LibraryCatalogue::find(const boost::filesystem::path& path) const {
+    auto it = librariesByPath.find(path.string());
+    return it != librariesByPath.cend() ? &libraries[it->second] : nullptr;
+}
+
+bool LibraryCatalogue::matchesDynamicLinkerCacheOf(const boost::filesystem::path& rootfsDir) const {
+    // the modification time is preserved by the squashfs image, with a resolution of one second
+    struct stat cacheStat;
+    if(lstat((rootfsDir / "etc/ld.so.cache").c_str(), &cacheStat) != 0) {
+        return linkerCacheSize < 0;
+    }
+    return cacheStat.st_size == linkerCacheSize && cacheStat.st_mtime == linkerCacheModificationTime;
+}
+
+void LibraryCatalogue::index() {
+    librariesByPath.clear();
+    for(std::size_t i=0; i<libraries.size(); ++i) {
+        librariesByPath.emplace(libraries[i].path.string(), i);
+    }
+}
+
+/**
+ * Returns the paths of the libraries in the dynamic linker cache, in the same order
+ * as "ldconfig -p". Both the new format and the old format with an embedded new format
+ * (written by ldconfig of glibc < 2.32) are supported.
+ */
+std::vector<boost::filesystem::path> readDynamicLinkerCache(const boost::filesystem::path& cacheFile) {
+    MappedFile file{cacheFile};
+
+    auto newHeaderOffset = std::uint64_t{0};
+    if(file.size >= sizeof(oldCacheMagic) - 1 && std::memcmp(file.data, oldCacheMagic, sizeof(oldCacheMagic) - 1) == 0) {
+        const auto* oldHeader = file.at<OldCacheHeader>(0);
+        if(!oldHeader) {
+            SARUS_THROW_ERROR((boost::format("Failed to parse dynamic linker cache %s: truncated file") % cacheFile).str());
+        }
+        auto alignment = alignof(NewCacheEntry);
+        newHeaderOffset = sizeof(OldCacheHeader) + std::uint64_t{oldHeader->numberOfLibraries} * sizeof(OldCacheEntry);
+        newHeaderOffset = (newHeaderOffset + alignment - 1) & ~std::uint64_t{alignment - 1};
+    }
+
+    const auto* header = file.at<NewCacheHeader>(newHeaderOffset);
+    if(!header || std::memcmp(header->magic, newCacheMagic, sizeof(header->magic)) != 0) {
+        auto message = boost::format("Failed to parse dynamic linker cache %s: unsupported format") % cacheFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+    const auto* entries = file.at<NewCacheEntry>(newHeaderOffset + sizeof(NewCacheHeader), header->numberOfLibraries);
+    if(!entries) {
+        auto message = boost::format("Failed to parse dynamic linker cache %s: truncated file") % cacheFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    // the string offsets are relative to the new header
+    auto libraries = std::vector<boost::filesystem::path>{};
+    libraries.reserve(header->numberOfLibraries);
+    for(std::size_t i=0; i<header->numberOfLibraries; ++i) {
+        auto path = file.stringAt(newHeaderOffset + entries[i].value, file.size);
+        if(!path.empty()) {
+            libraries.push_back(path);
+        }
+    }
+    return libraries;
+}
+
+/**
+ * Returns the ELF class, machine and SONAME of the file, or nothing if the file is not
+ * an ELF file of the same byte order as the host.
+ */
+boost::optional<ElfInformation> readElfInformation(const boost::filesystem::path& file) {
+    MappedFile mappedFile{file};
+    const auto* identification = mappedFile.at<unsigned char>(0, EI_NIDENT);
+    if(!identification || std::memcmp(identification, ELFMAG, SELFMAG) != 0) {
+        return {};
+    }
+
+    const auto hostByteOrder = [] {
+        const std::uint16_t value = 1;
+        return *reinterpret_cast<const std::uint8_t*>(&value) == 1 ? ELFDATA2LSB : ELFDATA2MSB;
+    }();
+    if(identification[EI_DATA] != hostByteOrder) {
+        return {};
+    }
+
+    auto information = ElfInformation{};
+    if(identification[EI_CLASS] == ELFCLASS64) {
+        information.elfClass = 64;
+        parseElf<Elf64_Ehdr, Elf64_Shdr, Elf64_Dyn>(mappedFile, information);
+    }
+    else if(identification[EI_CLASS] == ELFCLASS32) {
+        information.elfClass = 32;
+        parseElf<Elf32_Ehdr, Elf32_Shdr, Elf32_Dyn>(mappedFile, information);
+    }
+    else {
+        return {};
+    }
+    return information;
+}
+
+/**
+ * Returns the version of glibc from the banner embedded in libc.so, e.g.
+ * "GNU C Library (Ubuntu GLIBC 2.35-0ubuntu3) stable release version 2.35."
+ * This is the same version printed by "ldd --version", but it doesn't require
+ * executing a program of the image.
+ */
+boost::optional<std::tuple<unsigned int, unsigned int>> readGlibcVersion(const boost::filesystem::path& libc) {
+    MappedFile file{libc};
+    if(!file.data) {
+        return {};
+    }
+    auto re = boost::regex{"release version (\\d+)\\.(\\d+)"};
+    boost::cmatch matches;
+    if(!boost::regex_search(file.data, file.data + file.size, matches, re)) {
+        return {};
+    }
+    return std::make_tuple(static_cast<unsigned int>(std::stoul(matches[1])),
+                           static_cast<unsigned int>(std::stoul(matches[2])));
+}
+
+}
+}
@@ -0,0 +1,95 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_LibraryCatalogue_hpp
+#define sarus_common_LibraryCatalogue_hpp
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+#include <rapidjson/document.h>
+
+#include "common/AbiVersion.hpp"
+
+
+namespace sarus {
+namespace common {
+
+/**
+ * Catalogue of the shared libraries listed in the dynamic linker cache (/etc/ld.so.cache)
+ * of an image. It is created once, from the unpacked root filesystem, when the image is
+ * pulled or loaded, and stored in the image's metadata file. The runtime passes it to the
+ * hooks through the OCI bundle, so that they don't have to probe the container's rootfs
+ * (ldconfig, readelf, symlink resolution) at every launch.
+ *
+ * The catalogue is computed natively (parsing the linker cache and the ELF headers),
+ * because no trusted ldconfig or readelf is configured at pull time.
+ */
+class LibraryCatalogue {
+public:
+    struct Library {
+        boost::filesystem::path path;     // as listed in the linker cache
+        boost::filesystem::path realPath; // with all the symlinks resolved within the rootfs (when cataloguing)
+        std::string soname;               // empty if the library has none
+        int elfClass = 0;                 // 32, 64, or 0 if unknown
+        int machine = 0;                  // ELF e_machine, e.g. EM_X86_64
+        AbiVersion abi;                   // ABI version as resolved by common::resolveSharedLibAbi
+    };
+
+    // format of the JSON representation, which is ignored by readers of a different version
+    static constexpr int formatVersion = 1;
+    // file of the OCI bundle through which the runtime passes the catalogue to the hooks
+    static constexpr const char* fileNameInBundle = "library-catalogue.json";
+
+public:
+    LibraryCatalogue() = default;
+    LibraryCatalogue(const rapidjson::Value& json);
+    static LibraryCatalogue create(const boost::filesystem::path& rootfsDir);
+
+    rapidjson::Value toJSON(rapidjson::MemoryPoolAllocator<>& allocator) const;
+    void write(const boost::filesystem::path& file) const;
+
+    const std::vector<Library>& getLibraries() const { return libraries; }
+    const Library* find(const boost::filesystem::path& path) const;
+    const boost::optional<std::tuple<unsigned int, unsigned int>>& getLibcVersion() const { return libcVersion; }
+    // false if the linker cache of the rootfs is not the one the catalogue was created from,
+    // e.g. because a bind mount shadows it or a hook has run ldconfig in the container
+    bool matchesDynamicLinkerCacheOf(const boost::filesystem::path& rootfsDir) const;
+
+private:
+    void index();
+
+private:
+    std::vector<Library> libraries;
+    boost::optional<std::tuple<unsigned int, unsigned int>> libcVersion;
+    std::int64_t linkerCacheSize = -1;
+    std::int64_t linkerCacheModificationTime = -1;
+    std::unordered_map<std::string, std::size_t> librariesByPath;
+};
+
+struct ElfInformation {
+    int elfClass = 0;
+    int machine = 0;
+    std::string soname;
+};
+
+std::vector<boost::filesystem::path> readDynamicLinkerCache(const boost::filesystem::path& cacheFile);
+boost::optional<ElfInformation> readElfInformation(const boost::filesystem::path& file);
+boost::optional<std::tuple<unsigned int, unsigned int>> readGlibcVersion(const boost::filesystem::path& libc);
+
+}
+}
+
+#endif
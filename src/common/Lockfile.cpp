@@ -20,6 +20,7 @@
 
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 
 
 namespace sarus {
@@ -36,6 +37,7 @@ Lockfile::Lockfile(const boost::filesystem::path& file, unsigned int timeoutMs)
     auto message = boost::format("acquiring lock on file %s") % file;
     logger->log(message.str(), loggerSubsystemName, common::LogLevel::DEBUG);
 
+    auto start = std::chrono::steady_clock::now();
     unsigned int elapsedTimeMs = 0;
     while(!createLockfileAtomically()) {
         if(timeoutMs != noTimeout && elapsedTimeMs >= timeoutMs) {
@@ -47,6 +49,9 @@ Lockfile::Lockfile(const boost::filesystem::path& file, unsigned int timeoutMs)
         elapsedTimeMs += backoffTimeMs;
     }
 
+    auto waitTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    common::Metrics::getInstance().observe("sarus_lock_wait", waitTime.count());
+
     logger->log("successfully acquired lock", loggerSubsystemName, common::LogLevel::DEBUG);
 }
 
@@ -0,0 +1,470 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "common/Metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/fsuid.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <boost/format.hpp>
+
+#include "common/Config.hpp"
+#include "common/Error.hpp"
+#include "common/Logger.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace common {
+
+namespace {
+
+std::string formatValue(double value) {
+    if(value == std::floor(value) && std::fabs(value) < 1e15) {
+        return std::to_string(static_cast<long long>(value));
+    }
+    auto os = std::ostringstream{};
+    os << std::setprecision(15) << value;
+    return os.str();
+}
+
+std::string escapeLabelValue(const std::string& value) {
+    auto escaped = std::string{};
+    for(auto c : value) {
+        switch(c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string makeSeries(const std::string& name, const Metrics::Labels& labels,
+                       const boost::optional<std::string>& le = {}) {
+    auto items = std::vector<std::string>{};
+    for(const auto& label : labels) {
+        items.push_back(label.first + "=\"" + escapeLabelValue(label.second) + "\"");
+    }
+    if(le) {
+        items.push_back("le=\"" + *le + "\"");
+    }
+    if(items.empty()) {
+        return name;
+    }
+    auto series = name + "{";
+    for(std::size_t i=0; i<items.size(); ++i) {
+        series += (i > 0 ? "," : "") + items[i];
+    }
+    return series + "}";
+}
+
+/**
+ * The samples of a textfile, grouped by metric family in order of appearance
+ */
+class Textfile {
+public:
+    explicit Textfile(const std::string& content) {
+        auto is = std::istringstream{content};
+        auto line = std::string{};
+        Family* family = nullptr;
+        while(std::getline(is, line)) {
+            if(line.compare(0, 7, "# TYPE ") == 0) {
+                auto fields = std::istringstream{line.substr(7)};
+                auto name = std::string{};
+                auto type = std::string{};
+                fields >> name >> type;
+                family = &getFamily(name, type);
+            }
+            else if(!line.empty() && line[0] != '#' && family) {
+                auto separator = line.find_last_of(' ');
+                if(separator == std::string::npos) {
+                    continue;
+                }
+                try {
+                    add(*family, line.substr(0, separator), std::stod(line.substr(separator+1)));
+                }
+                catch(std::exception&) {
+                    continue; // drop malformed samples instead of failing the export
+                }
+            }
+        }
+    }
+
+    void add(const std::string& familyName, const std::string& type, const std::string& series, double value) {
+        add(getFamily(familyName, type), series, value);
+    }
+
+    std::string str() const {
+        auto os = std::ostringstream{};
+        for(const auto& family : families) {
+            os << "# TYPE " << family.name << " " << family.type << "\n";
+            for(const auto& sample : family.samples) {
+                os << sample.first << " " << formatValue(sample.second) << "\n";
+            }
+        }
+        return os.str();
+    }
+
+private:
+    struct Family {
+        std::string name;
+        std::string type;
+        std::vector<std::pair<std::string, double>> samples;
+        std::unordered_map<std::string, std::size_t> indexOfSample;
+    };
+
+    Family& getFamily(const std::string& name, const std::string& type) {
+        auto it = std::find_if(families.begin(), families.end(), [&name](const Family& f) {
+            return f.name == name;
+        });
+        if(it != families.end()) {
+            return *it;
+        }
+        families.push_back(Family{name, type, {}, {}});
+        return families.back();
+    }
+
+    void add(Family& family, const std::string& series, double value) {
+        auto it = family.indexOfSample.find(series);
+        if(it != family.indexOfSample.cend()) {
+            family.samples[it->second].second += value;
+        }
+        else {
+            family.indexOfSample[series] = family.samples.size();
+            family.samples.emplace_back(series, value);
+        }
+    }
+
+private:
+    std::vector<Family> families;
+};
+
+void logMetricsMessage(const boost::format& message, LogLevel level) {
+    Logger::getInstance().log(message, "Metrics", level);
+}
+
+} // namespace
+
+Metrics::ScopedTimer::ScopedTimer(std::string name, Labels labels)
+    : name{std::move(name)}
+    , labels{std::move(labels)}
+    , start{std::chrono::steady_clock::now()}
+{}
+
+Metrics::ScopedTimer::ScopedTimer(ScopedTimer&& rhs)
+    : name{std::move(rhs.name)}
+    , labels{std::move(rhs.labels)}
+    , start{rhs.start}
+{
+    rhs.isActive = false;
+}
+
+Metrics::ScopedTimer::~ScopedTimer() {
+    if(!isActive) {
+        return;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    Metrics::getInstance().observe(name, elapsed.count(), labels);
+}
+
+Metrics& Metrics::getInstance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::~Metrics() {
+    closeSinks();
+}
+
+const std::vector<double>& Metrics::getHistogramBuckets() {
+    static const auto buckets = std::vector<double>{
+        0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600};
+    return buckets;
+}
+
+void Metrics::configure(const common::Config& config) {
+    auto textfileDirectory = boost::optional<boost::filesystem::path>{};
+    auto socket = boost::optional<boost::filesystem::path>{};
+    if(const auto* value = rapidjson::Pointer("/metrics/textfileDirectory").Get(config.json)) {
+        textfileDirectory = boost::filesystem::path{value->GetString()};
+    }
+    if(const auto* value = rapidjson::Pointer("/metrics/socket").Get(config.json)) {
+        socket = boost::filesystem::path{value->GetString()};
+    }
+    configure(textfileDirectory, socket, config.userIdentity.uid, config.userIdentity.gid);
+}
+
+void Metrics::configure(const boost::optional<boost::filesystem::path>& textfileDirectory,
+                        const boost::optional<boost::filesystem::path>& socket,
+                        uid_t uid,
+                        gid_t gid) {
+    closeSinks();
+    clear();
+    this->uid = uid;
+    this->gid = gid;
+
+    if(textfileDirectory) {
+        textfileDirectoryFd = open(textfileDirectory->c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(textfileDirectoryFd < 0) {
+            logMetricsMessage(boost::format("Failed to open metrics textfile directory %s: %s")
+                              % *textfileDirectory % strerror(errno), LogLevel::INFO);
+        }
+    }
+
+    if(socket) {
+        auto address = sockaddr_un{};
+        address.sun_family = AF_UNIX;
+        if(socket->string().size() >= sizeof(address.sun_path)) {
+            logMetricsMessage(boost::format("Metrics socket path %s is too long") % *socket, LogLevel::INFO);
+            return;
+        }
+        std::strncpy(address.sun_path, socket->c_str(), sizeof(address.sun_path) - 1);
+
+        socketFd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(socketFd >= 0 && connect(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            logMetricsMessage(boost::format("Failed to connect to metrics socket %s: %s")
+                              % *socket % strerror(errno), LogLevel::INFO);
+            close(socketFd);
+            socketFd = -1;
+        }
+    }
+}
+
+void Metrics::incrementCounter(const std::string& name, const Labels& labels, double value) {
+    if(!isEnabled()) {
+        return;
+    }
+    auto allLabels = addDefaultLabels(labels);
+    if(textfileDirectoryFd >= 0) {
+        counters[SeriesKey{name, allLabels}] += value;
+    }
+    if(socketFd >= 0) {
+        datagrams.push_back(makeDatagram(name, formatValue(value), "c", allLabels));
+    }
+}
+
+void Metrics::observe(const std::string& name, double seconds, const Labels& labels) {
+    if(!isEnabled()) {
+        return;
+    }
+    auto allLabels = addDefaultLabels(labels);
+    if(textfileDirectoryFd >= 0) {
+        auto& histogram = histograms[SeriesKey{name, allLabels}];
+        const auto& buckets = getHistogramBuckets();
+        for(std::size_t i=0; i<buckets.size(); ++i) {
+            if(seconds <= buckets[i]) {
+                ++histogram.bucketCounts[i];
+            }
+        }
+        histogram.sum += seconds;
+        ++histogram.count;
+    }
+    if(socketFd >= 0) {
+        datagrams.push_back(makeDatagram(name, formatValue(seconds * 1000), "ms", allLabels));
+    }
+}
+
+void Metrics::flush() {
+    if(!isEnabled()) {
+        return;
+    }
+    if(textfileDirectoryFd >= 0 && !(counters.empty() && histograms.empty())) {
+        try {
+            exportToTextfile();
+        }
+        catch(const std::exception& e) {
+            logMetricsMessage(boost::format("Failed to export metrics to textfile: %s") % e.what(), LogLevel::INFO);
+        }
+    }
+    if(socketFd >= 0) {
+        try {
+            exportToSocket();
+        }
+        catch(const std::exception& e) {
+            logMetricsMessage(boost::format("Failed to export metrics to socket: %s") % e.what(), LogLevel::INFO);
+        }
+    }
+    clear();
+}
+
+/**
+ * Merges the metrics collected by this process into the samples of a textfile previously
+ * written by other processes: counters are added up and histograms are combined bucket-wise.
+ */
+std::string Metrics::formatTextfile(const std::string& previousContent) const {
+    auto textfile = Textfile{previousContent};
+
+    for(const auto& counter : counters) {
+        auto family = counter.first.first + "_total";
+        textfile.add(family, "counter", makeSeries(family, counter.first.second), counter.second);
+    }
+
+    const auto& buckets = getHistogramBuckets();
+    for(const auto& entry : histograms) {
+        auto family = entry.first.first + "_seconds";
+        const auto& labels = entry.first.second;
+        const auto& histogram = entry.second;
+        for(std::size_t i=0; i<buckets.size(); ++i) {
+            textfile.add(family, "histogram", makeSeries(family + "_bucket", labels, formatValue(buckets[i])),
+                         histogram.bucketCounts[i]);
+        }
+        textfile.add(family, "histogram", makeSeries(family + "_bucket", labels, std::string{"+Inf"}), histogram.count);
+        textfile.add(family, "histogram", makeSeries(family + "_sum", labels), histogram.sum);
+        textfile.add(family, "histogram", makeSeries(family + "_count", labels), histogram.count);
+    }
+
+    return textfile.str();
+}
+
+Metrics::Labels Metrics::addDefaultLabels(const Labels& labels) const {
+    auto allLabels = labels;
+    allLabels["uid"] = std::to_string(uid); // keeps the series of the per-user textfiles distinct
+    return allLabels;
+}
+
+std::string Metrics::makeDatagram(const std::string& name, const std::string& value,
+                                  const std::string& type, const Labels& labels) const {
+    auto datagram = name + ":" + value + "|" + type;
+    auto separator = "|#";
+    for(const auto& label : labels) {
+        datagram += separator + label.first + ":" + label.second;
+        separator = ",";
+    }
+    return datagram;
+}
+
+void Metrics::exportToTextfile() const {
+    // create the files on behalf of the user, so that the user's own (unprivileged)
+    // Sarus processes can update them later on
+    auto needsFilesystemUid = geteuid() == 0 && uid != 0;
+    if(needsFilesystemUid) {
+        setfsgid(gid);
+        setfsuid(uid);
+    }
+
+    auto restoreFilesystemUid = [needsFilesystemUid]() {
+        if(needsFilesystemUid) {
+            setfsuid(0);
+            setfsgid(0);
+        }
+    };
+
+    auto fileName = "sarus_" + std::to_string(uid) + ".prom";
+    auto lockName = fileName + ".lock";
+    auto tempName = fileName + ".tmp-" + common::generateRandomString(16);
+    int lockFd = -1;
+    int fd = -1;
+
+    try {
+        lockFd = openat(textfileDirectoryFd, lockName.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if(lockFd < 0 || flock(lockFd, LOCK_EX) != 0) {
+            auto message = boost::format("Failed to lock %s: %s") % lockName % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+
+        auto previousContent = std::string{};
+        fd = openat(textfileDirectoryFd, fileName.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if(fd >= 0) {
+            char buffer[4096];
+            ssize_t n;
+            while((n = read(fd, buffer, sizeof(buffer))) > 0) {
+                previousContent.append(buffer, n);
+            }
+            close(fd);
+            fd = -1;
+        }
+        else if(errno != ENOENT) {
+            auto message = boost::format("Failed to open %s: %s") % fileName % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+
+        auto content = formatTextfile(previousContent);
+        fd = openat(textfileDirectoryFd, tempName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if(fd < 0) {
+            auto message = boost::format("Failed to create %s: %s") % tempName % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        std::size_t written = 0;
+        while(written < content.size()) {
+            auto n = write(fd, content.data() + written, content.size() - written);
+            if(n < 0) {
+                auto message = boost::format("Failed to write %s: %s") % tempName % strerror(errno);
+                unlinkat(textfileDirectoryFd, tempName.c_str(), 0);
+                SARUS_THROW_ERROR(message.str());
+            }
+            written += n;
+        }
+        close(fd);
+        fd = -1;
+
+        // atomically replace the file read by the textfile collector
+        if(renameat(textfileDirectoryFd, tempName.c_str(), textfileDirectoryFd, fileName.c_str()) != 0) {
+            auto message = boost::format("Failed to rename %s to %s: %s") % tempName % fileName % strerror(errno);
+            unlinkat(textfileDirectoryFd, tempName.c_str(), 0);
+            SARUS_THROW_ERROR(message.str());
+        }
+    }
+    catch(...) {
+        if(fd >= 0) {
+            close(fd);
+        }
+        if(lockFd >= 0) {
+            close(lockFd);
+        }
+        restoreFilesystemUid();
+        throw;
+    }
+
+    close(lockFd);
+    restoreFilesystemUid();
+}
+
+void Metrics::exportToSocket() const {
+    for(const auto& datagram : datagrams) {
+        if(send(socketFd, datagram.c_str(), datagram.size(), MSG_NOSIGNAL) < 0) {
+            auto message = boost::format("Failed to send metrics to socket: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+    }
+}
+
+void Metrics::clear() {
+    counters.clear();
+    histograms.clear();
+    datagrams.clear();
+}
+
+void Metrics::closeSinks() {
+    if(textfileDirectoryFd >= 0) {
+        close(textfileDirectoryFd);
+        textfileDirectoryFd = -1;
+    }
+    if(socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+}
+
+}
+}
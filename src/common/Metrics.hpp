@@ -0,0 +1,117 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_Metrics_hpp
+#define sarus_common_Metrics_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace common {
+
+class Config;
+
+/**
+ * Collects counters and latency histograms during the lifetime of a Sarus process
+ * (or hook) and exports them when flush() is called. Two sinks are supported:
+ *
+ * - a directory read by the Prometheus node exporter's textfile collector: the samples
+ *   are merged into the per-user file "sarus_<uid>.prom", which is atomically replaced
+ *   while holding a lock, so that concurrent processes of the same user never lose updates.
+ * - a UNIX datagram socket: every sample is sent as one StatsD line, e.g.
+ *   "sarus_image_phase:1234.5|ms|#phase:mksquashfs,uid:1000", ready to be consumed by a statsd_exporter.
+ *
+ * The directory and the socket are opened by configure(), thus the export keeps working
+ * after the process changed its mount namespace (e.g. OCI hooks entering the container).
+ * Exporting is best effort: errors are logged and never make the caller fail.
+ */
+class Metrics {
+public:
+    using Labels = std::map<std::string, std::string>;
+
+    class ScopedTimer {
+    public:
+        ScopedTimer(std::string name, Labels labels = {});
+        ScopedTimer(ScopedTimer&&);
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ~ScopedTimer();
+
+    private:
+        std::string name;
+        Labels labels;
+        std::chrono::steady_clock::time_point start;
+        bool isActive = true;
+    };
+
+public:
+    static Metrics& getInstance();
+
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+    ~Metrics();
+
+    void configure(const common::Config& config);
+    void configure(const boost::optional<boost::filesystem::path>& textfileDirectory,
+                   const boost::optional<boost::filesystem::path>& socket,
+                   uid_t uid,
+                   gid_t gid);
+    bool isEnabled() const { return textfileDirectoryFd >= 0 || socketFd >= 0; }
+
+    void incrementCounter(const std::string& name, const Labels& labels = {}, double value = 1);
+    void observe(const std::string& name, double seconds, const Labels& labels = {});
+    void flush();
+
+    std::string formatTextfile(const std::string& previousContent) const;
+
+    static const std::vector<double>& getHistogramBuckets();
+
+private:
+    struct Histogram {
+        std::vector<std::uint64_t> bucketCounts = std::vector<std::uint64_t>(getHistogramBuckets().size(), 0);
+        double sum = 0;
+        std::uint64_t count = 0;
+    };
+    using SeriesKey = std::pair<std::string, Labels>;
+
+    Labels addDefaultLabels(const Labels& labels) const;
+    std::string makeDatagram(const std::string& name, const std::string& value,
+                             const std::string& type, const Labels& labels) const;
+    void exportToTextfile() const;
+    void exportToSocket() const;
+    void clear();
+    void closeSinks();
+
+private:
+    int textfileDirectoryFd = -1;
+    int socketFd = -1;
+    uid_t uid = 0;
+    gid_t gid = 0;
+    std::map<SeriesKey, double> counters;
+    std::map<SeriesKey, Histogram> histograms;
+    std::vector<std::string> datagrams;
+};
+
+}
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include "PathRAII.hpp"
 #include "Error.hpp"
 #include "Utility.hpp"
+#include "TreeRemoval.hpp"
 
 
 namespace sarus {
@@ -30,23 +31,37 @@ PathRAII::PathRAII(const boost::filesystem::path& path)
 
 PathRAII::PathRAII(PathRAII&& rhs)
     : path{std::move(rhs.path)}
+    , trashDir{std::move(rhs.trashDir)}
 {
     rhs.release();
 }
 
 PathRAII& PathRAII::operator=(PathRAII&& rhs) {
     path = std::move(rhs.path);
+    trashDir = std::move(rhs.trashDir);
     rhs.release();
     return *this;
 }
 
 PathRAII::~PathRAII() {
-    if(path && boost::filesystem::exists(*path)) {
-        // Ensure the path contents can be removed by enforcing owner write and exec permissions.
-        // This is needed when using PathRAII for unpacked OCI image files, because
-        // some images (e.g. Fedora) contain files without owner write or search perms
-        setFilesAsRemovableByOwner();
-        boost::filesystem::remove_all(*path);
+    if(!path) {
+        return;
+    }
+    // The removal adds the owner's write and search permissions to the directories as needed.
+    // This is needed when using PathRAII for unpacked OCI image files, because
+    // some images (e.g. Fedora) contain files without owner write or search perms
+    // A destructor must not throw, thus a failed removal is only logged
+    try {
+        if(trashDir) {
+            removeTreeInBackground(*path, *trashDir);
+        }
+        else {
+            removeTree(*path);
+        }
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Failed to remove %s: %s") % *path % e.what();
+        logMessage(message, LogLevel::WARN);
     }
 }
 
@@ -58,19 +73,8 @@ void PathRAII::release() {
     path.reset();
 }
 
-void PathRAII::setFilesAsRemovableByOwner() const {
-    auto requiredPermissions = boost::filesystem::perms::owner_write | boost::filesystem::perms::owner_exe;
-    boost::filesystem::permissions(*path, boost::filesystem::perms::add_perms | requiredPermissions);
-
-    if (boost::filesystem::is_regular_file(*path)) {
-        return;
-    }
-
-    for (const auto& entry : boost::filesystem::recursive_directory_iterator(*path)) {
-        if (!isSymlink(entry.path())) {
-            boost::filesystem::permissions(entry.path(), boost::filesystem::perms::add_perms | requiredPermissions);
-        }
-    }
+void PathRAII::setDeferredRemoval(const boost::filesystem::path& trashDir) {
+    this->trashDir = trashDir;
 }
 
 }
@@ -32,11 +32,12 @@ public:
 
     const boost::filesystem::path& getPath() const;
     void release();
+    // the path will be moved into the trash directory and removed in background
+    void setDeferredRemoval(const boost::filesystem::path& trashDir);
 
 private:
-    void setFilesAsRemovableByOwner() const;
-
     boost::optional<boost::filesystem::path> path;
+    boost::optional<boost::filesystem::path> trashDir;
 };
 
 }
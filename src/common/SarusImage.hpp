@@ -11,7 +11,10 @@
 #ifndef _SarusImage_hpp
 #define _SarusImage_hpp
 
+#include <cstdint>
+#include <ctime>
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 #include "ImageReference.hpp"
@@ -38,6 +41,18 @@ struct SarusImage {
 
     boost::filesystem::path imageFile;
     boost::filesystem::path metadataFile;
+    std::vector<boost::filesystem::path> lowerImageFiles;  // images stacked below imageFile, topmost first,
+                                                           // when the image is stored as a delta
+                                                           // (see image_manager::ImageDelta)
+
+    time_t lastUsed;             // The time of the last launch recorded in the access log of the repository,
+                                 // 0 if the image was never launched (see image_manager::access_log)
+    std::uint64_t launchCount;
+    std::uint64_t numberOfNodes; // The number of distinct nodes which launched the image
+
+    std::string imageFileDigest; // The SHA-256 digest of imageFile recorded by "sarus broadcast",
+                                 // against which the node-local staged copies of the image are verified;
+                                 // empty if the image was never broadcast (see image_manager::ImageBroadcast)
 
     static std::string createTimeString(time_t time_in);
     static std::string createSizeString(size_t size);
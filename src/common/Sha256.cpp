@@ -0,0 +1,198 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "common/Sha256.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "common/Error.hpp"
+
+
+namespace sarus {
+namespace common {
+
+namespace {
+
+const std::uint32_t roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline std::uint32_t rotateRight(std::uint32_t x, unsigned int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+std::string hexToBytes(const std::string& hex) {
+    auto value = [](char c) {
+        return static_cast<char>(c <= '9' ? c - '0' : c - 'a' + 10);
+    };
+    auto bytes = std::string{};
+    for(std::size_t i=0; i+1<hex.size(); i+=2) {
+        bytes.push_back(static_cast<char>(value(hex[i]) << 4 | value(hex[i+1])));
+    }
+    return bytes;
+}
+
+} // namespace
+
+Sha256::Sha256()
+    : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+{}
+
+void Sha256::update(const void* data, std::size_t size) {
+    auto* bytes = static_cast<const unsigned char*>(data);
+    totalSize += size;
+
+    if(bufferSize > 0) {
+        auto n = std::min(size, sizeof(buffer) - bufferSize);
+        std::memcpy(buffer + bufferSize, bytes, n);
+        bufferSize += n;
+        bytes += n;
+        size -= n;
+        if(bufferSize < sizeof(buffer)) {
+            return;
+        }
+        processBlock(buffer);
+        bufferSize = 0;
+    }
+
+    while(size >= sizeof(buffer)) {
+        processBlock(bytes);
+        bytes += sizeof(buffer);
+        size -= sizeof(buffer);
+    }
+
+    std::memcpy(buffer, bytes, size);
+    bufferSize = size;
+}
+
+std::string Sha256::hexDigest() {
+    auto bitSize = totalSize * 8;
+
+    unsigned char padding[64] = {0x80};
+    auto paddingSize = (bufferSize < 56) ? (56 - bufferSize) : (120 - bufferSize);
+    update(padding, paddingSize);
+
+    unsigned char length[8];
+    for(int i=0; i<8; ++i) {
+        length[i] = static_cast<unsigned char>(bitSize >> (56 - 8*i));
+    }
+    update(length, sizeof(length));
+
+    static const char* hexDigits = "0123456789abcdef";
+    auto digest = std::string{};
+    digest.reserve(64);
+    for(auto word : state) {
+        for(int shift=28; shift>=0; shift-=4) {
+            digest.push_back(hexDigits[(word >> shift) & 0xf]);
+        }
+    }
+    return digest;
+}
+
+std::string Sha256::digestOfFile(const boost::filesystem::path& file) {
+    std::ifstream is{file.string(), std::ios::binary};
+    if(!is) {
+        auto message = boost::format("Failed to open %s to compute its SHA-256 digest") % file;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto sha = Sha256{};
+    auto chunk = std::vector<char>(1 << 20);
+    while(is) {
+        is.read(chunk.data(), chunk.size());
+        sha.update(chunk.data(), is.gcount());
+    }
+    if(is.bad()) {
+        auto message = boost::format("Failed to read %s to compute its SHA-256 digest") % file;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return sha.hexDigest();
+}
+
+std::string Sha256::hmacHexDigest(const std::string& key, const std::string& message) {
+    const std::size_t blockSize = 64;
+    auto blockKey = key;
+    if(blockKey.size() > blockSize) {
+        auto sha = Sha256{};
+        sha.update(key.data(), key.size());
+        blockKey = hexToBytes(sha.hexDigest());
+    }
+    blockKey.resize(blockSize, '\0');
+
+    auto innerPad = blockKey;
+    auto outerPad = blockKey;
+    for(std::size_t i=0; i<blockSize; ++i) {
+        innerPad[i] ^= 0x36;
+        outerPad[i] ^= 0x5c;
+    }
+
+    auto inner = Sha256{};
+    inner.update(innerPad.data(), innerPad.size());
+    inner.update(message.data(), message.size());
+    auto innerDigest = hexToBytes(inner.hexDigest());
+
+    auto outer = Sha256{};
+    outer.update(outerPad.data(), outerPad.size());
+    outer.update(innerDigest.data(), innerDigest.size());
+    return outer.hexDigest();
+}
+
+void Sha256::processBlock(const unsigned char* block) {
+    std::uint32_t w[64];
+    for(int i=0; i<16; ++i) {
+        w[i] = (std::uint32_t(block[4*i]) << 24)
+             | (std::uint32_t(block[4*i+1]) << 16)
+             | (std::uint32_t(block[4*i+2]) << 8)
+             | std::uint32_t(block[4*i+3]);
+    }
+    for(int i=16; i<64; ++i) {
+        auto s0 = rotateRight(w[i-15], 7) ^ rotateRight(w[i-15], 18) ^ (w[i-15] >> 3);
+        auto s1 = rotateRight(w[i-2], 17) ^ rotateRight(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    auto a = state[0], b = state[1], c = state[2], d = state[3];
+    auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for(int i=0; i<64; ++i) {
+        auto s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        auto choice = (e & f) ^ (~e & g);
+        auto t1 = h + s1 + choice + roundConstants[i] + w[i];
+        auto s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        auto majority = (a & b) ^ (a & c) ^ (b & c);
+        auto t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+}
+}
@@ -0,0 +1,54 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_Sha256_hpp
+#define sarus_common_Sha256_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace common {
+
+/**
+ * Incremental SHA-256 (FIPS 180-4) computation.
+ *
+ * Data can be fed in arbitrarily sized pieces through update(), which makes the class
+ * suitable to digest streams while they are being transferred or written, without
+ * having to read the data a second time.
+ */
+class Sha256 {
+public:
+    Sha256();
+    void update(const void* data, std::size_t size);
+    std::string hexDigest(); // finalizes the computation, the object must not be updated afterwards
+
+    static std::string digestOfFile(const boost::filesystem::path& file);
+    // HMAC-SHA-256 (RFC 2104) of a message, e.g. to authenticate data received from the network
+    static std::string hmacHexDigest(const std::string& key, const std::string& message);
+
+private:
+    void processBlock(const unsigned char* block);
+
+private:
+    std::uint32_t state[8];
+    unsigned char buffer[64];
+    std::size_t bufferSize = 0;
+    std::uint64_t totalSize = 0;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "TreeRemoval.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
+
+#include "common/Error.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace common {
+
+namespace {
+
+struct Directory {
+    int fd = -1;
+    std::shared_ptr<Directory> parent;
+    std::string name; // name in the parent directory (the full path for the root of the tree)
+    std::atomic<std::size_t> pending{1}; // own scan + subdirectories not yet removed
+};
+
+class ParallelTreeRemover {
+public:
+    ParallelTreeRemover(unsigned int numberOfThreads)
+        : queues(std::max(numberOfThreads, 1u))
+    {}
+
+    void remove(const boost::filesystem::path& root) {
+        struct stat st;
+        if(lstat(root.c_str(), &st) != 0) {
+            if(errno == ENOENT) {
+                return;
+            }
+            recordError("stat", root.string(), errno);
+        }
+        else if(!S_ISDIR(st.st_mode)) {
+            if(unlink(root.c_str()) != 0 && errno != ENOENT) {
+                recordError("remove", root.string(), errno);
+            }
+        }
+        else {
+            // scan the root in this thread and only start the pool if there are subdirectories
+            outstandingTasks = 1;
+            processDirectory(0, Task{nullptr, root.string()});
+            --outstandingTasks;
+
+            auto threads = std::vector<std::thread>{};
+            if(outstandingTasks > 0) {
+                for(std::size_t i=1; i<queues.size(); ++i) {
+                    threads.emplace_back(&ParallelTreeRemover::work, this, i);
+                }
+                work(0);
+            }
+            for(auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        if(error) {
+            SARUS_THROW_ERROR(*error);
+        }
+    }
+
+private:
+    struct Task {
+        std::shared_ptr<Directory> parent;
+        std::string name;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // the threads without tasks sleep until a task is queued or the whole tree is removed
+    void work(std::size_t self) {
+        auto task = Task{};
+        while(true) {
+            if(pop(self, task) || steal(self, task)) {
+                processDirectory(self, task);
+                if(--outstandingTasks == 0) {
+                    std::lock_guard<std::mutex> lock{idleMutex};
+                    workAvailable.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock{idleMutex};
+            ++idleThreads;
+            workAvailable.wait(lock, [this]() { return outstandingTasks == 0 || queuedTasks > 0; });
+            --idleThreads;
+            if(outstandingTasks == 0) {
+                return;
+            }
+        }
+    }
+
+    void push(std::size_t self, Task task) {
+        ++outstandingTasks;
+        {
+            std::lock_guard<std::mutex> lock{queues[self].mutex};
+            queues[self].tasks.push_back(std::move(task));
+        }
+        // a thread going idle counts itself before checking for queued tasks, thus either it
+        // sees this task or it is counted here and woken up
+        ++queuedTasks;
+        if(idleThreads > 0) {
+            std::lock_guard<std::mutex> lock{idleMutex};
+            workAvailable.notify_one();
+        }
+    }
+
+    // the owner works depth-first, which bounds the number of open directories
+    bool pop(std::size_t self, Task& task) {
+        std::lock_guard<std::mutex> lock{queues[self].mutex};
+        if(queues[self].tasks.empty()) {
+            return false;
+        }
+        task = std::move(queues[self].tasks.back());
+        queues[self].tasks.pop_back();
+        --queuedTasks;
+        return true;
+    }
+
+    // thieves take the oldest tasks, i.e. the ones closest to the root of the tree
+    bool steal(std::size_t self, Task& task) {
+        for(std::size_t i=1; i<queues.size(); ++i) {
+            auto& victim = queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock{victim.mutex};
+            if(!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --queuedTasks;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void processDirectory(std::size_t self, const Task& task) {
+        auto parentFd = task.parent ? task.parent->fd : AT_FDCWD;
+        auto fd = openDirectory(parentFd, task.name);
+        if(fd < 0) {
+            if(errno != ENOENT) {
+                recordError("open", getPath(task.parent, task.name), errno);
+            }
+            complete(task.parent);
+            return;
+        }
+
+        auto directory = std::make_shared<Directory>();
+        directory->fd = fd;
+        directory->parent = task.parent;
+        directory->name = task.name;
+
+        // entries can only be listed and removed with the owner's permissions on the directory
+        struct stat st;
+        const auto requiredPermissions = S_IRUSR | S_IWUSR | S_IXUSR;
+        if(fstat(fd, &st) == 0 && (st.st_mode & requiredPermissions) != requiredPermissions) {
+            fchmod(fd, (st.st_mode & 07777) | requiredPermissions);
+        }
+
+        auto streamFd = dup(fd);
+        auto* stream = streamFd >= 0 ? fdopendir(streamFd) : nullptr;
+        if(!stream) {
+            recordError("list", getPath(directory), errno);
+            if(streamFd >= 0) {
+                close(streamFd);
+            }
+            complete(directory);
+            return;
+        }
+
+        while(auto* entry = readdir(stream)) {
+            if(std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            auto isDirectory = entry->d_type == DT_DIR;
+            if(entry->d_type == DT_UNKNOWN) {
+                struct stat entryStat;
+                isDirectory = fstatat(fd, entry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == 0
+                              && S_ISDIR(entryStat.st_mode);
+            }
+
+            if(isDirectory) {
+                ++directory->pending;
+                push(self, Task{directory, entry->d_name});
+            }
+            else if(unlinkat(fd, entry->d_name, 0) != 0 && errno != ENOENT) {
+                recordError("remove", getPath(directory, entry->d_name), errno);
+            }
+        }
+        closedir(stream);
+
+        complete(directory);
+    }
+
+    static int openDirectory(int parentFd, const std::string& name) {
+        const auto flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+        auto fd = openat(parentFd, name.c_str(), flags);
+        if(fd < 0 && errno == EACCES) {
+            struct stat st;
+            if(fstatat(parentFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0
+               && fchmodat(parentFd, name.c_str(), (st.st_mode & 07777) | S_IRWXU, 0) == 0) {
+                fd = openat(parentFd, name.c_str(), flags);
+            }
+            else {
+                errno = EACCES;
+            }
+        }
+        return fd;
+    }
+
+    // removes the directories whose subtrees have been completely removed, bottom-up
+    void complete(std::shared_ptr<Directory> directory) {
+        while(directory && directory->pending.fetch_sub(1) == 1) {
+            close(directory->fd);
+            auto parentFd = directory->parent ? directory->parent->fd : AT_FDCWD;
+            if(unlinkat(parentFd, directory->name.c_str(), AT_REMOVEDIR) != 0 && errno != ENOENT) {
+                recordError("remove", getPath(directory), errno);
+            }
+            directory = directory->parent;
+        }
+    }
+
+    static std::string getPath(std::shared_ptr<Directory> parent, const std::string& name) {
+        auto path = boost::filesystem::path{name};
+        for(; parent; parent = parent->parent) {
+            path = boost::filesystem::path{parent->name} / path;
+        }
+        return path.string();
+    }
+
+    static std::string getPath(const std::shared_ptr<Directory>& directory) {
+        return getPath(directory->parent, directory->name);
+    }
+
+    void recordError(const std::string& operation, const std::string& path, int errorNumber) {
+        std::lock_guard<std::mutex> lock{errorMutex};
+        if(!error) {
+            error = (boost::format("Failed to %s %s while removing directory tree: %s")
+                % operation % path % strerror(errorNumber)).str();
+        }
+    }
+
+private:
+    std::vector<Queue> queues;
+    std::atomic<std::size_t> outstandingTasks{0};
+    std::atomic<std::size_t> queuedTasks{0};
+    std::atomic<std::size_t> idleThreads{0};
+    std::mutex idleMutex;
+    std::condition_variable workAvailable;
+    std::mutex errorMutex;
+    boost::optional<std::string> error;
+};
+
+}
+
+/**
+ * Removal is bound by the latency of metadata operations (especially on parallel
+ * filesystems) rather than by CPU, thus more threads than cores are used.
+ */
+unsigned int getDefaultNumberOfRemovalThreads() {
+    auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::min(2 * cores, 32u);
+}
+
+void removeTree(const boost::filesystem::path& path, unsigned int numberOfThreads) {
+    ParallelTreeRemover{numberOfThreads}.remove(path);
+}
+
+bool isTrashDirectoryTrusted(const boost::filesystem::path& trashDir, uid_t owner) {
+    struct stat trashStat;
+    return lstat(trashDir.c_str(), &trashStat) == 0
+        && S_ISDIR(trashStat.st_mode)
+        && trashStat.st_uid == owner
+        && (trashStat.st_mode & 07777) == S_IRWXU;
+}
+
+void removeTreeInBackground(const boost::filesystem::path& path, const boost::filesystem::path& trashDir) {
+    auto trashPath = boost::filesystem::path{};
+    try {
+        createFoldersIfNecessary(trashDir.parent_path());
+        if(mkdir(trashDir.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+            auto message = boost::format("Failed to create trash directory %s: %s") % trashDir % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        struct stat treeStat;
+        if(lstat(path.c_str(), &treeStat) != 0) {
+            removeTree(path);
+            return;
+        }
+        if(!isTrashDirectoryTrusted(trashDir, treeStat.st_uid)) {
+            auto message = boost::format("Refusing to use trash directory %s: expected a directory owned by uid %d"
+                                         " with mode 0700. Removing %s synchronously") % trashDir % treeStat.st_uid % path;
+            logMessage(message, LogLevel::WARN);
+            removeTree(path);
+            return;
+        }
+        trashPath = makeUniquePathWithRandomSuffix(trashDir / path.filename());
+    }
+    catch(const common::Error&) {
+        removeTree(path);
+        return;
+    }
+
+    if(rename(path.c_str(), trashPath.c_str()) != 0) {
+        if(errno != ENOENT) {
+            removeTree(path);
+        }
+        return;
+    }
+
+    // double fork, so that the remover is detached and reparented to init
+    auto pid = fork();
+    if(pid < 0) {
+        removeTree(trashPath);
+        return;
+    }
+    if(pid == 0) {
+        setsid();
+        if(fork() == 0) {
+            // don't hold the standard streams of the caller (e.g. pipes read until EOF)
+            auto devNull = open("/dev/null", O_RDWR);
+            if(devNull >= 0) {
+                dup2(devNull, STDIN_FILENO);
+                dup2(devNull, STDOUT_FILENO);
+                dup2(devNull, STDERR_FILENO);
+            }
+            try {
+                removeTree(trashPath);
+            }
+            catch(...) {}
+            _exit(0);
+        }
+        _exit(0);
+    }
+
+    int status;
+    while(waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+}
+
+}
+}
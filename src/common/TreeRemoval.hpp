@@ -0,0 +1,53 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_common_TreeRemoval_hpp
+#define sarus_common_TreeRemoval_hpp
+
+#include <sys/types.h>
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace common {
+
+unsigned int getDefaultNumberOfRemovalThreads();
+
+/**
+ * Removes a file or a directory tree, like "rm -rf".
+ *
+ * The tree is walked only once, by a pool of threads which steal subdirectories
+ * from each other. Entries are removed relative to the file descriptors of their
+ * parent directories (openat/unlinkat), and the directories which lack the owner's
+ * read, write or search permission (e.g. in the unpacked root filesystem of some
+ * images) get them added along the way. Symlinks are removed, never followed.
+ */
+void removeTree(const boost::filesystem::path& path,
+                unsigned int numberOfThreads = getDefaultNumberOfRemovalThreads());
+
+/**
+ * The trash directory may be at a predictable path in a shared directory (e.g. /tmp), thus it is
+ * trusted only if it is a directory (not a symlink) owned by the given user and accessible only
+ * by them, i.e. it could not have been created or tampered with by another user.
+ */
+bool isTrashDirectoryTrusted(const boost::filesystem::path& trashDir, uid_t owner);
+
+/**
+ * Renames the tree into the trash directory (which must be on the same filesystem)
+ * and removes it in a detached background process, returning immediately. If the
+ * tree cannot be renamed, or the trash directory is not a directory with mode 0700
+ * owned by the owner of the tree, the tree is removed synchronously.
+ */
+void removeTreeInBackground(const boost::filesystem::path& path, const boost::filesystem::path& trashDir);
+
+}
+}
+
+#endif
@@ -10,6 +10,7 @@
 
 #include "Utility.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <array>
@@ -28,6 +29,7 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <sys/fsuid.h>
 #include <sched.h>
 #include <pwd.h>
@@ -40,6 +42,9 @@
 #include <rapidjson/istreamwrapper.h>
 #include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/filereadstream.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/encodedstream.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/error/en.h>
@@ -340,6 +345,31 @@ size_t getFileSize(const boost::filesystem::path& filename) {
     return st.st_size;
 }
 
+/**
+ * Returns the space allocated on disk for the given file or directory tree, in bytes.
+ * Symlinks are not followed. Unlike "du", files with multiple hard links in the tree
+ * are counted once per link.
+ */
+std::uintmax_t getDiskUsage(const boost::filesystem::path& path) {
+    auto getAllocatedSize = [](const boost::filesystem::path& path) {
+        struct stat st;
+        if(lstat(path.c_str(), &st) != 0) {
+            auto message = boost::format("Failed to retrieve disk usage of %s. Stat failed: %s")
+                % path % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        return static_cast<std::uintmax_t>(st.st_blocks) * 512;
+    };
+
+    auto usage = getAllocatedSize(path);
+    if(boost::filesystem::is_directory(boost::filesystem::symlink_status(path))) {
+        for(const auto& entry : boost::filesystem::recursive_directory_iterator(path)) {
+            usage += getAllocatedSize(entry.path());
+        }
+    }
+    return usage;
+}
+
 dev_t getDeviceID(const boost::filesystem::path& path) {
     struct stat sb;
     if(stat(path.c_str(), &sb) != 0) {
@@ -411,6 +441,10 @@ boost::filesystem::path getCentralizedRepositoryDirectory(const common::Config&
 
 boost::filesystem::path getLocalRepositoryDirectory(const common::Config& config) {
     auto baseDir = boost::filesystem::path{ config.json["localRepositoryBaseDir"].GetString() };
+    return getLocalRepositoryDirectory(baseDir, config);
+}
+
+boost::filesystem::path getLocalRepositoryDirectory(const boost::filesystem::path& baseDir, const common::Config& config) {
     auto passwdFile = boost::filesystem::path{ config.json["prefixDir"].GetString() } / "etc/passwd";
     auto username = PasswdDB{passwdFile}.getUsername(config.userIdentity.uid);
     return baseDir / username / common::Config::BuildTime{}.localRepositoryFolder;
@@ -436,6 +470,21 @@ boost::filesystem::path makeUniquePathWithRandomSuffix(const boost::filesystem::
     return uniquePath;
 }
 
+/**
+ * Tells whether the file name ends with a suffix generated by makeUniquePathWithRandomSuffix,
+ * e.g. to find the temporary files left behind by an interrupted process.
+ */
+bool hasRandomSuffix(const boost::filesystem::path& path) {
+    const size_t sizeOfRandomSuffix = 16;
+    auto name = path.filename().string();
+    if(name.size() <= sizeOfRandomSuffix + 1 || name[name.size() - sizeOfRandomSuffix - 1] != '-') {
+        return false;
+    }
+    return std::all_of(name.cend() - sizeOfRandomSuffix, name.cend(), [](char c) {
+        return c >= 'a' && c <= 'z';
+    });
+}
+
 std::string generateRandomString(size_t size) {
     auto dist = std::uniform_int_distribution<std::mt19937::result_type>(0, 'z'-'a');
     std::mt19937 generator;
@@ -803,7 +852,7 @@ bool isSharedLib(const boost::filesystem::path& file) {
     return pos+3 == filename.cend() || *(pos+3) == '.';
 }
 
-std::vector<std::string> parseSharedLibAbi(const boost::filesystem::path& lib) {
+AbiVersion parseSharedLibAbi(const boost::filesystem::path& lib) {
     if(!isSharedLib(lib)) {
         auto message = boost::format{"Cannot parse ABI version of '%s': not a shared library"} % lib;
         SARUS_THROW_ERROR(message.str());
@@ -824,21 +873,18 @@ std::vector<std::string> parseSharedLibAbi(const boost::filesystem::path& lib) {
         return {};
     }
 
-    auto tokens = std::vector<std::string>{};
-    auto versionString = std::string(pos+4, name.cend());
-    boost::split(tokens, versionString, boost::is_any_of("."));
-
-    return tokens;
+    return AbiVersion::parse(std::string(pos+4, name.cend()));
 }
 
-std::vector<std::string> resolveSharedLibAbi(const boost::filesystem::path& lib,
-                                             const boost::filesystem::path& rootDir) {
+AbiVersion resolveSharedLibAbi(const boost::filesystem::path& lib,
+                               const boost::filesystem::path& rootDir) {
     if(!isSharedLib(lib)) {
         auto message = boost::format{"Cannot resolve ABI version of '%s': not a shared library"} % lib;
         SARUS_THROW_ERROR(message.str());
     }
 
-    auto longestAbiSoFar = std::vector<std::string>{};
+    auto longestAbiSoFar = AbiVersion{};
+    auto linkerName = getSharedLibLinkerName(lib);
 
     auto traversedSymlinks = std::vector<boost::filesystem::path>{};
     auto libReal = appendPathsWithinRootfs(rootDir, "/", lib, &traversedSymlinks);
@@ -851,7 +897,7 @@ std::vector<std::string> resolveSharedLibAbi(const boost::filesystem::path& lib,
             // e.g. with /lib -> /lib64
             continue;
         }
-        if(getSharedLibLinkerName(path) != getSharedLibLinkerName(lib)) {
+        if(getSharedLibLinkerName(path) != linkerName) {
             // E.g. on Cray we could have:
             // mpich-gnu-abi/7.1/lib/libmpi.so.12 -> ../../../mpich-gnu/7.1/lib/libmpich_gnu_71.so.3.0.1
             // Let's ignore the symlink's target in this case
@@ -867,7 +913,7 @@ std::vector<std::string> resolveSharedLibAbi(const boost::filesystem::path& lib,
         const auto& shorter = abi.size() < longestAbiSoFar.size() ? abi : longestAbiSoFar;
         const auto& longer = abi.size() > longestAbiSoFar.size() ? abi : longestAbiSoFar;
 
-        if(!std::equal(shorter.cbegin(), shorter.cend(), longer.cbegin())) {
+        if(!shorter.isPrefixOf(longer)) {
             // Some vendors have symlinks with incompatible major versions. e.g.
             // libvdpau_nvidia.so.1 -> libvdpau_nvidia.so.440.33.01.
             // For these cases, we trust the vendor and resolve the Lib Abi to that of the symlink.
@@ -878,7 +924,7 @@ std::vector<std::string> resolveSharedLibAbi(const boost::filesystem::path& lib,
             continue;
         }
 
-        longestAbiSoFar = std::move(longer);
+        longestAbiSoFar = longer;
     }
 
     return longestAbiSoFar;
@@ -974,6 +1020,76 @@ void setCpuAffinity(const std::vector<int>& cpus) {
     logMessage("Successfully set CPU affinity", common::LogLevel::INFO);
 }
 
+/**
+ * Parses a list in the format used by the kernel for CPUs and NUMA nodes,
+ * e.g. "0-3,8,10-11" (see cpuset(7), section "List format").
+ */
+std::vector<int> parseCpuList(const std::string& list) {
+    auto ids = std::vector<int>{};
+    auto trimmedList = boost::trim_copy(list);
+    if(trimmedList.empty()) {
+        return ids;
+    }
+
+    auto ranges = std::vector<std::string>{};
+    boost::split(ranges, trimmedList, boost::is_any_of(","));
+    for(const auto& range : ranges) {
+        try {
+            auto dash = range.find('-');
+            auto first = std::stoi(range.substr(0, dash));
+            auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if(first < 0 || last < first) {
+                SARUS_THROW_ERROR("invalid range");
+            }
+            for(int id=first; id<=last; ++id) {
+                ids.push_back(id);
+            }
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to parse list of CPUs or NUMA nodes '%s'") % list;
+            SARUS_RETHROW_ERROR(e, message.str());
+        }
+    }
+    return ids;
+}
+
+std::vector<int> getNumaNodes(const boost::filesystem::path& sysfsNodesDir) {
+    auto nodes = std::vector<int>{};
+    if(!boost::filesystem::exists(sysfsNodesDir / "online")) {
+        logMessage(boost::format("No NUMA topology found in %s") % sysfsNodesDir, common::LogLevel::DEBUG);
+        return nodes;
+    }
+    return parseCpuList(readFile(sysfsNodesDir / "online"));
+}
+
+/**
+ * Returns the NUMA nodes which contain at least one of the given CPUs,
+ * or an empty vector if the NUMA topology is not exposed in sysfs.
+ */
+std::vector<int> getNumaNodesOfCpus(const std::vector<int>& cpus, const boost::filesystem::path& sysfsNodesDir) {
+    logMessage("Getting NUMA nodes of CPUs", common::LogLevel::INFO);
+
+    auto nodesOfCpus = std::vector<int>{};
+    for(auto node : getNumaNodes(sysfsNodesDir)) {
+        auto cpuListFile = sysfsNodesDir / ("node" + std::to_string(node)) / "cpulist";
+        if(!boost::filesystem::exists(cpuListFile)) {
+            continue;
+        }
+        auto cpusOfNode = parseCpuList(readFile(cpuListFile));
+        auto hasAnyCpu = std::any_of(cpusOfNode.cbegin(), cpusOfNode.cend(), [&cpus](int cpu) {
+            return std::find(cpus.cbegin(), cpus.cend(), cpu) != cpus.cend();
+        });
+        if(hasAnyCpu) {
+            nodesOfCpus.push_back(node);
+            logMessage(boost::format("Detected NUMA node %d") % node, common::LogLevel::DEBUG);
+        }
+    }
+
+    logMessage("Successfully got NUMA nodes of CPUs", common::LogLevel::INFO);
+
+    return nodesOfCpus;
+}
+
 std::string readFile(const boost::filesystem::path& path) {
     std::ifstream ifs(path.string());
     auto s = std::string(   std::istreambuf_iterator<char>(ifs),
@@ -997,6 +1113,60 @@ void writeTextFile(const std::string& text, const boost::filesystem::path& filen
     }
 }
 
+namespace {
+
+/**
+ * Read-only view of the whole content of a file. Regular files are memory-mapped, so that
+ * the JSON parser reads the page cache directly instead of going through an std::istream
+ * and intermediate copies. Other files (e.g. named pipes) are read into a buffer.
+ */
+class FileContent {
+public:
+    FileContent(const boost::filesystem::path& file) {
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            auto message = boost::format("Failed to open %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+
+        struct stat sb;
+        if(fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0) {
+            auto* mapping = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED) {
+                madvise(mapping, sb.st_size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(mapping);
+                size = sb.st_size;
+                isMapped = true;
+            }
+        }
+        close(fd);
+
+        if(!isMapped) {
+            buffer = readFile(file);
+            data = buffer.c_str();
+            size = buffer.size();
+        }
+    }
+
+    FileContent(const FileContent&) = delete;
+    FileContent& operator=(const FileContent&) = delete;
+
+    ~FileContent() {
+        if(isMapped) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+private:
+    bool isMapped = false;
+    std::string buffer;
+};
+
+} // namespace
+
 rapidjson::Document parseJSONStream(std::istream& is) {
     auto json = rapidjson::Document{};
 
@@ -1012,8 +1182,8 @@ rapidjson::Document parseJSONStream(std::istream& is) {
 }
 
 rapidjson::Document parseJSON(const std::string& string) {
-    std::istringstream iss(string);
-    auto json = parseJSONStream(iss);
+    auto json = rapidjson::Document{};
+    json.Parse(string.c_str(), string.size());
     if (json.HasParseError()) {
         auto message = boost::format(
             "Error parsing JSON string:\n'%s'\nInput data is not valid JSON\n"
@@ -1027,8 +1197,15 @@ rapidjson::Document parseJSON(const std::string& string) {
 }
 
 rapidjson::Document readJSON(const boost::filesystem::path& filename) {
-    std::ifstream ifs(filename.string());
-    auto json = parseJSONStream(ifs);
+    auto json = rapidjson::Document{};
+    try {
+        FileContent content{filename};
+        json.Parse(content.data, content.size);
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Error reading JSON file %s") % filename;
+        SARUS_RETHROW_ERROR(e, message.str());
+    }
     if (json.HasParseError()) {
         auto message = boost::format(
             "Error parsing JSON file %s. Input data is not valid JSON\n"
@@ -1068,10 +1245,12 @@ rapidjson::Document readAndValidateJSON(const boost::filesystem::path& jsonFile,
 
     // Use a reader object to parse the JSON storing configuration settings
     try {
-        std::ifstream configInputStream(jsonFile.string());
-        rapidjson::IStreamWrapper configStreamWrapper(configInputStream);
+        FileContent content{jsonFile};
+        using InputStream = rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream>;
+        rapidjson::MemoryStream memoryStream(content.data, content.size);
+        InputStream inputStream(memoryStream);
         // Parse JSON from reader, validate the SAX events, and populate the configuration Document.
-        rapidjson::SchemaValidatingReader<rapidjson::kParseDefaultFlags, rapidjson::IStreamWrapper, rapidjson::UTF8<> > reader(configStreamWrapper, schema);
+        rapidjson::SchemaValidatingReader<rapidjson::kParseDefaultFlags, InputStream, rapidjson::UTF8<> > reader(inputStream, schema);
         json.Populate(reader);
 
         // Check parsing outcome
@@ -1116,18 +1295,33 @@ rapidjson::Document readAndValidateJSON(const boost::filesystem::path& jsonFile,
     return json;
 }
 
-void writeJSON(const rapidjson::Value& json, const boost::filesystem::path& filename) {
+void writeJSON(const rapidjson::Value& json, const boost::filesystem::path& filename, bool prettyPrint) {
     try {
         createFoldersIfNecessary(filename.parent_path());
-        std::ofstream ofs(filename.string());
-        if(!ofs) {
-            auto message = boost::format("Failed to open std::ofstream for %s") % filename;
+        auto file = std::unique_ptr<FILE, int(*)(FILE*)>{fopen(filename.c_str(), "we"), fclose};
+        if(!file) {
+            auto message = boost::format("Failed to open %s: %s") % filename % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+
+        // serialize straight into the file through a fixed-size buffer
+        char buffer[1 << 16];
+        rapidjson::FileWriteStream stream(file.get(), buffer, sizeof(buffer));
+        if(prettyPrint) {
+            rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(stream);
+            writer.SetIndent(' ', 3);
+            json.Accept(writer);
+        }
+        else {
+            rapidjson::Writer<rapidjson::FileWriteStream> writer(stream);
+            json.Accept(writer);
+        }
+        stream.Flush();
+
+        if(ferror(file.get()) || fclose(file.release()) != 0) {
+            auto message = boost::format("Failed to write %s: %s") % filename % strerror(errno);
             SARUS_THROW_ERROR(message.str());
         }
-        rapidjson::OStreamWrapper osw(ofs);
-        rapidjson::PrettyWriter<rapidjson::OStreamWrapper> writer(osw);
-        writer.SetIndent(' ', 3);
-        json.Accept(writer);
     }
     catch(const std::exception& e) {
         auto message = boost::format("Failed to write JSON to %s") % filename;
@@ -11,6 +11,7 @@
 #ifndef _common_Utility_hpp
 #define _common_Utility_hpp
 
+#include <cstdint>
 #include <cstdlib>
 #include <string>
 #include <tuple>
@@ -28,6 +29,7 @@
 #include "common/Logger.hpp"
 #include "common/UserIdentity.hpp"
 #include "common/AbiCompatibility.hpp"
+#include "common/AbiVersion.hpp"
 
 /**
  * Utility functions
@@ -54,6 +56,7 @@ void redirectStdoutToFile(const boost::filesystem::path& file);
 void SetStdinEcho(bool);
 std::string getHostname();
 size_t getFileSize(const boost::filesystem::path& filename);
+std::uintmax_t getDiskUsage(const boost::filesystem::path& path);
 dev_t getDeviceID(const boost::filesystem::path& path);
 char getDeviceType(const boost::filesystem::path& path);
 std::tuple<uid_t, gid_t> getOwner(const boost::filesystem::path&);
@@ -61,7 +64,9 @@ void setOwner(const boost::filesystem::path&, uid_t, gid_t);
 bool isCentralizedRepositoryEnabled(const common::Config& config);
 boost::filesystem::path getCentralizedRepositoryDirectory(const common::Config& config);
 boost::filesystem::path getLocalRepositoryDirectory(const common::Config& config);
+boost::filesystem::path getLocalRepositoryDirectory(const boost::filesystem::path& baseDir, const common::Config& config);
 boost::filesystem::path makeUniquePathWithRandomSuffix(const boost::filesystem::path&);
+bool hasRandomSuffix(const boost::filesystem::path&);
 std::string generateRandomString(size_t size);
 void createFoldersIfNecessary(const boost::filesystem::path&, uid_t uid=-1, gid_t gid=-1);
 void createFileIfNecessary(const boost::filesystem::path&, uid_t uid=-1, gid_t gid=-1);
@@ -83,14 +88,18 @@ std::vector<boost::filesystem::path> getSharedLibsFromDynamicLinker(
     const boost::filesystem::path& ldconfigPath,
     const boost::filesystem::path& rootDir);
 bool isSharedLib(const boost::filesystem::path& file);
-std::vector<std::string> parseSharedLibAbi(const boost::filesystem::path& lib);
-std::vector<std::string> resolveSharedLibAbi(const boost::filesystem::path& lib,
-                                           const boost::filesystem::path& rootDir = "/");
+AbiVersion parseSharedLibAbi(const boost::filesystem::path& lib);
+AbiVersion resolveSharedLibAbi(const boost::filesystem::path& lib,
+                               const boost::filesystem::path& rootDir = "/");
 std::string getSharedLibSoname(const boost::filesystem::path& path, const boost::filesystem::path& readelfPath);
 bool isLibc(const boost::filesystem::path&);
 bool is64bitSharedLib(const boost::filesystem::path& path, const boost::filesystem::path& readelfPath);
 std::vector<int> getCpuAffinity();
 void setCpuAffinity(const std::vector<int>&);
+std::vector<int> parseCpuList(const std::string& list);
+std::vector<int> getNumaNodesOfCpus(const std::vector<int>& cpus,
+                                    const boost::filesystem::path& sysfsNodesDir = "/sys/devices/system/node");
+std::vector<int> getNumaNodes(const boost::filesystem::path& sysfsNodesDir = "/sys/devices/system/node");
 std::string readFile(const boost::filesystem::path& path);
 std::vector<std::string> readLines(const boost::filesystem::path& path);
 void writeTextFile(const std::string& text,
@@ -102,7 +111,7 @@ rapidjson::Document parseJSON(const std::string& string);
 rapidjson::Document readJSON(const boost::filesystem::path& filename);
 rapidjson::Document readAndValidateJSON(const boost::filesystem::path& jsonFile,
                                         const boost::filesystem::path& schemaFile);
-void writeJSON(const rapidjson::Value& json, const boost::filesystem::path& filename);
+void writeJSON(const rapidjson::Value& json, const boost::filesystem::path& filename, bool prettyPrint = true);
 std::string serializeJSON(const rapidjson::Value& json);
 void logMessage(const std::string&, LogLevel, std::ostream& out = std::cout, std::ostream& err = std::cerr);
 void logMessage(const boost::format&, LogLevel, std::ostream& out = std::cout, std::ostream& err = std::cerr);
@@ -0,0 +1,144 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+/**
+ * Compares common::AbiVersion with the vectors of strings it replaced in the ABI checks
+ * of the MPI hook, on the library sets of typical launches: the MPI libraries of a Cray
+ * host and their dependencies, checked against the libraries of container images with
+ * a few tens (minimal MPI image) up to a thousand (CUDA + ML stack) libraries.
+ */
+
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+#include "common/AbiVersion.hpp"
+#include "test_utility/Benchmark.hpp"
+
+using namespace sarus;
+
+static volatile std::size_t sink;
+
+// e.g. "12.5.5" for libmpi.so.12.5.5
+static std::string getVersionString(const std::string& filename) {
+    auto pos = filename.rfind(".so") + 3;
+    return pos < filename.size() ? filename.substr(pos + 1) : std::string{};
+}
+
+// common::parseSharedLibAbi before the numeric ABI versions
+static std::vector<std::string> legacyParseAbi(const std::string& filename) {
+    auto versionString = getVersionString(filename);
+    if(versionString.empty()) {
+        return {};
+    }
+    auto tokens = std::vector<std::string>{};
+    boost::split(tokens, versionString, boost::is_any_of("."));
+    return tokens;
+}
+
+// the check of hooks::mpi::SharedLibrary before the numeric ABI versions
+static bool legacyIsFullAbiCompatible(const std::vector<std::string>& abi, const std::vector<std::string>& hostAbi) {
+    auto major = abi.size() > 0 ? std::stoi(abi[0]) : 0;
+    auto minor = abi.size() > 1 ? std::stoi(abi[1]) : 0;
+    auto hostMajor = hostAbi.size() > 0 ? std::stoi(hostAbi[0]) : 0;
+    auto hostMinor = hostAbi.size() > 1 ? std::stoi(hostAbi[1]) : 0;
+    return major == hostMajor && minor <= hostMinor;
+}
+
+static const std::vector<std::string> hostLibraries = {
+    "libmpi.so.12.5.5", "libmpich.so.12.5.5", "libmpl.so.12.0.0", "libfabric.so.1.17.0",
+    "libpmi.so.0.6.0", "libpmi2.so.0.6.0", "libcxi.so.1.5.0", "libxpmem.so.0.0.0",
+    "libpals.so.0.0.0", "libgfortran.so.5.0.0", "libquadmath.so.0.0.0", "libatomic.so.1.2.0",
+};
+
+static const std::vector<std::string> containerLibraryTemplates = {
+    "libc.so.6", "libm.so.6", "libdl.so.2", "librt.so.1", "libpthread.so.0",
+    "libstdc++.so.6.0.28", "libgcc_s.so.1", "libgfortran.so.5.0.0", "libquadmath.so.0.0.0",
+    "libz.so.1.2.11", "libssl.so.1.1", "libcrypto.so.1.1", "libcuda.so.1", "libcudart.so.11.0.221",
+    "libnvidia-ml.so.440.33.01", "libvdpau_nvidia.so.440.33.01", "libmpi.so.12.4.0",
+    "libmpich.so.12", "libfabric.so.1", "libhwloc.so.15.5.2", "libpmi.so.0", "libnuma.so.1.0.0",
+};
+
+static std::vector<std::string> makeContainerLibraries(std::size_t numberOfLibraries) {
+    auto libraries = std::vector<std::string>{};
+    for(std::size_t i = 0; i < numberOfLibraries; ++i) {
+        const auto& name = containerLibraryTemplates[i % containerLibraryTemplates.size()];
+        auto copy = i / containerLibraryTemplates.size();
+        libraries.push_back(copy == 0 ? name : (boost::format("lib%d%s") % copy % name.substr(3)).str());
+    }
+    return libraries;
+}
+
+int main(int argc, char* argv[]) {
+    struct Case {
+        std::string name;
+        std::size_t numberOfLibraries;
+        std::size_t iterations;
+    };
+    auto cases = std::vector<Case>{
+        {"minimal-mpi-image", 30, 20000},
+        {"hpc-image", 200, 2000},
+        {"cuda-ml-image", 1000, 500},
+    };
+
+    namespace bm = test_utility::benchmark;
+    bm::printHeader();
+    for(const auto& c : cases) {
+        auto containerLibraries = makeContainerLibraries(c.numberOfLibraries);
+        auto iterations = c.iterations;
+        auto label = [&](const std::string& operation) {
+            return (boost::format("%s (%d libs) %s") % c.name % c.numberOfLibraries % operation).str();
+        };
+
+        bm::print(bm::run(label("parse legacy"), iterations, [&]() {
+            for(const auto& lib : containerLibraries) {
+                sink = sink + legacyParseAbi(lib).size();
+            }
+        }));
+        bm::print(bm::run(label("parse AbiVersion"), iterations, [&]() {
+            for(const auto& lib : containerLibraries) {
+                sink = sink + common::AbiVersion::parse(getVersionString(lib)).size();
+            }
+        }));
+
+        // the hook checks every container library against every host library
+        auto legacyHost = std::vector<std::vector<std::string>>{};
+        auto host = std::vector<common::AbiVersion>{};
+        for(const auto& lib : hostLibraries) {
+            legacyHost.push_back(legacyParseAbi(lib));
+            host.push_back(common::AbiVersion::parse(getVersionString(lib)));
+        }
+        auto legacyContainer = std::vector<std::vector<std::string>>{};
+        auto container = std::vector<common::AbiVersion>{};
+        for(const auto& lib : containerLibraries) {
+            legacyContainer.push_back(legacyParseAbi(lib));
+            container.push_back(common::AbiVersion::parse(getVersionString(lib)));
+        }
+
+        bm::print(bm::run(label("compare legacy"), iterations, [&]() {
+            for(const auto& hostAbi : legacyHost) {
+                for(const auto& abi : legacyContainer) {
+                    sink = sink + legacyIsFullAbiCompatible(abi, hostAbi);
+                }
+            }
+        }));
+        bm::print(bm::run(label("compare AbiVersion"), iterations, [&]() {
+            for(const auto& hostAbi : host) {
+                for(const auto& abi : container) {
+                    sink = sink + (common::getAbiCompatibility(hostAbi, abi) == common::AbiCompatibility::COMPATIBLE);
+                }
+            }
+        }));
+    }
+
+    return 0;
+}
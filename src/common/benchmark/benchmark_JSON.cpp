@@ -0,0 +1,110 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+/**
+ * Compares the JSON I/O functions of common/Utility.hpp with the stream-based
+ * implementation they replaced, on documents with the sizes of the JSON files
+ * handled by Sarus: OCI hook configurations (< 1 KiB), sarus.json and the bundle's
+ * config.json (a few KiB), seccomp profiles (tens of KiB) and the metadata of
+ * repositories with many images (up to MiBs).
+ */
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/prettywriter.h>
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/Benchmark.hpp"
+
+namespace rj = rapidjson;
+using namespace sarus;
+
+static rj::Document legacyReadJSON(const boost::filesystem::path& filename) {
+    std::ifstream ifs(filename.string());
+    rj::IStreamWrapper isw(ifs);
+    auto json = rj::Document{};
+    json.ParseStream(isw);
+    return json;
+}
+
+static void legacyWriteJSON(const rj::Value& json, const boost::filesystem::path& filename) {
+    std::ofstream ofs(filename.string());
+    rj::OStreamWrapper osw(ofs);
+    rj::PrettyWriter<rj::OStreamWrapper> writer(osw);
+    writer.SetIndent(' ', 3);
+    json.Accept(writer);
+}
+
+// A repository metadata-like document with the given number of entries
+static rj::Document makeDocument(std::size_t numberOfEntries) {
+    auto json = rj::Document{rj::kObjectType};
+    auto& allocator = json.GetAllocator();
+    auto images = rj::Value{rj::kArrayType};
+    for(std::size_t i=0; i<numberOfEntries; ++i) {
+        auto image = rj::Value{rj::kObjectType};
+        auto reference = (boost::format("docker.io/library/image-%d:latest") % i).str();
+        auto digest = "sha256:" + std::string(64, 'a' + i % 26);
+        image.AddMember("reference", rj::Value{reference.c_str(), allocator}, allocator);
+        image.AddMember("id", rj::Value{digest.c_str(), allocator}, allocator);
+        image.AddMember("datasize", rj::Value{"123.45MB"}, allocator);
+        image.AddMember("created", rj::Value{"2022-06-01T12:00:00"}, allocator);
+        image.AddMember("imagefile", rj::Value{"/var/sarus/images/docker.io/library/image/latest.squashfs"}, allocator);
+        image.AddMember("pullCount", rj::Value{static_cast<unsigned>(i)}, allocator);
+        images.PushBack(image, allocator);
+    }
+    json.AddMember("images", images, allocator);
+    return json;
+}
+
+int main(int argc, char* argv[]) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-benchmark-json")};
+    common::createFoldersIfNecessary(testDir.getPath());
+
+    struct Case {
+        std::string name;
+        std::size_t numberOfEntries;
+        std::size_t iterations;
+    };
+    auto cases = std::vector<Case>{
+        {"hook", 1, 20000},
+        {"config", 20, 5000},
+        {"seccomp", 100, 2000},
+        {"metadata-1k-images", 1000, 200},
+        {"metadata-10k-images", 10000, 20},
+    };
+
+    test_utility::benchmark::printHeader();
+    for(const auto& c : cases) {
+        auto document = makeDocument(c.numberOfEntries);
+        auto file = testDir.getPath() / (c.name + ".json");
+        common::writeJSON(document, file);
+        auto serialized = common::serializeJSON(document);
+        auto size = boost::filesystem::file_size(file);
+        auto label = [&](const std::string& operation) {
+            return (boost::format("%s %s (%d B)") % c.name % operation % size).str();
+        };
+
+        namespace bm = test_utility::benchmark;
+        bm::print(bm::run(label("read legacy"), c.iterations, [&]() { legacyReadJSON(file); }));
+        bm::print(bm::run(label("readJSON"), c.iterations, [&]() { common::readJSON(file); }));
+        bm::print(bm::run(label("parseJSON"), c.iterations, [&]() { common::parseJSON(serialized); }));
+        bm::print(bm::run(label("write legacy"), c.iterations, [&]() { legacyWriteJSON(document, file); }));
+        bm::print(bm::run(label("writeJSON"), c.iterations, [&]() { common::writeJSON(document, file); }));
+        bm::print(bm::run(label("writeJSON compact"), c.iterations, [&]() { common::writeJSON(document, file, false); }));
+    }
+
+    return 0;
+}
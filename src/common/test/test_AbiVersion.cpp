@@ -0,0 +1,86 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <string>
+
+#include "common/AbiVersion.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+using namespace sarus;
+
+// the comparisons are usable at compile time
+static_assert(common::AbiVersion{1, 2} == common::AbiVersion{1, 2}, "");
+static_assert(common::AbiVersion{1, 2} < common::AbiVersion{1, 10}, "");
+static_assert(common::AbiVersion{1, 2} < common::AbiVersion{1, 2, 0}, "");
+static_assert(common::AbiVersion{1}.isPrefixOf(common::AbiVersion{1, 2, 3}), "");
+static_assert(common::AbiVersion{}.getMinor() == 0, "");
+static_assert(common::getAbiCompatibility(common::AbiVersion{12, 5, 5}, common::AbiVersion{12, 4})
+              == common::AbiCompatibility::COMPATIBLE, "");
+
+TEST_GROUP(AbiVersionTestGroup) {
+};
+
+TEST(AbiVersionTestGroup, parse) {
+    CHECK(common::AbiVersion::parse("") == common::AbiVersion{});
+    CHECK(common::AbiVersion::parse("12") == common::AbiVersion{12});
+    CHECK((common::AbiVersion::parse("12.5.5") == common::AbiVersion{12, 5, 5}));
+    CHECK((common::AbiVersion::parse("440.33.01") == common::AbiVersion{440, 33, 1}));
+    CHECK((common::AbiVersion::parse("1.2.3rc1") == common::AbiVersion{1, 2, 3}));
+
+    // the parsing stops at the first component without leading digits
+    CHECK((common::AbiVersion::parse("1.beta.3") == common::AbiVersion{1}));
+    CHECK(common::AbiVersion::parse("rc1") == common::AbiVersion{});
+
+    // overflowing components are clamped
+    CHECK(common::AbiVersion::parse("99999999999").getMajor() == 4294967295u);
+
+    // the components beyond the capacity are ignored
+    auto abi = common::AbiVersion::parse("1.2.3.4.5.6.7.8");
+    CHECK_EQUAL(abi.size(), common::AbiVersion::capacity);
+    CHECK_EQUAL(abi.toString(), std::string{"1.2.3.4.5.6"});
+    CHECK(!abi.append(7));
+}
+
+TEST(AbiVersionTestGroup, accessors) {
+    auto abi = common::AbiVersion{};
+    CHECK(abi.empty());
+    CHECK(abi.append(2));
+    CHECK(abi.append(10));
+    CHECK_EQUAL(abi.size(), 2u);
+    CHECK_EQUAL(abi.getMajor(), 2u);
+    CHECK_EQUAL(abi.getMinor(), 10u);
+    CHECK_EQUAL(abi.getPatch(), 0u); // missing components are zero
+    CHECK_EQUAL(abi.toString(), std::string{"2.10"});
+    CHECK_EQUAL(common::AbiVersion{}.toString(), std::string{""});
+}
+
+TEST(AbiVersionTestGroup, comparisons) {
+    CHECK(common::AbiVersion{} == common::AbiVersion{});
+    CHECK((common::AbiVersion{1} != common::AbiVersion{1, 0}));
+    CHECK((common::AbiVersion{2, 9} < common::AbiVersion{2, 10})); // no string-comparison pitfalls
+    CHECK(!(common::AbiVersion{3} < common::AbiVersion{2, 10}));
+
+    CHECK(common::AbiVersion{}.isPrefixOf(common::AbiVersion{1}));
+    CHECK((common::AbiVersion{1, 2}.isPrefixOf(common::AbiVersion{1, 2})));
+    CHECK(!(common::AbiVersion{1, 2}.isPrefixOf(common::AbiVersion{1})));
+    CHECK(!(common::AbiVersion{1}.isPrefixOf(common::AbiVersion{440, 33, 1})));
+}
+
+TEST(AbiVersionTestGroup, abiCompatibility) {
+    auto host = common::AbiVersion{12, 5, 5};
+    CHECK(common::getAbiCompatibility(host, common::AbiVersion{12, 5, 10}) == common::AbiCompatibility::COMPATIBLE);
+    CHECK(common::getAbiCompatibility(host, common::AbiVersion{12, 4}) == common::AbiCompatibility::COMPATIBLE);
+    CHECK(common::getAbiCompatibility(host, common::AbiVersion{12}) == common::AbiCompatibility::COMPATIBLE);
+    CHECK(common::getAbiCompatibility(host, common::AbiVersion{12, 6}) == common::AbiCompatibility::MINOR_NOT_COMPATIBLE);
+    CHECK(common::getAbiCompatibility(host, common::AbiVersion{11, 5}) == common::AbiCompatibility::MAJOR_NOT_COMPATIBLE);
+    CHECK(common::getAbiCompatibility(host, common::AbiVersion{}) == common::AbiCompatibility::MAJOR_NOT_COMPATIBLE);
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
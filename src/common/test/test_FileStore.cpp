@@ -0,0 +1,205 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <boost/filesystem.hpp>
+
+#include "common/Error.hpp"
+#include "common/FileStore.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(FileStoreTestGroup) {
+};
+
+static void createFile(const boost::filesystem::path& path, const std::string& content, mode_t mode) {
+    common::createFoldersIfNecessary(path.parent_path());
+    std::ofstream{path.string()} << content;
+    chmod(path.c_str(), mode);
+}
+
+static mode_t getMode(const boost::filesystem::path& path) {
+    struct stat sb;
+    CHECK_EQUAL(lstat(path.c_str(), &sb), 0);
+    return sb.st_mode;
+}
+
+static struct stat getStat(const boost::filesystem::path& path) {
+    struct stat sb;
+    CHECK_EQUAL(lstat(path.c_str(), &sb), 0);
+    return sb;
+}
+
+TEST(FileStoreTestGroup, deduplicate) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-file-store")};
+    auto storeDir = testDir.getPath() / "store";
+    auto rootfs0 = testDir.getPath() / "rootfs0";
+    auto rootfs1 = testDir.getPath() / "rootfs1";
+    auto largeContent = std::string(64, 'x');
+
+    createFile(rootfs0 / "usr/lib/libfoo.so", largeContent, 0755);
+    createFile(rootfs0 / "usr/lib/small", "small", 0644);
+    createFile(rootfs0 / "usr/bin/setuid", largeContent, 04755);
+    chmod((rootfs0 / "usr/lib").c_str(), 0750);
+    createFile(rootfs1 / "opt/libfoo.so", largeContent, 0755);
+    createFile(rootfs1 / "opt/data", largeContent, 0644);
+
+    auto store = common::FileStore{storeDir, 16};
+    auto objects0 = store.deduplicate(rootfs0, "view0");
+    auto objects1 = store.deduplicate(rootfs1, "view1");
+    CHECK_EQUAL(objects0.size(), std::size_t{1});
+    CHECK_EQUAL(objects1.size(), std::size_t{2});
+    CHECK_EQUAL(store.getStatistics().numberOfFiles, std::size_t{3});
+    CHECK_EQUAL(store.getStatistics().storedBytes, std::uintmax_t{128});
+    CHECK_EQUAL(store.getStatistics().reusedBytes, std::uintmax_t{64});
+
+    // same content and mode => same object
+    const auto& object = objects0[0];
+    CHECK(std::find(objects1.cbegin(), objects1.cend(), object) != objects1.cend());
+    CHECK_EQUAL(object.substr(object.size() - 4), std::string{"-755"});
+    CHECK_EQUAL(common::readFile(store.getObjectFile(object)), largeContent);
+    CHECK_EQUAL(getMode(store.getObjectFile(object)) & 0777, mode_t{0555});
+
+    // the views hold the deduplicated files at their original paths, as hard links to the objects
+    auto objectInode = getStat(store.getObjectFile(object)).st_ino;
+    CHECK_EQUAL(getStat(store.getViewDirectory("view0") / "usr/lib/libfoo.so").st_ino, objectInode);
+    CHECK_EQUAL(getStat(store.getViewDirectory("view1") / "opt/libfoo.so").st_ino, objectInode);
+    CHECK(boost::filesystem::exists(store.getViewDirectory("view1") / "opt/data"));
+    // the directories of the views get the attributes of the image's directories
+    CHECK_EQUAL(getMode(store.getViewDirectory("view0") / "usr/lib") & 07777, mode_t{0750});
+
+    // the image keeps sparse placeholders with the size and mode of the files
+    auto placeholder = rootfs0 / "usr/lib/libfoo.so";
+    CHECK(S_ISREG(getMode(placeholder)));
+    CHECK_EQUAL(common::getFileSize(placeholder), largeContent.size());
+    CHECK_EQUAL(getMode(placeholder) & 0777, mode_t{0755});
+    CHECK(common::readFile(placeholder) == std::string(largeContent.size(), '\0'));
+
+    // small and setuid files stay in the image
+    CHECK_EQUAL(common::readFile(rootfs0 / "usr/lib/small"), std::string{"small"});
+    CHECK_EQUAL(common::readFile(rootfs0 / "usr/bin/setuid"), largeContent);
+    CHECK(!boost::filesystem::exists(store.getViewDirectory("view0") / "usr/lib/small"));
+    CHECK(!boost::filesystem::exists(store.getViewDirectory("view0") / "usr/bin"));
+}
+
+TEST(FileStoreTestGroup, deduplicateWithBaseView) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-file-store")};
+    auto storeDir = testDir.getPath() / "store";
+    auto baseRootfs = testDir.getPath() / "base";
+    auto deltaRootfs = testDir.getPath() / "delta";
+    createFile(baseRootfs / "usr/lib/libfoo.so", std::string(64, 'f'), 0755);
+    createFile(deltaRootfs / "usr/lib/libbar.so", std::string(64, 'b'), 0755);
+
+    auto store = common::FileStore{storeDir, 16};
+    auto baseObjects = store.deduplicate(baseRootfs, "base");
+    auto deltaObjects = store.deduplicate(deltaRootfs, "delta", std::string{"base"});
+    CHECK_EQUAL(deltaObjects.size(), std::size_t{1});
+
+    // the view of the delta also holds the files of the base image
+    auto deltaView = store.getViewDirectory("delta");
+    CHECK_EQUAL(getStat(deltaView / "usr/lib/libfoo.so").st_ino, getStat(store.getObjectFile(baseObjects[0])).st_ino);
+    CHECK_EQUAL(getStat(deltaView / "usr/lib/libbar.so").st_ino, getStat(store.getObjectFile(deltaObjects[0])).st_ino);
+}
+
+TEST(FileStoreTestGroup, removeUnreferencedObjects) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-file-store")};
+    auto storeDir = testDir.getPath() / "store";
+    auto rootfs = testDir.getPath() / "rootfs";
+    createFile(rootfs / "file0", std::string(64, '0'), 0644);
+    createFile(rootfs / "file1", std::string(64, '1'), 0644);
+    // the files of unpacked images often have old modification times
+    auto oldTimes = utimbuf{0, 0};
+    CHECK_EQUAL(utime((rootfs / "file1").c_str(), &oldTimes), 0);
+
+    auto store = common::FileStore{storeDir, 16};
+    auto objects = store.deduplicate(rootfs, "view");
+    CHECK_EQUAL(objects.size(), std::size_t{2});
+
+    // recently added objects are kept
+    auto now = time(nullptr);
+    CHECK(store.removeUnreferencedObjects({}, now - 3600).empty());
+
+    auto referenced = std::unordered_set<std::string>{objects[0]};
+
+    auto removed = store.removeUnreferencedObjects(referenced, now + 3600);
+    CHECK_EQUAL(removed.size(), std::size_t{1});
+    CHECK(removed[0] == store.getObjectFile(objects[1]));
+    CHECK(boost::filesystem::exists(store.getObjectFile(objects[0])));
+    CHECK(!boost::filesystem::exists(store.getObjectFile(objects[1])));
+
+    // the view keeps the files whose objects were removed
+    CHECK_EQUAL(common::readFile(store.getViewDirectory("view") / "file1"), std::string(64, '1'));
+}
+
+TEST(FileStoreTestGroup, removeUnreferencedViews) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-file-store")};
+    auto storeDir = testDir.getPath() / "store";
+    createFile(testDir.getPath() / "rootfs0/file", std::string(64, '0'), 0644);
+    createFile(testDir.getPath() / "rootfs1/file", std::string(64, '1'), 0644);
+
+    auto store = common::FileStore{storeDir, 16};
+    store.deduplicate(testDir.getPath() / "rootfs0", "view0");
+    store.deduplicate(testDir.getPath() / "rootfs1", "view1");
+
+    // recently created views are kept
+    auto now = time(nullptr);
+    CHECK(store.removeUnreferencedViews({}, now - 3600).empty());
+
+    auto removed = store.removeUnreferencedViews({"view0"}, now + 3600);
+    CHECK_EQUAL(removed.size(), std::size_t{1});
+    CHECK(removed[0] == store.getViewDirectory("view1"));
+    CHECK(boost::filesystem::exists(store.getViewDirectory("view0")));
+    CHECK(!boost::filesystem::exists(store.getViewDirectory("view1")));
+
+    // the views are not mistaken for objects
+    CHECK_EQUAL(store.removeUnreferencedObjects({}, now + 3600).size(), std::size_t{2});
+    CHECK(boost::filesystem::exists(store.getViewDirectory("view0")));
+}
+
+TEST(FileStoreTestGroup, checkViewDirectory) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-file-store")};
+    auto storeDir = testDir.getPath() / "store";
+    createFile(testDir.getPath() / "rootfs/file", std::string(64, '0'), 0644);
+
+    auto store = common::FileStore{storeDir, 16};
+    store.deduplicate(testDir.getPath() / "rootfs", "view");
+    store.checkViewDirectory("view");
+
+    // names which are not a single path component
+    CHECK_THROWS(common::Error, store.getViewDirectory(""));
+    CHECK_THROWS(common::Error, store.getViewDirectory(".."));
+    CHECK_THROWS(common::Error, store.getViewDirectory("../../rootfs"));
+    CHECK_THROWS(common::Error, store.checkViewDirectory("view/../../../rootfs"));
+
+    // missing view and symlinks leading out of the store
+    CHECK_THROWS(common::Error, store.checkViewDirectory("missing"));
+    boost::filesystem::create_symlink(testDir.getPath() / "rootfs", store.getViewDirectory("symlink"));
+    CHECK_THROWS(common::Error, store.checkViewDirectory("symlink"));
+
+    auto otherStoreDir = testDir.getPath() / "other-store";
+    common::createFoldersIfNecessary(otherStoreDir);
+    common::createFoldersIfNecessary(testDir.getPath() / "rootfs/dir");
+    boost::filesystem::create_directory_symlink(testDir.getPath() / "rootfs", otherStoreDir / "views");
+    CHECK_THROWS(common::Error, common::FileStore(otherStoreDir, 16).checkViewDirectory("dir"));
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -0,0 +1,171 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "common/ImageFileIndex.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(ImageFileIndexTestGroup) {
+};
+
+// writes the fields of the squashfs superblock the index is bound to
+static void writeSquashfsSuperblock(const boost::filesystem::path& file, std::uint32_t creationTime, std::uint64_t bytesUsed) {
+    char superblock[96] = {};
+    auto magic = std::uint32_t{0x73717368};
+    std::memcpy(superblock, &magic, sizeof(magic));
+    std::memcpy(superblock + 8, &creationTime, sizeof(creationTime));
+    std::memcpy(superblock + 40, &bytesUsed, sizeof(bytesUsed));
+    boost::filesystem::ofstream{file, std::ios::binary}.write(superblock, sizeof(superblock));
+}
+
+static void createRootfs(const boost::filesystem::path& rootfs) {
+    common::createFoldersIfNecessary(rootfs / "usr/lib64");
+    common::createFoldersIfNecessary(rootfs / "etc");
+    common::writeTextFile("dummy", rootfs / "usr/lib64/libfoo.so.1.2");
+    boost::filesystem::create_symlink("usr/lib64", rootfs / "lib64");
+    boost::filesystem::create_symlink("libfoo.so.1.2", rootfs / "usr/lib64/libfoo.so.1");
+    boost::filesystem::create_symlink("/lib64/libfoo.so.1", rootfs / "etc/libfoo");
+    boost::filesystem::create_symlink("loop", rootfs / "loop");
+}
+
+TEST(ImageFileIndexTestGroup, getFileOfImage) {
+    CHECK(common::ImageFileIndex::getFileOfImage("/images/library/alpine/latest.squashfs")
+          == "/images/library/alpine/latest.index");
+}
+
+TEST(ImageFileIndexTestGroup, find) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-file-index")};
+    auto rootfs = testDir.getPath() / "rootfs";
+    auto squashfsFile = testDir.getPath() / "image.squashfs";
+    auto indexFile = common::ImageFileIndex::getFileOfImage(squashfsFile);
+    createRootfs(rootfs);
+    writeSquashfsSuperblock(squashfsFile, 1234, 4096);
+
+    common::ImageFileIndex::create(rootfs, squashfsFile, indexFile);
+    auto index = common::ImageFileIndex{indexFile};
+
+    // "/", "/etc", "/etc/libfoo", "/lib64", "/loop", "/usr", "/usr/lib64" and the two libfoo entries
+    CHECK_EQUAL(index.size(), std::size_t{9});
+
+    auto entry = index.find("/usr/lib64/libfoo.so.1.2");
+    CHECK(entry);
+    CHECK(S_ISREG(entry->mode));
+    CHECK_EQUAL(entry->size, std::uint64_t{5});
+
+    entry = index.find("/etc");
+    CHECK(entry);
+    CHECK(S_ISDIR(entry->mode));
+
+    entry = index.find("/lib64");
+    CHECK(entry);
+    CHECK(S_ISLNK(entry->mode));
+    CHECK_EQUAL(entry->symlinkTarget, std::string{"usr/lib64"});
+
+    CHECK(!index.find("/usr/lib64/libbar.so"));
+    CHECK(!index.find("/lib64/libfoo.so.1")); // symlinks are not resolved
+}
+
+TEST(ImageFileIndexTestGroup, createOnTopOfLowerIndex) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-file-index")};
+    auto lowerRootfs = testDir.getPath() / "lower-rootfs";
+    auto lowerSquashfsFile = testDir.getPath() / "lower.squashfs";
+    createRootfs(lowerRootfs);
+    writeSquashfsSuperblock(lowerSquashfsFile, 1234, 4096);
+    common::ImageFileIndex::create(lowerRootfs, lowerSquashfsFile, common::ImageFileIndex::getFileOfImage(lowerSquashfsFile));
+    auto lowerIndex = common::ImageFileIndex{common::ImageFileIndex::getFileOfImage(lowerSquashfsFile)};
+
+    auto rootfs = testDir.getPath() / "rootfs";
+    auto squashfsFile = testDir.getPath() / "image.squashfs";
+    common::createFoldersIfNecessary(rootfs / "usr/lib64");
+    common::writeTextFile("new content", rootfs / "usr/lib64/libfoo.so.1.2");
+    common::writeTextFile("bar", rootfs / "usr/lib64/libbar.so");
+    writeSquashfsSuperblock(squashfsFile, 5678, 4096);
+    common::ImageFileIndex::create(rootfs, squashfsFile, common::ImageFileIndex::getFileOfImage(squashfsFile), lowerIndex);
+    auto index = common::ImageFileIndex{common::ImageFileIndex::getFileOfImage(squashfsFile)};
+
+    // the 9 entries of the lower index plus "/usr/lib64/libbar.so"
+    CHECK_EQUAL(index.size(), std::size_t{10});
+    CHECK_EQUAL(index.find("/usr/lib64/libfoo.so.1.2")->size, std::uint64_t{11});
+    CHECK(index.find("/usr/lib64/libbar.so"));
+    CHECK_EQUAL(index.find("/lib64")->symlinkTarget, std::string{"usr/lib64"});
+    CHECK(index.realpath("/etc/libfoo") == "/usr/lib64/libfoo.so.1.2");
+
+    // directories precede their contents
+    auto entries = index.getEntries();
+    CHECK_EQUAL(entries.size(), std::size_t{10});
+    CHECK_EQUAL(entries[0].first, std::string{"/"});
+}
+
+TEST(ImageFileIndexTestGroup, realpath) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-file-index")};
+    auto rootfs = testDir.getPath() / "rootfs";
+    auto squashfsFile = testDir.getPath() / "image.squashfs";
+    auto indexFile = common::ImageFileIndex::getFileOfImage(squashfsFile);
+    createRootfs(rootfs);
+    writeSquashfsSuperblock(squashfsFile, 1234, 4096);
+
+    common::ImageFileIndex::create(rootfs, squashfsFile, indexFile);
+    auto index = common::ImageFileIndex{indexFile};
+
+    // same results as the lookups through the filesystem
+    for(const auto& path : {"/lib64/libfoo.so.1", "/etc/libfoo", "/etc/../lib64/libfoo.so.1.2", "/usr/lib64/missing"}) {
+        CHECK(index.realpath(path) == common::realpathWithinRootfs(rootfs, path));
+    }
+    CHECK(index.realpath("/etc/libfoo") == "/usr/lib64/libfoo.so.1.2");
+    CHECK_THROWS(common::Error, index.realpath("/loop/file"));
+}
+
+TEST(ImageFileIndexTestGroup, matchesImage) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-file-index")};
+    auto rootfs = testDir.getPath() / "rootfs";
+    auto squashfsFile = testDir.getPath() / "image.squashfs";
+    auto indexFile = common::ImageFileIndex::getFileOfImage(squashfsFile);
+    createRootfs(rootfs);
+    writeSquashfsSuperblock(squashfsFile, 1234, 4096);
+
+    common::ImageFileIndex::create(rootfs, squashfsFile, indexFile);
+    auto index = common::ImageFileIndex{indexFile};
+    CHECK(index.matchesImage(squashfsFile));
+
+    // a copy written elsewhere (e.g. into the OCI bundle) is bound to the same image
+    auto copiedFile = testDir.getPath() / common::ImageFileIndex::fileNameInBundle;
+    index.write(copiedFile);
+    CHECK(common::ImageFileIndex{copiedFile}.matchesImage(squashfsFile));
+
+    // the image was replaced
+    writeSquashfsSuperblock(squashfsFile, 1234, 8192);
+    CHECK(!index.matchesImage(squashfsFile));
+}
+
+TEST(ImageFileIndexTestGroup, readInvalidFile) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-file-index")};
+    auto indexFile = testDir.getPath() / "image.index";
+
+    common::writeTextFile("not an index", indexFile);
+    CHECK_THROWS(common::Error, common::ImageFileIndex{indexFile});
+
+    common::writeTextFile(std::string(4096, 'x'), indexFile);
+    CHECK_THROWS(common::Error, common::ImageFileIndex{indexFile});
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -34,12 +34,18 @@ TEST(ImageMetadataTestGroup, write_read_from_file) {
         {"labelKey0", "labelValue0"},
         {"labelKey1", "labelValue1"}
     };
+    writtenMetadata.fileStoreObjects = std::vector<std::string>{"01/23-755", "ab/cd-644"};
+    writtenMetadata.fileStoreView = std::string{"view-0123"};
+    writtenMetadata.layers = std::vector<std::string>{"sha256:0123", "sha256:4567"};
 
     auto file = common::makeUniquePathWithRandomSuffix("/tmp/sarus-test-imagemetadata");
     writtenMetadata.write(file);
     auto readMetadata = common::ImageMetadata{file, common::UserIdentity{}};
 
     CHECK(readMetadata == writtenMetadata);
+    CHECK(readMetadata.fileStoreObjects == writtenMetadata.fileStoreObjects);
+    CHECK(readMetadata.fileStoreView == writtenMetadata.fileStoreView);
+    CHECK(readMetadata.layers == writtenMetadata.layers);
 
     boost::filesystem::remove(file);
 }
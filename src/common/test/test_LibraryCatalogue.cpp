@@ -0,0 +1,228 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <elf.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "common/LibraryCatalogue.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(LibraryCatalogueTestGroup) {
+};
+
+static boost::filesystem::path getDummyLibsDir() {
+    return boost::filesystem::path{__FILE__}
+        .parent_path()
+        .parent_path()
+        .parent_path()
+        .parent_path() / "CI/dummy_libs";
+}
+
+template<class T>
+static void append(std::string& buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// writes a linker cache in the format of glibc >= 2.32 (see sysdeps/generic/dl-cache.h)
+static void writeDynamicLinkerCache(const boost::filesystem::path& file, const std::vector<std::string>& libraries) {
+    const auto headerSize = std::uint32_t{48};
+    const auto entrySize = std::uint32_t{24};
+
+    auto strings = std::string{};
+    auto entries = std::string{};
+    for(const auto& library : libraries) {
+        auto key = headerSize + entrySize*libraries.size() + strings.size();
+        strings += boost::filesystem::path{library}.filename().string() + '\0';
+        auto value = headerSize + entrySize*libraries.size() + strings.size();
+        strings += library + '\0';
+
+        append(entries, std::int32_t{0x0303}); // ELF, x86-64
+        append(entries, static_cast<std::uint32_t>(key));
+        append(entries, static_cast<std::uint32_t>(value));
+        append(entries, std::uint32_t{0});
+        append(entries, std::uint64_t{0});
+    }
+
+    auto header = std::string{"glibc-ld.so.cache1.1"};
+    append(header, static_cast<std::uint32_t>(libraries.size()));
+    append(header, static_cast<std::uint32_t>(strings.size()));
+    header.append(4, '\0');  // flags + padding
+    header.append(16, '\0'); // extension offset + unused
+    CHECK_EQUAL(header.size(), std::size_t{headerSize});
+
+    common::createFoldersIfNecessary(file.parent_path());
+    boost::filesystem::ofstream{file, std::ios::binary} << header << entries << strings;
+}
+
+static void createRootfs(const boost::filesystem::path& rootfs) {
+    auto dummyLibsDir = getDummyLibsDir();
+    common::copyFile(dummyLibsDir / "libc.so.6-host", rootfs / "lib64/libc.so.6");
+    common::copyFile(dummyLibsDir / "libc.so.6-32bit-container", rootfs / "lib/libc.so.6");
+    common::copyFile(dummyLibsDir / "lib_dummy_0.so", rootfs / "usr/lib64/libdummy.so.1.2");
+    boost::filesystem::create_symlink("../usr/lib64/libdummy.so.1.2", rootfs / "lib64/libdummy.so.1");
+    boost::filesystem::create_symlink("/usr/lib64/libmissing.so.3", rootfs / "lib64/libbroken.so.3");
+
+    writeDynamicLinkerCache(rootfs / "etc/ld.so.cache", {
+        "/lib64/libc.so.6",
+        "/lib/libc.so.6",
+        "/lib64/libdummy.so.1",
+        "/lib64/libbroken.so.3"
+    });
+}
+
+TEST(LibraryCatalogueTestGroup, readDynamicLinkerCache) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-library-catalogue")};
+    auto cacheFile = testDir.getPath() / "ld.so.cache";
+
+    writeDynamicLinkerCache(cacheFile, {"/lib64/libc.so.6", "/usr/lib/libfoo.so.1"});
+    auto expected = std::vector<boost::filesystem::path>{"/lib64/libc.so.6", "/usr/lib/libfoo.so.1"};
+    CHECK(common::readDynamicLinkerCache(cacheFile) == expected);
+
+    common::writeTextFile("not a linker cache", cacheFile);
+    CHECK_THROWS(common::Error, common::readDynamicLinkerCache(cacheFile));
+}
+
+TEST(LibraryCatalogueTestGroup, readElfInformation) {
+    auto dummyLibsDir = getDummyLibsDir();
+
+    auto information = common::readElfInformation(dummyLibsDir / "libc.so.6-host");
+    CHECK(information);
+    CHECK_EQUAL(information->elfClass, 64);
+    CHECK_EQUAL(information->machine, EM_X86_64);
+    CHECK_EQUAL(information->soname, std::string{"libc.so.6"});
+
+    information = common::readElfInformation(dummyLibsDir / "libc.so.6-32bit-container");
+    CHECK(information);
+    CHECK_EQUAL(information->elfClass, 32);
+    CHECK_EQUAL(information->machine, EM_386);
+
+    information = common::readElfInformation(dummyLibsDir / "lib_dummy_0.so");
+    CHECK(information);
+    CHECK(information->soname.empty());
+
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-library-catalogue")};
+    common::writeTextFile("not an ELF file", testDir.getPath());
+    CHECK(!common::readElfInformation(testDir.getPath()));
+}
+
+TEST(LibraryCatalogueTestGroup, create) {
+    auto rootfs = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-library-catalogue")};
+    createRootfs(rootfs.getPath());
+
+    auto catalogue = common::LibraryCatalogue::create(rootfs.getPath());
+
+    // the broken symlink is skipped
+    CHECK_EQUAL(catalogue.getLibraries().size(), std::size_t{3});
+    CHECK(catalogue.find("/lib64/libbroken.so.3") == nullptr);
+
+    const auto* libc = catalogue.find("/lib64/libc.so.6");
+    CHECK(libc != nullptr);
+    CHECK(libc->realPath == "/lib64/libc.so.6");
+    CHECK_EQUAL(libc->soname, std::string{"libc.so.6"});
+    CHECK_EQUAL(libc->elfClass, 64);
+    CHECK_EQUAL(libc->machine, EM_X86_64);
+    CHECK(libc->abi == common::AbiVersion{6});
+
+    const auto* libc32 = catalogue.find("/lib/libc.so.6");
+    CHECK(libc32 != nullptr);
+    CHECK_EQUAL(libc32->elfClass, 32);
+
+    const auto* dummy = catalogue.find("/lib64/libdummy.so.1");
+    CHECK(dummy != nullptr);
+    CHECK(dummy->realPath == "/usr/lib64/libdummy.so.1.2");
+    CHECK((dummy->abi == common::AbiVersion{1, 2}));
+
+    // the dummy libc doesn't contain the version string of glibc
+    CHECK(!catalogue.getLibcVersion());
+
+    CHECK(catalogue.matchesDynamicLinkerCacheOf(rootfs.getPath()));
+    writeDynamicLinkerCache(rootfs.getPath() / "etc/ld.so.cache", {"/lib64/libc.so.6"});
+    CHECK(!catalogue.matchesDynamicLinkerCacheOf(rootfs.getPath()));
+}
+
+TEST(LibraryCatalogueTestGroup, createWithoutDynamicLinkerCache) {
+    auto rootfs = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-library-catalogue")};
+    common::createFoldersIfNecessary(rootfs.getPath() / "etc");
+
+    auto catalogue = common::LibraryCatalogue::create(rootfs.getPath());
+    CHECK(catalogue.getLibraries().empty());
+    CHECK(catalogue.matchesDynamicLinkerCacheOf(rootfs.getPath()));
+}
+
+TEST(LibraryCatalogueTestGroup, writeAndRead) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-library-catalogue")};
+    auto rootfs = testDir.getPath() / "rootfs";
+    createRootfs(rootfs);
+
+    auto written = common::LibraryCatalogue::create(rootfs);
+    auto file = testDir.getPath() / common::LibraryCatalogue::fileNameInBundle;
+    written.write(file);
+    auto read = common::LibraryCatalogue{common::readJSON(file)};
+
+    CHECK_EQUAL(read.getLibraries().size(), written.getLibraries().size());
+    for(const auto& library : written.getLibraries()) {
+        const auto* readLibrary = read.find(library.path);
+        CHECK(readLibrary != nullptr);
+        CHECK(readLibrary->realPath == library.realPath);
+        CHECK_EQUAL(readLibrary->soname, library.soname);
+        CHECK_EQUAL(readLibrary->elfClass, library.elfClass);
+        CHECK_EQUAL(readLibrary->machine, library.machine);
+        CHECK(readLibrary->abi == library.abi);
+    }
+    CHECK(read.getLibcVersion() == written.getLibcVersion());
+    CHECK(read.matchesDynamicLinkerCacheOf(rootfs));
+}
+
+TEST(LibraryCatalogueTestGroup, readInvalidJSON) {
+    // unsupported version
+    auto json = common::parseJSON(R"({"version": 0, "libraries": []})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+
+    // path outside of the rootfs
+    json = common::parseJSON(R"({"version": 1, "linkerCache": {"size": 0, "modificationTime": 0},)"
+                             R"( "libraries": [{"path": "/lib/libc.so.6", "realPath": "/lib/../../etc/shadow",)"
+                             R"( "soname": "", "elfClass": 64, "machine": 62, "abi": []}]})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+
+    // mistyped or missing values
+    json = common::parseJSON(R"({"version": "1", "linkerCache": {"size": 0, "modificationTime": 0}, "libraries": []})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+    json = common::parseJSON(R"({"version": 1, "libraries": []})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+    json = common::parseJSON(R"({"version": 1, "linkerCache": {"size": "0", "modificationTime": 0}, "libraries": []})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+    json = common::parseJSON(R"({"version": 1, "linkerCache": {"size": 0, "modificationTime": 0},)"
+                             R"( "libcVersion": [2], "libraries": []})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+    json = common::parseJSON(R"({"version": 1, "linkerCache": {"size": 0, "modificationTime": 0}, "libraries": {}})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+    json = common::parseJSON(R"({"version": 1, "linkerCache": {"size": 0, "modificationTime": 0},)"
+                             R"( "libraries": [{"path": "/lib/libc.so.6", "realPath": "/lib/libc-2.35.so",)"
+                             R"( "soname": null, "elfClass": 64, "machine": 62, "abi": []}]})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+    json = common::parseJSON(R"({"version": 1, "linkerCache": {"size": 0, "modificationTime": 0},)"
+                             R"( "libraries": [{"path": "/lib/libc.so.6", "realPath": "/lib/libc-2.35.so",)"
+                             R"( "soname": "libc.so.6", "elfClass": 64, "machine": 62, "abi": [6]}]})");
+    CHECK_THROWS(common::Error, common::LibraryCatalogue{json});
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -0,0 +1,108 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "common/Metrics.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+using namespace sarus;
+
+TEST_GROUP(MetricsTestGroup) {
+};
+
+TEST(MetricsTestGroup, disabledByDefault) {
+    common::Metrics metrics;
+    CHECK_FALSE(metrics.isEnabled());
+    metrics.incrementCounter("sarus_test");
+    metrics.observe("sarus_test", 1.0);
+    CHECK(metrics.formatTextfile("").empty());
+    metrics.flush();
+}
+
+TEST(MetricsTestGroup, textfile) {
+    auto directory = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-metrics")};
+    common::createFoldersIfNecessary(directory.getPath());
+    auto uid = getuid();
+    auto textfile = directory.getPath() / ("sarus_" + std::to_string(uid) + ".prom");
+    auto uidLabel = "uid=\"" + std::to_string(uid) + "\"";
+
+    common::Metrics metrics;
+    metrics.configure(directory.getPath(), {}, uid, getgid());
+    CHECK(metrics.isEnabled());
+
+    metrics.incrementCounter("sarus_images_pulled");
+    metrics.observe("sarus_image_phase", 0.3, {{"phase", "copy"}});
+    metrics.flush();
+
+    auto content = common::readFile(textfile);
+    CHECK(content.find("# TYPE sarus_images_pulled_total counter\n") != std::string::npos);
+    CHECK(content.find("sarus_images_pulled_total{" + uidLabel + "} 1\n") != std::string::npos);
+    CHECK(content.find("# TYPE sarus_image_phase_seconds histogram\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_bucket{phase=\"copy\"," + uidLabel + ",le=\"0.25\"} 0\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_bucket{phase=\"copy\"," + uidLabel + ",le=\"0.5\"} 1\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_bucket{phase=\"copy\"," + uidLabel + ",le=\"+Inf\"} 1\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_sum{phase=\"copy\"," + uidLabel + "} 0.3\n") != std::string::npos);
+
+    // samples of later processes are merged with the existing ones
+    metrics.incrementCounter("sarus_images_pulled");
+    metrics.observe("sarus_image_phase", 2, {{"phase", "copy"}});
+    metrics.observe("sarus_image_phase", 7, {{"phase", "mksquashfs"}});
+    metrics.flush();
+
+    content = common::readFile(textfile);
+    CHECK(content.find("sarus_images_pulled_total{" + uidLabel + "} 2\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_bucket{phase=\"copy\"," + uidLabel + ",le=\"0.5\"} 1\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_bucket{phase=\"copy\"," + uidLabel + ",le=\"2.5\"} 2\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_sum{phase=\"copy\"," + uidLabel + "} 2.3\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_count{phase=\"copy\"," + uidLabel + "} 2\n") != std::string::npos);
+    CHECK(content.find("sarus_image_phase_seconds_count{phase=\"mksquashfs\"," + uidLabel + "} 1\n") != std::string::npos);
+
+    // every family is declared only once
+    CHECK_EQUAL(content.find("# TYPE sarus_image_phase_seconds"), content.rfind("# TYPE sarus_image_phase_seconds"));
+}
+
+TEST(MetricsTestGroup, socket) {
+    auto directory = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-metrics")};
+    common::createFoldersIfNecessary(directory.getPath());
+    auto socketPath = directory.getPath() / "metrics.sock";
+
+    auto receiver = socket(AF_UNIX, SOCK_DGRAM, 0);
+    auto address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    CHECK_EQUAL(bind(receiver, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    common::Metrics metrics;
+    metrics.configure({}, socketPath, 1000, 1000);
+    metrics.incrementCounter("sarus_containers_launched");
+    metrics.observe("sarus_hook", 0.25, {{"hook", "mpi"}});
+    metrics.flush();
+
+    auto receive = [receiver]() {
+        char buffer[256];
+        auto size = recv(receiver, buffer, sizeof(buffer), MSG_DONTWAIT);
+        return size > 0 ? std::string(buffer, size) : std::string{};
+    };
+    CHECK_EQUAL(receive(), std::string{"sarus_containers_launched:1|c|#uid:1000"});
+    CHECK_EQUAL(receive(), std::string{"sarus_hook:250|ms|#hook:mpi,uid:1000"});
+    CHECK(receive().empty());
+
+    close(receiver);
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
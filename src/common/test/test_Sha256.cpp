@@ -0,0 +1,70 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <fstream>
+#include <string>
+
+#include "common/Sha256.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+using namespace sarus;
+
+TEST_GROUP(Sha256TestGroup) {
+};
+
+std::string digest(const std::string& data, std::size_t pieceSize) {
+    auto sha = common::Sha256{};
+    for(std::size_t i=0; i<data.size(); i+=pieceSize) {
+        sha.update(data.data() + i, std::min(pieceSize, data.size() - i));
+    }
+    return sha.hexDigest();
+}
+
+TEST(Sha256TestGroup, knownDigests) {
+    // test vectors from FIPS 180-4 examples
+    CHECK_EQUAL(digest("", 1), std::string{"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"});
+    CHECK_EQUAL(digest("abc", 1), std::string{"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"});
+    CHECK_EQUAL(digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 64),
+                std::string{"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"});
+
+    // the result must not depend on how the data is split
+    auto million = std::string(1000000, 'a');
+    auto expected = std::string{"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"};
+    CHECK_EQUAL(digest(million, 1000000), expected);
+    CHECK_EQUAL(digest(million, 63), expected);
+    CHECK_EQUAL(digest(million, 4096), expected);
+}
+
+TEST(Sha256TestGroup, digestOfFile) {
+    auto file = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-sha256")};
+    {
+        std::ofstream os{file.getPath().string()};
+        os << "abc";
+    }
+    CHECK_EQUAL(common::Sha256::digestOfFile(file.getPath()),
+                std::string{"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"});
+    CHECK_THROWS(common::Error, common::Sha256::digestOfFile("/tmp/sarus-utest-sha256-does-not-exist"));
+}
+
+TEST(Sha256TestGroup, hmac) {
+    // test vectors from RFC 4231
+    CHECK_EQUAL(common::Sha256::hmacHexDigest(std::string(20, '\x0b'), "Hi There"),
+                std::string{"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"});
+    CHECK_EQUAL(common::Sha256::hmacHexDigest("Jefe", "what do ya want for nothing?"),
+                std::string{"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"});
+    // key longer than the block size
+    CHECK_EQUAL(common::Sha256::hmacHexDigest(std::string(131, '\xaa'),
+                                              "Test Using Larger Than Block-Size Key - Hash Key First"),
+                std::string{"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"});
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -0,0 +1,147 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "common/PathRAII.hpp"
+#include "common/TreeRemoval.hpp"
+#include "common/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(TreeRemovalTestGroup) {
+};
+
+// a tree with files, symlinks and directories without the owner's write or search permissions
+static void createTree(const boost::filesystem::path& root, const boost::filesystem::path& symlinkTarget) {
+    for(int i=0; i<10; ++i) {
+        auto dir = root / ("dir" + std::to_string(i));
+        for(int j=0; j<10; ++j) {
+            common::createFileIfNecessary(dir / ("subdir" + std::to_string(j)) / "file");
+        }
+        common::createFileIfNecessary(dir / "file");
+        boost::filesystem::create_symlink(symlinkTarget, dir / "symlink");
+    }
+    common::createFileIfNecessary(root / "file");
+    common::createFoldersIfNecessary(root / "empty");
+    chmod((root / "dir0/subdir0").c_str(), 0);
+    chmod((root / "dir1").c_str(), S_IRUSR | S_IXUSR);
+    chmod((root / "dir2").c_str(), S_IRUSR);
+}
+
+TEST(TreeRemovalTestGroup, removeTree) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-tree-removal")};
+    auto symlinkTarget = testDir.getPath() / "symlink-target";
+    common::createFoldersIfNecessary(symlinkTarget);
+    common::createFileIfNecessary(symlinkTarget / "file");
+
+    for(auto numberOfThreads : {1u, 4u}) {
+        auto root = testDir.getPath() / "tree";
+        createTree(root, symlinkTarget);
+        common::removeTree(root, numberOfThreads);
+        CHECK(!boost::filesystem::exists(boost::filesystem::symlink_status(root)));
+        CHECK(boost::filesystem::exists(symlinkTarget / "file"));
+    }
+
+    // single file
+    auto file = testDir.getPath() / "file";
+    common::createFileIfNecessary(file);
+    common::removeTree(file);
+    CHECK(!boost::filesystem::exists(file));
+
+    // nonexistent path
+    common::removeTree(testDir.getPath() / "nonexistent");
+}
+
+TEST(TreeRemovalTestGroup, removeTreeInBackground) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-tree-removal")};
+    auto root = testDir.getPath() / "tree";
+    auto trashDir = testDir.getPath() / "trash";
+    createTree(root, testDir.getPath());
+
+    common::removeTreeInBackground(root, trashDir);
+    CHECK(!boost::filesystem::exists(root));
+
+    // the tree disappears from the trash once the background process is done
+    auto isTrashEmpty = [&]() {
+        return boost::filesystem::directory_iterator(trashDir) == boost::filesystem::directory_iterator{};
+    };
+    for(int i=0; i<100 && !isTrashEmpty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    CHECK(isTrashEmpty());
+}
+
+TEST(TreeRemovalTestGroup, removeTreeInBackgroundWithUntrustedTrash) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-tree-removal")};
+    auto root = testDir.getPath() / "tree";
+    auto target = testDir.getPath() / "target";
+    createTree(root, testDir.getPath());
+    common::createFoldersIfNecessary(target);
+
+    // a symlink planted at the path of the trash is not followed
+    auto symlinkTrash = testDir.getPath() / "symlink-trash";
+    boost::filesystem::create_directory_symlink(target, symlinkTrash);
+    common::removeTreeInBackground(root, symlinkTrash);
+    CHECK(!boost::filesystem::exists(root));
+    CHECK(boost::filesystem::directory_iterator(target) == boost::filesystem::directory_iterator{});
+
+    // a trash accessible by other users is not used
+    createTree(root, testDir.getPath());
+    auto openTrash = testDir.getPath() / "open-trash";
+    common::createFoldersIfNecessary(openTrash);
+    boost::filesystem::permissions(openTrash, boost::filesystem::all_all);
+    common::removeTreeInBackground(root, openTrash);
+    CHECK(!boost::filesystem::exists(root));
+    CHECK(boost::filesystem::directory_iterator(openTrash) == boost::filesystem::directory_iterator{});
+}
+
+TEST(TreeRemovalTestGroup, isTrashDirectoryTrusted) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-tree-removal")};
+    auto trash = testDir.getPath() / "trash";
+    auto owner = getuid();
+
+    CHECK(!common::isTrashDirectoryTrusted(trash, owner));
+
+    common::createFoldersIfNecessary(trash);
+    boost::filesystem::permissions(trash, boost::filesystem::owner_all);
+    CHECK(common::isTrashDirectoryTrusted(trash, owner));
+    CHECK(!common::isTrashDirectoryTrusted(trash, owner + 1));
+
+    boost::filesystem::permissions(trash, boost::filesystem::owner_all | boost::filesystem::group_read);
+    CHECK(!common::isTrashDirectoryTrusted(trash, owner));
+
+    auto symlinkTrash = testDir.getPath() / "symlink-trash";
+    boost::filesystem::permissions(trash, boost::filesystem::owner_all);
+    boost::filesystem::create_directory_symlink(trash, symlinkTrash);
+    CHECK(!common::isTrashDirectoryTrusted(symlinkTrash, owner));
+}
+
+TEST(TreeRemovalTestGroup, deferredRemovalOfPathRAII) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-tree-removal")};
+    auto root = testDir.getPath() / "tree";
+    createTree(root, testDir.getPath());
+    {
+        auto rootRAII = common::PathRAII{root};
+        rootRAII.setDeferredRemoval(testDir.getPath() / "trash");
+    }
+    CHECK(!boost::filesystem::exists(root));
+    CHECK(boost::filesystem::exists(testDir.getPath() / "trash"));
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -162,6 +162,15 @@ TEST(UtilityTestGroup, makeUniquePathWithRandomSuffix) {
     CHECK(boost::regex_match(uniquePath.string().c_str(), matches, expectedRegex));
 }
 
+TEST(UtilityTestGroup, hasRandomSuffix) {
+    CHECK(common::hasRandomSuffix(common::makeUniquePathWithRandomSuffix("/tmp/file")));
+    CHECK(common::hasRandomSuffix("/tmp/file.squashfs-abcdefghijklmnop"));
+    CHECK(!common::hasRandomSuffix("/tmp/file.squashfs"));
+    CHECK(!common::hasRandomSuffix("/tmp/file-abcdefghijklmno"));
+    CHECK(!common::hasRandomSuffix("/tmp/file-abcdefghijklmnoP"));
+    CHECK(!common::hasRandomSuffix("/tmp/-abcdefghijklmnop/file"));
+}
+
 TEST(UtilityTestGroup, createFoldersIfNecessary) {
     common::createFoldersIfNecessary("/tmp/grandparent/parent/child");
     CHECK((common::getOwner("/tmp/grandparent/parent") == std::tuple<uid_t, gid_t>{0, 0}));
@@ -400,13 +409,13 @@ TEST(UtilityTestGroup, isSharedLib) {
 
 TEST(UtilityTestGroup, parseSharedLibAbi) {
     CHECK_THROWS(common::Error, common::parseSharedLibAbi("invalid"));
-    CHECK(common::parseSharedLibAbi("libc.so") == (std::vector<std::string>{}));
-    CHECK(common::parseSharedLibAbi("libc.so.1") == (std::vector<std::string>{"1"}));
-    CHECK(common::parseSharedLibAbi("libc.so.1.2") == (std::vector<std::string>{"1", "2"}));
-    CHECK(common::parseSharedLibAbi("libc.so.1.2.3") == (std::vector<std::string>{"1", "2", "3"}));
-    CHECK(common::parseSharedLibAbi("libc.so.1.2.3rc1") == (std::vector<std::string>{"1", "2", "3rc1"}));
+    CHECK(common::parseSharedLibAbi("libc.so") == (common::AbiVersion{}));
+    CHECK(common::parseSharedLibAbi("libc.so.1") == (common::AbiVersion{1}));
+    CHECK(common::parseSharedLibAbi("libc.so.1.2") == (common::AbiVersion{1, 2}));
+    CHECK(common::parseSharedLibAbi("libc.so.1.2.3") == (common::AbiVersion{1, 2, 3}));
+    CHECK(common::parseSharedLibAbi("libc.so.1.2.3rc1") == (common::AbiVersion{1, 2, 3}));
 
-    CHECK(common::parseSharedLibAbi("libfoo.so.0") == (std::vector<std::string>{"0"}));
+    CHECK(common::parseSharedLibAbi("libfoo.so.0") == (common::AbiVersion{0}));
 }
 
 TEST(UtilityTestGroup, resolveSharedLibAbi) {
@@ -421,48 +430,48 @@ TEST(UtilityTestGroup, resolveSharedLibAbi) {
 
     // libtest.so
     common::createFileIfNecessary(testDir / "libtest.so");
-    CHECK(common::resolveSharedLibAbi(testDir / "libtest.so") == std::vector<std::string>{});
+    CHECK(common::resolveSharedLibAbi(testDir / "libtest.so") == common::AbiVersion{});
 
     // libtest.so.1
     common::createFileIfNecessary(testDir / "libtest.so.1");
-    CHECK(common::resolveSharedLibAbi(testDir / "libtest.so.1") == std::vector<std::string>{"1"});
+    CHECK(common::resolveSharedLibAbi(testDir / "libtest.so.1") == common::AbiVersion{1});
 
     // libtest_symlink.so.1 -> libtest_symlink.so.1.2
     common::createFileIfNecessary(testDir / "libtest_symlink.so.1.2");
     boost::filesystem::create_symlink(testDir / "libtest_symlink.so.1.2", testDir / "libtest_symlink.so.1");
-    CHECK(common::resolveSharedLibAbi(testDir / "libtest_symlink.so.1") == (std::vector<std::string>{"1", "2"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "libtest_symlink.so.1") == (common::AbiVersion{1, 2}));
 
     // libtest_symlink.so.1.2.3 -> libtest_symlink.so.1.2
     boost::filesystem::create_symlink(testDir / "libtest_symlink.so.1.2", testDir / "libtest_symlink.so.1.2.3");
-    CHECK(common::resolveSharedLibAbi(testDir / "libtest_symlink.so.1.2.3") == (std::vector<std::string>{"1", "2", "3"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "libtest_symlink.so.1.2.3") == (common::AbiVersion{1, 2, 3}));
 
     // libtest_symlink.so -> libtest_symlink.so.1.2.3 -> libtest_symlink.so.1.2
     boost::filesystem::create_symlink(testDir / "libtest_symlink.so.1.2.3", testDir / "libtest_symlink.so");
-    CHECK(common::resolveSharedLibAbi(testDir / "libtest_symlink.so") == (std::vector<std::string>{"1", "2", "3"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "libtest_symlink.so") == (common::AbiVersion{1, 2, 3}));
 
     // subdir/libtest_symlink.so -> ../libtest_symlink.so.1.2.3 -> libtest_symlink.so.1.2
     common::createFoldersIfNecessary(testDir / "subdir");
     boost::filesystem::create_symlink("../libtest_symlink.so.1.2.3", testDir / "subdir/libtest_symlink.so");
-    CHECK(common::resolveSharedLibAbi(testDir / "subdir/libtest_symlink.so") == (std::vector<std::string>{"1", "2", "3"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "subdir/libtest_symlink.so") == (common::AbiVersion{1, 2, 3}));
 
     // /libtest_symlink_within_rootdir.so -> /subdir/libtest_symlink_within_rootdir.so.1 -> ../libtest_symlink_within_rootdir.so.1.2
     boost::filesystem::create_symlink("/subdir/libtest_symlink_within_rootdir.so.1", testDir / "libtest_symlink_within_rootdir.so");
     boost::filesystem::create_symlink("../libtest_symlink_within_rootdir.so.1.2", testDir / "/subdir/libtest_symlink_within_rootdir.so.1");
     common::createFileIfNecessary(testDir / "libtest_symlink_within_rootdir.so.1.2");
-    CHECK(common::resolveSharedLibAbi("/libtest_symlink_within_rootdir.so", testDir) == (std::vector<std::string>{"1", "2"}));
+    CHECK(common::resolveSharedLibAbi("/libtest_symlink_within_rootdir.so", testDir) == (common::AbiVersion{1, 2}));
 
     // Some vendors have symlinks with incompatible major versions,
     // like libvdpau_nvidia.so.1 -> libvdpau_nvidia.so.440.33.01.
     // For these cases, we trust the vendor and resolve the Lib Abi to that of the symlink.
     // Note here we use libtest.so.1 as the "original lib file" and create a symlink to it.
     boost::filesystem::create_symlink(testDir / "libtest.so.1", testDir / "libtest.so.234.56");
-    CHECK(common::resolveSharedLibAbi(testDir / "libtest.so.234.56") == (std::vector<std::string>{"234", "56"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "libtest.so.234.56") == (common::AbiVersion{234, 56}));
 
     boost::filesystem::create_symlink("../libtest.so.1.2", testDir / "subdir" / "libtest.so.234.56");
-    CHECK(common::resolveSharedLibAbi(testDir / "subdir" / "libtest.so.234.56") == (std::vector<std::string>{"234", "56"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "subdir" / "libtest.so.234.56") == (common::AbiVersion{234, 56}));
 
     boost::filesystem::create_symlink("../libtest.so.1.2", testDir / "subdir" / "libtest.so.234");
-    CHECK(common::resolveSharedLibAbi(testDir / "subdir" / "libtest.so.234") == (std::vector<std::string>{"234"}));
+    CHECK(common::resolveSharedLibAbi(testDir / "subdir" / "libtest.so.234") == (common::AbiVersion{234}));
 }
 
 TEST(UtilityTestGroup, getSharedLibSoname) {
@@ -522,6 +531,37 @@ TEST(UtilityTestGroup, serializeJSON) {
     CHECK_EQUAL(common::removeWhitespaces(actual), expected);
 }
 
+TEST(UtilityTestGroup, writeJSON_readJSON) {
+    namespace rj = rapidjson;
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-json")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto file = testDir.getPath() / "file.json";
+
+    auto json = rj::Document{rj::kObjectType};
+    auto& allocator = json.GetAllocator();
+    json.AddMember("string", rj::Value{"stringValue", allocator}, allocator);
+    json.AddMember("array", rj::Value{rj::kArrayType}, allocator);
+    json["array"].PushBack(rj::Value{0}, allocator);
+    json["array"].PushBack(rj::Value{1}, allocator);
+
+    // pretty
+    common::writeJSON(json, file);
+    CHECK(common::readFile(file).find('\n') != std::string::npos);
+    CHECK(common::readJSON(file) == json);
+
+    // compact
+    common::writeJSON(json, file, false);
+    CHECK_EQUAL(common::readFile(file), std::string{"{\"string\":\"stringValue\",\"array\":[0,1]}"});
+    CHECK(common::readJSON(file) == json);
+
+    // empty, invalid and missing files
+    common::createFileIfNecessary(testDir.getPath() / "empty.json");
+    CHECK_THROWS(common::Error, common::readJSON(testDir.getPath() / "empty.json"));
+    common::writeTextFile("{\"key\": ", testDir.getPath() / "invalid.json");
+    CHECK_THROWS(common::Error, common::readJSON(testDir.getPath() / "invalid.json"));
+    CHECK_THROWS(common::Error, common::readJSON(testDir.getPath() / "missing.json"));
+}
+
 TEST(UtilityTestGroup, setCpuAffinity_invalid_argument) {
     CHECK_THROWS(common::Error, common::setCpuAffinity({})); // no CPUs
 }
@@ -546,4 +586,30 @@ TEST(UtilityTestGroup, getCpuAffinity_setCpuAffinity) {
     common::setCpuAffinity(initialCpus);
 }
 
+TEST(UtilityTestGroup, parseCpuList) {
+    CHECK(common::parseCpuList("") == std::vector<int>{});
+    CHECK(common::parseCpuList("\n") == std::vector<int>{});
+    CHECK(common::parseCpuList("3\n") == std::vector<int>{3});
+    CHECK(common::parseCpuList("0-3,8,10-11") == (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    CHECK_THROWS(common::Error, common::parseCpuList("3-1"));
+    CHECK_THROWS(common::Error, common::parseCpuList("a-b"));
+}
+
+TEST(UtilityTestGroup, getNumaNodesOfCpus) {
+    auto sysfsNodesDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-numa")};
+    common::writeTextFile("0-1,3\n", sysfsNodesDir.getPath() / "online");
+    common::writeTextFile("0-3,16-19\n", sysfsNodesDir.getPath() / "node0/cpulist");
+    common::writeTextFile("4-7,20-23\n", sysfsNodesDir.getPath() / "node1/cpulist");
+    common::writeTextFile("\n", sysfsNodesDir.getPath() / "node3/cpulist"); // memory-only node
+
+    CHECK(common::getNumaNodes(sysfsNodesDir.getPath()) == (std::vector<int>{0, 1, 3}));
+    CHECK(common::getNumaNodesOfCpus({2, 3}, sysfsNodesDir.getPath()) == std::vector<int>{0});
+    CHECK(common::getNumaNodesOfCpus({21}, sysfsNodesDir.getPath()) == std::vector<int>{1});
+    CHECK(common::getNumaNodesOfCpus({3, 4}, sysfsNodesDir.getPath()) == (std::vector<int>{0, 1}));
+    CHECK(common::getNumaNodesOfCpus({30}, sysfsNodesDir.getPath()) == std::vector<int>{});
+
+    // no NUMA topology in sysfs
+    CHECK(common::getNumaNodesOfCpus({0}, sysfsNodesDir.getPath() / "non-existing") == std::vector<int>{});
+}
+
 SARUS_UNITTEST_MAIN_FUNCTION();
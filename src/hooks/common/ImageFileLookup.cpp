@@ -0,0 +1,292 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "ImageFileLookup.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <tuple>
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+
+#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "common/Error.hpp"
+#include "common/Utility.hpp"
+#include "hooks/common/Utility.hpp"
+
+
+namespace sarus {
+namespace hooks {
+namespace common {
+
+namespace {
+
+const unsigned int maxSymlinkDepth = 40;
+
+// mountinfo escapes spaces, tabs, newlines and backslashes as octal sequences, e.g. "\040"
+std::string unescapeMountinfoField(const std::string& field) {
+    auto result = std::string{};
+    for(std::size_t i=0; i<field.size(); ++i) {
+        if(field[i] == '\\' && i + 3 < field.size()) {
+            auto octal = field.substr(i+1, 3);
+            if(octal.find_first_not_of("01234567") == std::string::npos) {
+                result += static_cast<char>(std::stoi(octal, nullptr, 8));
+                i += 3;
+                continue;
+            }
+        }
+        result += field[i];
+    }
+    return result;
+}
+
+bool isWhiteout(const struct stat& st) {
+    return S_ISCHR(st.st_mode) && st.st_rdev == makedev(0, 0);
+}
+
+// the "trusted.overlay.*" attributes, or the "user.overlay.*" ones of the overlays mounted with "userxattr"
+boost::optional<std::string> getOverlayAttribute(const boost::filesystem::path& path, const std::string& name) {
+    for(const auto* prefix : {"trusted.overlay.", "user.overlay."}) {
+        auto attribute = prefix + name;
+        char value[256];
+        auto size = lgetxattr(path.c_str(), attribute.c_str(), value, sizeof(value));
+        if(size >= 0) {
+            return std::string(value, size);
+        }
+        if(errno == ERANGE) {
+            return std::string{};
+        }
+    }
+    return {};
+}
+
+bool isPrefixOf(const boost::filesystem::path& prefix, const boost::filesystem::path& path) {
+    auto prefixIt = prefix.begin();
+    auto pathIt = path.begin();
+    for(; prefixIt != prefix.end(); ++prefixIt, ++pathIt) {
+        if(pathIt == path.end() || *prefixIt != *pathIt) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+ImageFileLookup::ImageFileLookup(const boost::filesystem::path& bundleDir, const boost::filesystem::path& rootfsDir)
+    : rootfsDir{rootfsDir}
+{
+    auto indexFile = bundleDir / sarus::common::ImageFileIndex::fileNameInBundle;
+    if(!boost::filesystem::exists(indexFile)) {
+        utility::logMessage("No index of the image's files available in the OCI bundle", sarus::common::LogLevel::DEBUG);
+        return;
+    }
+
+    try {
+        index = sarus::common::ImageFileIndex{indexFile};
+        std::tie(mountPoints, upperDir) = parseMountsOfRootfs(sarus::common::readFile("/proc/self/mountinfo"), rootfsDir);
+    }
+    catch(const std::exception& e) {
+        utility::logMessage(boost::format("Ignoring index of the image's files: %s") % e.what(),
+                            sarus::common::LogLevel::DEBUG);
+        index = boost::none;
+        return;
+    }
+
+    if(!upperDir) {
+        utility::logMessage("Ignoring index of the image's files: the rootfs is not an overlay filesystem",
+                            sarus::common::LogLevel::DEBUG);
+    }
+}
+
+boost::filesystem::path ImageFileLookup::realpathWithinRootfs(const boost::filesystem::path& path) const {
+    auto result = boost::filesystem::path{};
+    if(!isIndexAvailable() || !path.is_absolute() || !appendPaths("/", path, 0, result)) {
+        return sarus::common::realpathWithinRootfs(rootfsDir, path);
+    }
+    return result;
+}
+
+bool ImageFileLookup::exists(const boost::filesystem::path& path) const {
+    auto symlinkTarget = std::string{};
+    auto result = isIndexAvailable() && path.is_absolute() ? lookup(path, symlinkTarget) : Lookup::unknown;
+    if(result == Lookup::unknown) {
+        return boost::filesystem::exists(rootfsDir / path);
+    }
+    return result != Lookup::notFound;
+}
+
+std::tuple<std::vector<boost::filesystem::path>, boost::optional<boost::filesystem::path>>
+ImageFileLookup::parseMountsOfRootfs(const std::string& mountinfo, const boost::filesystem::path& rootfsDir) {
+    auto mountPoints = std::vector<boost::filesystem::path>{};
+    auto upperDir = boost::optional<boost::filesystem::path>{};
+
+    // e.g. 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+    std::istringstream is{mountinfo};
+    std::string line;
+    while(std::getline(is, line)) {
+        auto fields = std::vector<std::string>{};
+        boost::split(fields, line, boost::is_any_of(" "));
+        auto separator = std::find(fields.cbegin(), fields.cend(), "-");
+        if(fields.size() < 5 || std::distance(separator, fields.cend()) < 4) {
+            continue;
+        }
+        auto mountPoint = boost::filesystem::path{unescapeMountinfoField(fields[4])};
+        const auto& filesystemType = *(separator + 1);
+        const auto& superOptions = *(separator + 3);
+
+        if(mountPoint == rootfsDir) {
+            // the last mount on the rootfs is the visible one
+            upperDir = boost::none;
+            if(filesystemType == "overlay") {
+                auto options = std::vector<std::string>{};
+                boost::split(options, superOptions, boost::is_any_of(","));
+                for(const auto& option : options) {
+                    if(boost::starts_with(option, "upperdir=")) {
+                        upperDir = boost::filesystem::path{unescapeMountinfoField(option.substr(9))};
+                    }
+                }
+            }
+        }
+        else if(isPrefixOf(rootfsDir, mountPoint)) {
+            auto mountPointInRootfs = boost::filesystem::path{"/"};
+            auto it = mountPoint.begin();
+            std::advance(it, std::distance(rootfsDir.begin(), rootfsDir.end()));
+            for(; it != mountPoint.end(); ++it) {
+                mountPointInRootfs /= *it;
+            }
+            mountPoints.push_back(mountPointInRootfs);
+        }
+    }
+
+    return std::tuple<std::vector<boost::filesystem::path>, boost::optional<boost::filesystem::path>>{mountPoints, upperDir};
+}
+
+ImageFileLookup::Lookup ImageFileLookup::lookup(const boost::filesystem::path& path, std::string& symlinkTarget) const {
+    if(isUnderMountPoint(path)) {
+        return Lookup::unknown;
+    }
+
+    if(auto result = lookupInUpperDir(*upperDir, path, symlinkTarget)) {
+        return *result;
+    }
+
+    auto entry = index->find(path);
+    if(!entry) {
+        return Lookup::notFound;
+    }
+    if(S_ISLNK(entry->mode)) {
+        symlinkTarget = entry->symlinkTarget;
+        return Lookup::symlink;
+    }
+    return Lookup::other;
+}
+
+/**
+ * The upper directory answers the lookup if it holds the path itself, or if one of the path's
+ * ancestors hides the lower layer below it: a whiteout, a file replacing a directory of the
+ * lower layer, or an opaque directory (e.g. a directory removed and created again in the
+ * container, or a persistent writable layer). A directory renamed with "redirect_dir" takes
+ * its contents from another path of the lower layer, thus the filesystem is looked up instead.
+ */
+boost::optional<ImageFileLookup::Lookup> ImageFileLookup::lookupInUpperDir(const boost::filesystem::path& upperDir,
+                                                                           const boost::filesystem::path& path,
+                                                                           std::string& symlinkTarget) {
+    struct stat st;
+    auto pathInUpperDir = upperDir / path;
+    if(lstat(pathInUpperDir.c_str(), &st) == 0) {
+        // a whiteout hides the file of the lower layer
+        if(isWhiteout(st)) {
+            return Lookup::notFound;
+        }
+        if(S_ISLNK(st.st_mode)) {
+            symlinkTarget = boost::filesystem::read_symlink(pathInUpperDir).string();
+            return Lookup::symlink;
+        }
+        return Lookup::other;
+    }
+
+    for(auto ancestor = path.parent_path(); !ancestor.empty(); ancestor = ancestor.parent_path()) {
+        auto ancestorInUpperDir = upperDir / ancestor;
+        if(lstat(ancestorInUpperDir.c_str(), &st) == 0) {
+            if(S_ISLNK(st.st_mode)) {
+                return Lookup::unknown;
+            }
+            if(!S_ISDIR(st.st_mode) || getOverlayAttribute(ancestorInUpperDir, "opaque") == std::string{"y"}) {
+                return Lookup::notFound;
+            }
+            if(getOverlayAttribute(ancestorInUpperDir, "redirect")) {
+                return Lookup::unknown;
+            }
+        }
+        if(ancestor == ancestor.root_path()) {
+            break;
+        }
+    }
+
+    return {};
+}
+
+bool ImageFileLookup::isUnderMountPoint(const boost::filesystem::path& path) const {
+    for(const auto& mountPoint : mountPoints) {
+        if(isPrefixOf(mountPoint, path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// see appendPathsWithinRootfs in common/Utility.cpp, returns false if a lookup cannot be answered
+bool ImageFileLookup::appendPaths(const boost::filesystem::path& path0, const boost::filesystem::path& path1,
+                                  unsigned int depth, boost::filesystem::path& result) const {
+    if(depth > maxSymlinkDepth) {
+        return false;
+    }
+
+    auto current = path0;
+    for(const auto& element : path1) {
+        if(element == "/" || element == ".") {
+            continue;
+        }
+        else if(element == "..") {
+            if(current > "/") {
+                current = current.remove_trailing_separator().parent_path();
+            }
+            continue;
+        }
+
+        auto symlinkTarget = std::string{};
+        auto found = lookup(current / element, symlinkTarget);
+        if(found == Lookup::unknown) {
+            return false;
+        }
+        else if(found == Lookup::symlink) {
+            auto target = boost::filesystem::path{symlinkTarget};
+            if(!appendPaths(target.is_absolute() ? "/" : current, target, depth + 1, current)) {
+                return false;
+            }
+        }
+        else {
+            current /= element;
+        }
+    }
+
+    result = current;
+    return true;
+}
+
+}}} // namespace
@@ -0,0 +1,72 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_hooks_common_ImageFileLookup_hpp
+#define sarus_hooks_common_ImageFileLookup_hpp
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common/ImageFileIndex.hpp"
+
+
+namespace sarus {
+namespace hooks {
+namespace common {
+
+/**
+ * Path lookups within the container's rootfs, answered by the index of the image's files when
+ * the runtime passed one in the OCI bundle. The index only describes the read-only lower layer
+ * of the rootfs, thus a path is looked up in the overlay's upper directory first (where the
+ * runtime and the hooks write), and the paths under a mount point of the rootfs are looked up
+ * in the filesystem as usual. Without an index, all the lookups go through the filesystem.
+ * The lookups are meant for the checks of the hooks: the destinations where the hooks mount
+ * or create files are resolved in the rootfs with sarus::common::realpathWithinRootfs.
+ */
+class ImageFileLookup {
+public:
+    ImageFileLookup(const boost::filesystem::path& bundleDir, const boost::filesystem::path& rootfsDir);
+
+    bool isIndexAvailable() const { return index && upperDir; }
+    // same as sarus::common::realpathWithinRootfs
+    boost::filesystem::path realpathWithinRootfs(const boost::filesystem::path& path) const;
+    // whether a path of the rootfs (whose symlinks are already resolved) exists
+    bool exists(const boost::filesystem::path& path) const;
+
+    // the mount points and overlay upper directory of the rootfs, from /proc/self/mountinfo
+    static std::tuple<std::vector<boost::filesystem::path>, boost::optional<boost::filesystem::path>>
+    parseMountsOfRootfs(const std::string& mountinfo, const boost::filesystem::path& rootfsDir);
+
+    enum class Lookup { notFound, symlink, other, unknown };
+    // the lookup of a path in the upper directory, or none if the lower layer (i.e. the index) answers it
+    static boost::optional<Lookup> lookupInUpperDir(const boost::filesystem::path& upperDir,
+                                                    const boost::filesystem::path& path,
+                                                    std::string& symlinkTarget);
+
+private:
+    Lookup lookup(const boost::filesystem::path& path, std::string& symlinkTarget) const;
+    bool isUnderMountPoint(const boost::filesystem::path& path) const;
+    bool appendPaths(const boost::filesystem::path& path0, const boost::filesystem::path& path1,
+                     unsigned int depth, boost::filesystem::path& result) const;
+
+private:
+    boost::filesystem::path rootfsDir;
+    boost::optional<sarus::common::ImageFileIndex> index;
+    boost::optional<boost::filesystem::path> upperDir;
+    std::vector<boost::filesystem::path> mountPoints; // relative to the rootfs
+};
+
+}}} // namespace
+
+#endif
@@ -23,6 +23,7 @@
 #include <rapidjson/istreamwrapper.h>
 
 #include "common/Error.hpp"
+#include "common/Metrics.hpp"
 #include "common/Utility.hpp"
 #include "runtime/mount_utilities.hpp"
 
@@ -63,6 +64,33 @@ void applyLoggingConfigIfAvailable(const rapidjson::Document& json) {
     }
 }
 
+/**
+ * Configures the export of the hook's metrics with the sinks passed by Sarus
+ * through the bundle annotations. Must be called before entering the container's
+ * mount namespace, because the sinks are opened on the host filesystem.
+ */
+void applyMetricsConfigIfAvailable(const rapidjson::Document& json) {
+    if(!json.HasMember("annotations")) {
+        return;
+    }
+
+    auto textfileDirectory = boost::optional<boost::filesystem::path>{};
+    auto socket = boost::optional<boost::filesystem::path>{};
+    if(json["annotations"].HasMember("com.hooks.metrics.textfileDirectory")) {
+        textfileDirectory = boost::filesystem::path{json["annotations"]["com.hooks.metrics.textfileDirectory"].GetString()};
+    }
+    if(json["annotations"].HasMember("com.hooks.metrics.socket")) {
+        socket = boost::filesystem::path{json["annotations"]["com.hooks.metrics.socket"].GetString()};
+    }
+    if(!textfileDirectory && !socket) {
+        return;
+    }
+
+    auto uid = json["process"]["user"]["uid"].GetUint();
+    auto gid = json["process"]["user"]["gid"].GetUint();
+    sarus::common::Metrics::getInstance().configure(textfileDirectory, socket, uid, gid);
+}
+
 std::tuple<boost::filesystem::path, pid_t> parseStateOfContainerFromStdin() {
     rj::Document state;
     try {
@@ -90,6 +118,33 @@ std::unordered_map<std::string, std::string> parseEnvironmentVariablesFromOCIBun
     return env;
 }
 
+/**
+ * Returns the catalogue of the container's libraries passed by the runtime, if any and if still
+ * valid for the container's rootfs. Otherwise the hooks fall back to probing the rootfs.
+ */
+boost::optional<sarus::common::LibraryCatalogue> readLibraryCatalogueIfAvailable(const boost::filesystem::path& bundleDir,
+                                                                                 const boost::filesystem::path& rootfsDir) {
+    auto file = bundleDir / sarus::common::LibraryCatalogue::fileNameInBundle;
+    if(!boost::filesystem::exists(file)) {
+        utility::logMessage("No library catalogue available in the OCI bundle", sarus::common::LogLevel::DEBUG);
+        return {};
+    }
+
+    try {
+        auto catalogue = sarus::common::LibraryCatalogue{sarus::common::readJSON(file)};
+        if(!catalogue.matchesDynamicLinkerCacheOf(rootfsDir)) {
+            utility::logMessage("Ignoring library catalogue: the container's dynamic linker cache has changed",
+                                sarus::common::LogLevel::DEBUG);
+            return {};
+        }
+        return catalogue;
+    }
+    catch(const sarus::common::Error& e) {
+        utility::logMessage(boost::format("Ignoring library catalogue: %s") % e.what(), sarus::common::LogLevel::DEBUG);
+        return {};
+    }
+}
+
 static void enterNamespace(const boost::filesystem::path& namespaceFile) {
     // get namespace's fd   
     auto fd = open(namespaceFile.c_str(), O_RDONLY);
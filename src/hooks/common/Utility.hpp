@@ -18,6 +18,7 @@
 #include <boost/filesystem.hpp>
 #include <rapidjson/document.h>
 
+#include "common/LibraryCatalogue.hpp"
 #include "common/Logger.hpp"
 #include "common/UserIdentity.hpp"
 
@@ -27,8 +28,11 @@ namespace common {
 namespace utility {
 
 void applyLoggingConfigIfAvailable(const rapidjson::Document&);
+void applyMetricsConfigIfAvailable(const rapidjson::Document&);
 std::tuple<boost::filesystem::path, pid_t> parseStateOfContainerFromStdin();
 std::unordered_map<std::string, std::string> parseEnvironmentVariablesFromOCIBundle(const boost::filesystem::path&);
+boost::optional<sarus::common::LibraryCatalogue> readLibraryCatalogueIfAvailable(const boost::filesystem::path& bundleDir,
+        const boost::filesystem::path& rootfsDir);
 void enterMountNamespaceOfProcess(pid_t);
 void enterPidNamespaceOfProcess(pid_t pid);
 void validatedBindMount(const boost::filesystem::path& from, const boost::filesystem::path& to,
@@ -0,0 +1,93 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "hooks/common/ImageFileLookup.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(ImageFileLookupTestGroup) {
+};
+
+TEST(ImageFileLookupTestGroup, parseMountsOfRootfs) {
+    auto mountinfo = std::string{
+        "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+        "90 22 0:50 / /var/sarus/rootfs rw,relatime - overlay overlay"
+            " rw,lowerdir=/var/sarus/lower,upperdir=/var/sarus/overlay/upper,workdir=/var/sarus/overlay/work\n"
+        "91 90 0:51 / /var/sarus/rootfs/dev rw,nosuid - tmpfs tmpfs rw\n"
+        "92 90 8:1 /home/user /var/sarus/rootfs/home/user\\040name rw - ext4 /dev/sda1 rw\n"
+        "93 22 8:1 / /var/sarus/rootfs-other rw - ext4 /dev/sda1 rw\n"};
+
+    auto mountPoints = std::vector<boost::filesystem::path>{};
+    auto upperDir = boost::optional<boost::filesystem::path>{};
+    std::tie(mountPoints, upperDir) = hooks::common::ImageFileLookup::parseMountsOfRootfs(mountinfo, "/var/sarus/rootfs");
+
+    CHECK(upperDir);
+    CHECK(*upperDir == "/var/sarus/overlay/upper");
+    auto expectedMountPoints = std::vector<boost::filesystem::path>{"/dev", "/home/user name"};
+    CHECK(mountPoints == expectedMountPoints);
+
+    // the overlay is hidden by a later mount on the rootfs
+    mountinfo += "94 90 8:1 / /var/sarus/rootfs rw - ext4 /dev/sda1 rw\n";
+    std::tie(mountPoints, upperDir) = hooks::common::ImageFileLookup::parseMountsOfRootfs(mountinfo, "/var/sarus/rootfs");
+    CHECK(!upperDir);
+}
+
+TEST(ImageFileLookupTestGroup, lookupInUpperDir) {
+    using Lookup = hooks::common::ImageFileLookup::Lookup;
+    auto upperDirRAII = sarus::common::PathRAII{sarus::common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-upper")};
+    const auto& upperDir = upperDirRAII.getPath();
+    sarus::common::createFoldersIfNecessary(upperDir / "dir");
+    sarus::common::createFileIfNecessary(upperDir / "dir/file");
+    boost::filesystem::create_symlink("file", upperDir / "dir/link");
+    CHECK_EQUAL(mknod((upperDir / "whiteout").c_str(), S_IFCHR, makedev(0, 0)), 0);
+    sarus::common::createFoldersIfNecessary(upperDir / "opaque");
+    CHECK_EQUAL(setxattr((upperDir / "opaque").c_str(), "trusted.overlay.opaque", "y", 1, 0), 0);
+    sarus::common::createFoldersIfNecessary(upperDir / "redirected");
+    CHECK_EQUAL(setxattr((upperDir / "redirected").c_str(), "trusted.overlay.redirect", "/dir", 4, 0), 0);
+
+    auto lookup = [&upperDir](const boost::filesystem::path& path) {
+        auto symlinkTarget = std::string{};
+        return hooks::common::ImageFileLookup::lookupInUpperDir(upperDir, path, symlinkTarget);
+    };
+    auto symlinkTarget = std::string{};
+
+    // paths of the upper directory
+    CHECK(lookup("/dir/file") == Lookup::other);
+    CHECK(hooks::common::ImageFileLookup::lookupInUpperDir(upperDir, "/dir/link", symlinkTarget) == Lookup::symlink);
+    CHECK_EQUAL(symlinkTarget, std::string{"file"});
+    CHECK(lookup("/whiteout") == Lookup::notFound);
+
+    // paths of the lower layer
+    CHECK(!lookup("/dir/lower-file"));
+    CHECK(!lookup("/lower-dir/lower-file"));
+
+    // paths of the lower layer hidden or moved by an ancestor in the upper directory
+    CHECK(lookup("/whiteout/lower-file") == Lookup::notFound);
+    CHECK(lookup("/dir/file/lower-file") == Lookup::notFound);
+    CHECK(lookup("/opaque/lower-dir/lower-file") == Lookup::notFound);
+    CHECK(lookup("/redirected/lower-file") == Lookup::unknown);
+    CHECK(lookup("/dir/link/lower-file") == Lookup::unknown);
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -16,6 +16,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <elf.h>
 
 #include <boost/format.hpp>
 #include <boost/regex.hpp>
@@ -38,6 +39,8 @@ GlibcHook::GlibcHook() {
     hooks::common::utility::enterMountNamespaceOfProcess(pidOfContainer);
     parseConfigJSONOfBundle();
     parseEnvironmentVariables();
+    libraryCatalogue = hooks::common::utility::readLibraryCatalogueIfAvailable(bundleDir, rootfsDir);
+    imageFileLookup = hooks::common::ImageFileLookup{bundleDir, rootfsDir};
 
     logMessage("Successfully initialized hook", sarus::common::LogLevel::INFO);
 }
@@ -76,6 +79,7 @@ void GlibcHook::parseConfigJSONOfBundle() {
     auto json = sarus::common::readJSON(bundleDir / "config.json");
 
     hooks::common::utility::applyLoggingConfigIfAvailable(json);
+    hooks::common::utility::applyMetricsConfigIfAvailable(json);
 
     // get rootfs
     auto root = boost::filesystem::path{ json["root"]["path"].GetString() };
@@ -116,11 +120,21 @@ bool GlibcHook::containerHasGlibc() const {
 }
 
 std::vector<boost::filesystem::path> GlibcHook::get64bitContainerLibraries() const {
+    if(libraryCatalogue) {
+        auto libs = std::vector<boost::filesystem::path>{};
+        for(const auto& lib : libraryCatalogue->getLibraries()) {
+            if(lib.machine == EM_X86_64 && imageFileLookup->exists(lib.realPath)) {
+                libs.push_back(lib.path);
+            }
+        }
+        return libs;
+    }
+
     auto isNot64bit = [this](const boost::filesystem::path& lib) {
-        return !sarus::common::is64bitSharedLib(rootfsDir / sarus::common::realpathWithinRootfs(rootfsDir, lib), readelfPath);
+        return !sarus::common::is64bitSharedLib(rootfsDir / imageFileLookup->realpathWithinRootfs(lib), readelfPath);
     };
     auto doesNotExist = [this](const boost::filesystem::path& lib) {
-        return !boost::filesystem::exists(rootfsDir / sarus::common::realpathWithinRootfs(rootfsDir, lib));
+        return !imageFileLookup->exists(imageFileLookup->realpathWithinRootfs(lib));
     };
     auto libs = sarus::common::getSharedLibsFromDynamicLinker(ldconfigPath, rootfsDir);
     auto newEnd = std::remove_if(libs.begin(), libs.end(), doesNotExist);
@@ -185,6 +199,10 @@ std::tuple<unsigned int, unsigned int> GlibcHook::detectHostLibcVersion() const
  * A file is used to store information about the ldd output, since forkExecWait() does not capture stdout.
  */
 std::tuple<unsigned int, unsigned int> GlibcHook::detectContainerLibcVersion() const {
+    if(libraryCatalogue && libraryCatalogue->getLibcVersion()) {
+        return *libraryCatalogue->getLibcVersion();
+    }
+
     auto glibcOutput = std::string();
     auto lddOutputPath = sarus::common::makeUniquePathWithRandomSuffix(boost::filesystem::path{"/tmp/glibc-hook-ldd-out"});
 
@@ -218,7 +236,10 @@ void GlibcHook::verifyThatHostAndContainerGlibcAreABICompatible(
     const boost::filesystem::path& hostLibc,
     const boost::filesystem::path& containerLibc) const {
     auto hostSoname = sarus::common::getSharedLibSoname(hostLibc, readelfPath);
-    auto containerSoname = sarus::common::getSharedLibSoname(rootfsDir / containerLibc, readelfPath);
+    const auto* cataloguedLibc = libraryCatalogue ? libraryCatalogue->find(containerLibc) : nullptr;
+    auto containerSoname = cataloguedLibc && !cataloguedLibc->soname.empty()
+        ? cataloguedLibc->soname
+        : sarus::common::getSharedLibSoname(rootfsDir / containerLibc, readelfPath);
     if(hostSoname != containerSoname) {
         auto message = boost::format(
             "Failed to inject glibc libraries. Host's glibc is not ABI compatible with container's glibc."
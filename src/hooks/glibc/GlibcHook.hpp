@@ -16,8 +16,10 @@
 #include <boost/filesystem.hpp>
 #include <sys/types.h>
 
+#include "common/LibraryCatalogue.hpp"
 #include "common/Logger.hpp"
 #include "common/UserIdentity.hpp"
+#include "hooks/common/ImageFileLookup.hpp"
 
 namespace sarus {
 namespace hooks {
@@ -56,6 +58,8 @@ private:
     boost::filesystem::path readelfPath;
     std::vector<boost::filesystem::path> hostLibraries;
     std::vector<boost::filesystem::path> containerLibraries;
+    boost::optional<sarus::common::LibraryCatalogue> libraryCatalogue;
+    boost::optional<hooks::common::ImageFileLookup> imageFileLookup;
 };
 
 }}} // namespace
@@ -10,15 +10,20 @@
 
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 #include "hooks/common/Utility.hpp"
 #include "GlibcHook.hpp"
 
 int main(int argc, char* argv[]) {
     try {
+        auto timer = sarus::common::Metrics::ScopedTimer{"sarus_hook", {{"hook", "glibc"}}};
         sarus::hooks::glibc::GlibcHook{}.injectGlibcLibrariesIfNecessary();
     } catch(const sarus::common::Error& e) {
         sarus::common::Logger::getInstance().logErrorTrace(e, "Glibc hook");
+        sarus::common::Metrics::getInstance().incrementCounter("sarus_hook_failures", {{"hook", "glibc"}});
+        sarus::common::Metrics::getInstance().flush();
         exit(EXIT_FAILURE);
     }
+    sarus::common::Metrics::getInstance().flush();
     return 0;
 }
@@ -28,6 +28,7 @@
 #include "common/Error.hpp"
 #include "common/Utility.hpp"
 #include "hooks/common/Utility.hpp"
+#include "hooks/common/ImageFileLookup.hpp"
 #include "runtime/mount_utilities.hpp"
 #include "SharedLibrary.hpp"
 
@@ -42,17 +43,33 @@ MpiHook::MpiHook() {
     hooks::common::utility::enterMountNamespaceOfProcess(pidOfContainer);
     parseConfigJSONOfBundle();
     parseEnvironmentVariables();
-    log("Getting list of shared libs from the container's dynamic linker cache", sarus::common::LogLevel::DEBUG);
-    auto containerLibPaths = sarus::common::getSharedLibsFromDynamicLinker(ldconfig, rootfsDir);
-    for (const auto& p : containerLibPaths){
-        if ( !boost::filesystem::exists(rootfsDir / sarus::common::realpathWithinRootfs(rootfsDir, p)) ) {
-            auto message = boost::format("Container library %s has an entry in the dynamic linker cache"
-                                         " but does not exist or is a broken symlink in the container's"
-                                         " filesystem. Skipping...") % p;
-            log(message, sarus::common::LogLevel::DEBUG);
-            continue;
+    imageFileLookup = hooks::common::ImageFileLookup{bundleDir, rootfsDir};
+    if (auto catalogue = hooks::common::utility::readLibraryCatalogueIfAvailable(bundleDir, rootfsDir)) {
+        log("Getting list of shared libs from the image's library catalogue", sarus::common::LogLevel::DEBUG);
+        for (const auto& lib : catalogue->getLibraries()){
+            // a bind mount could still shadow the library
+            if ( !imageFileLookup->exists(lib.realPath) ) {
+                auto message = boost::format("Container library %s is in the image's library catalogue"
+                                             " but does not exist in the container's filesystem. Skipping...") % lib.path;
+                log(message, sarus::common::LogLevel::DEBUG);
+                continue;
+            }
+            containerLibs.push_back(SharedLibrary(lib.path, lib.abi));
+        }
+    }
+    else {
+        log("Getting list of shared libs from the container's dynamic linker cache", sarus::common::LogLevel::DEBUG);
+        auto containerLibPaths = sarus::common::getSharedLibsFromDynamicLinker(ldconfig, rootfsDir);
+        for (const auto& p : containerLibPaths){
+            if ( !imageFileLookup->exists(imageFileLookup->realpathWithinRootfs(p)) ) {
+                auto message = boost::format("Container library %s has an entry in the dynamic linker cache"
+                                             " but does not exist or is a broken symlink in the container's"
+                                             " filesystem. Skipping...") % p;
+                log(message, sarus::common::LogLevel::DEBUG);
+                continue;
+            }
+            containerLibs.push_back(SharedLibrary(p, rootfsDir));
         }
-        containerLibs.push_back(SharedLibrary(p, rootfsDir));
     }
     // Map Libraries
     hostToContainerMpiLibs = mapHostTocontainerLibs(hostMpiLibs, containerLibs);
@@ -88,6 +105,7 @@ void MpiHook::parseConfigJSONOfBundle() {
     auto json = sarus::common::readJSON(bundleDir / "config.json");
 
     hooks::common::utility::applyLoggingConfigIfAvailable(json);
+    hooks::common::utility::applyMetricsConfigIfAvailable(json);
 
     auto root = boost::filesystem::path{ json["root"]["path"].GetString() };
     if(root.is_absolute()) {
@@ -362,9 +380,12 @@ void MpiHook::createSymlinksInDynamicLinkerDefaultSearchDirs(const boost::filesy
     //      You should note that the library being injected (configured in Sarus configuration) should've been compiled using sonames,
     //      not the linker names, to avoid breaking the injected library for the same reason stated above.
     auto libName = sarus::common::getSharedLibLinkerName(linkFilename);
+    // The names are prefixes of the filename, so that the version numbers are kept verbatim (e.g. "01" in libfoo.so.1.01)
     auto linkNames = std::vector<std::string> { libName.string() };
-    for(const auto& versionNumber : sarus::common::parseSharedLibAbi(linkFilename)) {
-        linkNames.push_back(linkNames.back() + "." + versionNumber);
+    auto filename = linkFilename.filename().string();
+    for(auto dot = libName.string().size(); dot < filename.size(); ) {
+        dot = filename.find('.', dot + 1);
+        linkNames.push_back(filename.substr(0, dot));
     }
 
     // Preserve root links (when requested)
@@ -15,11 +15,13 @@
 #include <unordered_map>
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 #include <sys/types.h>
 
 #include "common/LogLevel.hpp"
 #include "common/PathHash.hpp"
 #include "common/UserIdentity.hpp"
+#include "hooks/common/ImageFileLookup.hpp"
 #include "SharedLibrary.hpp"
 
 namespace sarus {
@@ -65,6 +67,7 @@ private:
     sarus::common::UserIdentity userIdentity;
     boost::filesystem::path ldconfig;
     std::vector<boost::filesystem::path> bindMounts;
+    boost::optional<hooks::common::ImageFileLookup> imageFileLookup;
     std::vector<SharedLibrary> containerLibs;
     std::vector<SharedLibrary> hostMpiLibs;
     std::vector<SharedLibrary> hostDepLibs;
@@ -10,44 +10,36 @@
 #include "common/Utility.hpp"
 #include "hooks/mpi/SharedLibrary.hpp"
 
-#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
-#include <unordered_map>
 #include <vector>
 
 namespace sarus {
 namespace hooks {
 namespace mpi {
 
-SharedLibrary::SharedLibrary(const boost::filesystem::path& path, const boost::filesystem::path& rootDir) : path(path) {
+SharedLibrary::SharedLibrary(const boost::filesystem::path& path, const boost::filesystem::path& rootDir)
+    : SharedLibrary(path, sarus::common::resolveSharedLibAbi(path, rootDir))
+{}
+
+SharedLibrary::SharedLibrary(const boost::filesystem::path& path, const sarus::common::AbiVersion& abi)
+    : abi(abi)
+    , path(path)
+{
     linkerName = sarus::common::getSharedLibLinkerName(path).string();
-    auto abi = sarus::common::resolveSharedLibAbi(path, rootDir);
-    if (abi.size() > 0)
-        major = std::stoi(abi[0]);
-    if (abi.size() > 1)
-        minor = std::stoi(abi[1]);
-    if (abi.size() > 2)
-        patch = std::stoi(abi[2]);
-    auto abiString = boost::algorithm::join(abi, ".");
-    if (abiString.size() > 0)
-        realName = linkerName + "." + abiString;
-    else
-        realName = linkerName;
 }
 
 bool SharedLibrary::hasMajorVersion() const {
-    return realName != linkerName;
+    return !abi.empty();
 }
 
 bool SharedLibrary::isFullAbiCompatible(const SharedLibrary& sl) const{
     return linkerName == sl.getLinkerName() &&
-           major == sl.major &&
-           minor <= sl.minor;
+           sarus::common::getAbiCompatibility(sl.abi, abi) == sarus::common::AbiCompatibility::COMPATIBLE;
 }
 
 bool SharedLibrary::isMajorAbiCompatible(const SharedLibrary& sl) const{
     return linkerName == sl.getLinkerName() &&
-           major == sl.major;
+           sarus::common::getAbiCompatibility(sl.abi, abi) != sarus::common::AbiCompatibility::MAJOR_NOT_COMPATIBLE;
 }
 
 SharedLibrary SharedLibrary::pickNewestAbiCompatibleLibrary(const std::vector<SharedLibrary>& candidates) const{
@@ -60,14 +52,16 @@ SharedLibrary SharedLibrary::pickNewestAbiCompatibleLibrary(const std::vector<Sh
     }
 
     // find the oldest
+    const auto major = abi.getMajor();
+    const auto minor = abi.getMinor();
     const SharedLibrary* oldest = &candidates[0];
     for (auto& c : candidates){
-        if (c.getRealName() == realName){
+        if (c.linkerName == linkerName && c.abi == abi){
             // exact match!
             return c;
         }
-        if (c.major < oldest->major || (c.major == oldest->major && c.minor <= oldest->minor)){
-            if (oldest->major == major && c.major < major){
+        if (c.abi.getMajor() < oldest->abi.getMajor() || (c.abi.getMajor() == oldest->abi.getMajor() && c.abi.getMinor() <= oldest->abi.getMinor())){
+            if (oldest->abi.getMajor() == major && c.abi.getMajor() < major){
                 // don't go to an older major
                 continue;
             }
@@ -78,11 +72,11 @@ SharedLibrary SharedLibrary::pickNewestAbiCompatibleLibrary(const std::vector<Sh
     // find best >= oldest but <= this
     const SharedLibrary* best = oldest;
     for (auto& c : candidates){
-        if ((c.major > best->major || (c.major == best->major && c.minor >= best->minor)) &&
-            c.major <= major &&
-            c.minor <= minor) {
+        if ((c.abi.getMajor() > best->abi.getMajor() || (c.abi.getMajor() == best->abi.getMajor() && c.abi.getMinor() >= best->abi.getMinor())) &&
+            c.abi.getMajor() <= major &&
+            c.abi.getMinor() <= minor) {
                 // c newer than best, older than me.
-                if (c.major == major && c.minor == minor && c.patch < best->patch) {
+                if (c.abi.getMajor() == major && c.abi.getMinor() == minor && c.abi.getPatch() < best->abi.getPatch()) {
                     // don't downgrade patch
                     continue;
                 }
@@ -101,7 +95,10 @@ boost::filesystem::path SharedLibrary::getPath() const {
 }
 
 std::string SharedLibrary::getRealName() const {
-    return realName;
+    // computed on demand, the comparisons between libraries only need the linker name and the ABI version
+    if (abi.empty())
+        return linkerName;
+    return linkerName + "." + abi.toString();
 }
 
 }}}
\ No newline at end of file
@@ -12,8 +12,11 @@
 #define sarus_hooks_mpi_Utils_hpp
 
 #include <boost/filesystem.hpp>
+#include <string>
 #include <vector>
 
+#include "common/AbiVersion.hpp"
+
 // See comment on <sys/types.h> or https://bugzilla.redhat.com/show_bug.cgi?id=130601
 #undef major
 #undef minor
@@ -26,6 +29,7 @@ class SharedLibrary {
     // Using naming convention mentioned in The Linux Programming Interface book.
 public:
     SharedLibrary(const boost::filesystem::path& path, const boost::filesystem::path& rootDir="");
+    SharedLibrary(const boost::filesystem::path& path, const sarus::common::AbiVersion& abi);
 
     bool hasMajorVersion() const;
     bool isFullAbiCompatible(const SharedLibrary& sl) const;
@@ -34,14 +38,12 @@ public:
     std::string getLinkerName() const;
     boost::filesystem::path getPath() const;
     std::string getRealName() const;
+    const sarus::common::AbiVersion& getAbi() const { return abi; }
 
 private:
-    int major = 0;
-    int minor = 0;
-    int patch = 0;
+    sarus::common::AbiVersion abi;
     std::string linkerName;
     boost::filesystem::path path;
-    std::string realName;
 };
 
 }}}
@@ -10,15 +10,20 @@
 
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 #include "hooks/common/Utility.hpp"
 #include "MpiHook.hpp"
 
 int main(int argc, char* argv[]) {
     try {
+        auto timer = sarus::common::Metrics::ScopedTimer{"sarus_hook", {{"hook", "mpi"}}};
         sarus::hooks::mpi::MpiHook{}.activateMpiSupport();
     } catch(const sarus::common::Error& e) {
         sarus::common::Logger::getInstance().logErrorTrace(e, "MPI hook");
+        sarus::common::Metrics::getInstance().incrementCounter("sarus_hook_failures", {{"hook", "mpi"}});
+        sarus::common::Metrics::getInstance().flush();
         exit(EXIT_FAILURE);
     }
+    sarus::common::Metrics::getInstance().flush();
     return 0;
 }
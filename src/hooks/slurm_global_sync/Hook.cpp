@@ -143,6 +143,7 @@ void Hook::parseConfigJSONOfBundle() {
     auto json = sarus::common::readJSON(bundleDir / "config.json");
 
     hooks::common::utility::applyLoggingConfigIfAvailable(json);
+    hooks::common::utility::applyMetricsConfigIfAvailable(json);
 
     // get environment variables
     auto env = hooks::common::utility::parseEnvironmentVariablesFromOCIBundle(bundleDir);
@@ -10,19 +10,24 @@
 
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 #include "hooks/common/Utility.hpp"
 #include "Hook.hpp"
 
 
 int main(int argc, char* argv[]) {
     try {
+        auto timer = sarus::common::Metrics::ScopedTimer{"sarus_hook", {{"hook", "slurm-global-sync"}}};
         auto hook = sarus::hooks::slurm_global_sync::Hook{};
         hook.dropPrivileges();
         hook.loadConfigs();
         hook.performSynchronization();
     } catch(const sarus::common::Error& e) {
         sarus::common::Logger::getInstance().logErrorTrace(e, "SLURM global sync hook");
+        sarus::common::Metrics::getInstance().incrementCounter("sarus_hook_failures", {{"hook", "slurm-global-sync"}});
+        sarus::common::Metrics::getInstance().flush();
         exit(EXIT_FAILURE);
     }
+    sarus::common::Metrics::getInstance().flush();
     return 0;
 }
\ No newline at end of file
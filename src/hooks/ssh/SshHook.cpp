@@ -106,6 +106,7 @@ void SshHook::parseConfigJSONOfBundle() {
     auto json = sarus::common::readJSON(bundleDir / "config.json");
 
     hooks::common::utility::applyLoggingConfigIfAvailable(json);
+    hooks::common::utility::applyMetricsConfigIfAvailable(json);
 
     // get rootfs
     auto root = boost::filesystem::path{ json["root"]["path"].GetString() };
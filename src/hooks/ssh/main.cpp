@@ -14,6 +14,7 @@
 
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 #include "common/Utility.hpp"
 #include "hooks/common/Utility.hpp"
 #include "SshHook.hpp"
@@ -38,7 +39,11 @@ int main(int argc, char* argv[]) {
             sarus::hooks::ssh::SshHook{}.checkUserHasSshKeys();
         }
         else if(argv[1] == std::string("start-ssh-daemon")) {
-            sarus::hooks::ssh::SshHook{}.startSshDaemon();
+            {
+                auto timer = sarus::common::Metrics::ScopedTimer{"sarus_hook", {{"hook", "ssh"}}};
+                sarus::hooks::ssh::SshHook{}.startSshDaemon();
+            }
+            sarus::common::Metrics::getInstance().flush();
         }
         else {
             auto message = boost::format("Failed to execute SSH hook. CLI argument %s is not supported.")
@@ -0,0 +1,338 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "hooks/timestamp/LaunchTrace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+
+#include "common/Error.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace hooks {
+namespace timestamp {
+namespace trace {
+
+static const std::string recordTag = "sarus-trace";
+static const std::string recordVersion = "1";
+static const double stragglerSpreadFactor = 3.0;
+static const double minStragglerDelay = 0.001; // seconds
+
+static std::int64_t readClock(clockid_t clock) {
+    struct timespec ts;
+    if(clock_gettime(clock, &ts) != 0) {
+        SARUS_THROW_ERROR("Failed to read clock: " + std::string(strerror(errno)));
+    }
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+std::string getRankFromEnvironment(const std::unordered_map<std::string, std::string>& environment) {
+    // the first variable set by the most common workload managers and process managers
+    static const auto variables = std::vector<std::string>{
+        "SLURM_PROCID", "PMIX_RANK", "PMI_RANK", "OMPI_COMM_WORLD_RANK", "ALPS_APP_PE"
+    };
+    // the rank is part of the name of the trace file, thus only plain numbers are accepted
+    for(const auto& variable : variables) {
+        auto it = environment.find(variable);
+        if(it != environment.cend() && !it->second.empty()
+           && std::all_of(it->second.cbegin(), it->second.cend(), ::isdigit)) {
+            return it->second;
+        }
+    }
+    return "";
+}
+
+Record makeRecord(const std::string& phase,
+                  const std::unordered_map<std::string, std::string>& environment,
+                  pid_t pidOfContainer) {
+    auto record = Record{};
+    record.monotonic = readClock(CLOCK_MONOTONIC);
+    record.realtime = readClock(CLOCK_REALTIME);
+    record.node = sarus::common::getHostname();
+    record.rank = getRankFromEnvironment(environment);
+    record.pid = pidOfContainer;
+    record.phase = phase.empty() ? "unnamed" : phase;
+    return record;
+}
+
+boost::filesystem::path getTraceFile(const boost::filesystem::path& traceDirectory, const Record& record) {
+    // one file per rank, so that thousands of ranks never append to the same file
+    auto rank = record.rank.empty() ? "pid" + std::to_string(record.pid) : record.rank;
+    return traceDirectory / (boost::format("%s.%s.trace") % record.node % rank).str();
+}
+
+void appendRecord(const boost::filesystem::path& traceFile, const Record& record) {
+    auto line = formatRecord(record) + "\n";
+
+    auto fd = open(traceFile.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        auto message = boost::format("Failed to open trace file %s: %s") % traceFile % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    // a single write of a short line, so that records of concurrent hooks never interleave
+    auto written = write(fd, line.c_str(), line.size());
+    auto writeErrno = errno;
+    close(fd);
+    if(written != static_cast<ssize_t>(line.size())) {
+        auto message = boost::format("Failed to write record to trace file %s: %s") % traceFile % strerror(writeErrno);
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+std::string formatRecord(const Record& record) {
+    auto rank = record.rank.empty() ? "-" : record.rank;
+    return (boost::format("%s %s %d %d %s %s %d %s")
+        % recordTag % recordVersion
+        % record.realtime % record.monotonic
+        % record.node % rank % record.pid % record.phase).str();
+}
+
+boost::optional<Record> parseRecord(const std::string& line) {
+    auto is = std::istringstream{line};
+    auto tag = std::string{};
+    auto version = std::string{};
+    auto record = Record{};
+    if(!(is >> tag >> version) || tag != recordTag || version != recordVersion) {
+        return {};
+    }
+    if(!(is >> record.realtime >> record.monotonic >> record.node >> record.rank >> record.pid)) {
+        return {};
+    }
+    if(record.rank == "-") {
+        record.rank.clear();
+    }
+    // the phase is the rest of the line and may contain spaces
+    std::getline(is >> std::ws, record.phase);
+    if(record.phase.empty()) {
+        return {};
+    }
+    return record;
+}
+
+static void readRecordsOfFile(const boost::filesystem::path& file, std::vector<Record>& records) {
+    std::ifstream is{file.string()};
+    if(!is) {
+        auto message = boost::format("Failed to open trace file %s") % file;
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto line = std::string{};
+    while(std::getline(is, line)) {
+        // lines not in the trace format (e.g. log messages) are skipped
+        if(auto record = parseRecord(line)) {
+            records.push_back(std::move(*record));
+        }
+    }
+}
+
+std::vector<Record> readRecords(const std::vector<boost::filesystem::path>& filesOrDirectories) {
+    auto records = std::vector<Record>{};
+    for(const auto& path : filesOrDirectories) {
+        if(boost::filesystem::is_directory(path)) {
+            auto files = std::vector<boost::filesystem::path>{};
+            for(const auto& entry : boost::filesystem::directory_iterator{path}) {
+                if(boost::filesystem::is_regular_file(entry.status())) {
+                    files.push_back(entry.path());
+                }
+            }
+            std::sort(files.begin(), files.end());
+            for(const auto& file : files) {
+                readRecordsOfFile(file, records);
+            }
+        }
+        else {
+            readRecordsOfFile(path, records);
+        }
+    }
+    return records;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if(values.empty()) {
+        SARUS_THROW_ERROR("Cannot compute the percentile of an empty set of values");
+    }
+    // nearest-rank method
+    std::sort(values.begin(), values.end());
+    auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * values.size()));
+    rank = std::min(std::max(rank, std::size_t{1}), values.size());
+    return values[rank - 1];
+}
+
+static PhaseStatistics makeStatistics(const std::string& phase, const std::vector<double>& values) {
+    auto statistics = PhaseStatistics{};
+    statistics.phase = phase;
+    statistics.numberOfRanks = values.size();
+    statistics.min = *std::min_element(values.cbegin(), values.cend());
+    statistics.p50 = percentile(values, 50);
+    statistics.p90 = percentile(values, 90);
+    statistics.p99 = percentile(values, 99);
+    statistics.max = *std::max_element(values.cbegin(), values.cend());
+    return statistics;
+}
+
+static bool isEarlierByMedian(const PhaseStatistics& lhs, const PhaseStatistics& rhs) {
+    return lhs.p50 < rhs.p50 || (lhs.p50 == rhs.p50 && lhs.phase < rhs.phase);
+}
+
+Timeline analyze(const std::vector<Record>& records, std::size_t maxStragglersPerPhase) {
+    if(records.empty()) {
+        SARUS_THROW_ERROR("No launch trace records found");
+    }
+
+    auto timeline = Timeline{};
+    timeline.start = std::min_element(records.cbegin(), records.cend(), [](const Record& lhs, const Record& rhs) {
+        return lhs.realtime < rhs.realtime;
+    })->realtime;
+
+    // group records by rank; ranks without a rank identifier are told apart by node and container pid
+    using RankKey = std::pair<std::string, std::string>; // (rank, node)
+    auto recordsOfRank = std::map<RankKey, std::vector<const Record*>>{};
+    auto nodes = std::set<std::string>{};
+    for(const auto& record : records) {
+        auto key = record.rank.empty()
+            ? RankKey{record.node + ":" + std::to_string(record.pid), record.node}
+            : RankKey{record.rank, record.node};
+        recordsOfRank[key].push_back(&record);
+        nodes.insert(record.node);
+    }
+    timeline.numberOfRanks = recordsOfRank.size();
+    timeline.numberOfNodes = nodes.size();
+
+    auto offsetsOfPhase = std::map<std::string, std::vector<std::pair<double, RankKey>>>{};
+    auto durationsOfInterval = std::map<std::string, std::vector<double>>{};
+
+    for(auto& entry : recordsOfRank) {
+        auto& rankRecords = entry.second;
+        std::sort(rankRecords.begin(), rankRecords.end(), [](const Record* lhs, const Record* rhs) {
+            return lhs->monotonic < rhs->monotonic;
+        });
+
+        auto seenPhases = std::set<std::string>{};
+        const Record* previous = nullptr;
+        for(const auto* record : rankRecords) {
+            // in case of repeated phases (e.g. the same trace file reused), keep the first one
+            if(!seenPhases.insert(record->phase).second) {
+                continue;
+            }
+            auto offset = (record->realtime - timeline.start) / 1e9;
+            offsetsOfPhase[record->phase].push_back({offset, entry.first});
+            if(previous) {
+                auto interval = previous->phase + " -> " + record->phase;
+                durationsOfInterval[interval].push_back((record->monotonic - previous->monotonic) / 1e9);
+            }
+            previous = record;
+        }
+    }
+
+    for(const auto& entry : offsetsOfPhase) {
+        auto offsets = std::vector<double>{};
+        for(const auto& offsetAndRank : entry.second) {
+            offsets.push_back(offsetAndRank.first);
+        }
+        timeline.phases.push_back(makeStatistics(entry.first, offsets));
+    }
+    std::sort(timeline.phases.begin(), timeline.phases.end(), isEarlierByMedian);
+
+    for(const auto& entry : durationsOfInterval) {
+        timeline.intervals.push_back(makeStatistics(entry.first, entry.second));
+    }
+    std::sort(timeline.intervals.begin(), timeline.intervals.end(),
+              [](const PhaseStatistics& lhs, const PhaseStatistics& rhs) { return lhs.p50 > rhs.p50; });
+
+    for(const auto& phase : timeline.phases) {
+        auto offsets = offsetsOfPhase[phase.phase];
+        std::sort(offsets.begin(), offsets.end(), [](const std::pair<double, RankKey>& lhs, const std::pair<double, RankKey>& rhs) {
+            return lhs.first > rhs.first;
+        });
+        // report only the ranks that lag well behind the bulk of the job, i.e. later than
+        // the median by more than a few times the spread between the median and the 90th percentile
+        auto threshold = phase.p50 + std::max(stragglerSpreadFactor * (phase.p90 - phase.p50), minStragglerDelay);
+        for(std::size_t i=0; i<offsets.size() && i<maxStragglersPerPhase; ++i) {
+            if(offsets[i].first <= threshold) {
+                break;
+            }
+            timeline.stragglers.push_back(Straggler{phase.phase, offsets[i].second.second, offsets[i].second.first, offsets[i].first});
+        }
+    }
+
+    for(const auto& entry : recordsOfRank) {
+        auto phases = std::set<std::string>{};
+        for(const auto* record : entry.second) {
+            phases.insert(record->phase);
+        }
+        if(phases.size() < offsetsOfPhase.size()) {
+            timeline.incompleteRanks.push_back(entry.first.first + "@" + entry.first.second);
+        }
+    }
+
+    return timeline;
+}
+
+static std::string formatStatisticsTable(const std::string& title, const std::vector<PhaseStatistics>& rows) {
+    auto os = std::ostringstream{};
+    os << boost::format("%-40s %8s %10s %10s %10s %10s %10s\n")
+        % title % "ranks" % "min" % "p50" % "p90" % "p99" % "max";
+    for(const auto& row : rows) {
+        os << boost::format("%-40s %8d %10.6f %10.6f %10.6f %10.6f %10.6f\n")
+            % row.phase % row.numberOfRanks % row.min % row.p50 % row.p90 % row.p99 % row.max;
+    }
+    return os.str();
+}
+
+std::string formatTimeline(const Timeline& timeline) {
+    auto os = std::ostringstream{};
+    os << boost::format("Launch timeline of %d ranks on %d nodes, starting at %.6f (UNIX time)\n\n")
+        % timeline.numberOfRanks % timeline.numberOfNodes % (timeline.start / 1e9);
+
+    os << formatStatisticsTable("Phase (seconds since start)", timeline.phases);
+    os << "\n";
+    if(!timeline.intervals.empty()) {
+        os << formatStatisticsTable("Interval (seconds)", timeline.intervals);
+        os << "\n";
+    }
+
+    if(timeline.stragglers.empty()) {
+        os << "No stragglers\n";
+    }
+    else {
+        os << "Stragglers (seconds since start):\n";
+        for(const auto& straggler : timeline.stragglers) {
+            os << boost::format("  %-40s rank %s on %s at %.6f\n")
+                % straggler.phase % straggler.rank % straggler.node % straggler.offset;
+        }
+    }
+
+    if(!timeline.incompleteRanks.empty()) {
+        os << boost::format("\n%d ranks are missing some of the phases:") % timeline.incompleteRanks.size();
+        for(const auto& rank : timeline.incompleteRanks) {
+            os << " " << rank;
+        }
+        os << "\n";
+    }
+
+    return os.str();
+}
+
+} // namespace
+
+}}} // namespace
@@ -0,0 +1,96 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_hooks_timestamp_LaunchTrace_hpp
+#define sarus_hooks_timestamp_LaunchTrace_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace hooks {
+namespace timestamp {
+
+/**
+ * Structured launch traces: every invocation of the Timestamp hook appends one record
+ * to a per-rank trace file, and the records of all the ranks of a job are later merged
+ * into a job-wide timeline.
+ *
+ * A record is a single line with the format
+ *
+ *   sarus-trace 1 <CLOCK_REALTIME ns> <CLOCK_MONOTONIC ns> <node> <rank> <container pid> <phase>
+ *
+ * The realtime clock places the records of different nodes on a common time axis, while
+ * the monotonic clock measures the time between the phases of the same rank without being
+ * affected by adjustments of the system clock.
+ */
+namespace trace {
+
+struct Record {
+    std::int64_t realtime;  // nanoseconds
+    std::int64_t monotonic; // nanoseconds
+    std::string node;
+    std::string rank;
+    pid_t pid; // of the container
+    std::string phase;
+};
+
+struct PhaseStatistics {
+    std::string phase;
+    std::size_t numberOfRanks;
+    // seconds since the first record of the job
+    double min, p50, p90, p99, max;
+};
+
+struct Straggler {
+    std::string phase;
+    std::string node;
+    std::string rank;
+    double offset; // seconds since the first record of the job
+};
+
+struct Timeline {
+    std::size_t numberOfRanks;
+    std::size_t numberOfNodes;
+    std::int64_t start; // CLOCK_REALTIME of the first record
+    std::vector<PhaseStatistics> phases; // ordered by median offset
+    std::vector<PhaseStatistics> intervals; // time between consecutive phases of the same rank
+    std::vector<Straggler> stragglers; // ranks far behind the median of a phase
+    std::vector<std::string> incompleteRanks; // ranks missing some of the phases
+};
+
+Record makeRecord(const std::string& phase,
+                  const std::unordered_map<std::string, std::string>& environment,
+                  pid_t pidOfContainer);
+std::string getRankFromEnvironment(const std::unordered_map<std::string, std::string>& environment);
+boost::filesystem::path getTraceFile(const boost::filesystem::path& traceDirectory, const Record&);
+void appendRecord(const boost::filesystem::path& traceFile, const Record&);
+
+std::string formatRecord(const Record&);
+boost::optional<Record> parseRecord(const std::string& line);
+std::vector<Record> readRecords(const std::vector<boost::filesystem::path>& filesOrDirectories);
+
+Timeline analyze(const std::vector<Record>& records, std::size_t maxStragglersPerPhase);
+std::string formatTimeline(const Timeline&);
+double percentile(std::vector<double> values, double p);
+
+} // namespace
+
+}}} // namespace
+
+#endif
@@ -13,9 +13,12 @@
 #include <string>
 #include <fstream>
 
+#include <sys/fsuid.h>
+
 #include "common/Utility.hpp"
 #include "common/Logger.hpp"
 #include "hooks/common/Utility.hpp"
+#include "hooks/timestamp/LaunchTrace.hpp"
 
 
 namespace sarus {
@@ -29,22 +32,32 @@ void TimestampHook::activate() {
         return;
     }
     parseEnvironmentVariables();
-    timestamp();
+    if(!logFilePath.empty()) {
+        timestamp();
+    }
+    if(!traceDirectory.empty()) {
+        trace();
+    }
 }
 
 void TimestampHook::parseConfigJSONOfBundle() {
     auto json = sarus::common::readJSON(bundleDir / "config.json");
 
     hooks::common::utility::applyLoggingConfigIfAvailable(json);
+    hooks::common::utility::applyMetricsConfigIfAvailable(json);
 
     // get uid + gid of user
     uidOfUser = json["process"]["user"]["uid"].GetInt();
     gidOfUser = json["process"]["user"]["gid"].GetInt();
 
     // get environment variables
-    auto env = hooks::common::utility::parseEnvironmentVariablesFromOCIBundle(bundleDir);
-    if(env.find("TIMESTAMP_HOOK_LOGFILE") != env.cend()) {
-        logFilePath = env["TIMESTAMP_HOOK_LOGFILE"];
+    containerEnvironment = hooks::common::utility::parseEnvironmentVariablesFromOCIBundle(bundleDir);
+    if(containerEnvironment.find("TIMESTAMP_HOOK_LOGFILE") != containerEnvironment.cend()) {
+        logFilePath = containerEnvironment["TIMESTAMP_HOOK_LOGFILE"];
+        isHookEnabled = true;
+    }
+    if(containerEnvironment.find("TIMESTAMP_HOOK_TRACE_DIR") != containerEnvironment.cend()) {
+        traceDirectory = containerEnvironment["TIMESTAMP_HOOK_TRACE_DIR"];
         isHookEnabled = true;
     }
 }
@@ -60,6 +73,30 @@ void TimestampHook::timestamp() {
     logger.log(fullMessage.str(), "hook", sarus::common::LogLevel::INFO, logFile);
 }
 
+void TimestampHook::trace() {
+    // read the clocks first, so that the record does not include the time spent on the filesystem
+    auto record = trace::makeRecord(message, containerEnvironment, pidOfContainer);
+
+    // the trace directory comes from the container's environment: create and open the
+    // files on behalf of the user, so that the user's permissions apply
+    setfsgid(gidOfUser);
+    setfsuid(uidOfUser);
+    auto restoreFilesystemUid = []() {
+        setfsuid(0);
+        setfsgid(0);
+    };
+
+    try {
+        sarus::common::createFoldersIfNecessary(traceDirectory);
+        trace::appendRecord(trace::getTraceFile(traceDirectory, record), record);
+    }
+    catch(...) {
+        restoreFilesystemUid();
+        throw;
+    }
+    restoreFilesystemUid();
+}
+
 void TimestampHook::parseEnvironmentVariables() {
     char* p;
     if((p = getenv("TIMESTAMP_HOOK_MESSAGE")) != nullptr) {
@@ -13,6 +13,7 @@
 
 #include <boost/filesystem.hpp>
 #include <string>
+#include <unordered_map>
 
 
 namespace sarus {
@@ -27,11 +28,14 @@ private:
     void parseConfigJSONOfBundle();
     void parseEnvironmentVariables();
     void timestamp();
+    void trace();
 
 private:
     bool isHookEnabled{ false };
     std::string message;
     boost::filesystem::path logFilePath;
+    boost::filesystem::path traceDirectory;
+    std::unordered_map<std::string, std::string> containerEnvironment;
     boost::filesystem::path bundleDir;
     pid_t pidOfContainer;
     uid_t uidOfUser;
@@ -11,13 +11,18 @@
 #include "TimestampHook.hpp"
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 
 int main(int argc, char* argv[]) {
     try {
+        auto timer = sarus::common::Metrics::ScopedTimer{"sarus_hook", {{"hook", "timestamp"}}};
         sarus::hooks::timestamp::TimestampHook{}.activate();
     } catch(const sarus::common::Error& e) {
         sarus::common::Logger::getInstance().logErrorTrace(e, "Timestamp hook");
+        sarus::common::Metrics::getInstance().incrementCounter("sarus_hook_failures", {{"hook", "timestamp"}});
+        sarus::common::Metrics::getInstance().flush();
         exit(EXIT_FAILURE);
     }
+    sarus::common::Metrics::getInstance().flush();
     return 0;
 }
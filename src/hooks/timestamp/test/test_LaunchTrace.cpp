@@ -0,0 +1,172 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <fstream>
+
+#include "common/Error.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "hooks/timestamp/LaunchTrace.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+namespace sarus {
+namespace hooks {
+namespace timestamp {
+namespace test {
+
+TEST_GROUP(LaunchTraceTestGroup) {
+};
+
+trace::Record makeRecord(const std::string& node, const std::string& rank, const std::string& phase,
+                         double realtime, double monotonic) {
+    return trace::Record{static_cast<std::int64_t>(realtime * 1e9),
+                         static_cast<std::int64_t>(monotonic * 1e9),
+                         node, rank, 1000, phase};
+}
+
+TEST(LaunchTraceTestGroup, formatAndParseRecord) {
+    auto record = makeRecord("nid001", "42", "After runtime", 1650000000.123456789, 1234.5);
+    auto line = trace::formatRecord(record);
+
+    auto parsed = trace::parseRecord(line);
+    CHECK(static_cast<bool>(parsed));
+    CHECK_EQUAL(parsed->realtime, record.realtime);
+    CHECK_EQUAL(parsed->monotonic, record.monotonic);
+    CHECK_EQUAL(parsed->node, std::string{"nid001"});
+    CHECK_EQUAL(parsed->rank, std::string{"42"});
+    CHECK_EQUAL(parsed->pid, 1000);
+    CHECK_EQUAL(parsed->phase, std::string{"After runtime"});
+
+    // unknown rank
+    record.rank = "";
+    parsed = trace::parseRecord(trace::formatRecord(record));
+    CHECK(static_cast<bool>(parsed));
+    CHECK(parsed->rank.empty());
+
+    // lines not in the trace format
+    CHECK(!trace::parseRecord("[1552438146.449463] [nid07641-16741] [hook] [INFO] Timestamp hook: After-runtime"));
+    CHECK(!trace::parseRecord("sarus-trace 2 1 2 nid001 0 1000 phase"));
+    CHECK(!trace::parseRecord("sarus-trace 1 1 2 nid001 0 1000"));
+    CHECK(!trace::parseRecord(""));
+}
+
+TEST(LaunchTraceTestGroup, rankFromEnvironment) {
+    CHECK_EQUAL(trace::getRankFromEnvironment({{"SLURM_PROCID", "3"}, {"PMI_RANK", "5"}}), std::string{"3"});
+    CHECK_EQUAL(trace::getRankFromEnvironment({{"OMPI_COMM_WORLD_RANK", "7"}}), std::string{"7"});
+    CHECK(trace::getRankFromEnvironment({{"PATH", "/bin"}}).empty());
+    CHECK_EQUAL(trace::getRankFromEnvironment({{"SLURM_PROCID", "../3"}, {"PMI_RANK", "5"}}), std::string{"5"});
+    CHECK(trace::getRankFromEnvironment({{"SLURM_PROCID", "3/../../x"}}).empty());
+
+    auto record = makeRecord("nid001", "", "phase", 0, 0);
+    CHECK_EQUAL(trace::getTraceFile("/traces", record), boost::filesystem::path{"/traces/nid001.pid1000.trace"});
+    record.rank = "3";
+    CHECK_EQUAL(trace::getTraceFile("/traces", record), boost::filesystem::path{"/traces/nid001.3.trace"});
+}
+
+TEST(LaunchTraceTestGroup, percentile) {
+    auto values = std::vector<double>{};
+    for(int i=100; i>=1; --i) {
+        values.push_back(i);
+    }
+    CHECK_EQUAL(trace::percentile(values, 50), 50.0);
+    CHECK_EQUAL(trace::percentile(values, 90), 90.0);
+    CHECK_EQUAL(trace::percentile(values, 99), 99.0);
+    CHECK_EQUAL(trace::percentile(values, 100), 100.0);
+    CHECK_EQUAL(trace::percentile({7.0}, 50), 7.0);
+    CHECK_THROWS(sarus::common::Error, trace::percentile({}, 50));
+}
+
+TEST(LaunchTraceTestGroup, appendRecordDoesNotFollowSymlinks) {
+    auto testDir = sarus::common::PathRAII{sarus::common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-launch-trace")};
+    sarus::common::createFoldersIfNecessary(testDir.getPath());
+    auto target = testDir.getPath() / "target";
+    auto link = testDir.getPath() / "nid001.0.trace";
+    sarus::common::createFileIfNecessary(target);
+    boost::filesystem::create_symlink(target, link);
+
+    CHECK_THROWS(sarus::common::Error, trace::appendRecord(link, makeRecord("nid001", "0", "phase", 0, 0)));
+    CHECK_EQUAL(boost::filesystem::file_size(target), 0);
+}
+
+TEST(LaunchTraceTestGroup, mergeTimelineOfJob) {
+    auto testDir = sarus::common::PathRAII{sarus::common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-launch-trace")};
+    sarus::common::createFoldersIfNecessary(testDir.getPath());
+
+    // 20 ranks on 10 nodes, with rank 13 starting 5 seconds late.
+    // The monotonic clocks of the nodes have unrelated origins.
+    const double start = 1650000000.0;
+    for(int rank=0; rank<20; ++rank) {
+        auto node = "nid" + std::to_string(rank / 2);
+        auto delay = rank == 13 ? 5.0 : rank * 0.01;
+        auto monotonicOrigin = 1000.0 * (rank / 2);
+        auto file = testDir.getPath() / (node + "." + std::to_string(rank) + ".trace");
+        trace::appendRecord(file, makeRecord(node, std::to_string(rank), "After-runtime",
+                                             start + delay, monotonicOrigin + delay));
+        trace::appendRecord(file, makeRecord(node, std::to_string(rank), "After-MPI-hook",
+                                             start + delay + 0.5, monotonicOrigin + delay + 0.5));
+        // rank 19 never reached the last phase
+        if(rank != 19) {
+            trace::appendRecord(file, makeRecord(node, std::to_string(rank), "After-SSH-hook",
+                                                 start + delay + 0.75, monotonicOrigin + delay + 0.75));
+        }
+    }
+    // lines which are not records are ignored
+    {
+        std::ofstream os{(testDir.getPath() / "nid0.0.trace").string(), std::ios::app};
+        os << "garbage\n";
+    }
+
+    auto records = trace::readRecords({testDir.getPath()});
+    CHECK_EQUAL(records.size(), 59);
+
+    auto timeline = trace::analyze(records, 3);
+    CHECK_EQUAL(timeline.numberOfRanks, 20);
+    CHECK_EQUAL(timeline.numberOfNodes, 10);
+    CHECK_EQUAL(timeline.start, static_cast<std::int64_t>(start * 1e9));
+
+    // phases are ordered by their median time
+    CHECK_EQUAL(timeline.phases.size(), 3);
+    CHECK_EQUAL(timeline.phases[0].phase, std::string{"After-runtime"});
+    CHECK_EQUAL(timeline.phases[1].phase, std::string{"After-MPI-hook"});
+    CHECK_EQUAL(timeline.phases[2].phase, std::string{"After-SSH-hook"});
+    CHECK_EQUAL(timeline.phases[0].numberOfRanks, 20);
+    CHECK_EQUAL(timeline.phases[2].numberOfRanks, 19);
+    DOUBLES_EQUAL(timeline.phases[0].min, 0.0, 1e-6);
+    DOUBLES_EQUAL(timeline.phases[0].max, 5.0, 1e-6);
+    DOUBLES_EQUAL(timeline.phases[0].p50, 0.09, 1e-6);
+
+    // intervals between phases are measured with the monotonic clock of each rank
+    CHECK_EQUAL(timeline.intervals.size(), 2);
+    CHECK_EQUAL(timeline.intervals[0].phase, std::string{"After-runtime -> After-MPI-hook"});
+    DOUBLES_EQUAL(timeline.intervals[0].min, 0.5, 1e-6);
+    DOUBLES_EQUAL(timeline.intervals[0].max, 0.5, 1e-6);
+    DOUBLES_EQUAL(timeline.intervals[1].p50, 0.25, 1e-6);
+
+    // rank 13 is the only straggler of every phase
+    CHECK_EQUAL(timeline.stragglers.size(), 3);
+    for(const auto& straggler : timeline.stragglers) {
+        CHECK_EQUAL(straggler.rank, std::string{"13"});
+        CHECK_EQUAL(straggler.node, std::string{"nid6"});
+    }
+
+    CHECK_EQUAL(timeline.incompleteRanks.size(), 1);
+    CHECK_EQUAL(timeline.incompleteRanks[0], std::string{"19@nid9"});
+
+    auto report = trace::formatTimeline(timeline);
+    CHECK(report.find("20 ranks on 10 nodes") != std::string::npos);
+    CHECK(report.find("rank 13 on nid6") != std::string::npos);
+
+    CHECK_THROWS(sarus::common::Error, trace::analyze({}, 3));
+}
+
+}}}} // namespace
+
+SARUS_UNITTEST_MAIN_FUNCTION();
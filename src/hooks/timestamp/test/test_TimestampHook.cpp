@@ -16,6 +16,7 @@
 #include "common/Utility.hpp"
 #include "hooks/common/Utility.hpp"
 #include "hooks/timestamp/TimestampHook.hpp"
+#include "hooks/timestamp/LaunchTrace.hpp"
 #include "test_utility/Misc.hpp"
 #include "test_utility/config.hpp"
 #include "test_utility/OCIHooks.hpp"
@@ -117,6 +118,43 @@ TEST(TimestampTestGroup, test_non_existing_file) {
     }
 }
 
+TEST(TimestampTestGroup, test_trace_directory) {
+    auto traceDirRAII = sarus::common::PathRAII{sarus::common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-timestamp-trace")};
+    auto traceDir = traceDirRAII.getPath();
+
+    auto doc = test_utility::ocihooks::createBaseConfigJSON(bundleDir / "rootfs", idsOfUser);
+    auto& allocator = doc.GetAllocator();
+    auto traceVariable = "TIMESTAMP_HOOK_TRACE_DIR=" + traceDir.string();
+    doc["process"]["env"].PushBack(rapidjson::Value{traceVariable.c_str(), allocator}, allocator);
+    doc["process"]["env"].PushBack(rapidjson::Value{"SLURM_PROCID=7", allocator}, allocator);
+    sarus::common::writeJSON(doc, bundleDir / "config.json");
+
+    // two hooks at different stages of the container's lifecycle
+    sarus::common::setEnvironmentVariable("TIMESTAMP_HOOK_MESSAGE", "After-runtime");
+    test_utility::ocihooks::writeContainerStateToStdin(bundleDir);
+    TimestampHook{}.activate();
+    sarus::common::setEnvironmentVariable("TIMESTAMP_HOOK_MESSAGE", "After-MPI-hook");
+    test_utility::ocihooks::writeContainerStateToStdin(bundleDir);
+    TimestampHook{}.activate();
+
+    // the logfile is not written without TIMESTAMP_HOOK_LOGFILE
+    CHECK(!boost::filesystem::exists(logFile));
+
+    auto traceFile = traceDir / (sarus::common::getHostname() + ".7.trace");
+    CHECK(boost::filesystem::exists(traceFile));
+    CHECK(sarus::common::getOwner(traceDir) == idsOfUser);
+    CHECK(sarus::common::getOwner(traceFile) == idsOfUser);
+
+    auto records = trace::readRecords({traceFile});
+    CHECK_EQUAL(records.size(), 2);
+    CHECK_EQUAL(records[0].rank, std::string{"7"});
+    CHECK_EQUAL(records[0].node, sarus::common::getHostname());
+    CHECK_EQUAL(records[0].phase, std::string{"After-runtime"});
+    CHECK_EQUAL(records[1].phase, std::string{"After-MPI-hook"});
+    CHECK(records[0].monotonic <= records[1].monotonic);
+    CHECK(records[0].realtime <= records[1].realtime);
+}
+
 }}}} // namespace
 
 SARUS_UNITTEST_MAIN_FUNCTION();
@@ -0,0 +1,67 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include "common/Error.hpp"
+#include "common/Logger.hpp"
+#include "hooks/timestamp/LaunchTrace.hpp"
+
+namespace po = boost::program_options;
+namespace trace = sarus::hooks::timestamp::trace;
+
+int main(int argc, char* argv[]) {
+    auto options = po::options_description{"Options"};
+    auto paths = std::vector<std::string>{};
+    std::size_t maxStragglers;
+    options.add_options()
+        ("help,h", "Print this help message")
+        ("stragglers", po::value<std::size_t>(&maxStragglers)->default_value(10),
+            "Maximum number of stragglers reported for each phase");
+    auto hiddenOptions = po::options_description{};
+    hiddenOptions.add_options()
+        ("path", po::value<std::vector<std::string>>(&paths));
+    auto allOptions = po::options_description{};
+    allOptions.add(options).add(hiddenOptions);
+    auto positionalOptions = po::positional_options_description{};
+    positionalOptions.add("path", -1);
+
+    try {
+        auto values = po::variables_map{};
+        po::store(po::command_line_parser(argc, argv)
+                    .options(allOptions)
+                    .positional(positionalOptions)
+                    .run(), values);
+        po::notify(values);
+
+        if(values.count("help") || paths.empty()) {
+            std::cout << "Usage: timestamp_trace_analyzer [OPTIONS] TRACE_FILE_OR_DIRECTORY...\n\n"
+                      << "Merges the launch traces written by the Timestamp hook for all the ranks of a job\n"
+                      << "into a job-wide timeline with per-phase percentiles and stragglers.\n\n"
+                      << options;
+            return paths.empty() && !values.count("help") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+
+        auto tracePaths = std::vector<boost::filesystem::path>(paths.cbegin(), paths.cend());
+        auto timeline = trace::analyze(trace::readRecords(tracePaths), maxStragglers);
+        std::cout << trace::formatTimeline(timeline);
+    }
+    catch(const sarus::common::Error& e) {
+        sarus::common::Logger::getInstance().logErrorTrace(e, "Timestamp trace analyzer");
+        return EXIT_FAILURE;
+    }
+    catch(const std::exception& e) {
+        std::cerr << "Timestamp trace analyzer: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
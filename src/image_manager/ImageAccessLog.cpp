@@ -0,0 +1,160 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "image_manager/ImageAccessLog.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+
+#include "common/Error.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace image_manager {
+namespace access_log {
+
+static const std::string recordTag = "sarus-access";
+static const std::string recordVersion = "1";
+
+const std::size_t maxTrackedNodes = 1024;
+
+boost::filesystem::path getLogFile(const boost::filesystem::path& repositoryMetadataFile) {
+    return repositoryMetadataFile.parent_path() / "access.log";
+}
+
+// the log is renamed aside while it is compacted, so that new launches start a new log. The name
+// of the detached log is unique, so that a compaction can tell whether it already merged its records.
+static const std::string detachedLogPrefix = "access.log.compacting.";
+
+static boost::optional<boost::filesystem::path> findDetachedLogFile(const boost::filesystem::path& logFile) {
+    for(const auto& entry : boost::filesystem::directory_iterator{logFile.parent_path()}) {
+        if(entry.path().filename().string().compare(0, detachedLogPrefix.size(), detachedLogPrefix) == 0) {
+            return entry.path();
+        }
+    }
+    return {};
+}
+
+Record makeRecord(const std::string& uniqueKey) {
+    auto record = Record{};
+    record.time = time(nullptr);
+    record.node = common::getHostname();
+    record.uniqueKey = uniqueKey;
+    return record;
+}
+
+void appendRecord(const boost::filesystem::path& logFile, const Record& record) {
+    auto line = formatRecord(record) + "\n";
+
+    auto fd = open(logFile.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        auto message = boost::format("Failed to open image access log %s: %s") % logFile % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    // a single write of a short line, so that records of concurrent launches never interleave
+    auto written = write(fd, line.c_str(), line.size());
+    auto writeErrno = errno;
+    close(fd);
+    if(written != static_cast<ssize_t>(line.size())) {
+        auto message = boost::format("Failed to write record to image access log %s: %s") % logFile % strerror(writeErrno);
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+std::string formatRecord(const Record& record) {
+    return (boost::format("%s %s %d %s %s")
+        % recordTag % recordVersion
+        % record.time % record.node % record.uniqueKey).str();
+}
+
+boost::optional<Record> parseRecord(const std::string& line) {
+    auto is = std::istringstream{line};
+    auto tag = std::string{};
+    auto version = std::string{};
+    auto record = Record{};
+    if(!(is >> tag >> version) || tag != recordTag || version != recordVersion) {
+        return {};
+    }
+    if(!(is >> record.time >> record.node >> record.uniqueKey)) {
+        return {};
+    }
+    // a record torn by a concurrent append would leave trailing characters
+    auto rest = std::string{};
+    if(is >> rest) {
+        return {};
+    }
+    return record;
+}
+
+std::vector<Record> readRecords(const boost::filesystem::path& logFile) {
+    std::ifstream is{logFile.string()};
+    if(!is) {
+        auto message = boost::format("Failed to open image access log %s") % logFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto records = std::vector<Record>{};
+    auto line = std::string{};
+    while(std::getline(is, line)) {
+        if(auto record = parseRecord(line)) {
+            records.push_back(std::move(*record));
+        }
+    }
+    return records;
+}
+
+/**
+ * Moves the log aside and returns its records. The caller merges them and then removes them with
+ * removeDetachedRecords(). The records detached by a compaction which was interrupted before their
+ * removal are returned again (instead of the current log, which is left to the next compaction):
+ * the caller tells by the name of the detached log whether it already merged them.
+ */
+DetachedRecords detachRecords(const boost::filesystem::path& logFile) {
+    auto detached = DetachedRecords{};
+    if(boost::filesystem::is_directory(logFile.parent_path())) {
+        if(auto leftOver = findDetachedLogFile(logFile)) {
+            detached.file = *leftOver;
+        }
+    }
+    if(detached.file.empty()) {
+        if(!boost::filesystem::exists(logFile)) {
+            return detached;
+        }
+        detached.file = logFile.parent_path() / (detachedLogPrefix + common::generateRandomString(16));
+        boost::filesystem::rename(logFile, detached.file);
+    }
+    detached.records = readRecords(detached.file);
+    return detached;
+}
+
+void removeDetachedRecords(const DetachedRecords& detached) {
+    if(!detached.file.empty()) {
+        boost::filesystem::remove(detached.file);
+    }
+}
+
+void mergeRecord(Usage& usage, const Record& record) {
+    usage.lastUsed = std::max(usage.lastUsed, record.time);
+    ++usage.launchCount;
+    auto it = std::lower_bound(usage.nodes.begin(), usage.nodes.end(), record.node);
+    if((it == usage.nodes.end() || *it != record.node) && usage.nodes.size() < maxTrackedNodes) {
+        usage.nodes.insert(it, record.node);
+    }
+}
+
+}}} // namespace
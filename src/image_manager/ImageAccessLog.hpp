@@ -0,0 +1,79 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_image_manager_ImageAccessLog_hpp
+#define sarus_image_manager_ImageAccessLog_hpp
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace image_manager {
+
+/**
+ * The launches of the images of a repository: every "sarus run" appends one record to the
+ * access log of the repository, without taking the lock of the repository metadata, and the
+ * records are periodically compacted by ImageStore into per-image usage statistics stored
+ * in the repository metadata.
+ *
+ * A record is a single line with the format
+ *
+ *   sarus-access 1 <seconds since the epoch> <node> <unique key of the image>
+ *
+ * The records are appended with a single write to a file opened with O_APPEND, thus records
+ * of concurrent launches on the same node never interleave. Lines which can't be parsed (e.g.
+ * a record torn by a filesystem without atomic appends) are skipped by the compaction.
+ */
+namespace access_log {
+
+struct Record {
+    time_t time;
+    std::string node;
+    std::string uniqueKey;
+};
+
+// the records moved aside by detachRecords(), in a file with a unique name
+struct DetachedRecords {
+    boost::filesystem::path file; // empty if there was no log
+    std::vector<Record> records;
+};
+
+// the per-image statistics the records are compacted into
+struct Usage {
+    time_t lastUsed = 0;
+    std::uint64_t launchCount = 0;
+    std::vector<std::string> nodes; // sorted, at most maxTrackedNodes
+};
+
+extern const std::size_t maxTrackedNodes;
+
+boost::filesystem::path getLogFile(const boost::filesystem::path& repositoryMetadataFile);
+Record makeRecord(const std::string& uniqueKey);
+void appendRecord(const boost::filesystem::path& logFile, const Record&);
+
+std::string formatRecord(const Record&);
+boost::optional<Record> parseRecord(const std::string& line);
+std::vector<Record> readRecords(const boost::filesystem::path& logFile);
+DetachedRecords detachRecords(const boost::filesystem::path& logFile);
+void removeDetachedRecords(const DetachedRecords&);
+
+void mergeRecord(Usage&, const Record&);
+
+} // namespace
+
+}} // namespace
+
+#endif
@@ -0,0 +1,775 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "image_manager/ImageBroadcast.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include <endian.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <boost/algorithm/string.hpp>
+#include <rapidjson/document.h>
+
+#include "common/Error.hpp"
+#include "common/Logger.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Sha256.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace image_manager {
+
+namespace {
+
+const char magic[8] = {'S', 'A', 'R', 'U', 'S', 'B', 'C', '1'};
+const std::size_t digestLength = 64;
+const std::size_t nonceSize = 32;
+const std::size_t keySize = 32;
+const std::uint8_t statusSuccess = 0;
+const std::uint8_t statusFailure = 1;
+
+class FileDescriptorRAII {
+public:
+    explicit FileDescriptorRAII(int fd) : fd{fd} {}
+    FileDescriptorRAII(const FileDescriptorRAII&) = delete;
+    FileDescriptorRAII& operator=(const FileDescriptorRAII&) = delete;
+    ~FileDescriptorRAII() {
+        if(fd >= 0) {
+            close(fd);
+        }
+    }
+    int get() const { return fd; }
+
+private:
+    int fd;
+};
+
+void waitForData(int fd, std::chrono::seconds timeout) {
+    auto pfd = pollfd{fd, POLLIN, 0};
+    int ret;
+    do {
+        ret = poll(&pfd, 1, std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+    } while(ret < 0 && errno == EINTR);
+
+    if(ret < 0) {
+        auto message = boost::format("Failed to poll socket: %s") % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    if(ret == 0) {
+        auto message = boost::format("Timed out after %d seconds waiting for data from peer") % timeout.count();
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+void readExactly(int fd, void* buffer, std::size_t size, std::chrono::seconds timeout) {
+    auto* p = static_cast<char*>(buffer);
+    while(size > 0) {
+        waitForData(fd, timeout);
+        auto n = read(fd, p, size);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n < 0) {
+            auto message = boost::format("Failed to read from peer: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        if(n == 0) {
+            SARUS_THROW_ERROR("Connection closed by peer before the end of the transfer");
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+void writeExactly(int fd, const void* buffer, std::size_t size) {
+    auto* p = static_cast<const char*>(buffer);
+    while(size > 0) {
+        // MSG_NOSIGNAL prevents a peer that went away from killing us with SIGPIPE
+        auto n = ::send(fd, p, size, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n < 0) {
+            auto message = boost::format("Failed to write to peer: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+void writeToFile(int fd, const char* buffer, std::size_t size) {
+    while(size > 0) {
+        auto n = write(fd, buffer, size);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n < 0) {
+            auto message = boost::format("Failed to write file: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        buffer += n;
+        size -= n;
+    }
+}
+
+void writeUint64(int fd, std::uint64_t value) {
+    auto encoded = htobe64(value);
+    writeExactly(fd, &encoded, sizeof(encoded));
+}
+
+std::uint64_t readUint64(int fd, std::chrono::seconds timeout) {
+    std::uint64_t encoded;
+    readExactly(fd, &encoded, sizeof(encoded), timeout);
+    return be64toh(encoded);
+}
+
+void writeString(int fd, const std::string& value) {
+    writeUint64(fd, value.size());
+    writeExactly(fd, value.data(), value.size());
+}
+
+std::string readString(int fd, std::chrono::seconds timeout) {
+    const std::uint64_t maxLength = 4096;
+    auto length = readUint64(fd, timeout);
+    if(length > maxLength) {
+        auto message = boost::format("Received string of %d bytes exceeds maximum length of %d bytes")
+            % length % maxLength;
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto value = std::string(length, '\0');
+    readExactly(fd, &value[0], length, timeout);
+    return value;
+}
+
+std::string readRandomHex(std::size_t size) {
+    FileDescriptorRAII random{open("/dev/urandom", O_RDONLY | O_CLOEXEC)};
+    if(random.get() < 0) {
+        auto message = boost::format("Failed to open /dev/urandom: %s") % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto bytes = std::vector<unsigned char>(size);
+    for(std::size_t offset=0; offset<size; ) {
+        auto n = read(random.get(), bytes.data() + offset, size - offset);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            auto message = boost::format("Failed to read /dev/urandom: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        offset += n;
+    }
+
+    static const char* hexDigits = "0123456789abcdef";
+    auto hex = std::string{};
+    for(auto byte : bytes) {
+        hex.push_back(hexDigits[byte >> 4]);
+        hex.push_back(hexDigits[byte & 0xf]);
+    }
+    return hex;
+}
+
+// doesn't leak through its timing how many characters of an authentication code are right
+bool isEqualInConstantTime(const std::string& lhs, const std::string& rhs) {
+    if(lhs.size() != rhs.size()) {
+        return false;
+    }
+    unsigned char difference = 0;
+    for(std::size_t i=0; i<lhs.size(); ++i) {
+        difference |= lhs[i] ^ rhs[i];
+    }
+    return difference == 0;
+}
+
+int listenOn(std::uint16_t port) {
+    auto fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        auto message = boost::format("Failed to create socket: %s") % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    auto address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+       || listen(fd, 1) != 0) {
+        auto message = boost::format("Failed to listen on port %d: %s") % port % strerror(errno);
+        close(fd);
+        SARUS_THROW_ERROR(message.str());
+    }
+    return fd;
+}
+
+int connectTo(const ImageBroadcast::Peer& peer, std::chrono::seconds timeout) {
+    auto hints = addrinfo{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    auto service = std::to_string(peer.port);
+
+    // the peer might not be listening yet, e.g. because it was launched later than us
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(true) {
+        addrinfo* addresses = nullptr;
+        if(getaddrinfo(peer.host.c_str(), service.c_str(), &hints, &addresses) == 0) {
+            for(auto* a = addresses; a != nullptr; a = a->ai_next) {
+                auto fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+                if(fd < 0) {
+                    continue;
+                }
+                if(connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+                    freeaddrinfo(addresses);
+                    return fd;
+                }
+                close(fd);
+            }
+            freeaddrinfo(addresses);
+        }
+
+        if(std::chrono::steady_clock::now() > deadline) {
+            auto message = boost::format("Timed out after %d seconds connecting to peer %s:%d")
+                % timeout.count() % peer.host % peer.port;
+            SARUS_THROW_ERROR(message.str());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    }
+}
+
+void validateStagedName(const boost::filesystem::path& name) {
+    if(name.empty() || name.is_absolute()) {
+        auto message = boost::format("Invalid name of staged file %s: must be a non-empty relative path") % name;
+        SARUS_THROW_ERROR(message.str());
+    }
+    for(const auto& element : name) {
+        if(element == "..") {
+            auto message = boost::format("Invalid name of staged file %s: must not contain '..'") % name;
+            SARUS_THROW_ERROR(message.str());
+        }
+    }
+}
+
+boost::filesystem::path getSidecarFile(const boost::filesystem::path& stagedFile) {
+    return stagedFile.string() + ".json";
+}
+
+} // namespace
+
+ImageBroadcast::ChildrenRAII::~ChildrenRAII() {
+    for(const auto& child : children) {
+        if(child.fd >= 0) {
+            close(child.fd);
+        }
+    }
+}
+
+ImageBroadcast::ImageBroadcast(std::vector<Peer> peers, std::size_t rank, std::string secret, std::size_t fanout)
+    : peers{std::move(peers)}
+    , rank{rank}
+    , secret{std::move(secret)}
+    , fanout{fanout}
+{
+    if(this->peers.empty() || rank >= this->peers.size()) {
+        auto message = boost::format("Invalid broadcast rank %d for %d peers") % rank % this->peers.size();
+        SARUS_THROW_ERROR(message.str());
+    }
+    if(fanout == 0) {
+        SARUS_THROW_ERROR("Invalid broadcast fanout: must be greater than zero");
+    }
+    if(this->secret.empty()) {
+        SARUS_THROW_ERROR("Invalid broadcast secret: must not be empty");
+    }
+}
+
+ImageBroadcast::StagedFile ImageBroadcast::send(const boost::filesystem::path& sourceFile,
+                                                const boost::filesystem::path& stagedName,
+                                                const std::string& imageID,
+                                                const boost::filesystem::path& stagingDir) const {
+    if(rank != 0) {
+        SARUS_THROW_ERROR("Only the peer with rank 0 can be the source of a broadcast");
+    }
+    validateStagedName(stagedName);
+
+    printLog(boost::format("Broadcasting %s to %d peers with fanout %d") % sourceFile % peers.size() % fanout,
+             common::LogLevel::INFO);
+    auto start = std::chrono::steady_clock::now();
+
+    FileDescriptorRAII source{open(sourceFile.c_str(), O_RDONLY | O_CLOEXEC)};
+    if(source.get() < 0) {
+        auto message = boost::format("Failed to open %s: %s") % sourceFile % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto header = Header{stagedName.string(), imageID, boost::filesystem::file_size(sourceFile)};
+    ChildrenRAII children{connectToChildren(header)};
+
+    auto readChunk = [&source, &sourceFile](char* buffer, std::size_t size) {
+        while(size > 0) {
+            auto n = read(source.get(), buffer, size);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                auto message = boost::format("Failed to read %s: %s") % sourceFile
+                    % (n == 0 ? "unexpected end of file" : strerror(errno));
+                SARUS_THROW_ERROR(message.str());
+            }
+            buffer += n;
+            size -= n;
+        }
+    };
+
+    // the root vouches for the data it reads: its own digest is the reference for everybody else
+    auto digest = std::string{};
+    auto staged = relay(header, "", readChunk, children.get(), stagingDir, digest);
+
+    if(!collectStatusOfChildren(children.get())) {
+        SARUS_THROW_ERROR("Failed to broadcast image: some peers did not receive a verified copy");
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    printLog(boost::format("Successfully broadcast %d bytes to %d peers in %.3f seconds")
+             % header.size % peers.size() % elapsed.count(), common::LogLevel::INFO);
+    return staged;
+}
+
+ImageBroadcast::StagedFile ImageBroadcast::receive(const boost::filesystem::path& stagedName,
+                                                   const std::string& imageID,
+                                                   const boost::filesystem::path& stagingDir) const {
+    if(rank == 0) {
+        SARUS_THROW_ERROR("The peer with rank 0 is the source of a broadcast and cannot receive");
+    }
+    validateStagedName(stagedName);
+
+    FileDescriptorRAII listener{listenOn(peers[rank].port)};
+    printLog(boost::format("Waiting for broadcast from parent peer on port %d") % peers[rank].port,
+             common::LogLevel::INFO);
+
+    // anybody can connect to the port: wait for the parent among the connections
+    auto parent = std::unique_ptr<FileDescriptorRAII>{};
+    auto nonce = std::string{};
+    auto header = Header{};
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(!parent) {
+        auto remaining = std::chrono::duration_cast<std::chrono::seconds>(deadline - std::chrono::steady_clock::now());
+        waitForData(listener.get(), std::max(remaining, std::chrono::seconds{0}));
+        auto connection = std::unique_ptr<FileDescriptorRAII>{
+            new FileDescriptorRAII{accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC)}};
+        if(connection->get() < 0) {
+            auto message = boost::format("Failed to accept connection from parent peer: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+
+        nonce = readRandomHex(nonceSize);
+        try {
+            writeString(connection->get(), nonce);
+            header = readHeader(connection->get(), nonce);
+        }
+        catch(const common::Error& e) {
+            printLog(boost::format("Rejected broadcast connection: %s") % e.what(), common::LogLevel::WARN);
+            continue;
+        }
+        parent = std::move(connection);
+    }
+
+    auto readChunk = [this, &parent](char* buffer, std::size_t size) {
+        readExactly(parent->get(), buffer, size, timeout);
+    };
+
+    auto status = statusFailure;
+    auto staged = StagedFile{};
+    try {
+        // nothing is written unless the parent sends the image this peer was asked for
+        if(header.name != stagedName.string() || header.imageID != imageID) {
+            auto message = boost::format("Received image %s with ID %s does not match requested image %s with ID %s."
+                                         " Were all the nodes given the same image reference?")
+                % header.name % header.imageID % stagedName % imageID;
+            SARUS_THROW_ERROR(message.str());
+        }
+
+        ChildrenRAII children{connectToChildren(header)};
+        auto digest = std::string{};
+        staged = relay(header, nonce, readChunk, children.get(), stagingDir, digest);
+        status = collectStatusOfChildren(children.get()) ? statusSuccess : statusFailure;
+    }
+    catch(const common::Error& e) {
+        // let the parent know about our failure before giving up, so that the root
+        // doesn't have to wait for the timeout to find out
+        try {
+            writeExactly(parent->get(), &status, sizeof(status));
+        }
+        catch(const common::Error&) {}
+        throw;
+    }
+    writeExactly(parent->get(), &status, sizeof(status));
+
+    printLog(boost::format("Successfully received and verified %s") % staged.path, common::LogLevel::INFO);
+    return staged;
+}
+
+std::vector<std::size_t> ImageBroadcast::getChildren(std::size_t rank) const {
+    auto children = std::vector<std::size_t>{};
+    for(std::size_t i=1; i<=fanout; ++i) {
+        auto child = rank * fanout + i;
+        if(child >= peers.size()) {
+            break;
+        }
+        children.push_back(child);
+    }
+    return children;
+}
+
+std::vector<ImageBroadcast::Peer> ImageBroadcast::parsePeers(const std::string& peerList, std::uint16_t defaultPort) {
+    auto peers = std::vector<Peer>{};
+
+    auto entries = std::vector<std::string>{};
+    boost::split(entries, peerList, boost::is_any_of(",\n "), boost::token_compress_on);
+    for(const auto& entry : entries) {
+        if(entry.empty()) {
+            continue;
+        }
+        auto separator = entry.rfind(':');
+        if(separator == std::string::npos) {
+            peers.push_back(Peer{entry, defaultPort});
+            continue;
+        }
+        try {
+            auto port = std::stoul(entry.substr(separator + 1));
+            if(port == 0 || port > 65535) {
+                throw std::out_of_range{"port"};
+            }
+            peers.push_back(Peer{entry.substr(0, separator), static_cast<std::uint16_t>(port)});
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Invalid port in broadcast peer '%s'") % entry;
+            SARUS_THROW_ERROR(message.str());
+        }
+    }
+
+    return peers;
+}
+
+/**
+ * Returns the key stored in the file, after creating the file with a random key if it doesn't exist.
+ * The file is meant to be shared by the nodes (e.g. in the user's home directory): the new key is
+ * written to a temporary file which is then linked to the file, so that all the nodes which create
+ * the file at the same time end up with the key of the first one.
+ */
+std::string ImageBroadcast::readOrCreateKeyFile(const boost::filesystem::path& file, uid_t owner) {
+    if(!boost::filesystem::exists(boost::filesystem::symlink_status(file))) {
+        auto tempFile = common::PathRAII{common::makeUniquePathWithRandomSuffix(file)};
+        {
+            FileDescriptorRAII output{open(tempFile.getPath().c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600)};
+            if(output.get() < 0) {
+                auto message = boost::format("Failed to create key file %s: %s") % tempFile.getPath() % strerror(errno);
+                SARUS_THROW_ERROR(message.str());
+            }
+            auto key = readRandomHex(keySize);
+            writeToFile(output.get(), key.data(), key.size());
+        }
+        if(link(tempFile.getPath().c_str(), file.c_str()) != 0 && errno != EEXIST) {
+            auto message = boost::format("Failed to create key file %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+    }
+
+    FileDescriptorRAII input{open(file.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW)};
+    struct stat sb;
+    if(input.get() < 0 || fstat(input.get(), &sb) != 0) {
+        auto message = boost::format("Failed to open key file %s: %s") % file % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    if(!S_ISREG(sb.st_mode) || sb.st_uid != owner || (sb.st_mode & (S_IRWXG | S_IRWXO))) {
+        auto message = boost::format("Key file %s must be a regular file owned by uid %d and"
+                                     " not accessible by other users") % file % owner;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto key = std::string(4096, '\0');
+    std::size_t size = 0;
+    while(size < key.size()) {
+        auto n = read(input.get(), &key[size], key.size() - size);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n < 0) {
+            auto message = boost::format("Failed to read key file %s: %s") % file % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        if(n == 0) {
+            break;
+        }
+        size += n;
+    }
+    key.resize(size);
+    boost::algorithm::trim(key);
+    if(key.empty()) {
+        auto message = boost::format("Key file %s is empty") % file;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return key;
+}
+
+boost::optional<ImageBroadcast::StagedFile> ImageBroadcast::findStagedFile(const boost::filesystem::path& stagingDir,
+                                                                           const boost::filesystem::path& stagedName,
+                                                                           const std::string& imageID,
+                                                                           uid_t owner) {
+    auto path = stagingDir / stagedName;
+    auto sidecar = getSidecarFile(path);
+
+    // staged files are only trusted as much as the user's own repository: they must belong
+    // to the user and must not be modifiable by anybody else
+    for(const auto& p : {stagingDir, path, sidecar}) {
+        struct stat sb;
+        if(lstat(p.c_str(), &sb) != 0
+           || sb.st_uid != owner
+           || (sb.st_mode & (S_IWGRP | S_IWOTH))
+           || (p != stagingDir && !S_ISREG(sb.st_mode))) {
+            return {};
+        }
+    }
+
+    try {
+        auto json = common::readJSON(sidecar);
+        auto staged = StagedFile{ path,
+                                  json["imageID"].GetString(),
+                                  json["digest"].GetString(),
+                                  json["size"].GetUint64() };
+        if(staged.imageID != imageID || boost::filesystem::file_size(path) != staged.size) {
+            return {};
+        }
+        return staged;
+    }
+    catch(const std::exception&) {
+        return {};
+    }
+}
+
+std::vector<ImageBroadcast::Child> ImageBroadcast::connectToChildren(const Header& header) const {
+    // Connect to the children concurrently, so that an unreachable child doesn't delay its siblings.
+    // Connection attempts are given half of the timeout: this way the siblings of an unreachable
+    // child are still waiting for data when we give up on it and start streaming.
+    auto connectionTimeout = std::max(timeout / 2, std::chrono::seconds{1});
+    auto childRanks = getChildren(rank);
+    auto children = std::vector<Child>(childRanks.size(), Child{-1, {}});
+    auto errors = std::vector<std::string>(childRanks.size());
+
+    auto threads = std::vector<std::thread>{};
+    for(std::size_t i=0; i<childRanks.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            int fd = -1;
+            try {
+                fd = connectTo(peers[childRanks[i]], connectionTimeout);
+                auto nonce = readString(fd, connectionTimeout);
+                writeHeader(fd, header, nonce);
+                children[i] = Child{fd, nonce};
+            }
+            catch(const common::Error& e) {
+                errors[i] = e.what();
+                if(fd >= 0) {
+                    close(fd);
+                }
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+
+    for(std::size_t i=0; i<childRanks.size(); ++i) {
+        if(children[i].fd < 0) {
+            // the subtree of this child is lost, but the other subtrees can still be served
+            auto child = childRanks[i];
+            printLog(boost::format("Failed to forward broadcast to peer %s:%d (rank %d): %s")
+                     % peers[child].host % peers[child].port % child % errors[i], common::LogLevel::WARN);
+        }
+    }
+    return children;
+}
+
+ImageBroadcast::StagedFile ImageBroadcast::relay(const Header& header,
+                                                 const std::string& nonce,
+                                                 const ChunkReader& readChunk,
+                                                 std::vector<Child>& children,
+                                                 const boost::filesystem::path& stagingDir,
+                                                 std::string& digest) const {
+    auto finalPath = stagingDir / header.name;
+    common::createFoldersIfNecessary(finalPath.parent_path());
+    auto tempPath = common::PathRAII{common::makeUniquePathWithRandomSuffix(finalPath)};
+    FileDescriptorRAII output{open(tempPath.getPath().c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600)};
+    if(output.get() < 0) {
+        auto message = boost::format("Failed to create staged file %s: %s") % tempPath.getPath() % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto forward = [this](Child& child, const char* data, std::size_t size) {
+        if(child.fd < 0) {
+            return;
+        }
+        try {
+            writeExactly(child.fd, data, size);
+        }
+        catch(const common::Error& e) {
+            printLog(boost::format("Dropping broadcast peer: %s") % e.what(), common::LogLevel::WARN);
+            close(child.fd);
+            child.fd = -1;
+        }
+    };
+
+    auto sha = common::Sha256{};
+    auto buffer = std::vector<char>(std::min<std::uint64_t>(chunkSize, std::max<std::uint64_t>(header.size, 1)));
+    auto remaining = header.size;
+    while(remaining > 0) {
+        auto size = static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), remaining));
+        readChunk(buffer.data(), size);
+        for(auto& child : children) {
+            forward(child, buffer.data(), size);
+        }
+        writeToFile(output.get(), buffer.data(), size);
+        sha.update(buffer.data(), size);
+        remaining -= size;
+    }
+    auto computedDigest = sha.hexDigest();
+
+    // the digest of the root travels down the tree after the data, authenticated for each peer
+    if(rank == 0) {
+        digest = computedDigest;
+    }
+    else {
+        digest = std::string(digestLength, '\0');
+        readChunk(&digest[0], digestLength);
+        auto authenticationCode = std::string(digestLength, '\0');
+        readChunk(&authenticationCode[0], digestLength);
+        if(!isEqualInConstantTime(authenticationCode, authenticate(nonce, {"digest", digest}))) {
+            SARUS_THROW_ERROR("Failed to authenticate the digest of the broadcast file");
+        }
+    }
+    for(auto& child : children) {
+        auto trailer = digest + authenticate(child.nonce, {"digest", digest});
+        forward(child, trailer.data(), trailer.size());
+    }
+
+    if(computedDigest != digest) {
+        auto message = boost::format("Digest verification of broadcast file %s failed: expected sha256:%s, got sha256:%s")
+            % finalPath % digest % computedDigest;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    if(fsync(output.get()) != 0) {
+        auto message = boost::format("Failed to flush staged file %s: %s") % tempPath.getPath() % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto staged = StagedFile{finalPath, header.imageID, "sha256:" + digest, header.size};
+    writeSidecar(staged);
+    boost::filesystem::rename(tempPath.getPath(), finalPath);
+    tempPath.release();
+
+    return staged;
+}
+
+bool ImageBroadcast::collectStatusOfChildren(std::vector<Child>& children) const {
+    auto success = true;
+    for(auto& child : children) {
+        if(child.fd < 0) {
+            success = false;
+            continue;
+        }
+        try {
+            auto status = statusFailure;
+            readExactly(child.fd, &status, sizeof(status), timeout);
+            success = success && (status == statusSuccess);
+        }
+        catch(const common::Error& e) {
+            printLog(boost::format("Failed to collect broadcast status from peer: %s") % e.what(),
+                     common::LogLevel::WARN);
+            success = false;
+        }
+        close(child.fd);
+        child.fd = -1;
+    }
+    return success;
+}
+
+void ImageBroadcast::writeHeader(int fd, const Header& header, const std::string& nonce) const {
+    writeExactly(fd, magic, sizeof(magic));
+    writeString(fd, header.name);
+    writeString(fd, header.imageID);
+    writeUint64(fd, header.size);
+    writeString(fd, authenticate(nonce, {"header", header.name, header.imageID, std::to_string(header.size)}));
+}
+
+ImageBroadcast::Header ImageBroadcast::readHeader(int fd, const std::string& nonce) const {
+    char receivedMagic[sizeof(magic)];
+    readExactly(fd, receivedMagic, sizeof(receivedMagic), timeout);
+    if(std::memcmp(receivedMagic, magic, sizeof(magic)) != 0) {
+        SARUS_THROW_ERROR("Received invalid broadcast header: is the peer a Sarus broadcast of the same version?");
+    }
+
+    auto header = Header{};
+    header.name = readString(fd, timeout);
+    header.imageID = readString(fd, timeout);
+    header.size = readUint64(fd, timeout);
+    auto authenticationCode = readString(fd, timeout);
+    if(!isEqualInConstantTime(authenticationCode,
+                              authenticate(nonce, {"header", header.name, header.imageID, std::to_string(header.size)}))) {
+        SARUS_THROW_ERROR("Failed to authenticate broadcast header: was the peer given the same secret?");
+    }
+    return header;
+}
+
+// HMAC of the fields of a message, bound to the nonce of the receiving peer to prevent replays
+std::string ImageBroadcast::authenticate(const std::string& nonce, const std::vector<std::string>& fields) const {
+    auto message = nonce;
+    for(const auto& field : fields) {
+        message += std::to_string(field.size()) + ":" + field;
+    }
+    return common::Sha256::hmacHexDigest(secret, message);
+}
+
+void ImageBroadcast::writeSidecar(const StagedFile& staged) const {
+    auto json = rapidjson::Document{rapidjson::kObjectType};
+    auto& allocator = json.GetAllocator();
+    json.AddMember("imageID", rapidjson::Value{staged.imageID.c_str(), allocator}, allocator);
+    json.AddMember("digest", rapidjson::Value{staged.digest.c_str(), allocator}, allocator);
+    json.AddMember("size", rapidjson::Value{staged.size}, allocator);
+
+    auto sidecar = getSidecarFile(staged.path);
+    auto tempSidecar = common::makeUniquePathWithRandomSuffix(sidecar);
+    common::writeJSON(json, tempSidecar);
+    boost::filesystem::permissions(tempSidecar, boost::filesystem::owner_read | boost::filesystem::owner_write);
+    boost::filesystem::rename(tempSidecar, sidecar);
+}
+
+void ImageBroadcast::printLog(const boost::format& message, common::LogLevel level) const {
+    printLog(message.str(), level);
+}
+
+void ImageBroadcast::printLog(const std::string& message, common::LogLevel level) const {
+    common::Logger::getInstance().log(message, sysname, level);
+}
+
+}
+}
@@ -0,0 +1,142 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_image_manager_ImageBroadcast_hpp
+#define sarus_image_manager_ImageBroadcast_hpp
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "common/LogLevel.hpp"
+
+
+namespace sarus {
+namespace image_manager {
+
+/**
+ * Distributes a file (the SquashFS backing file of an image) from the first peer (rank 0)
+ * to the node-local staging directories of all the other peers.
+ *
+ * The peers are organized in a spanning tree with configurable fanout: each peer receives
+ * a stream of chunks from its parent over TCP and forwards every chunk to its children while
+ * writing it to the staging directory, so the shared filesystem is read only once by the root.
+ * The SHA-256 digest of the data is computed along the way and compared with the digest sent
+ * by the root at the end of the stream; only verified files are moved to their final location.
+ * Every peer finally reports to its parent whether its subtree succeeded, which makes the
+ * outcome of the whole broadcast known at the root.
+ *
+ * The peers listen on a TCP port which anybody on the network can connect to, thus the streams
+ * are authenticated with a secret shared by the peers: a receiving peer sends a random nonce to
+ * whoever connects, and only accepts the header and the final digest of the stream if they come
+ * with their HMAC keyed with the secret and bound to the nonce. Connections which fail the
+ * authentication are dropped and the peer keeps waiting for its parent.
+ */
+class ImageBroadcast {
+public:
+    struct Peer {
+        std::string host;
+        std::uint16_t port;
+    };
+
+    struct StagedFile {
+        boost::filesystem::path path;
+        std::string imageID;
+        std::string digest;
+        std::uint64_t size;
+    };
+
+public:
+    ImageBroadcast(std::vector<Peer> peers, std::size_t rank, std::string secret, std::size_t fanout=2);
+
+    void setTimeout(std::chrono::seconds value) { timeout = value; }
+    void setChunkSize(std::size_t value) { chunkSize = value; }
+
+    StagedFile send(const boost::filesystem::path& sourceFile,
+                    const boost::filesystem::path& stagedName,
+                    const std::string& imageID,
+                    const boost::filesystem::path& stagingDir) const;
+    StagedFile receive(const boost::filesystem::path& stagedName,
+                       const std::string& imageID,
+                       const boost::filesystem::path& stagingDir) const;
+
+    std::vector<std::size_t> getChildren(std::size_t rank) const;
+
+    static std::vector<Peer> parsePeers(const std::string& peerList, std::uint16_t defaultPort);
+    static std::string readOrCreateKeyFile(const boost::filesystem::path& file, uid_t owner);
+    static boost::optional<StagedFile> findStagedFile(const boost::filesystem::path& stagingDir,
+                                                      const boost::filesystem::path& stagedName,
+                                                      const std::string& imageID,
+                                                      uid_t owner);
+
+private:
+    struct Header {
+        std::string name;
+        std::string imageID;
+        std::uint64_t size;
+    };
+
+    struct Child {
+        int fd;
+        std::string nonce; // sent by the child to authenticate the stream
+    };
+
+    // closes the connections to the children which are still open
+    class ChildrenRAII {
+    public:
+        explicit ChildrenRAII(std::vector<Child> children) : children{std::move(children)} {}
+        ChildrenRAII(const ChildrenRAII&) = delete;
+        ChildrenRAII& operator=(const ChildrenRAII&) = delete;
+        ~ChildrenRAII();
+        std::vector<Child>& get() { return children; }
+
+    private:
+        std::vector<Child> children;
+    };
+
+    using ChunkReader = std::function<void(char*, std::size_t)>;
+
+    std::vector<Child> connectToChildren(const Header& header) const;
+    StagedFile relay(const Header& header,
+                     const std::string& nonce,
+                     const ChunkReader& readChunk,
+                     std::vector<Child>& children,
+                     const boost::filesystem::path& stagingDir,
+                     std::string& digest) const;
+    bool collectStatusOfChildren(std::vector<Child>& children) const;
+    void writeHeader(int fd, const Header& header, const std::string& nonce) const;
+    Header readHeader(int fd, const std::string& nonce) const;
+    std::string authenticate(const std::string& nonce, const std::vector<std::string>& fields) const;
+    void writeSidecar(const StagedFile& staged) const;
+    void printLog(const boost::format& message, common::LogLevel level) const;
+    void printLog(const std::string& message, common::LogLevel level) const;
+
+private:
+    std::vector<Peer> peers;
+    std::size_t rank;
+    std::string secret;
+    std::size_t fanout;
+    std::chrono::seconds timeout{300};
+    std::size_t chunkSize = 4 << 20;
+    const std::string sysname = "ImageBroadcast";
+};
+
+}
+}
+
+#endif
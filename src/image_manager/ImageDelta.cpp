@@ -0,0 +1,165 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "ImageDelta.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boost/format.hpp>
+
+#include "common/Error.hpp"
+#include "common/Logger.hpp"
+#include "common/Utility.hpp"
+
+
+namespace sarus {
+namespace image_manager {
+
+// unusual attributes, which umoci overwrites when a layer contains an entry with the same path
+static const mode_t placeholderDirectoryMode = 0717;
+static const struct timespec placeholderTime = {1, 123456789};
+
+static void log(const boost::format& message, common::LogLevel level) {
+    common::Logger::getInstance().log(message.str(), "ImageDelta", level);
+}
+
+static common::ImageFileIndex openIndexOfImage(const boost::filesystem::path& imageFile) {
+    auto index = common::ImageFileIndex{common::ImageFileIndex::getFileOfImage(imageFile)};
+    if(!index.matchesImage(imageFile)) {
+        auto message = boost::format("the index of the image's files doesn't match %s") % imageFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+    return index;
+}
+
+static boost::filesystem::path createHardLink(const boost::filesystem::path& target, const boost::filesystem::path& link) {
+    boost::filesystem::remove(link); // left by an interrupted pull
+    if(::link(target.c_str(), link.c_str()) != 0) {
+        auto message = boost::format("Failed to create hard link %s to %s: %s") % link % target % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    return link;
+}
+
+ImageDelta::ImageDelta(const common::SarusImage& baseImage, const common::ImageMetadata& baseMetadata,
+                       const boost::filesystem::path& lowerImageFile)
+    : baseImage{baseImage}
+    , baseMetadata{baseMetadata}
+    , baseIndex{openIndexOfImage(baseImage.imageFile)}
+    , lowerImageFile{createHardLink(baseImage.imageFile, lowerImageFile)}
+{}
+
+std::vector<boost::filesystem::path> ImageDelta::getLowerImageFiles() const {
+    auto files = std::vector<boost::filesystem::path>{lowerImageFile.getPath()};
+    files.insert(files.end(), baseImage.lowerImageFiles.cbegin(), baseImage.lowerImageFiles.cend());
+    return files;
+}
+
+void ImageDelta::createPlaceholders(const boost::filesystem::path& unpackDir) {
+    log(boost::format("Creating placeholders of the files of image %s in %s") % baseImage.reference % unpackDir,
+        common::LogLevel::INFO);
+
+    for(const auto& entry : baseIndex.getEntries()) {
+        if(entry.first == "/") {
+            continue;
+        }
+        auto path = unpackDir / entry.first;
+        if(S_ISDIR(entry.second.mode)) {
+            if(mkdir(path.c_str(), placeholderDirectoryMode) != 0 || chmod(path.c_str(), placeholderDirectoryMode) != 0) {
+                auto message = boost::format("Failed to create placeholder directory %s: %s") % path % strerror(errno);
+                SARUS_THROW_ERROR(message.str());
+            }
+        }
+        else {
+            auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+            if(fd == -1) {
+                auto message = boost::format("Failed to create placeholder file %s: %s") % path % strerror(errno);
+                SARUS_THROW_ERROR(message.str());
+            }
+            close(fd);
+            struct timespec times[2] = {placeholderTime, placeholderTime};
+            if(utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW) != 0) {
+                auto message = boost::format("Failed to set times of placeholder file %s: %s") % path % strerror(errno);
+                SARUS_THROW_ERROR(message.str());
+            }
+        }
+
+        struct stat sb;
+        if(lstat(path.c_str(), &sb) != 0) {
+            auto message = boost::format("Failed to stat placeholder %s: %s") % path % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        placeholders.push_back(Placeholder{entry.first, sb.st_ino, entry.second.mode});
+    }
+
+    log(boost::format("Created %d placeholders") % placeholders.size(), common::LogLevel::INFO);
+}
+
+bool ImageDelta::removePlaceholders(const boost::filesystem::path& unpackDir) const {
+    log(boost::format("Removing placeholders from %s") % unpackDir, common::LogLevel::INFO);
+
+    // the contents of the directories come first
+    for(auto it = placeholders.crbegin(); it != placeholders.crend(); ++it) {
+        auto path = unpackDir / it->path;
+        struct stat sb;
+        if(lstat(path.c_str(), &sb) != 0) {
+            log(boost::format("The new layers remove %s of the previous image") % it->path, common::LogLevel::INFO);
+            return false;
+        }
+
+        if(S_ISDIR(it->baseMode)) {
+            if(!S_ISDIR(sb.st_mode) || sb.st_ino != it->inode) {
+                log(boost::format("The new layers replace directory %s of the previous image") % it->path,
+                    common::LogLevel::INFO);
+                return false;
+            }
+            if((sb.st_mode & 07777) != placeholderDirectoryMode) {
+                continue; // the new layers set the attributes of the directory
+            }
+            if(boost::filesystem::is_empty(path)) {
+                boost::filesystem::remove(path);
+            }
+            else if(chmod(path.c_str(), it->baseMode & 07777) != 0) {
+                auto message = boost::format("Failed to restore mode of directory %s: %s") % path % strerror(errno);
+                SARUS_THROW_ERROR(message.str());
+            }
+            continue;
+        }
+
+        auto isPlaceholder = S_ISREG(sb.st_mode)
+            && sb.st_ino == it->inode
+            && sb.st_size == 0
+            && sb.st_mtim.tv_sec == placeholderTime.tv_sec
+            && sb.st_mtim.tv_nsec == placeholderTime.tv_nsec;
+        if(!isPlaceholder) {
+            continue; // replaced by the new layers
+        }
+        if(sb.st_nlink > 1) {
+            log(boost::format("The new layers hard link %s of the previous image") % it->path, common::LogLevel::INFO);
+            return false;
+        }
+        boost::filesystem::remove(path);
+    }
+
+    log(boost::format("Successfully removed placeholders"), common::LogLevel::INFO);
+    return true;
+}
+
+void ImageDelta::release() {
+    lowerImageFile.release();
+}
+
+}
+}
@@ -0,0 +1,79 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_image_manager_ImageDelta_hpp
+#define sarus_image_manager_ImageDelta_hpp
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <boost/filesystem.hpp>
+
+#include "common/ImageFileIndex.hpp"
+#include "common/ImageMetadata.hpp"
+#include "common/PathRAII.hpp"
+#include "common/SarusImage.hpp"
+
+
+namespace sarus {
+namespace image_manager {
+
+/**
+ * Storage of an image as a delta of the previous image with the same reference, e.g. when a
+ * tag like "latest" moves to an image with additional layers. Only the additional layers are
+ * unpacked and converted to a (small) squashfs file, which the runtime stacks with OverlayFS
+ * on top of the squashfs file(s) of the previous image. The squashfs file of the previous
+ * image is kept as a lower image of the new one through a hard link.
+ *
+ * The whiteouts of the additional layers can't be represented in a squashfs file created by
+ * an unprivileged user, thus the delta is only possible when the additional layers don't
+ * remove files of the previous image. To detect that, the files of the previous image (known
+ * from its file index) are represented by placeholders in the directory where the additional
+ * layers are unpacked: umoci applies the whiteouts by removing the placeholders. The remaining
+ * placeholders are removed before the creation of the squashfs file.
+ */
+class ImageDelta {
+public:
+    ImageDelta(const common::SarusImage& baseImage, const common::ImageMetadata& baseMetadata,
+               const boost::filesystem::path& lowerImageFile);
+
+    const common::SarusImage& getBaseImage() const { return baseImage; }
+    const common::ImageMetadata& getBaseMetadata() const { return baseMetadata; }
+    const common::ImageFileIndex& getBaseIndex() const { return baseIndex; }
+    std::size_t getNumberOfBaseLayers() const { return baseMetadata.layers.size(); }
+    // the lower images of the new image, topmost first
+    std::vector<boost::filesystem::path> getLowerImageFiles() const;
+
+    void createPlaceholders(const boost::filesystem::path& unpackDir);
+    // returns false if the unpacked layers removed or replaced files of the base image
+    bool removePlaceholders(const boost::filesystem::path& unpackDir) const;
+    // keeps the lower image file, once the new image is in the repository
+    void release();
+
+private:
+    struct Placeholder {
+        std::string path;
+        ino_t inode;
+        mode_t baseMode;
+    };
+
+    common::SarusImage baseImage;
+    common::ImageMetadata baseMetadata;
+    common::ImageFileIndex baseIndex;
+    common::PathRAII lowerImageFile;
+    std::vector<Placeholder> placeholders;
+};
+
+}
+}
+
+#endif
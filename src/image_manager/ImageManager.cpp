@@ -10,12 +10,25 @@
 
 #include "image_manager/ImageManager.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+#include <sys/stat.h>
+
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/regex.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
+#include <rapidjson/pointer.h>
 
 #include "common/Error.hpp"
+#include "common/FileStore.hpp"
+#include "common/ImageFileIndex.hpp"
+#include "common/ImageMetadata.hpp"
+#include "common/Metrics.hpp"
 #include "common/PathRAII.hpp"
+#include "common/TreeRemoval.hpp"
 #include "common/Utility.hpp"
 #include "image_manager/SquashfsImage.hpp"
 #include "image_manager/Utility.hpp"
@@ -24,11 +37,37 @@
 namespace sarus {
 namespace image_manager {
 
+    // temporary files younger than this may belong to pulls or loads still in progress
+    static const auto orphanedTemporaryFilesGracePeriod = std::chrono::hours{24};
+    // default of the "fileDeduplication/minFileSize" configuration parameter
+    static const auto defaultMinDeduplicatedFileSize = std::uintmax_t{1024*1024};
+
+    // total size of the regular files of the unpacked image (the entries which can't be read are skipped)
+    static std::uintmax_t getSizeOfUnpackedImage(const boost::filesystem::path& rootfsDir) {
+        auto size = std::uintmax_t{0};
+        auto ec = boost::system::error_code{};
+        auto options = boost::filesystem::directory_options::skip_permission_denied;
+        for(auto it = boost::filesystem::recursive_directory_iterator{rootfsDir, options, ec};
+            !ec && it != boost::filesystem::recursive_directory_iterator{};
+            it.increment(ec)) {
+            auto fileEc = boost::system::error_code{};
+            if(boost::filesystem::is_regular_file(it->symlink_status(fileEc))) {
+                auto fileSize = boost::filesystem::file_size(it->path(), fileEc);
+                size += fileEc ? 0 : fileSize;
+            }
+        }
+        return size;
+    }
+
     ImageManager::ImageManager(std::shared_ptr<const common::Config> config)
     : config(config)
     , skopeoDriver(config)
     , imageStore(config)
-    {}
+    {
+        if(!this->config->imageTier.empty()) {
+            imageStore.getTier(this->config->imageTier); // fail early on invalid tier
+        }
+    }
 
     /**
      * Pull the container image and add to the repository
@@ -68,6 +107,7 @@ namespace image_manager {
         if (storedImage && storedImage->reference.digest == pullReference.digest) {
             printLog(boost::format("Image for %s is already available and up to date") % config->imageReference,
                      common::LogLevel::GENERAL);
+            common::Metrics::getInstance().incrementCounter("sarus_images_up_to_date");
             return;
         }
 
@@ -80,6 +120,7 @@ namespace image_manager {
         auto ociImagePath = skopeoDriver.copyToOCIImage(transport, pullReference.normalize().string());
         processImage(OCIImage{config, ociImagePath}, pullReference);
 
+        common::Metrics::getInstance().incrementCounter("sarus_images_pulled");
         printLog("Successfully pulled image", common::LogLevel::INFO);
     }
 
@@ -92,9 +133,30 @@ namespace image_manager {
 
         printLog(boost::format("Loading image archive %s") % archive, common::LogLevel::INFO);
 
+        // Archives can be regular files or streams (named pipes, standard input redirected
+        // from a pipe). Sarus doesn't make a copy of a stream, which is read once by Skopeo:
+        // Skopeo still buffers in the Sarus temporary directory the parts of the archive it
+        // cannot read in order (see SkopeoDriver::copyToOCIImage()), thus a stream is not
+        // loaded end to end without touching the disk.
+        // Terminals and other character devices are rejected, e.g. "sarus load -" without
+        // redirection would wait forever for an archive typed on the terminal.
+        auto archiveStatus = boost::filesystem::status(archive);
+        if(boost::filesystem::is_regular_file(archiveStatus)) {
+            printLog("Image archive is a regular file", common::LogLevel::DEBUG);
+        }
+        else if(archiveStatus.type() == boost::filesystem::fifo_file) {
+            printLog("Image archive is a stream, reading it in a single pass", common::LogLevel::INFO);
+        }
+        else {
+            auto message = boost::format("Failed to load image archive %s: the path must lead to a regular file, "
+                                         "a named pipe or the standard input redirected from a file or a pipe") % archive;
+            SARUS_THROW_ERROR(message.str());
+        }
+
         auto ociImagePath = skopeoDriver.copyToOCIImage(format, archive.string());
         processImage(OCIImage{config, ociImagePath}, config->imageReference);
 
+        common::Metrics::getInstance().incrementCounter("sarus_images_loaded");
         printLog("Successfully loaded image archive", common::LogLevel::INFO);
     }
 
@@ -119,33 +181,400 @@ namespace image_manager {
         printLog(boost::format("removed image %s") % config->imageReference, common::LogLevel::GENERAL);
     }
 
+    /**
+     * Remove the images data from repository
+     */
+    void ImageManager::removeImages() {
+        issueErrorIfIsCentralizedRepositoryAndCentralizedRepositoryIsDisabled();
+        issueWarningIfIsCentralizedRepositoryAndIsNotRootUser();
+
+        for(const auto& reference : config->imageReferences) {
+            printLog(boost::format("removing image %s") % reference, common::LogLevel::INFO);
+        }
+
+        imageStore.removeImages(config->imageReferences);
+
+        for(const auto& reference : config->imageReferences) {
+            printLog(boost::format("removed image %s") % reference, common::LogLevel::GENERAL);
+        }
+    }
+
+    /**
+     * Remove the images matching the criteria of the prune command from repository, together
+     * with the temporary files left behind by interrupted pulls and loads (e.g. killed by the
+     * workload manager at the end of a job)
+     */
+    void ImageManager::pruneImages() {
+        issueErrorIfIsCentralizedRepositoryAndCentralizedRepositoryIsDisabled();
+        issueWarningIfIsCentralizedRepositoryAndIsNotRootUser();
+
+        auto now = time(nullptr);
+        const auto& criteria = config->commandPrune;
+        auto filter = ImageStore::PruneFilter{};
+        if(criteria.olderThan) {
+            filter.createdBefore = now - criteria.olderThan->count();
+        }
+        if(criteria.unusedFor) {
+            filter.lastUsedBefore = now - criteria.unusedFor->count();
+        }
+        filter.referencePattern = criteria.referencePattern;
+
+        for(const auto& image : imageStore.pruneImages(filter)) {
+            printLog(boost::format("removed image %s") % image.reference, common::LogLevel::GENERAL);
+        }
+
+        auto gracePeriod = std::chrono::duration_cast<std::chrono::seconds>(orphanedTemporaryFilesGracePeriod);
+        auto modifiedBefore = now - gracePeriod.count();
+        auto orphans = imageStore.removeOrphanedTemporaryFiles(modifiedBefore);
+        auto orphanedDirectories = removeOrphanedTemporaryDirectories(modifiedBefore);
+        orphans.insert(orphans.end(), orphanedDirectories.cbegin(), orphanedDirectories.cend());
+        for(const auto& orphan : orphans) {
+            printLog(boost::format("removed orphaned temporary file %s") % orphan, common::LogLevel::INFO);
+        }
+        printLog(boost::format("removed %d orphaned temporary files") % orphans.size(), common::LogLevel::GENERAL);
+
+        removeUnreferencedFileStoreObjects(modifiedBefore);
+    }
+
+    /**
+     * Move the backing files of the image to another tier
+     */
+    void ImageManager::migrateImage() {
+        issueErrorIfIsCentralizedRepositoryAndCentralizedRepositoryIsDisabled();
+        issueWarningIfIsCentralizedRepositoryAndIsNotRootUser();
+
+        printLog(boost::format("migrating image %s to tier '%s'") % config->imageReference % config->imageTier,
+                 common::LogLevel::INFO);
+
+        imageStore.migrateImage(config->imageReference, config->imageTier);
+    }
+
+    /**
+     * The stages of the conversion are timed as phases of the "sarus_image_phase" metric (together
+     * with "copy", timed by the SkopeoDriver) and the bytes they move are added to the
+     * "sarus_image_phase_bytes" counter
+     */
     void ImageManager::processImage(const OCIImage& image, const common::ImageReference& storageReference) {
-        auto metadata = image.getMetadata();
-        auto metadataFile = imageStore.getImageMetadataFile(storageReference);
-        metadata.write(metadataFile);
-        auto metadataRAII = common::PathRAII{metadataFile};
+        auto& metrics = common::Metrics::getInstance();
+        const auto& tier = config->imageTier.empty()
+            ? imageStore.selectTier(storageReference, image.getLayersSize())
+            : imageStore.getTier(config->imageTier);
+
+        auto squashfsImagePath = imageStore.getImageSquashfsFile(storageReference, tier);
+        auto delta = createImageDelta(image, storageReference, squashfsImagePath);
+
+        metrics.incrementCounter("sarus_image_phase_bytes", {{"phase", "copy"}}, image.getLayersSize());
+        auto unpackedImage = unpackImage(image, delta);
+        // walking the unpacked tree costs as many metadata operations as its files: only when reported
+        if(metrics.isEnabled()) {
+            metrics.incrementCounter("sarus_image_phase_bytes", {{"phase", "unpack"}},
+                                     getSizeOfUnpackedImage(unpackedImage.getPath()));
+        }
 
-        auto unpackedImage = image.unpack();
+        auto metadata = image.getMetadata();
+        metadata.layers = image.getLayers();
+        if(delta) {
+            // the libraries of the lower images aren't in the unpacked directory
+            printLog("not creating library catalogue of delta image", common::LogLevel::INFO);
+        }
+        else {
+            metadata.libraryCatalogue = createLibraryCatalogue(unpackedImage.getPath());
+        }
+        deduplicateFiles(unpackedImage.getPath(), delta.get(), metadata);
 
-        auto squashfsImagePath = imageStore.getImageSquashfsFile(storageReference);
         auto squashfs = SquashfsImage{*config, unpackedImage.getPath(), squashfsImagePath};
         auto squashfsRAII = common::PathRAII{squashfs.getPathOfImage()};
-
         auto imageSize = common::getFileSize(squashfsRAII.getPath());
-        auto imageSizeString = common::SarusImage::createSizeString(imageSize);
-        auto created = common::SarusImage::createTimeString(std::time(nullptr));
-        auto sarusImage = common::SarusImage{
-            storageReference,
-            image.getImageID(),
-            imageSizeString,
-            created,
-            squashfsRAII.getPath(),
-            metadataRAII.getPath()};
-
-        imageStore.addImage(sarusImage);
+        metrics.incrementCounter("sarus_image_phase_bytes", {{"phase", "mksquashfs"}}, imageSize);
+        auto lowerIndex = delta ? boost::optional<common::ImageFileIndex>{delta->getBaseIndex()} : boost::none;
+        auto indexRAII = createImageFileIndex(unpackedImage.getPath(), squashfsRAII.getPath(), lowerIndex);
+
+        auto metadataFile = imageStore.getImageMetadataFile(storageReference, tier);
+        auto metadataRAII = common::PathRAII{};
+        {
+            auto timer = common::Metrics::ScopedTimer{"sarus_image_phase", {{"phase", "metadata"}}};
+            metadata.write(metadataFile);
+            metadataRAII = common::PathRAII{metadataFile};
+
+            auto lowerImageFiles = delta ? delta->getLowerImageFiles() : std::vector<boost::filesystem::path>{};
+            auto totalImageSize = imageSize;
+            for(const auto& file : lowerImageFiles) {
+                totalImageSize += common::getFileSize(file);
+            }
+
+            auto imageSizeString = common::SarusImage::createSizeString(totalImageSize);
+            auto created = common::SarusImage::createTimeString(std::time(nullptr));
+            auto sarusImage = common::SarusImage{
+                storageReference,
+                image.getImageID(),
+                imageSizeString,
+                created,
+                squashfsRAII.getPath(),
+                metadataFile};
+            sarusImage.lowerImageFiles = lowerImageFiles;
+
+            imageStore.addImage(sarusImage);
+        }
+        metrics.incrementCounter("sarus_image_phase_bytes", {{"phase", "metadata"}},
+                                 common::getFileSize(metadataFile)
+                                 + common::getFileSize(imageStore.getRepositoryMetadataFile()));
 
         metadataRAII.release();
         squashfsRAII.release();
+        if(indexRAII) {
+            indexRAII->release();
+        }
+        if(delta) {
+            delta->release();
+        }
+
+        auto timer = common::Metrics::ScopedTimer{"sarus_image_phase", {{"phase", "cleanup"}}};
+        auto removal = std::move(unpackedImage); // removed before the timer stops
+    }
+
+    /**
+     * With the "maxImageDeltas" configuration parameter, an image whose layers extend the layers
+     * of the image previously stored with the same reference (in the same tier) is stored as a
+     * delta of the previous image (see ImageDelta). Up to "maxImageDeltas" deltas are stacked,
+     * then the image is stored in full again.
+     */
+    std::unique_ptr<ImageDelta> ImageManager::createImageDelta(const OCIImage& image,
+                                                               const common::ImageReference& storageReference,
+                                                               const boost::filesystem::path& squashfsImagePath) const {
+        const auto* maxDeltas = rapidjson::Pointer("/maxImageDeltas").Get(config->json);
+        if(!maxDeltas || maxDeltas->GetUint() == 0) {
+            return {};
+        }
+
+        auto baseImage = imageStore.findImage(storageReference);
+        if(!baseImage || baseImage->imageFile != squashfsImagePath || baseImage->id.empty()) {
+            return {};
+        }
+        if(baseImage->lowerImageFiles.size() >= maxDeltas->GetUint()) {
+            printLog(boost::format("previous image %s already stacks %d deltas: storing the full image")
+                        % storageReference % baseImage->lowerImageFiles.size(),
+                     common::LogLevel::INFO);
+            return {};
+        }
+
+        try {
+            auto baseMetadata = common::ImageMetadata{baseImage->metadataFile, config->userIdentity};
+            const auto& baseLayers = baseMetadata.layers;
+            const auto& layers = image.getLayers();
+            if(baseLayers.empty()
+               || baseLayers.size() >= layers.size()
+               || !std::equal(baseLayers.cbegin(), baseLayers.cend(), layers.cbegin())) {
+                return {};
+            }
+            auto lowerImageFile = imageStore.getLowerImageFile(*baseImage);
+            auto delta = std::unique_ptr<ImageDelta>{new ImageDelta{*baseImage, baseMetadata, lowerImageFile}};
+            printLog(boost::format("storing image as a delta of %d layers on top of the previous image %s")
+                        % (layers.size() - baseLayers.size()) % storageReference,
+                     common::LogLevel::INFO);
+            return delta;
+        }
+        catch(const std::exception& e) {
+            printLog(boost::format("Not storing image as a delta of the previous image: %s") % e.what(),
+                     common::LogLevel::INFO);
+            return {};
+        }
+    }
+
+    /**
+     * If the layers of a delta remove or replace files of the previous image,
+     * the delta is dropped and the full image is unpacked
+     */
+    common::PathRAII ImageManager::unpackImage(const OCIImage& image, std::unique_ptr<ImageDelta>& delta) const {
+        if(delta) {
+            try {
+                auto& imageDelta = *delta;
+                auto unpackedImage = image.unpack(imageDelta.getNumberOfBaseLayers(),
+                                                  [&imageDelta](const boost::filesystem::path& dir) {
+                                                      imageDelta.createPlaceholders(dir);
+                                                  });
+                if(imageDelta.removePlaceholders(unpackedImage.getPath())) {
+                    return unpackedImage;
+                }
+            }
+            catch(const std::exception& e) {
+                printLog(boost::format("Failed to unpack delta image: %s") % e.what(), common::LogLevel::INFO);
+            }
+            printLog("storing the full image", common::LogLevel::INFO);
+            delta.reset();
+        }
+        return image.unpack();
+    }
+
+    /**
+     * The catalogue only spares the hooks some work at container launch,
+     * thus failing to create it doesn't fail the pull or load of the image
+     */
+    boost::optional<common::LibraryCatalogue> ImageManager::createLibraryCatalogue(const boost::filesystem::path& rootfsDir) const {
+        auto timer = common::Metrics::ScopedTimer{"sarus_image_phase", {{"phase", "catalogue"}}};
+        try {
+            return common::LibraryCatalogue::create(rootfsDir);
+        }
+        catch(const common::Error& e) {
+            auto message = boost::format("Failed to create library catalogue of image: %s."
+                                         " Hooks will analyze the container's libraries at launch time.") % e.what();
+            printLog(message, common::LogLevel::WARN);
+            return {};
+        }
+    }
+
+    /**
+     * With the "fileDeduplication" configuration parameter, moves the large files of the image
+     * into the file store of the repository and links them into a new view of the store, which
+     * the runtime stacks on top of the image (see common::FileStore). The catalogue was already
+     * created, thus it describes the libraries as they are seen from the container.
+     * A delta keeps referencing the objects of its base image, whose files are also in its view.
+     */
+    void ImageManager::deduplicateFiles(const boost::filesystem::path& rootfsDir,
+                                        const ImageDelta* delta,
+                                        common::ImageMetadata& metadata) const {
+        if(delta) {
+            metadata.fileStoreObjects = delta->getBaseMetadata().fileStoreObjects;
+            metadata.fileStoreView = delta->getBaseMetadata().fileStoreView;
+        }
+
+        const auto* deduplicationConfig = rapidjson::Pointer("/fileDeduplication").Get(config->json);
+        if(!deduplicationConfig) {
+            return;
+        }
+        auto minFileSize = defaultMinDeduplicatedFileSize;
+        if(deduplicationConfig->HasMember("minFileSize")) {
+            minFileSize = (*deduplicationConfig)["minFileSize"].GetUint64();
+        }
+
+        auto timer = common::Metrics::ScopedTimer{"sarus_image_phase", {{"phase", "deduplication"}}};
+        auto store = common::FileStore{common::FileStore::getDirectory(config->directories.repository), minFileSize};
+        auto viewName = common::makeUniquePathWithRandomSuffix(store.getViewDirectory("view")).filename().string();
+        auto objects = store.deduplicate(rootfsDir, viewName, metadata.fileStoreView);
+        const auto& statistics = store.getStatistics();
+        common::Metrics::getInstance().incrementCounter("sarus_image_phase_bytes", {{"phase", "deduplication"}},
+                                                        statistics.storedBytes);
+        printLog(boost::format("deduplicated %d files (%s), of which %s were already in the repository")
+                    % statistics.numberOfFiles
+                    % common::SarusImage::createSizeString(statistics.storedBytes + statistics.reusedBytes)
+                    % common::SarusImage::createSizeString(statistics.reusedBytes),
+                 common::LogLevel::INFO);
+
+        if(objects.empty()) {
+            // the view of the base image (if any) holds all the deduplicated files
+            common::removeTree(store.getViewDirectory(viewName));
+            return;
+        }
+        for(const auto& object : objects) {
+            if(std::find(metadata.fileStoreObjects.cbegin(), metadata.fileStoreObjects.cend(), object)
+               == metadata.fileStoreObjects.cend()) {
+                metadata.fileStoreObjects.push_back(object);
+            }
+        }
+        metadata.fileStoreView = viewName;
+    }
+
+    /**
+     * Like the library catalogue, the index of the image's files is an optimization for
+     * container launches: failing to create it doesn't fail the pull or load of the image
+     */
+    std::unique_ptr<common::PathRAII> ImageManager::createImageFileIndex(const boost::filesystem::path& rootfsDir,
+                                                                         const boost::filesystem::path& squashfsFile,
+                                                                         const boost::optional<common::ImageFileIndex>& lowerIndex) const {
+        auto timer = common::Metrics::ScopedTimer{"sarus_image_phase", {{"phase", "index"}}};
+        auto indexFile = common::ImageFileIndex::getFileOfImage(squashfsFile);
+        auto indexRAII = std::unique_ptr<common::PathRAII>{new common::PathRAII{indexFile}};
+        try {
+            common::ImageFileIndex::create(rootfsDir, squashfsFile, indexFile, lowerIndex);
+            return indexRAII;
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to create index of the image's files: %s."
+                                         " Lookups in the image's filesystem will go through the squashfs file.") % e.what();
+            printLog(message, common::LogLevel::WARN);
+            return {};
+        }
+    }
+
+    /**
+     * Remove the temporary OCI images of the cache, the temporary unpacked images and the trash
+     * of the deferred removals (see OCIImage::unpack) which belong to the user and were not
+     * modified since the given time
+     */
+    std::vector<boost::filesystem::path> ImageManager::removeOrphanedTemporaryDirectories(time_t modifiedBefore) const {
+        auto isOrphan = [this, modifiedBefore](const boost::filesystem::path& path) {
+            struct stat sb;
+            return lstat(path.c_str(), &sb) == 0
+                && sb.st_uid == config->userIdentity.uid
+                && sb.st_mtime < modifiedBefore;
+        };
+        auto isTemporary = [](const boost::filesystem::path& path, const std::string& prefix) {
+            return common::hasRandomSuffix(path) && boost::starts_with(path.filename().string(), prefix + "-");
+        };
+
+        auto orphans = std::vector<boost::filesystem::path>{};
+        auto ociImagesDir = config->directories.cache / "ociImages";
+        if(boost::filesystem::is_directory(ociImagesDir)) {
+            for(const auto& entry : boost::filesystem::directory_iterator{ociImagesDir}) {
+                if(isTemporary(entry.path(), "image") && isOrphan(entry.path())) {
+                    orphans.push_back(entry.path());
+                }
+            }
+        }
+        if(boost::filesystem::is_directory(config->directories.temp)) {
+            for(const auto& entry : boost::filesystem::directory_iterator{config->directories.temp}) {
+                if((isTemporary(entry.path(), "unpack-directory") || isTemporary(entry.path(), "sarusPullManifest"))
+                   && isOrphan(entry.path())) {
+                    orphans.push_back(entry.path());
+                }
+            }
+        }
+        // the trash is at a predictable path: don't follow a symlink or a directory planted by another user
+        auto trashDir = config->directories.temp / ("sarus-trash-" + std::to_string(config->userIdentity.uid));
+        if(common::isTrashDirectoryTrusted(trashDir, config->userIdentity.uid)) {
+            for(const auto& entry : boost::filesystem::directory_iterator{trashDir}) {
+                if(isOrphan(entry.path())) {
+                    orphans.push_back(entry.path());
+                }
+            }
+        }
+
+        auto removed = std::vector<boost::filesystem::path>{};
+        for(const auto& orphan : orphans) {
+            try {
+                common::removeTree(orphan);
+                removed.push_back(orphan);
+            }
+            catch(const std::exception& e) {
+                auto message = boost::format("Failed to remove orphaned temporary file %s: %s") % orphan % e.what();
+                printLog(message, common::LogLevel::WARN, std::cerr);
+            }
+        }
+        return removed;
+    }
+
+    /**
+     * The objects referenced by the images are collected from the metadata files of the images.
+     * If one of them can't be read, no object is removed, since it could be still in use.
+     */
+    void ImageManager::removeUnreferencedFileStoreObjects(time_t modifiedBefore) const {
+        auto storeDir = common::FileStore::getDirectory(config->directories.repository);
+        if(!boost::filesystem::is_directory(storeDir)) {
+            return;
+        }
+
+        auto removed = std::vector<boost::filesystem::path>{};
+        try {
+            removed = imageStore.removeUnreferencedFileStoreObjects(modifiedBefore);
+        }
+        catch(const common::Error& e) {
+            auto message = boost::format("Not removing the unreferenced files of the store %s: %s") % storeDir % e.what();
+            printLog(message, common::LogLevel::WARN, std::cerr);
+            return;
+        }
+        for(const auto& object : removed) {
+            printLog(boost::format("removed unreferenced file %s of the store") % object, common::LogLevel::INFO);
+        }
+        printLog(boost::format("removed %d unreferenced files of the store") % removed.size(), common::LogLevel::GENERAL);
     }
 
     std::string ImageManager::retrieveRegistryDigest(const std::string& transport, const common::ImageReference& targetReference) const {
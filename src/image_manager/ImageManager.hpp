@@ -11,12 +11,16 @@
 #ifndef _ImageManager_hpp
 #define _ImageManager_hpp
 
+#include <memory>
 #include <vector>
 #include <string>
 
 #include "common/Config.hpp"
+#include "common/ImageFileIndex.hpp"
 #include "common/Logger.hpp"
+#include "common/PathRAII.hpp"
 #include "common/SarusImage.hpp"
+#include "image_manager/ImageDelta.hpp"
 #include "image_manager/OCIImage.hpp"
 #include "image_manager/ImageStore.hpp"
 #include "image_manager/SkopeoDriver.hpp"
@@ -31,10 +35,24 @@ public:
     void pullImage(const std::string& transport);
     void loadImage(const std::string& format, const boost::filesystem::path& archive);
     void removeImage();
+    void removeImages();
+    void pruneImages();
+    void migrateImage();
     std::vector<common::SarusImage> listImages() const;
 
 private:
     void processImage(const OCIImage& image, const common::ImageReference& storageReference);
+    std::unique_ptr<ImageDelta> createImageDelta(const OCIImage& image,
+                                                 const common::ImageReference& storageReference,
+                                                 const boost::filesystem::path& squashfsImagePath) const;
+    common::PathRAII unpackImage(const OCIImage& image, std::unique_ptr<ImageDelta>& delta) const;
+    boost::optional<common::LibraryCatalogue> createLibraryCatalogue(const boost::filesystem::path& rootfsDir) const;
+    void deduplicateFiles(const boost::filesystem::path& rootfsDir, const ImageDelta* delta, common::ImageMetadata& metadata) const;
+    std::unique_ptr<common::PathRAII> createImageFileIndex(const boost::filesystem::path& rootfsDir,
+                                                           const boost::filesystem::path& squashfsFile,
+                                                           const boost::optional<common::ImageFileIndex>& lowerIndex) const;
+    std::vector<boost::filesystem::path> removeOrphanedTemporaryDirectories(time_t modifiedBefore) const;
+    void removeUnreferencedFileStoreObjects(time_t modifiedBefore) const;
     std::string retrieveRegistryDigest(const std::string& transport, const common::ImageReference& targetReference) const;
     void issueWarningIfIsCentralizedRepositoryAndIsNotRootUser() const;
     void issueErrorIfIsCentralizedRepositoryAndCentralizedRepositoryIsDisabled() const;
@@ -12,8 +12,22 @@
 
 #include <vector>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
@@ -21,10 +35,14 @@
 
 #include "common/PathRAII.hpp"
 #include "common/Error.hpp"
+#include "common/FileStore.hpp"
+#include "common/ImageFileIndex.hpp"
+#include "common/ImageMetadata.hpp"
 #include "common/Logger.hpp"
 #include "common/Utility.hpp"
 #include "common/Lockfile.hpp"
 #include "common/SarusImage.hpp"
+#include "common/TreeRemoval.hpp"
 
 
 namespace rj = rapidjson;
@@ -32,10 +50,18 @@ namespace rj = rapidjson;
 namespace sarus {
 namespace image_manager {
 
+    // about 10000 records
+    static const std::uintmax_t accessLogCompactionThreshold = 1024*1024;
+
     ImageStore::ImageStore(std::shared_ptr<const common::Config> config)
         : imagesDirectory{config->directories.images}
         , metadataFile{config->directories.repository / "metadata.json"}
-    {}
+        , accessLogFile{access_log::getLogFile(metadataFile)}
+        , uid{config->userIdentity.uid}
+        , gid{config->userIdentity.gid}
+    {
+        initializeTiers(*config);
+    }
 
     /**
      * Add the container image into repository (or update existing object)
@@ -49,9 +75,36 @@ namespace image_manager {
         auto metadata = readRepositoryMetadata();
 
         // remove previous entries with the same image reference (if any)
+        // and keep track of how many times the image was pulled/loaded
+        auto pullCount = std::uint64_t{1};
+        auto usage = access_log::Usage{};
         auto& images = metadata["images"];
         for(auto it = images.Begin(); it != images.End(); ) {
             if ((*it)["uniqueKey"].GetString() == image.reference.getUniqueKey()) {
+                pullCount = getPullCount(*it) + 1;
+                usage = getUsage(*it);
+                try {
+                    // the previous backing files would be orphaned if the image moved to another tier
+                    if (boost::filesystem::path{(*it)["imagePath"].GetString()} != image.imageFile) {
+                        removeImageBackingFiles(&(*it));
+                    }
+                    // and so would the lower images which the new image doesn't stack anymore
+                    else {
+                        auto orphanedLowerImageFiles = std::vector<boost::filesystem::path>{};
+                        for(const auto& file : getLowerImageFiles(*it)) {
+                            if(std::find(image.lowerImageFiles.cbegin(), image.lowerImageFiles.cend(), file)
+                               == image.lowerImageFiles.cend()) {
+                                orphanedLowerImageFiles.push_back(file);
+                            }
+                        }
+                        removeLowerImageFiles(orphanedLowerImageFiles);
+                    }
+                }
+                catch(const std::exception& e) {
+                    auto message = boost::format("Failed to remove the previous backing files of image %s: %s")
+                                   % image.reference % e.what();
+                    printLog(message, common::LogLevel::WARN, std::cerr);
+                }
                 it = images.Erase(it);
             } else {
                 ++it;
@@ -59,9 +112,12 @@ namespace image_manager {
         }
 
         // add new metadata entry
-        metadata["images"].GetArray().PushBack(
-            createImageJSON(image, metadata.GetAllocator()),
-            metadata.GetAllocator());
+        auto imageJSON = createImageJSON(image, metadata.GetAllocator());
+        imageJSON.AddMember("pullCount", rj::Value{pullCount}, metadata.GetAllocator());
+        if (usage.launchCount > 0) {
+            setUsage(imageJSON, usage, metadata.GetAllocator());
+        }
+        metadata["images"].GetArray().PushBack(imageJSON, metadata.GetAllocator());
 
         atomicallyUpdateRepositoryMetadataFile(metadata);
 
@@ -72,33 +128,167 @@ namespace image_manager {
      * Remove container image from repository
      */
     void ImageStore::removeImage(const common::ImageReference& imageReference) const {
-        printLog(boost::format("Attempting to remove image %s from local repository") % imageReference,
-                 common::LogLevel::INFO);
+        removeImages({imageReference});
+    }
+
+    /**
+     * Remove container images from repository, updating the repository metadata only once.
+     * The images which are found are removed even if some of the others are missing.
+     */
+    void ImageStore::removeImages(const std::vector<common::ImageReference>& imageReferences) const {
+        for(const auto& reference : imageReferences) {
+            printLog(boost::format("Attempting to remove image %s from local repository") % reference,
+                     common::LogLevel::INFO);
+        }
         common::Lockfile lock{metadataFile};
 
         auto repositoryMetadata = readRepositoryMetadata();
-        auto imageMetadata = findImageMetadata(imageReference, repositoryMetadata);
+        compactAccessLog(repositoryMetadata);
+        auto imagesMetadata = std::vector<const rj::Value*>{};
+        auto missingImages = std::vector<std::string>{};
+        for(const auto& reference : imageReferences) {
+            auto imageMetadata = findImageMetadata(reference, repositoryMetadata);
+            if(!imageMetadata) {
+                missingImages.push_back(reference.string());
+            }
+            else if(std::find(imagesMetadata.cbegin(), imagesMetadata.cend(), imageMetadata) == imagesMetadata.cend()) {
+                imagesMetadata.push_back(imageMetadata);
+            }
+        }
 
-        if (!imageMetadata) {
-            auto message = boost::format("Cannot find image '%s'") % imageReference;
+        removeImagesFromRepository(imagesMetadata, repositoryMetadata);
+
+        if(!missingImages.empty()) {
+            auto message = boost::format("Cannot find image '%s'") % boost::algorithm::join(missingImages, "', '");
             printLog(message, common::LogLevel::GENERAL, std::cerr);
             SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
         }
 
-        try {
-            // Attempting to remove backing files first so that, if something goes wrong on metadata removal,
-            // the orphaned metadata have more chance to be cleaned during a subsequent "sarus images" or "sarus run" command.
-            // If we remove metadata first and something goes wrong on backing files removal
-            // there would be no data-driven way to reach the orphaned files, which would just lie in the filesystem occupying space.
-            removeImageBackingFiles(imageMetadata);
-            removeRepositoryMetadataEntry(imageMetadata, repositoryMetadata);
+        printLog(boost::format("Successfully removed images from local repository"), common::LogLevel::INFO);
+    }
+
+    /**
+     * Remove the container images selected by the filter from repository
+     * and return them
+     */
+    std::vector<common::SarusImage> ImageStore::pruneImages(const PruneFilter& filter) const {
+        printLog(boost::format("Attempting to prune images from local repository"), common::LogLevel::INFO);
+        common::Lockfile lock{metadataFile};
+
+        auto repositoryMetadata = readRepositoryMetadata();
+        compactAccessLog(repositoryMetadata);
+        auto imagesMetadata = std::vector<const rj::Value*>{};
+        auto images = std::vector<common::SarusImage>{};
+        for(const auto& imageMetadata : repositoryMetadata["images"].GetArray()) {
+            if(matchesPruneFilter(imageMetadata, filter)) {
+                imagesMetadata.push_back(&imageMetadata);
+                images.push_back(convertImageMetadataToSarusImage(imageMetadata));
+            }
         }
-        catch(std::exception& e) {
-            auto message = boost::format("Failed to remove image %s") % imageReference;
-            SARUS_RETHROW_ERROR(e, message.str());
+
+        removeImagesFromRepository(imagesMetadata, repositoryMetadata);
+
+        printLog(boost::format("Successfully pruned %d images from local repository") % images.size(),
+                 common::LogLevel::INFO);
+        return images;
+    }
+
+    /**
+     * Remove the temporary files left in the repository by interrupted operations, e.g. the squashfs
+     * file of a pull which was killed, a partial copy to another tier or an update of the repository
+     * metadata. Only the files of the user which were not modified since the given time are removed,
+     * because the others may belong to operations still in progress.
+     */
+    std::vector<boost::filesystem::path> ImageStore::removeOrphanedTemporaryFiles(time_t modifiedBefore) const {
+        common::Lockfile lock{metadataFile};
+
+        auto isOrphan = [this, modifiedBefore](const boost::filesystem::path& path) {
+            struct stat sb;
+            return common::hasRandomSuffix(path)
+                && lstat(path.c_str(), &sb) == 0
+                && S_ISREG(sb.st_mode)
+                && sb.st_uid == uid
+                && sb.st_mtime < modifiedBefore;
+        };
+
+        // the backing files of the images are always named with an extension (e.g. ".squashfs"),
+        // thus they never look like temporary files
+        auto orphans = std::vector<boost::filesystem::path>{};
+        for(const auto& tier : tiers) {
+            if(!boost::filesystem::is_directory(tier.imagesDirectory)) {
+                continue;
+            }
+            for(auto it = boost::filesystem::recursive_directory_iterator{tier.imagesDirectory};
+                it != boost::filesystem::recursive_directory_iterator{};
+                ++it) {
+                if(isOrphan(it->path())) {
+                    orphans.push_back(it->path());
+                }
+            }
+        }
+        if(boost::filesystem::is_directory(metadataFile.parent_path())) {
+            for(const auto& entry : boost::filesystem::directory_iterator{metadataFile.parent_path()}) {
+                if(isOrphan(entry.path())) {
+                    orphans.push_back(entry.path());
+                }
+            }
+        }
+
+        auto removed = std::vector<boost::filesystem::path>{};
+        for(const auto& orphan : orphans) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(orphan, ec);
+            if(ec) {
+                auto message = boost::format("Failed to remove orphaned temporary file %s: %s") % orphan % ec.message();
+                printLog(message, common::LogLevel::WARN, std::cerr);
+                continue;
+            }
+            printLog(boost::format("Removed orphaned temporary file %s") % orphan, common::LogLevel::DEBUG);
+            removed.push_back(orphan);
+        }
+        return removed;
+    }
+
+    /**
+     * Remove the views and objects of the file store (see common::FileStore) which are referenced by no image
+     * of the repository and were not modified since the given time. The repository stays locked, so
+     * that no image referencing the objects is added between the collection of the references and
+     * the removal, while the objects of the pulls and loads still in progress are kept because their
+     * modification time is refreshed when they are added to the store.
+     */
+    std::vector<boost::filesystem::path> ImageStore::removeUnreferencedFileStoreObjects(time_t modifiedBefore) const {
+        auto storeDir = common::FileStore::getDirectory(metadataFile.parent_path());
+        if(!boost::filesystem::is_directory(storeDir)) {
+            return {};
+        }
+
+        common::Lockfile lock{metadataFile};
+        auto repositoryMetadata = readRepositoryMetadata();
+        auto referencedObjects = std::unordered_set<std::string>{};
+        auto referencedViews = std::unordered_set<std::string>{};
+        for(const auto& imageMetadata : repositoryMetadata["images"].GetArray()) {
+            if(!hasImageBackingFiles(imageMetadata)) {
+                continue;
+            }
+            auto image = convertImageMetadataToSarusImage(imageMetadata);
+            try {
+                auto metadata = common::ImageMetadata{image.metadataFile, common::UserIdentity{uid, gid, {}}};
+                referencedObjects.insert(metadata.fileStoreObjects.cbegin(), metadata.fileStoreObjects.cend());
+                if(metadata.fileStoreView) {
+                    referencedViews.insert(*metadata.fileStoreView);
+                }
+            }
+            catch(const common::Error& e) {
+                auto message = boost::format("Failed to read metadata of image %s") % image.reference;
+                SARUS_RETHROW_ERROR(e, message.str());
+            }
         }
 
-        printLog(boost::format("Successfully removed image from local repository"), common::LogLevel::INFO);
+        auto store = common::FileStore{storeDir, 0};
+        auto removed = store.removeUnreferencedViews(referencedViews, modifiedBefore);
+        auto removedObjects = store.removeUnreferencedObjects(referencedObjects, modifiedBefore);
+        removed.insert(removed.end(), removedObjects.cbegin(), removedObjects.cend());
+        return removed;
     }
 
     /**
@@ -107,6 +297,7 @@ namespace image_manager {
     std::vector<common::SarusImage> ImageStore::listImages() const {
         common::Lockfile lock{metadataFile};
         auto repositoryMetadata = readRepositoryMetadata();
+        compactAccessLog(repositoryMetadata);
         auto images = std::vector<common::SarusImage>{};
 
         for (const auto& imageMetadata : repositoryMetadata["images"].GetArray()) {
@@ -126,29 +317,24 @@ namespace image_manager {
         return images;
     }
 
+    /**
+     * Read-only lookup, which doesn't lock the repository: the metadata file is always replaced
+     * atomically (see atomicallyUpdateRepositoryMetadataFile()), thus it can be read concurrently
+     * with its updates. This keeps "sarus run" from writing to the repository, which may sit on a
+     * shared filesystem. An image whose backing files are missing is not found, while its entry is
+     * left to the commands which update the repository (e.g. removed by listImages()).
+     */
     boost::optional<common::SarusImage> ImageStore::findImage(const common::ImageReference& reference) const {
         printLog(boost::format("Looking for reference '%s' in local repository") % reference, common::LogLevel::DEBUG);
-        common::Lockfile lock{metadataFile};
         boost::optional<common::SarusImage> image;
 
         auto repositoryMetadata = readRepositoryMetadata();
         auto imageMetadata = findImageMetadata(reference, repositoryMetadata);
 
-        if (imageMetadata) {
-            // If backing files are present, all image data is available: assign object to return
-            // Else, ensure all image data is cleaned up
-            if (hasImageBackingFiles(*imageMetadata)) {
-                image = convertImageMetadataToSarusImage(*imageMetadata);
-            }
-            else {
-                removeImageBackingFiles(imageMetadata);
-                repositoryMetadata["images"].GetArray().Erase(imageMetadata);
-            }
+        if (imageMetadata && hasImageBackingFiles(*imageMetadata)) {
+            image = convertImageMetadataToSarusImage(*imageMetadata);
         }
 
-        // Update repository metadata in case entry was removed due to missing backing files
-        atomicallyUpdateRepositoryMetadataFile(repositoryMetadata);
-
         printLog(boost::format("Image for reference '%s' %s") % reference % (image ? "found" : "not found"),
                  common::LogLevel::DEBUG);
         return image;
@@ -198,6 +384,11 @@ namespace image_manager {
         if(!boost::filesystem::exists(metadataPath)) {
             missing.push_back(metadataPath.string());
         }
+        for(const auto& file : getLowerImageFiles(imageMetadata)) {
+            if(!boost::filesystem::exists(file)) {
+                missing.push_back(file.string());
+            }
+        }
         if(!missing.empty()) {
             auto message = boost::format("Repository inconsistency detected: image is listed in the repository "
                                          "metadata but the following backing files are missing: %s")
@@ -207,21 +398,39 @@ namespace image_manager {
         return missing.empty();
     }
 
-    common::SarusImage ImageStore::convertImageMetadataToSarusImage(const rapidjson::Value& imageMetadata) const {
-        auto imageReference = common::ImageReference{
+    common::ImageReference ImageStore::getImageReference(const rapidjson::Value& imageMetadata) const {
+        return common::ImageReference{
             imageMetadata["server"].GetString(),
             imageMetadata["namespace"].GetString(),
             imageMetadata["image"].GetString(),
             imageMetadata["tag"].GetString(),
             getRegistryDigest(imageMetadata)};
+    }
+
+    /**
+     * The paths of the backing files are not taken from the metadata as they are, since the files
+     * are loop mounted by "sarus run" and removed with the repository's privileges: the metadata
+     * only tells in which tier the image is stored, while the paths are derived from the tier's
+     * directory and the image's unique key (see getImageSquashfsFile()).
+     */
+    common::SarusImage ImageStore::convertImageMetadataToSarusImage(const rapidjson::Value& imageMetadata) const {
+        auto imageReference = getImageReference(imageMetadata);
+        const auto& imageTier = getTierOfBackingFile(imageMetadata["imagePath"].GetString());
+        const auto& metadataTier = getTierOfBackingFile(imageMetadata["metadataPath"].GetString());
         auto image = common::SarusImage{
             imageReference,
             getImageID(imageMetadata),
             imageMetadata["datasize"].GetString(),
             imageMetadata["created"].GetString(),
-            boost::filesystem::path{imageMetadata["imagePath"].GetString()},
-            boost::filesystem::path{imageMetadata["metadataPath"].GetString()}
+            checkBackingFile(getImageSquashfsFile(imageReference, imageTier), imageTier),
+            checkBackingFile(getImageMetadataFile(imageReference, metadataTier), metadataTier)
         };
+        image.lowerImageFiles = getLowerImageFiles(imageMetadata);
+        auto usage = getUsage(imageMetadata);
+        image.lastUsed = usage.lastUsed;
+        image.launchCount = usage.launchCount;
+        image.numberOfNodes = usage.nodes.size();
+        image.imageFileDigest = getImageFileDigest(imageMetadata);
         return image;
     }
 
@@ -283,12 +492,21 @@ namespace image_manager {
             ret.AddMember(  "metadataPath",
                             rj::Value{image.metadataFile.c_str(), allocator},
                             allocator);
+            if (!image.lowerImageFiles.empty()) {
+                ret.AddMember("lowerImagePaths", rj::Value{rj::kArrayType}, allocator);
+                for(const auto& file : image.lowerImageFiles) {
+                    ret["lowerImagePaths"].PushBack(rj::Value{file.c_str(), allocator}, allocator);
+                }
+            }
             ret.AddMember(  "datasize",
                             rj::Value{image.datasize.c_str(), allocator},
                             allocator);
             ret.AddMember(  "created",
                             rj::Value{image.created.c_str(), allocator},
                             allocator);
+            if (!image.imageFileDigest.empty()) {
+                ret.AddMember("imageFileDigest", rj::Value{image.imageFileDigest.c_str(), allocator}, allocator);
+            }
             return ret;
         }
         catch (const std::exception &e) {
@@ -296,6 +514,214 @@ namespace image_manager {
         }
     }
 
+    /**
+     * The "pullCount" property was introduced with the image tiers.
+     * Entries created by an earlier Sarus version count as pulled once.
+     */
+    std::uint64_t ImageStore::getPullCount(const rapidjson::Value& imageMetadata) const {
+        auto itr = imageMetadata.FindMember("pullCount");
+        if (itr != imageMetadata.MemberEnd() && itr->value.IsUint64()) {
+            return itr->value.GetUint64();
+        }
+        return 1;
+    }
+
+    /**
+     * The "imageFileDigest" property is set by "sarus broadcast" (see recordImageFileDigest()).
+     */
+    std::string ImageStore::getImageFileDigest(const rapidjson::Value& imageMetadata) const {
+        auto itr = imageMetadata.FindMember("imageFileDigest");
+        if (itr != imageMetadata.MemberEnd() && itr->value.IsString()) {
+            return itr->value.GetString();
+        }
+        return std::string{};
+    }
+
+    /**
+     * The "usage" property holds the statistics compacted from the access log (see access_log):
+     * {"lastUsed": <seconds since the epoch>, "launchCount": <launches>, "nodes": [<node>, ...]}.
+     * It is missing for the images never launched since the access log was introduced.
+     */
+    access_log::Usage ImageStore::getUsage(const rapidjson::Value& imageMetadata) const {
+        auto usage = access_log::Usage{};
+        auto itr = imageMetadata.FindMember("usage");
+        if (itr == imageMetadata.MemberEnd() || !itr->value.IsObject()) {
+            return usage;
+        }
+        const auto& json = itr->value;
+        if (json.HasMember("lastUsed") && json["lastUsed"].IsInt64()) {
+            usage.lastUsed = json["lastUsed"].GetInt64();
+        }
+        if (json.HasMember("launchCount") && json["launchCount"].IsUint64()) {
+            usage.launchCount = json["launchCount"].GetUint64();
+        }
+        if (json.HasMember("nodes") && json["nodes"].IsArray()) {
+            for(const auto& node : json["nodes"].GetArray()) {
+                usage.nodes.emplace_back(node.GetString());
+            }
+        }
+        return usage;
+    }
+
+    void ImageStore::setUsage(rapidjson::Value& imageMetadata, const access_log::Usage& usage,
+                              rapidjson::MemoryPoolAllocator<>& allocator) const {
+        auto json = rj::Value{rj::kObjectType};
+        json.AddMember("lastUsed", rj::Value{static_cast<std::int64_t>(usage.lastUsed)}, allocator);
+        json.AddMember("launchCount", rj::Value{usage.launchCount}, allocator);
+        auto nodes = rj::Value{rj::kArrayType};
+        for(const auto& node : usage.nodes) {
+            nodes.PushBack(rj::Value{node.c_str(), allocator}, allocator);
+        }
+        json.AddMember("nodes", nodes, allocator);
+        imageMetadata.RemoveMember("usage");
+        imageMetadata.AddMember("usage", json, allocator);
+    }
+
+    /**
+     * Appends a launch of the image to the access log of the repository. The repository metadata
+     * is not locked, thus launches never wait for the commands which update the repository.
+     * The records are compacted into the statistics of the images by listImages() and pruneImages(),
+     * or here once the log grew large, if the repository is not locked by another process.
+     */
+    void ImageStore::recordImageAccess(const common::ImageReference& reference) const {
+        access_log::appendRecord(accessLogFile, access_log::makeRecord(reference.getUniqueKey()));
+
+        boost::system::error_code ec;
+        auto size = boost::filesystem::file_size(accessLogFile, ec);
+        if (ec || size < accessLogCompactionThreshold) {
+            return;
+        }
+        try {
+            common::Lockfile lock{metadataFile, 0};
+            auto repositoryMetadata = readRepositoryMetadata();
+            compactAccessLog(repositoryMetadata);
+        }
+        catch (const std::exception& e) {
+            printLog(boost::format("Skipped compaction of image access log %s: %s") % accessLogFile % e.what(),
+                     common::LogLevel::DEBUG);
+        }
+    }
+
+    /**
+     * Records the digest of the image's squashfs file, computed by "sarus broadcast" while reading the
+     * file, so that "sarus run" only uses the node-local staged copies of the image which match it.
+     * The digest is not recorded if the image was replaced in the repository in the meantime, and it
+     * is dropped when the image is replaced later on.
+     */
+    void ImageStore::recordImageFileDigest(const common::ImageReference& reference, const std::string& imageID,
+                                           const std::string& digest) const {
+        common::Lockfile lock{metadataFile};
+        auto repositoryMetadata = readRepositoryMetadata();
+        auto& allocator = repositoryMetadata.GetAllocator();
+        for(auto& entry : repositoryMetadata["images"].GetArray()) {
+            if(entry["uniqueKey"].GetString() == reference.getUniqueKey() && getImageID(entry) == imageID) {
+                entry.RemoveMember("imageFileDigest");
+                entry.AddMember("imageFileDigest", rj::Value{digest.c_str(), allocator}, allocator);
+                atomicallyUpdateRepositoryMetadataFile(repositoryMetadata);
+                printLog(boost::format("Recorded digest %s of image %s") % digest % reference, common::LogLevel::DEBUG);
+                return;
+            }
+        }
+        printLog(boost::format("Not recording digest of image %s, which was replaced in the repository") % reference,
+                 common::LogLevel::INFO);
+    }
+
+    /**
+     * Merges the records of the access log into the statistics of the images and updates the
+     * repository metadata. Must be called with the repository metadata locked. The records of
+     * images which are not in the repository anymore are dropped.
+     * The repository metadata records the name of the last detached log it merged, in the same
+     * update as the statistics, thus the records of a compaction interrupted before the removal
+     * of the detached log are not merged twice.
+     */
+    void ImageStore::compactAccessLog(rapidjson::Document& repositoryMetadata) const {
+        auto detached = access_log::DetachedRecords{};
+        try {
+            detached = access_log::detachRecords(accessLogFile);
+        }
+        catch (const std::exception& e) {
+            auto message = boost::format("Failed to read image access log %s: %s") % accessLogFile % e.what();
+            printLog(message, common::LogLevel::WARN, std::cerr);
+            return;
+        }
+        const auto& records = detached.records;
+        auto detachedLogName = detached.file.filename().string();
+        auto marker = repositoryMetadata.FindMember("compactedAccessLog");
+        auto isMerged = marker != repositoryMetadata.MemberEnd()
+            && marker->value.IsString()
+            && marker->value.GetString() == detachedLogName;
+        if (records.empty() || isMerged) {
+            access_log::removeDetachedRecords(detached);
+            return;
+        }
+
+        auto entries = std::unordered_map<std::string, rj::Value*>{};
+        for(auto& entry : repositoryMetadata["images"].GetArray()) {
+            entries[entry["uniqueKey"].GetString()] = &entry;
+        }
+        auto usages = std::unordered_map<std::string, access_log::Usage>{};
+        for(const auto& record : records) {
+            auto entry = entries.find(record.uniqueKey);
+            if (entry == entries.cend()) {
+                continue;
+            }
+            auto usage = usages.find(record.uniqueKey);
+            if (usage == usages.cend()) {
+                usage = usages.emplace(record.uniqueKey, getUsage(*entry->second)).first;
+            }
+            access_log::mergeRecord(usage->second, record);
+        }
+
+        for(const auto& usage : usages) {
+            setUsage(*entries[usage.first], usage.second, repositoryMetadata.GetAllocator());
+        }
+        if (!usages.empty()) {
+            auto& allocator = repositoryMetadata.GetAllocator();
+            repositoryMetadata.RemoveMember("compactedAccessLog");
+            repositoryMetadata.AddMember("compactedAccessLog", rj::Value{detachedLogName.c_str(), allocator}, allocator);
+            atomicallyUpdateRepositoryMetadataFile(repositoryMetadata);
+        }
+        access_log::removeDetachedRecords(detached);
+
+        printLog(boost::format("Compacted %d records of image access log %s") % records.size() % accessLogFile,
+                 common::LogLevel::DEBUG);
+    }
+
+    /**
+     * The "lowerImagePaths" property is only present for the images stored as a delta
+     * of a previous image (see ImageDelta). The lower image files may be named after the
+     * unique key of another image (the base of the delta), thus their paths can't be derived
+     * like those of the other backing files: they are only accepted within a tier and with
+     * the name given by getLowerImageFile().
+     */
+    std::vector<boost::filesystem::path> ImageStore::getLowerImageFiles(const rapidjson::Value& imageMetadata) const {
+        auto files = std::vector<boost::filesystem::path>{};
+        auto itr = imageMetadata.FindMember("lowerImagePaths");
+        if (itr != imageMetadata.MemberEnd()) {
+            for(const auto& value : itr->value.GetArray()) {
+                auto file = boost::filesystem::path{value.GetString()};
+                if(!boost::algorithm::ends_with(file.filename().string(), ".lower.squashfs")) {
+                    auto message = boost::format("Invalid lower image file %s in repository metadata %s")
+                                   % file % metadataFile;
+                    SARUS_THROW_ERROR(message.str());
+                }
+                files.push_back(checkBackingFile(file, getTierOfBackingFile(file)));
+            }
+        }
+        return files;
+    }
+
+    void ImageStore::removeLowerImageFiles(const std::vector<boost::filesystem::path>& files) const {
+        for(const auto& file : files) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(file, ec);
+            if(ec) {
+                auto message = boost::format("Failed to remove lower image file %s: %s") % file % ec.message();
+                printLog(message, common::LogLevel::WARN, std::cerr);
+            }
+        }
+    }
+
     /**
      * Deletes an image entry from the repository's overall metadata.json
      * IMPORTANT: this function does not lock the metadata file on its own!
@@ -311,13 +737,156 @@ namespace image_manager {
      * Deletes the image's individual squashfs file and metadata file
      */
     void ImageStore::removeImageBackingFiles(const rapidjson::Value* imageMetadata) const {
-        auto imagePath = boost::filesystem::path{(*imageMetadata)["imagePath"].GetString()};
-        auto metadataPath = boost::filesystem::path{(*imageMetadata)["metadataPath"].GetString()};
-        boost::filesystem::remove_all(imagePath);
-        boost::filesystem::remove_all(metadataPath);
+        auto image = convertImageMetadataToSarusImage(*imageMetadata);
+        boost::filesystem::remove_all(image.imageFile);
+        boost::filesystem::remove_all(image.metadataFile);
+        boost::filesystem::remove(common::ImageFileIndex::getFileOfImage(image.imageFile));
+        for(const auto& file : image.lowerImageFiles) {
+            boost::filesystem::remove(file);
+        }
         printLog("Removed image backing files", common::LogLevel::DEBUG);
     }
 
+    /**
+     * Deletes the backing files of several images at once. The files are spread across the
+     * storage tiers and deleting them is dominated by the latency of the filesystems, thus
+     * the images are handled in parallel. Returns the error (if any) of each image.
+     */
+    std::vector<std::exception_ptr> ImageStore::removeImagesBackingFiles(const std::vector<const rapidjson::Value*>& imagesMetadata) const {
+        auto errors = std::vector<std::exception_ptr>(imagesMetadata.size());
+        std::atomic<std::size_t> nextImage{0};
+
+        auto removeImages = [&]() {
+            for(auto i = nextImage++; i < imagesMetadata.size(); i = nextImage++) {
+                try {
+                    removeImageBackingFiles(imagesMetadata[i]);
+                }
+                catch(...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        auto numberOfThreads = std::min<std::size_t>(common::getDefaultNumberOfRemovalThreads(), imagesMetadata.size());
+        auto threads = std::vector<std::thread>{};
+        for(std::size_t i=1; i<numberOfThreads; ++i) {
+            threads.emplace_back(removeImages);
+        }
+        removeImages();
+        for(auto& thread : threads) {
+            thread.join();
+        }
+
+        return errors;
+    }
+
+    /**
+     * Deletes the backing files and then the repository metadata entries of the images, updating
+     * the repository metadata file once. The entries of the images whose backing files could not
+     * be removed are kept.
+     * IMPORTANT: this function does not lock the metadata file on its own!
+     *            Use this function from a caller performing the lock!
+     */
+    void ImageStore::removeImagesFromRepository(const std::vector<const rapidjson::Value*>& imagesMetadata,
+                                                rapidjson::Document& repositoryMetadata) const {
+        if(imagesMetadata.empty()) {
+            return;
+        }
+
+        // Attempting to remove backing files first so that, if something goes wrong on metadata removal,
+        // the orphaned metadata have more chance to be cleaned during a subsequent "sarus images" or "sarus run" command.
+        // If we remove metadata first and something goes wrong on backing files removal
+        // there would be no data-driven way to reach the orphaned files, which would just lie in the filesystem occupying space.
+        auto errors = removeImagesBackingFiles(imagesMetadata);
+
+        auto removedKeys = std::vector<std::string>{};
+        auto failure = std::exception_ptr{};
+        auto failedImage = std::string{};
+        for(std::size_t i=0; i<imagesMetadata.size(); ++i) {
+            if(errors[i]) {
+                failure = errors[i];
+                failedImage = getImageReference(*imagesMetadata[i]).string();
+            }
+            else {
+                removedKeys.push_back((*imagesMetadata[i])["uniqueKey"].GetString());
+            }
+        }
+
+        // the pointers to the entries are invalidated by the first erasure: match them by key
+        auto& images = repositoryMetadata["images"];
+        for(auto it = images.Begin(); it != images.End(); ) {
+            if(std::find(removedKeys.cbegin(), removedKeys.cend(), (*it)["uniqueKey"].GetString()) != removedKeys.cend()) {
+                it = images.Erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        try {
+            if(!removedKeys.empty()) {
+                atomicallyUpdateRepositoryMetadataFile(repositoryMetadata);
+                printLog(boost::format("Removed %d image entries from repository metadata") % removedKeys.size(),
+                         common::LogLevel::DEBUG);
+            }
+            if(failure) {
+                std::rethrow_exception(failure);
+            }
+        }
+        catch(std::exception& e) {
+            auto message = failure ? boost::format("Failed to remove image %s") % failedImage
+                                   : boost::format("Failed to remove images");
+            SARUS_RETHROW_ERROR(e, message.str());
+        }
+    }
+
+    /**
+     * The "created" property holds the local time of the pull/load, as written by
+     * common::SarusImage::createTimeString
+     */
+    bool ImageStore::matchesPruneFilter(const rapidjson::Value& imageMetadata, const PruneFilter& filter) const {
+        if(!filter.createdBefore && !filter.lastUsedBefore && !filter.referencePattern) {
+            return false;
+        }
+
+        if(filter.createdBefore) {
+            auto tm = std::tm{};
+            if(strptime(imageMetadata["created"].GetString(), "%Y-%m-%dT%H:%M:%S", &tm) == nullptr) {
+                return false;
+            }
+            tm.tm_isdst = -1;
+            if(!(mktime(&tm) < *filter.createdBefore)) {
+                return false;
+            }
+        }
+
+        if(filter.lastUsedBefore) {
+            // the squashfs file is written by the pull (or migration) and read by each mount:
+            // take the latest of the two, as the access time is not updated on every read
+            // (e.g. "relatime") and not at all on filesystems mounted with "noatime".
+            // The launches recorded in the access log are more reliable, but only cover the
+            // launches since the log was introduced
+            struct stat sb;
+            if(stat(imageMetadata["imagePath"].GetString(), &sb) != 0) {
+                return false;
+            }
+            auto lastUsed = std::max({sb.st_atime, sb.st_mtime, getUsage(imageMetadata).lastUsed});
+            if(!(lastUsed < *filter.lastUsedBefore)) {
+                return false;
+            }
+        }
+
+        if(filter.referencePattern) {
+            auto reference = convertImageMetadataToSarusImage(imageMetadata).reference;
+            auto name = reference.tag.empty() ? reference.getFullName() : reference.getFullName() + ":" + reference.tag;
+            if(fnmatch(filter.referencePattern->c_str(), name.c_str(), 0) != 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     /**
      * Atomically update the repository's metadata file. Creates a temporary metadata file
      * and then atomically creates/replaces the actual metadata file by renaming the
@@ -340,14 +909,314 @@ namespace image_manager {
         printLog( boost::format("Success to update metadata: %s") % metadataFile, common::LogLevel::DEBUG);
     }
 
+    /**
+     * The index of the image's files is optional (e.g. missing for images pulled by older versions of
+     * Sarus): it follows the squashfs file on a best-effort basis, without failing the migration.
+     */
+    void ImageStore::migrateImageFileIndex(const boost::filesystem::path& oldImageFile,
+                                           const boost::filesystem::path& newImageFile) const {
+        auto oldIndexFile = common::ImageFileIndex::getFileOfImage(oldImageFile);
+        auto newIndexFile = common::ImageFileIndex::getFileOfImage(newImageFile);
+        if(!boost::filesystem::exists(oldIndexFile)) {
+            return;
+        }
+        try {
+            copyFileToTier(oldIndexFile, newIndexFile);
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to migrate index of the image's files %s: %s") % oldIndexFile % e.what();
+            printLog(message, common::LogLevel::WARN, std::cerr);
+        }
+        boost::system::error_code ec;
+        boost::filesystem::remove(oldIndexFile, ec);
+    }
+
     boost::filesystem::path ImageStore::getImageSquashfsFile(const common::ImageReference& reference) const {
-        auto relativePath = reference.getUniqueKey() + ".squashfs";
-        return imagesDirectory / relativePath;
+        return getImageSquashfsFile(reference, getTier("default"));
     }
 
     boost::filesystem::path ImageStore::getImageMetadataFile(const common::ImageReference& reference) const {
+        return getImageMetadataFile(reference, getTier("default"));
+    }
+
+    boost::filesystem::path ImageStore::getImageSquashfsFile(const common::ImageReference& reference, const Tier& tier) const {
+        auto relativePath = reference.getUniqueKey() + ".squashfs";
+        return tier.imagesDirectory / relativePath;
+    }
+
+    boost::filesystem::path ImageStore::getImageMetadataFile(const common::ImageReference& reference, const Tier& tier) const {
         auto relativePath = reference.getUniqueKey() + ".meta";
-        return imagesDirectory / relativePath;
+        return tier.imagesDirectory / relativePath;
+    }
+
+    /**
+     * The file through which a delta image keeps the squashfs file of the image it is based on,
+     * next to the squashfs file of the delta image. The name is unique within the lower images
+     * of the delta image, since each image of the stack has more layers (thus a different ID)
+     * than the images below it.
+     */
+    boost::filesystem::path ImageStore::getLowerImageFile(const common::SarusImage& image) const {
+        auto file = image.imageFile;
+        return file.replace_extension("." + image.id.substr(0, 12) + ".lower.squashfs");
+    }
+
+    /**
+     * Returns the tier whose directory contains the given backing file, without resolving the
+     * path: the caller derives the actual path of the file from the returned tier.
+     */
+    const ImageStore::Tier& ImageStore::getTierOfBackingFile(const boost::filesystem::path& file) const {
+        auto it = std::find_if(tiers.cbegin(), tiers.cend(), [&file](const Tier& tier) {
+            return isWithinDirectory(file, tier.imagesDirectory);
+        });
+        if(it == tiers.cend()) {
+            auto message = boost::format("Backing file %s in repository metadata %s is not stored"
+                                         " in any of the configured image tiers") % file % metadataFile;
+            SARUS_THROW_ERROR(message.str());
+        }
+        return *it;
+    }
+
+    /**
+     * Checks that the backing file stays within the tier also once resolved (e.g. through symlinks
+     * or "..", which may come from the unique key of the image). A missing file is accepted, since
+     * it is reported by hasImageBackingFiles().
+     */
+    boost::filesystem::path ImageStore::checkBackingFile(const boost::filesystem::path& file, const Tier& tier) const {
+        auto isWithinTier = isWithinDirectory(file, tier.imagesDirectory);
+        boost::system::error_code ec;
+        auto realFile = boost::filesystem::canonical(file, ec);
+        if(isWithinTier && !ec) {
+            isWithinTier = isWithinDirectory(realFile, boost::filesystem::canonical(tier.imagesDirectory));
+        }
+        if(!isWithinTier) {
+            auto message = boost::format("Backing file %s resolves outside of the directory %s of image tier '%s'")
+                           % file % tier.imagesDirectory % tier.name;
+            SARUS_THROW_ERROR(message.str());
+        }
+        return file;
+    }
+
+    bool ImageStore::isWithinDirectory(const boost::filesystem::path& file, const boost::filesystem::path& directory) {
+        if(!file.is_absolute()) {
+            return false;
+        }
+        for(const auto& element : file) {
+            if(element == "." || element == "..") {
+                return false;
+            }
+        }
+        auto relativePath = file.lexically_relative(directory);
+        return !relativePath.empty() && relativePath != "." && *relativePath.begin() != "..";
+    }
+
+    const ImageStore::Tier& ImageStore::getTier(const std::string& name) const {
+        auto it = std::find_if(tiers.cbegin(), tiers.cend(), [&name](const Tier& tier) {
+            return tier.name == name;
+        });
+        if(it == tiers.cend()) {
+            auto names = std::vector<std::string>{};
+            for(const auto& tier : tiers) {
+                names.push_back(tier.name);
+            }
+            auto message = boost::format("Image tier '%s' is not available. Available tiers: %s")
+                % name % boost::algorithm::join(names, ", ");
+            SARUS_THROW_ERROR(message.str());
+        }
+        return *it;
+    }
+
+    /**
+     * Selects the tier where a new image is stored: the first configured tier whose size and pull
+     * frequency constraints are satisfied by the image, or the default tier if none of them fits.
+     * The pull count includes the pull/load about to be performed.
+     */
+    const ImageStore::Tier& ImageStore::selectTier(const common::ImageReference& reference,
+                                                   std::uint64_t estimatedImageSize) const {
+        auto pullCount = std::uint64_t{1};
+        if(tiers.size() > 1) {
+            common::Lockfile lock{metadataFile};
+            auto repositoryMetadata = readRepositoryMetadata();
+            if(auto imageMetadata = findImageMetadata(reference, repositoryMetadata)) {
+                pullCount = getPullCount(*imageMetadata) + 1;
+            }
+        }
+
+        for(const auto& tier : tiers) {
+            if(tier.maxImageSize && estimatedImageSize > *tier.maxImageSize) {
+                continue;
+            }
+            if(tier.minPullCount && pullCount < *tier.minPullCount) {
+                continue;
+            }
+            printLog(boost::format("Selected image tier '%s' for image %s (estimated size: %d bytes, pull count: %d)")
+                     % tier.name % reference % estimatedImageSize % pullCount,
+                     common::LogLevel::INFO);
+            return tier;
+        }
+        return tiers.back();
+    }
+
+    /**
+     * Moves the backing files of an image to another tier. The files are first copied next to their
+     * final location in the target tier and flushed to disk, without holding the lock of the repository
+     * since copying a large image takes long. The repository is then locked only to check that the
+     * image didn't change in the meantime, to atomically rename the copies into place and to update
+     * the metadata, thus other Sarus processes either see the image in the old tier or in the new one.
+     */
+    void ImageStore::migrateImage(const common::ImageReference& reference, const std::string& tierName) const {
+        printLog(boost::format("Attempting to migrate image %s to tier '%s'") % reference % tierName,
+                 common::LogLevel::INFO);
+        const auto& targetTier = getTier(tierName);
+
+        auto findImageToMigrate = [this, &reference](const rj::Document& repositoryMetadata) {
+            auto imageMetadata = findImageMetadata(reference, repositoryMetadata);
+            if (!imageMetadata || !hasImageBackingFiles(*imageMetadata)) {
+                auto message = boost::format("Cannot find image '%s'") % reference;
+                printLog(message, common::LogLevel::GENERAL, std::cerr);
+                SARUS_THROW_ERROR(message.str(), common::LogLevel::INFO);
+            }
+            return convertImageMetadataToSarusImage(*imageMetadata);
+        };
+
+        auto image = findImageToMigrate(readRepositoryMetadata());
+        auto newImageFile = getImageSquashfsFile(image.reference, targetTier);
+        if (image.imageFile == newImageFile) {
+            printLog(boost::format("Image %s is already stored in tier '%s'") % reference % targetTier.name,
+                     common::LogLevel::GENERAL);
+            return;
+        }
+
+        auto oldFiles = std::vector<boost::filesystem::path>{image.imageFile, image.metadataFile};
+        oldFiles.insert(oldFiles.end(), image.lowerImageFiles.cbegin(), image.lowerImageFiles.cend());
+        auto newFiles = std::vector<boost::filesystem::path>{newImageFile, getImageMetadataFile(image.reference, targetTier)};
+        for(const auto& file : image.lowerImageFiles) {
+            newFiles.push_back(newImageFile.parent_path() / file.filename());
+        }
+
+        auto copies = std::vector<common::PathRAII>{};
+        auto movedCopies = std::vector<common::PathRAII>{};
+        try {
+            for(std::size_t i=0; i<oldFiles.size(); ++i) {
+                copies.push_back(copyFileToTemporaryFile(oldFiles[i], newFiles[i]));
+            }
+
+            common::Lockfile lock{metadataFile};
+            auto repositoryMetadata = readRepositoryMetadata();
+            auto currentImage = findImageToMigrate(repositoryMetadata);
+            if(currentImage.id != image.id
+               || currentImage.imageFile != image.imageFile
+               || currentImage.lowerImageFiles != image.lowerImageFiles) {
+                SARUS_THROW_ERROR("the image was replaced or migrated by another Sarus process in the meantime");
+            }
+
+            for(std::size_t i=0; i<copies.size(); ++i) {
+                boost::filesystem::rename(copies[i].getPath(), newFiles[i]); // atomically create/replace file
+                copies[i].release();
+                movedCopies.emplace_back(newFiles[i]);
+            }
+
+            auto& allocator = repositoryMetadata.GetAllocator();
+            for(auto& entry : repositoryMetadata["images"].GetArray()) {
+                if(entry["uniqueKey"].GetString() == image.reference.getUniqueKey()) {
+                    entry["imagePath"].SetString(newFiles[0].c_str(), allocator);
+                    entry["metadataPath"].SetString(newFiles[1].c_str(), allocator);
+                    if(entry.HasMember("lowerImagePaths")) {
+                        entry["lowerImagePaths"].SetArray();
+                        for(std::size_t i=2; i<newFiles.size(); ++i) {
+                            entry["lowerImagePaths"].PushBack(rj::Value{newFiles[i].c_str(), allocator}, allocator);
+                        }
+                    }
+                }
+            }
+            atomicallyUpdateRepositoryMetadataFile(repositoryMetadata);
+        }
+        catch(std::exception& e) {
+            auto message = boost::format("Failed to migrate image %s to tier '%s'") % reference % targetTier.name;
+            SARUS_RETHROW_ERROR(e, message.str());
+        }
+        for(auto& file : movedCopies) {
+            file.release();
+        }
+        migrateImageFileIndex(image.imageFile, newImageFile);
+
+        // containers still using the old backing file keep it open until they terminate
+        for(const auto& oldFile : oldFiles) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(oldFile, ec);
+            if(ec) {
+                auto message = boost::format("Failed to remove old backing file %s: %s") % oldFile % ec.message();
+                printLog(message, common::LogLevel::WARN, std::cerr);
+            }
+        }
+
+        printLog(boost::format("Migrated image %s to tier '%s'") % reference % targetTier.name,
+                 common::LogLevel::GENERAL);
+    }
+
+    void ImageStore::copyFileToTier(const boost::filesystem::path& source, const boost::filesystem::path& destination) const {
+        auto temp = copyFileToTemporaryFile(source, destination);
+        boost::filesystem::rename(temp.getPath(), destination); // atomically create/replace file
+        temp.release();
+    }
+
+    /**
+     * Copies the file next to the destination, under a temporary name, and makes sure that
+     * the data hit the disk before the file becomes visible under its final name.
+     */
+    common::PathRAII ImageStore::copyFileToTemporaryFile(const boost::filesystem::path& source,
+                                                         const boost::filesystem::path& destination) const {
+        auto temp = common::PathRAII{common::makeUniquePathWithRandomSuffix(destination)};
+        common::copyFile(source, temp.getPath(), uid, gid);
+
+        auto fd = open(temp.getPath().c_str(), O_RDONLY);
+        if(fd < 0 || fsync(fd) != 0) {
+            auto message = boost::format("Failed to flush %s to disk: %s") % temp.getPath() % strerror(errno);
+            if(fd >= 0) {
+                close(fd);
+            }
+            SARUS_THROW_ERROR(message.str());
+        }
+        close(fd);
+        return temp;
+    }
+
+    void ImageStore::initializeTiers(const common::Config& config) {
+        if(const auto* tiersJSON = rj::Pointer("/imageTiers").Get(config.json)) {
+            for(const auto& tierJSON : tiersJSON->GetArray()) {
+                auto tier = Tier{};
+                tier.name = tierJSON["name"].GetString();
+                if(tier.name == "default" || std::any_of(tiers.cbegin(), tiers.cend(),
+                                                         [&tier](const Tier& t){ return t.name == tier.name; })) {
+                    auto message = boost::format("Invalid image tier name '%s' in configuration:"
+                                                 " tier names must be unique and different from 'default'") % tier.name;
+                    SARUS_THROW_ERROR(message.str());
+                }
+
+                if(config.useCentralizedRepository) {
+                    auto itr = tierJSON.FindMember("centralizedRepositoryDir");
+                    if(itr == tierJSON.MemberEnd()) {
+                        continue; // tier not available to the centralized repository
+                    }
+                    tier.imagesDirectory = boost::filesystem::path{itr->value.GetString()} / "images";
+                }
+                else {
+                    auto baseDir = boost::filesystem::path{tierJSON["localRepositoryBaseDir"].GetString()};
+                    tier.imagesDirectory = common::getLocalRepositoryDirectory(baseDir, config) / "images";
+                }
+
+                auto itr = tierJSON.FindMember("maxImageSize");
+                if(itr != tierJSON.MemberEnd()) {
+                    tier.maxImageSize = itr->value.GetUint64();
+                }
+                itr = tierJSON.FindMember("minPullCount");
+                if(itr != tierJSON.MemberEnd()) {
+                    tier.minPullCount = itr->value.GetUint64();
+                }
+                tiers.push_back(tier);
+            }
+        }
+
+        tiers.push_back(Tier{"default", imagesDirectory, {}, {}});
     }
 
     void ImageStore::printLog(const boost::format& message, common::LogLevel LogLevel,
@@ -12,43 +12,110 @@
 #define sarus_image_manager_ImageStore_hpp
 
 #include <time.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <exception>
 #include <vector>
 #include <string>
 #include <memory>
 
+#include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 #include <rapidjson/document.h>
 
 #include "common/Config.hpp"
+#include "common/PathRAII.hpp"
 #include "common/SarusImage.hpp"
+#include "image_manager/ImageAccessLog.hpp"
 
 
 namespace sarus {
 namespace image_manager {
 
+/**
+ * Manages the images of a repository. The repository metadata file is the single index of the
+ * images, while their backing files can be spread across several storage tiers (e.g. a fast flash
+ * filesystem and a large capacity filesystem) configured with the "imageTiers" parameter.
+ * The images directory of the repository itself is always available as the "default" tier.
+ */
 class ImageStore {
+public:
+    struct Tier {
+        std::string name;
+        boost::filesystem::path imagesDirectory;
+        boost::optional<std::uint64_t> maxImageSize;
+        boost::optional<std::uint64_t> minPullCount;
+    };
+
+    /**
+     * Selects the images removed by pruneImages(): an image is selected when it matches all the
+     * criteria which are set, while no image is selected when none is set.
+     */
+    struct PruneFilter {
+        boost::optional<time_t> createdBefore;
+        boost::optional<time_t> lastUsedBefore; // last launch recorded in the access log, or access time
+                                                // of the squashfs file (i.e. the last mount) if later
+        boost::optional<std::string> referencePattern; // shell wildcard pattern matched against "server/namespace/image:tag"
+    };
+
 public:
     ImageStore(std::shared_ptr<const common::Config>);
 
     void addImage(const common::SarusImage&) const;
     void removeImage(const common::ImageReference&) const;
+    void removeImages(const std::vector<common::ImageReference>&) const;
+    std::vector<common::SarusImage> pruneImages(const PruneFilter&) const;
+    std::vector<boost::filesystem::path> removeOrphanedTemporaryFiles(time_t modifiedBefore) const;
+    std::vector<boost::filesystem::path> removeUnreferencedFileStoreObjects(time_t modifiedBefore) const;
     std::vector<common::SarusImage> listImages() const;
     boost::optional<common::SarusImage> findImage(const common::ImageReference& reference) const;
+    void recordImageAccess(const common::ImageReference& reference) const;
+    void recordImageFileDigest(const common::ImageReference& reference, const std::string& imageID,
+                               const std::string& digest) const;
     const boost::filesystem::path& getRepositoryMetadataFile() const { return metadataFile; }
     std::string getImageID(const rapidjson::Value& imageMetadata) const;
     std::string getRegistryDigest(const rapidjson::Value& imageMetadata) const;
     boost::filesystem::path getImageSquashfsFile(const common::ImageReference& reference) const;
     boost::filesystem::path getImageMetadataFile(const common::ImageReference& reference) const;
+    boost::filesystem::path getImageSquashfsFile(const common::ImageReference& reference, const Tier& tier) const;
+    boost::filesystem::path getImageMetadataFile(const common::ImageReference& reference, const Tier& tier) const;
+    boost::filesystem::path getLowerImageFile(const common::SarusImage& image) const;
+    const std::vector<Tier>& getTiers() const { return tiers; }
+    const Tier& getTier(const std::string& name) const;
+    const Tier& selectTier(const common::ImageReference& reference, std::uint64_t estimatedImageSize) const;
+    void migrateImage(const common::ImageReference& reference, const std::string& tierName) const;
 
 private:
     rapidjson::Document readRepositoryMetadata() const;
     const rapidjson::Value* findImageMetadata(const common::ImageReference& reference, const rapidjson::Document& metadata) const;
     void atomicallyUpdateRepositoryMetadataFile(const rapidjson::Value& metadata) const;
     rapidjson::Value createImageJSON(const common::SarusImage&, rapidjson::MemoryPoolAllocator<>& allocator) const;
+    common::ImageReference getImageReference(const rapidjson::Value& imageMetadata) const;
     common::SarusImage convertImageMetadataToSarusImage(const rapidjson::Value& imageMetadata) const;
     bool hasImageBackingFiles(const rapidjson::Value& imageMetadata) const;
     void removeImageBackingFiles(const rapidjson::Value* imageMetadata) const;
+    std::vector<std::exception_ptr> removeImagesBackingFiles(const std::vector<const rapidjson::Value*>& imagesMetadata) const;
+    void removeImagesFromRepository(const std::vector<const rapidjson::Value*>& imagesMetadata,
+                                    rapidjson::Document& repositoryMetadata) const;
+    bool matchesPruneFilter(const rapidjson::Value& imageMetadata, const PruneFilter& filter) const;
     void removeRepositoryMetadataEntry(const rapidjson::Value* imageMetadata, rapidjson::Document& repositoryMetadata) const;
+    std::uint64_t getPullCount(const rapidjson::Value& imageMetadata) const;
+    std::string getImageFileDigest(const rapidjson::Value& imageMetadata) const;
+    access_log::Usage getUsage(const rapidjson::Value& imageMetadata) const;
+    void setUsage(rapidjson::Value& imageMetadata, const access_log::Usage& usage,
+                  rapidjson::MemoryPoolAllocator<>& allocator) const;
+    void compactAccessLog(rapidjson::Document& repositoryMetadata) const;
+    std::vector<boost::filesystem::path> getLowerImageFiles(const rapidjson::Value& imageMetadata) const;
+    void removeLowerImageFiles(const std::vector<boost::filesystem::path>& files) const;
+    void initializeTiers(const common::Config& config);
+    const Tier& getTierOfBackingFile(const boost::filesystem::path& file) const;
+    boost::filesystem::path checkBackingFile(const boost::filesystem::path& file, const Tier& tier) const;
+    static bool isWithinDirectory(const boost::filesystem::path& file, const boost::filesystem::path& directory);
+    void copyFileToTier(const boost::filesystem::path& source, const boost::filesystem::path& destination) const;
+    common::PathRAII copyFileToTemporaryFile(const boost::filesystem::path& source,
+                                             const boost::filesystem::path& destination) const;
+    void migrateImageFileIndex(const boost::filesystem::path& oldImageFile,
+                               const boost::filesystem::path& newImageFile) const;
     void printLog(const boost::format& message, common::LogLevel LogLevel,
                   std::ostream& out = std::cout, std::ostream& err = std::cerr) const;
     void printLog(const std::string& message, common::LogLevel LogLevel,
@@ -58,6 +125,10 @@ private:
     const std::string sysname = "ImageStore"; // system name for logger
     boost::filesystem::path imagesDirectory;
     boost::filesystem::path metadataFile;
+    boost::filesystem::path accessLogFile;
+    std::vector<Tier> tiers;
+    uid_t uid;
+    gid_t gid;
 };
 
 } // namespace
@@ -10,7 +10,10 @@
 
 #include "OCIImage.hpp"
 
+#include <boost/format.hpp>
+
 #include "common/PathRAII.hpp"
+#include "common/Sha256.hpp"
 #include "common/Utility.hpp"
 #include "image_manager/Utility.hpp"
 #include "image_manager/UmociDriver.hpp"
@@ -32,9 +35,15 @@ OCIImage::OCIImage(std::shared_ptr<const common::Config> config, const boost::fi
 
     std::string manifestDigest = imageIndex["manifests"][0]["digest"].GetString();
     log(boost::format("Found manifest digest: %s") % manifestDigest, common::LogLevel::DEBUG);
-    auto manifestHash = manifestDigest.substr(manifestDigest.find(":")+1);
+    manifestHash = manifestDigest.substr(manifestDigest.find(":")+1);
     auto imageManifest = common::readJSON(imageDir.getPath() / "blobs/sha256" / manifestHash);
 
+    // the compressed size of the layers approximates the size of the squashfs file
+    for(const auto& layer : imageManifest["layers"].GetArray()) {
+        layers.push_back(layer["digest"].GetString());
+        layersSize += layer["size"].GetUint64();
+    }
+
     std::string configDigest = imageManifest["config"]["digest"].GetString();
     log(boost::format("Found config digest: %s") % configDigest, common::LogLevel::DEBUG);
     auto configHash = configDigest.substr(configDigest.find(":")+1);
@@ -44,18 +53,92 @@ OCIImage::OCIImage(std::shared_ptr<const common::Config> config, const boost::fi
     imageID = configHash;
 }
 
-common::PathRAII OCIImage::unpack() const {
-    log(boost::format("> unpacking OCI image"), common::LogLevel::GENERAL);
+common::PathRAII OCIImage::unpack(std::size_t firstLayer,
+                                  const std::function<void(const boost::filesystem::path&)>& prepareUnpackDirectory) const {
+    if(firstLayer == 0) {
+        log(boost::format("> unpacking OCI image"), common::LogLevel::GENERAL);
+    }
+    else {
+        log(boost::format("> unpacking the last %d of the %d layers of the OCI image")
+            % (layers.size() - firstLayer) % layers.size(), common::LogLevel::GENERAL);
+    }
 
     auto unpackDir = common::PathRAII{makeTemporaryUnpackDirectory()};
+    // removing a large unpacked tree can take minutes: don't make the user wait for it
+    auto trashDir = config->directories.temp / ("sarus-trash-" + std::to_string(config->userIdentity.uid));
+    unpackDir.setDeferredRemoval(trashDir);
+
+    if(prepareUnpackDirectory) {
+        prepareUnpackDirectory(unpackDir.getPath());
+    }
 
     auto umociDriver = UmociDriver{config};
-    umociDriver.unpack(imageDir.getPath(), unpackDir.getPath());
+    if(firstLayer == 0) {
+        umociDriver.unpack(imageDir.getPath(), unpackDir.getPath());
+    }
+    else {
+        umociDriver.unpack(imageDir.getPath(), unpackDir.getPath(), addManifestOfLayers(firstLayer));
+    }
 
     log(boost::format("Successfully unpacked OCI image"), common::LogLevel::INFO);
     return unpackDir;
 }
 
+/**
+ * Adds to the OCI image layout a manifest (and a config) with the layers of the image
+ * from firstLayer on, so that umoci can unpack them alone. Returns the reference of the
+ * new manifest.
+ */
+std::string OCIImage::addManifestOfLayers(std::size_t firstLayer) const {
+    if(firstLayer >= layers.size()) {
+        auto message = boost::format("Failed to select layers of OCI image: the image has only %d layers") % layers.size();
+        SARUS_THROW_ERROR(message.str());
+    }
+    const auto reference = std::string{"sarus-oci-image-layers"};
+
+    auto imageManifest = common::readJSON(imageDir.getPath() / "blobs/sha256" / manifestHash);
+    std::string configDigest = imageManifest["config"]["digest"].GetString();
+    auto imageConfig = common::readJSON(imageDir.getPath() / "blobs/sha256" / configDigest.substr(configDigest.find(":")+1));
+
+    // umoci checks that the layers match the diff IDs of the config
+    auto& manifestLayers = imageManifest["layers"];
+    manifestLayers.Erase(manifestLayers.Begin(), manifestLayers.Begin() + firstLayer);
+    auto& diffIDs = imageConfig["rootfs"]["diff_ids"];
+    diffIDs.Erase(diffIDs.Begin(), diffIDs.Begin() + firstLayer);
+    imageConfig.RemoveMember("history");
+
+    auto& allocator = imageManifest.GetAllocator();
+    imageManifest["config"]["digest"].SetString(writeBlob(imageConfig).c_str(), allocator);
+    imageManifest["config"]["size"].SetUint64(common::getFileSize(imageDir.getPath() / "blobs/sha256"
+        / std::string{imageManifest["config"]["digest"].GetString()}.substr(7)));
+
+    auto imageIndex = common::readJSON(imageDir.getPath() / "index.json");
+    auto& indexAllocator = imageIndex.GetAllocator();
+    auto descriptor = rapidjson::Value{imageIndex["manifests"][0], indexAllocator};
+    auto manifestDigest = writeBlob(imageManifest);
+    descriptor["digest"].SetString(manifestDigest.c_str(), indexAllocator);
+    descriptor["size"].SetUint64(common::getFileSize(imageDir.getPath() / "blobs/sha256" / manifestDigest.substr(7)));
+    descriptor.RemoveMember("annotations");
+    descriptor.AddMember("annotations", rapidjson::Value{rapidjson::kObjectType}, indexAllocator);
+    descriptor["annotations"].AddMember("org.opencontainers.image.ref.name",
+                                        rapidjson::Value{reference.c_str(), indexAllocator},
+                                        indexAllocator);
+    imageIndex["manifests"].PushBack(descriptor, indexAllocator);
+    common::writeJSON(imageIndex, imageDir.getPath() / "index.json");
+
+    return reference;
+}
+
+// returns the digest of the blob
+std::string OCIImage::writeBlob(const rapidjson::Value& json) const {
+    auto temporaryFile = common::PathRAII{common::makeUniquePathWithRandomSuffix(imageDir.getPath() / "blobs/sha256/blob")};
+    common::writeJSON(json, temporaryFile.getPath(), false);
+    auto hash = common::Sha256::digestOfFile(temporaryFile.getPath());
+    boost::filesystem::rename(temporaryFile.getPath(), imageDir.getPath() / "blobs/sha256" / hash);
+    temporaryFile.release();
+    return "sha256:" + hash;
+}
+
 boost::filesystem::path OCIImage::makeTemporaryUnpackDirectory() const {
     auto tempUnpackDir = common::makeUniquePathWithRandomSuffix(config->directories.temp / "unpack-directory");
     try {
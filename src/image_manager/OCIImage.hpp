@@ -12,6 +12,10 @@
 #define sarus_image_manger_OCIImage_hpp
 
 #include <memory>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 #include "common/Config.hpp"
@@ -25,13 +29,19 @@ namespace image_manager {
 class OCIImage {
 public:
     OCIImage(std::shared_ptr<const common::Config> config, const boost::filesystem::path& imagePath);
-    common::PathRAII unpack() const;
+    // the layers before firstLayer are skipped, prepareUnpackDirectory is called before unpacking
+    common::PathRAII unpack(std::size_t firstLayer = 0,
+                            const std::function<void(const boost::filesystem::path&)>& prepareUnpackDirectory = {}) const;
     std::string getImageID() const {return imageID;};
+    std::uint64_t getLayersSize() const {return layersSize;};
+    const std::vector<std::string>& getLayers() const {return layers;};
     common::ImageMetadata getMetadata() const {return metadata;};
     void release();
 
 private:
     boost::filesystem::path makeTemporaryUnpackDirectory() const;
+    std::string addManifestOfLayers(std::size_t firstLayer) const;
+    std::string writeBlob(const rapidjson::Value& json) const;
     void log(const boost::format &message, common::LogLevel,
              std::ostream& outStream=std::cout, std::ostream& errStream=std::cerr) const;
     void log(const std::string& message, common::LogLevel,
@@ -42,6 +52,9 @@ private:
     common::PathRAII imageDir;
     common::ImageMetadata metadata;
     std::string imageID;
+    std::string manifestHash;
+    std::vector<std::string> layers; // digests of the compressed layers
+    std::uint64_t layersSize = 0;
 };
 
 }
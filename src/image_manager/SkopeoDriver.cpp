@@ -14,9 +14,11 @@
 
 #include <rapidjson/document.h>
 #include <boost/regex.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
 #include "common/Error.hpp"
+#include "common/Metrics.hpp"
 #include "common/PathRAII.hpp"
 #include "common/Utility.hpp"
 #include "image_manager/Utility.hpp"
@@ -102,7 +104,13 @@ boost::filesystem::path SkopeoDriver::copyToOCIImage(const std::string& sourceTr
         printLog( boost::format("Symlinking blob cache %s to %s") % cachePath % imageBlobsPath, common::LogLevel::DEBUG);
     }
 
+    // When the source is a stream (e.g. a named pipe or the standard input), Skopeo buffers
+    // the parts of the archive it cannot seek into temporary files: point them to the Sarus
+    // temporary directory instead of the default system-wide location
     auto args = generateBaseArgs();
+    if (isStream(sourceTransport, sourceReference)) {
+        args += common::CLIArguments{"--tmpdir", tempDir.string()};
+    }
     args.push_back("copy");
     if (!authFilePath.empty()){
         args += common::CLIArguments{"--src-authfile", authFilePath.string()};
@@ -120,6 +128,7 @@ boost::filesystem::path SkopeoDriver::copyToOCIImage(const std::string& sourceTr
 
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / double(1000);
     printLog(boost::format("Elapsed time on copy operation: %s [sec]") % elapsed, common::LogLevel::INFO);
+    common::Metrics::getInstance().observe("sarus_image_phase", elapsed, {{"phase", "copy"}});
     printLog(boost::format("Successfully created OCI image"), common::LogLevel::INFO);
 
     ociImageRAII.release();
@@ -290,6 +299,13 @@ common::CLIArguments SkopeoDriver::getRegistriesDOption() const {
     return common::CLIArguments{};
 }
 
+bool SkopeoDriver::isStream(const std::string& transport, const std::string& reference) const {
+    if (!boost::algorithm::ends_with(transport, "-archive")) {
+        return false;
+    }
+    return boost::filesystem::status(reference).type() == boost::filesystem::fifo_file;
+}
+
 std::string SkopeoDriver::getTransportString(const std::string& transport) const {
     if (transport == std::string{"docker"}) {
         return std::string{"docker://"};
@@ -297,6 +313,9 @@ std::string SkopeoDriver::getTransportString(const std::string& transport) const
     else if (transport == std::string{"docker-archive"}) {
         return std::string{"docker-archive:"};
     }
+    else if (transport == std::string{"oci-archive"}) {
+        return std::string{"oci-archive:"};
+    }
     else if (transport == std::string{"sif"}) {
         return std::string{"sif:"};
     }
@@ -40,6 +40,7 @@ private:
     std::string getVerbosityOption() const;
     common::CLIArguments getPolicyOption() const;
     common::CLIArguments getRegistriesDOption() const;
+    bool isStream(const std::string& transport, const std::string& reference) const;
     std::string getTransportString(const std::string& transport) const;
     void printLog(const boost::format &message, common::LogLevel,
                   std::ostream& outStream=std::cout, std::ostream& errStream=std::cerr) const;
@@ -15,6 +15,7 @@
 
 #include "common/Utility.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 #include "common/PathRAII.hpp"
 
 
@@ -56,6 +57,7 @@ SquashfsImage::SquashfsImage(const common::Config& config,
     auto end = std::chrono::system_clock::now();
     auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / double(1000);
     log(boost::format("Elapsed time on mksquashfs: %s [s]") % elapsedTime, common::LogLevel::INFO);
+    common::Metrics::getInstance().observe("sarus_image_phase", elapsedTime, {{"phase", "mksquashfs"}});
 
     log(boost::format("successfully created squashfs file"), common::LogLevel::INFO);
 }
@@ -13,6 +13,7 @@
 #include <chrono>
 
 #include "common/Error.hpp"
+#include "common/Metrics.hpp"
 #include "common/Utility.hpp"
 
 
@@ -30,12 +31,13 @@ UmociDriver::UmociDriver(std::shared_ptr<const common::Config> config)
     }
 }
 
-void UmociDriver::unpack(const boost::filesystem::path& imagePath, const boost::filesystem::path& unpackPath) const {
+void UmociDriver::unpack(const boost::filesystem::path& imagePath, const boost::filesystem::path& unpackPath,
+                         const std::string& reference) const {
     printLog( boost::format("Unpacking OCI image from %s into %s") % imagePath % unpackPath, common::LogLevel::DEBUG);
 
     auto args = generateBaseArgs();
     args += common::CLIArguments{"raw", "unpack", "--rootless",
-                                 "--image", imagePath.string()+":sarus-oci-image",
+                                 "--image", imagePath.string() + ":" + reference,
                                  unpackPath.string()};
 
     auto start = std::chrono::system_clock::now();
@@ -48,6 +50,7 @@ void UmociDriver::unpack(const boost::filesystem::path& imagePath, const boost::
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / double(1000);
 
     printLog(boost::format("Elapsed time on unpacking    : %s [sec]") % elapsed, common::LogLevel::INFO);
+    common::Metrics::getInstance().observe("sarus_image_phase", elapsed, {{"phase", "unpack"}});
 }
 
 common::CLIArguments UmociDriver::generateBaseArgs() const {
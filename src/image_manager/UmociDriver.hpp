@@ -29,7 +29,8 @@ namespace image_manager {
 class UmociDriver {
 public:
     UmociDriver(std::shared_ptr<const common::Config> config);
-    void unpack(const boost::filesystem::path& imagePath, const boost::filesystem::path& unpackPath) const;
+    void unpack(const boost::filesystem::path& imagePath, const boost::filesystem::path& unpackPath,
+                const std::string& reference = "sarus-oci-image") const;
     common::CLIArguments generateBaseArgs() const;
 
 private:
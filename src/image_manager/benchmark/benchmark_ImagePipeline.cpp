@@ -0,0 +1,568 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+/**
+ * Measures the stages of "sarus pull" and "sarus load" on synthetic OCI images with controlled
+ * numbers of layers, files per layer and file sizes. Pulls are served by a minimal registry
+ * stand-in listening on the loopback interface (plain HTTP, declared insecure to Skopeo through
+ * CONTAINERS_REGISTRIES_CONF), loads read an oci-archive of the same image. The durations and
+ * the bytes of the stages are those reported by the image manager through its metrics
+ * ("sarus_image_phase" and "sarus_image_phase_bytes"), collected from a metrics socket.
+ * The blob cache is emptied before every pull, so that the copy stage always downloads the layers.
+ *
+ * Usage: benchmark_image_manager_ImagePipeline [LAYERS FILES_PER_LAYER FILE_SIZE_IN_BYTES]
+ * Like the unit tests of the image manager, it requires Skopeo, umoci and mksquashfs.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+
+#include "common/Error.hpp"
+#include "common/Metrics.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "image_manager/ImageManager.hpp"
+#include "test_utility/Benchmark.hpp"
+#include "test_utility/config.hpp"
+
+namespace rj = rapidjson;
+using namespace sarus;
+
+struct ImageShape {
+    std::size_t layers;
+    std::size_t filesPerLayer;
+    std::size_t fileSize;
+};
+
+struct Blob {
+    std::string digest;
+    std::uint64_t size;
+};
+
+static std::string formatBytes(double bytes) {
+    if(bytes >= 1024*1024) {
+        return (boost::format("%.1fMiB") % (bytes / (1024*1024))).str();
+    }
+    if(bytes >= 1024) {
+        return (boost::format("%.1fKiB") % (bytes / 1024)).str();
+    }
+    return (boost::format("%dB") % static_cast<std::uint64_t>(bytes)).str();
+}
+
+static std::string describe(const ImageShape& shape) {
+    return (boost::format("%d layers x %d files x %s")
+        % shape.layers % shape.filesPerLayer % formatBytes(shape.fileSize)).str();
+}
+
+static void execute(const common::CLIArguments& args) {
+    if(common::forkExecWait(args) != 0) {
+        auto message = boost::format("Failed to execute %s") % args;
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+// moves the file into the blobs of the OCI image layout
+static Blob addBlob(const boost::filesystem::path& layoutDir, const boost::filesystem::path& file) {
+    auto hash = common::executeCommand("sha256sum " + file.string()).substr(0, 64);
+    auto size = boost::filesystem::file_size(file);
+    boost::filesystem::rename(file, layoutDir / "blobs/sha256" / hash);
+    return Blob{"sha256:" + hash, size};
+}
+
+static Blob addJSONBlob(const boost::filesystem::path& layoutDir, const rj::Value& json,
+                        const boost::filesystem::path& workDir) {
+    auto file = workDir / "blob.json";
+    common::writeJSON(json, file, false);
+    return addBlob(layoutDir, file);
+}
+
+static rj::Value makeDescriptor(const std::string& mediaType, const Blob& blob, rj::Document::AllocatorType& allocator) {
+    auto descriptor = rj::Value{rj::kObjectType};
+    descriptor.AddMember("mediaType", rj::Value{mediaType.c_str(), allocator}, allocator);
+    descriptor.AddMember("digest", rj::Value{blob.digest.c_str(), allocator}, allocator);
+    descriptor.AddMember("size", rj::Value{static_cast<uint64_t>(blob.size)}, allocator);
+    return descriptor;
+}
+
+/**
+ * Pseudo-random contents from a 16-symbol alphabet: half of the entropy of random data,
+ * so that the compression of the layers and of the squashfs file has some work to do
+ */
+static void writeFiles(const boost::filesystem::path& dir, const ImageShape& shape, std::size_t layer) {
+    auto state = std::uint64_t{0x9e3779b97f4a7c15ull} ^ (layer + 1);
+    auto buffer = std::vector<char>(64*1024);
+    for(std::size_t i=0; i<shape.filesPerLayer; ++i) {
+        auto file = dir / (boost::format("dir-%d/file-%d") % (i / 100) % i).str();
+        common::createFoldersIfNecessary(file.parent_path());
+        std::ofstream os{file.string(), std::ios::binary};
+        for(auto remaining = shape.fileSize; remaining > 0;) {
+            auto chunkSize = std::min(remaining, buffer.size());
+            for(std::size_t j=0; j<chunkSize; ++j) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                buffer[j] = "0123456789abcdef"[state & 0xf];
+            }
+            os.write(buffer.data(), chunkSize);
+            remaining -= chunkSize;
+        }
+    }
+}
+
+/**
+ * Creates an OCI image layout with gzip-compressed layers, whose files are placed
+ * in a different directory for each layer. Returns the image manifest.
+ */
+static Blob createImageLayout(const boost::filesystem::path& layoutDir,
+                              const boost::filesystem::path& workDir,
+                              const ImageShape& shape) {
+    common::createFoldersIfNecessary(layoutDir / "blobs/sha256");
+    common::createFoldersIfNecessary(workDir);
+
+    auto layers = std::vector<Blob>{};
+    auto diffIDs = std::vector<std::string>{};
+    for(std::size_t i=0; i<shape.layers; ++i) {
+        auto contentDir = workDir / "content";
+        auto layerName = "layer-" + std::to_string(i);
+        writeFiles(contentDir / layerName, shape, i);
+        auto tarFile = workDir / "layer.tar";
+        execute({"tar", "-C", contentDir.string(), "-cf", tarFile.string(), layerName});
+        diffIDs.push_back("sha256:" + common::executeCommand("sha256sum " + tarFile.string()).substr(0, 64));
+        execute({"gzip", "-n", tarFile.string()});
+        layers.push_back(addBlob(layoutDir, workDir / "layer.tar.gz"));
+        boost::filesystem::remove_all(contentDir);
+    }
+
+    auto config = rj::Document{rj::kObjectType};
+    auto& configAllocator = config.GetAllocator();
+    config.AddMember("architecture", rj::Value{"amd64"}, configAllocator);
+    config.AddMember("os", rj::Value{"linux"}, configAllocator);
+    auto containerConfig = rj::Value{rj::kObjectType};
+    auto env = rj::Value{rj::kArrayType};
+    env.PushBack(rj::Value{"PATH=/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin"}, configAllocator);
+    containerConfig.AddMember("Env", env, configAllocator);
+    config.AddMember("config", containerConfig, configAllocator);
+    auto rootfs = rj::Value{rj::kObjectType};
+    rootfs.AddMember("type", rj::Value{"layers"}, configAllocator);
+    auto diffIDsValue = rj::Value{rj::kArrayType};
+    for(const auto& diffID : diffIDs) {
+        diffIDsValue.PushBack(rj::Value{diffID.c_str(), configAllocator}, configAllocator);
+    }
+    rootfs.AddMember("diff_ids", diffIDsValue, configAllocator);
+    config.AddMember("rootfs", rootfs, configAllocator);
+    auto configBlob = addJSONBlob(layoutDir, config, workDir);
+
+    auto manifest = rj::Document{rj::kObjectType};
+    auto& allocator = manifest.GetAllocator();
+    manifest.AddMember("schemaVersion", rj::Value{2}, allocator);
+    manifest.AddMember("mediaType", rj::Value{"application/vnd.oci.image.manifest.v1+json"}, allocator);
+    manifest.AddMember("config", makeDescriptor("application/vnd.oci.image.config.v1+json", configBlob, allocator), allocator);
+    auto layersValue = rj::Value{rj::kArrayType};
+    for(const auto& layer : layers) {
+        layersValue.PushBack(makeDescriptor("application/vnd.oci.image.layer.v1.tar+gzip", layer, allocator), allocator);
+    }
+    manifest.AddMember("layers", layersValue, allocator);
+    auto manifestBlob = addJSONBlob(layoutDir, manifest, workDir);
+
+    auto index = rj::Document{rj::kObjectType};
+    auto& indexAllocator = index.GetAllocator();
+    index.AddMember("schemaVersion", rj::Value{2}, indexAllocator);
+    auto manifests = rj::Value{rj::kArrayType};
+    auto descriptor = makeDescriptor("application/vnd.oci.image.manifest.v1+json", manifestBlob, indexAllocator);
+    auto annotations = rj::Value{rj::kObjectType};
+    annotations.AddMember("org.opencontainers.image.ref.name", rj::Value{"latest"}, indexAllocator);
+    descriptor.AddMember("annotations", annotations, indexAllocator);
+    manifests.PushBack(descriptor, indexAllocator);
+    index.AddMember("manifests", manifests, indexAllocator);
+    common::writeJSON(index, layoutDir / "index.json", false);
+    common::writeTextFile("{\"imageLayoutVersion\":\"1.0.0\"}", layoutDir / "oci-layout");
+
+    boost::filesystem::remove_all(workDir);
+    return manifestBlob;
+}
+
+/**
+ * Serves the manifest and the blobs of an OCI image layout through the read-only part
+ * of the registry API used by Skopeo. Every connection handles a single request
+ * ("Connection: close"), which keeps the stand-in simple.
+ */
+class RegistryStandIn {
+public:
+    RegistryStandIn(const boost::filesystem::path& layoutDir, const Blob& manifest)
+        : layoutDir{layoutDir}
+        , manifest{manifest}
+    {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        auto address = sockaddr_in{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        auto addressLength = socklen_t{sizeof(address)};
+        if(listenFd < 0
+           || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+           || listen(listenFd, 64) != 0
+           || getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+            auto message = boost::format("Failed to set up registry stand-in: %s") % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        port = ntohs(address.sin_port);
+        server = std::thread{[this]() { serve(); }};
+    }
+
+    RegistryStandIn(const RegistryStandIn&) = delete;
+    RegistryStandIn& operator=(const RegistryStandIn&) = delete;
+
+    ~RegistryStandIn() {
+        shutdown(listenFd, SHUT_RDWR); // makes accept() fail
+        server.join();
+        close(listenFd);
+    }
+
+    std::string getAddress() const {
+        return "127.0.0.1:" + std::to_string(port);
+    }
+
+private:
+    void serve() const {
+        auto connections = std::vector<std::thread>{};
+        while(true) {
+            auto fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if(fd < 0) {
+                if(errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                break;
+            }
+            connections.emplace_back([this, fd]() {
+                handle(fd);
+                close(fd);
+            });
+        }
+        for(auto& connection : connections) {
+            connection.join();
+        }
+    }
+
+    void handle(int fd) const {
+        auto request = std::string{};
+        char buffer[4096];
+        while(request.find("\r\n\r\n") == std::string::npos) {
+            auto bytes = recv(fd, buffer, sizeof(buffer), 0);
+            if(bytes <= 0) {
+                return;
+            }
+            request.append(buffer, bytes);
+            // e.g. the TLS handshake attempted by Skopeo before falling back to plain HTTP
+            if(!std::isupper(static_cast<unsigned char>(request[0]))) {
+                respond(fd, "400 Bad Request");
+                return;
+            }
+        }
+
+        auto requestLine = std::vector<std::string>{};
+        boost::split(requestLine, request.substr(0, request.find("\r\n")), boost::is_any_of(" "));
+        if(requestLine.size() != 3 || (requestLine[0] != "GET" && requestLine[0] != "HEAD")) {
+            respond(fd, "405 Method Not Allowed");
+            return;
+        }
+        auto isHead = requestLine[0] == "HEAD";
+        const auto& path = requestLine[1];
+
+        auto manifests = path.find("/manifests/");
+        auto blobs = path.find("/blobs/sha256:");
+        if(path == "/v2/" || path == "/v2") {
+            respond(fd, "200 OK");
+        }
+        else if(boost::starts_with(path, "/v2/") && manifests != std::string::npos) {
+            auto reference = path.substr(manifests + std::string{"/manifests/"}.size());
+            if(reference == "latest" || reference == manifest.digest) {
+                sendBlob(fd, manifest.digest, "application/vnd.oci.image.manifest.v1+json", isHead);
+            }
+            else {
+                respond(fd, "404 Not Found");
+            }
+        }
+        else if(boost::starts_with(path, "/v2/") && blobs != std::string::npos) {
+            auto digest = path.substr(blobs + std::string{"/blobs/"}.size());
+            auto hash = digest.substr(std::string{"sha256:"}.size());
+            if(hash.size() == 64 && hash.find_first_not_of("0123456789abcdef") == std::string::npos
+               && boost::filesystem::exists(layoutDir / "blobs/sha256" / hash)) {
+                sendBlob(fd, digest, "application/octet-stream", isHead);
+            }
+            else {
+                respond(fd, "404 Not Found");
+            }
+        }
+        else {
+            respond(fd, "404 Not Found");
+        }
+    }
+
+    static void sendAll(int fd, const std::string& data) {
+        auto sent = std::size_t{0};
+        while(sent < data.size()) {
+            auto bytes = send(fd, data.c_str() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if(bytes <= 0) {
+                return;
+            }
+            sent += bytes;
+        }
+    }
+
+    static void respond(int fd, const std::string& status) {
+        sendAll(fd, "HTTP/1.1 " + status + "\r\n"
+                    "Content-Type: application/json\r\n"
+                    "Content-Length: 2\r\n"
+                    "Docker-Distribution-Api-Version: registry/2.0\r\n"
+                    "Connection: close\r\n\r\n{}");
+    }
+
+    void sendBlob(int fd, const std::string& digest, const std::string& contentType, bool isHead) const {
+        auto file = layoutDir / "blobs/sha256" / digest.substr(std::string{"sha256:"}.size());
+        auto size = boost::filesystem::file_size(file);
+        sendAll(fd, (boost::format("HTTP/1.1 200 OK\r\n"
+                                   "Content-Type: %s\r\n"
+                                   "Content-Length: %d\r\n"
+                                   "Docker-Content-Digest: %s\r\n"
+                                   "Docker-Distribution-Api-Version: registry/2.0\r\n"
+                                   "Connection: close\r\n\r\n") % contentType % size % digest).str());
+        if(isHead) {
+            return;
+        }
+        auto fileFd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        auto offset = off_t{0};
+        while(fileFd >= 0 && static_cast<std::uint64_t>(offset) < size) {
+            if(sendfile(fd, fileFd, &offset, size - offset) <= 0) {
+                break;
+            }
+        }
+        close(fileFd);
+    }
+
+private:
+    boost::filesystem::path layoutDir;
+    Blob manifest;
+    int listenFd = -1;
+    int port = 0;
+    std::thread server;
+};
+
+struct Phase {
+    double seconds = 0;
+    double bytes = 0;
+};
+
+/**
+ * Receives the StatsD datagrams exported by common::Metrics, e.g.
+ * "sarus_image_phase:1234.5|ms|#phase:mksquashfs,uid:1000"
+ */
+class MetricsCollector {
+public:
+    MetricsCollector(const boost::filesystem::path& socketPath, const common::Config& config) {
+        auto address = sockaddr_un{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if(fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            auto message = boost::format("Failed to bind metrics socket %s: %s") % socketPath % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        common::Metrics::getInstance().configure(boost::none, socketPath, config.userIdentity.uid, config.userIdentity.gid);
+    }
+
+    MetricsCollector(const MetricsCollector&) = delete;
+    MetricsCollector& operator=(const MetricsCollector&) = delete;
+
+    ~MetricsCollector() {
+        common::Metrics::getInstance().configure(boost::none, boost::none, 0, 0);
+        close(fd);
+    }
+
+    // the phases reported since the previous call
+    std::map<std::string, Phase> collect() const {
+        common::Metrics::getInstance().flush();
+
+        auto phases = std::map<std::string, Phase>{};
+        char buffer[4096];
+        ssize_t bytes;
+        while((bytes = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            auto fields = std::vector<std::string>{};
+            boost::split(fields, std::string(buffer, bytes), boost::is_any_of("|"));
+            auto separator = fields[0].find(':');
+            if(fields.size() < 3 || separator == std::string::npos) {
+                continue;
+            }
+            auto name = fields[0].substr(0, separator);
+            auto value = std::stod(fields[0].substr(separator + 1));
+
+            auto labels = std::vector<std::string>{};
+            boost::split(labels, fields[2].substr(1), boost::is_any_of(","));
+            auto phase = std::find_if(labels.cbegin(), labels.cend(), [](const std::string& label) {
+                return boost::starts_with(label, "phase:");
+            });
+            if(phase == labels.cend()) {
+                continue;
+            }
+            auto& entry = phases[phase->substr(std::string{"phase:"}.size())];
+            if(name == "sarus_image_phase" && fields[1] == "ms") {
+                entry.seconds += value / 1000;
+            }
+            else if(name == "sarus_image_phase_bytes" && fields[1] == "c") {
+                entry.bytes += value;
+            }
+        }
+        return phases;
+    }
+
+private:
+    int fd = -1;
+};
+
+struct Measurement {
+    std::string name;
+    std::map<std::string, std::vector<double>> seconds;
+    std::map<std::string, std::vector<double>> bytes;
+};
+
+// the operation is timed, the reset (e.g. the removal of the image) is not
+template<class Operation, class Reset>
+static Measurement measure(const std::string& name, std::size_t iterations, const MetricsCollector& metrics,
+                           Operation&& operation, Reset&& reset) {
+    auto measurement = Measurement{name, {}, {}};
+    iterations = test_utility::benchmark::getIterations(iterations);
+    for(std::size_t i=0; i<iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        operation();
+        auto end = std::chrono::steady_clock::now();
+        measurement.seconds["total"].push_back(std::chrono::duration<double>(end - start).count());
+        for(const auto& phase : metrics.collect()) {
+            measurement.seconds[phase.first].push_back(phase.second.seconds);
+            measurement.bytes[phase.first].push_back(phase.second.bytes);
+        }
+        reset();
+    }
+    return measurement;
+}
+
+static void print(const Measurement& measurement) {
+    std::cout << "\n" << measurement.name << "\n";
+    std::cout << boost::format("%-12s %10s %12s %12s %12s %12s %14s\n")
+        % "stage" % "iterations" % "min [ms]" % "median [ms]" % "max [ms]" % "bytes" % "rate [MiB/s]";
+    for(const auto& stage : {"copy", "unpack", "catalogue", "mksquashfs", "index", "metadata", "cleanup", "total"}) {
+        auto seconds = measurement.seconds.find(stage);
+        if(seconds == measurement.seconds.cend()) {
+            continue;
+        }
+        auto time = test_utility::benchmark::summarize(stage, seconds->second);
+        auto bytes = measurement.bytes.find(stage);
+        auto bytesMoved = bytes != measurement.bytes.cend()
+            ? test_utility::benchmark::summarize(stage, bytes->second).median
+            : 0.0;
+        auto rate = bytesMoved > 0 && time.median > 0
+            ? (boost::format("%.1f") % (bytesMoved / (1024*1024) / time.median)).str()
+            : std::string{"-"};
+        std::cout << boost::format("%-12s %10d %12.1f %12.1f %12.1f %12s %14s\n")
+            % stage % time.iterations % (time.min * 1e3) % (time.median * 1e3) % (time.max * 1e3)
+            % (bytesMoved > 0 ? formatBytes(bytesMoved) : std::string{"-"}) % rate;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto shapes = std::vector<ImageShape>{
+        {1, 10000, 4*1024},         // many small files
+        {8, 1000, 64*1024},         // many layers
+        {1, 4, 64*1024*1024},       // few large files
+    };
+    if(argc == 4) {
+        shapes = {{std::stoul(argv[1]), std::stoul(argv[2]), std::stoul(argv[3])}};
+    }
+    else if(argc != 1) {
+        std::cerr << "Usage: " << argv[0] << " [LAYERS FILES_PER_LAYER FILE_SIZE_IN_BYTES]" << std::endl;
+        return 1;
+    }
+
+    auto configRAII = test_utility::config::makeConfig();
+    auto config = configRAII.config;
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-benchmark-image-pipeline")};
+    common::createFoldersIfNecessary(testDir.getPath());
+
+    auto policyFile = testDir.getPath() / "policy.json";
+    common::writeTextFile("{\"default\":[{\"type\":\"insecureAcceptAnything\"}]}", policyFile);
+    rj::Pointer("/containersPolicy/path").Set(config->json, policyFile.c_str());
+    rj::Pointer("/containersPolicy/enforce").Set(config->json, true);
+
+    MetricsCollector metrics{testDir.getPath() / "metrics.sock", *config};
+
+    auto measurements = std::vector<Measurement>{};
+    for(const auto& shape : shapes) {
+        auto imageDir = testDir.getPath() / "image";
+        auto layoutDir = imageDir / "layout";
+        auto manifest = createImageLayout(layoutDir, imageDir / "work", shape);
+        auto archive = imageDir / "image.oci.tar";
+        execute({"tar", "-C", layoutDir.string(), "-cf", archive.string(), "."});
+
+        RegistryStandIn registry{layoutDir, manifest};
+        auto registriesFile = imageDir / "registries.conf";
+        common::writeTextFile("[[registry]]\nlocation = \"" + registry.getAddress() + "\"\ninsecure = true\n",
+                              registriesFile);
+        common::setEnvironmentVariable("CONTAINERS_REGISTRIES_CONF", registriesFile.string());
+
+        auto removeImage = [&]() {
+            image_manager::ImageManager{config}.removeImage();
+        };
+
+        config->imageReference = common::ImageReference{registry.getAddress(), "benchmark", "image", "latest"};
+        auto emptyBlobCache = [&]() {
+            boost::filesystem::remove_all(config->directories.cache / "blobs");
+            common::createFoldersIfNecessary(config->directories.cache / "blobs");
+        };
+        emptyBlobCache();
+        measurements.push_back(measure("pull " + describe(shape), 3, metrics,
+            [&]() { image_manager::ImageManager{config}.pullImage("docker"); },
+            [&]() { removeImage(); emptyBlobCache(); }));
+
+        config->imageReference = common::ImageReference{"load", "benchmark", "image", "latest"};
+        measurements.push_back(measure("load " + describe(shape), 3, metrics,
+            [&]() { image_manager::ImageManager{config}.loadImage("oci-archive", archive); },
+            removeImage));
+
+        boost::filesystem::remove_all(imageDir);
+    }
+
+    for(const auto& measurement : measurements) {
+        print(measurement);
+    }
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <fstream>
+#include <random>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "common/PathRAII.hpp"
+#include "common/Sha256.hpp"
+#include "common/Utility.hpp"
+#include "image_manager/ImageBroadcast.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+namespace sarus {
+namespace image_manager {
+namespace test {
+
+TEST_GROUP(ImageBroadcastTestGroup) {
+};
+
+const std::string secret = "secret-of-the-job";
+
+std::vector<ImageBroadcast::Peer> makeLocalPeers(std::size_t numberOfPeers) {
+    // use a pid-dependent range of ports to avoid clashes between concurrent test runs
+    auto basePort = static_cast<std::uint16_t>(20000 + (getpid() % 20000));
+    auto peers = std::vector<ImageBroadcast::Peer>{};
+    for(std::size_t i=0; i<numberOfPeers; ++i) {
+        peers.push_back(ImageBroadcast::Peer{"127.0.0.1", static_cast<std::uint16_t>(basePort + i)});
+    }
+    return peers;
+}
+
+void createRandomFile(const boost::filesystem::path& file, std::size_t size) {
+    auto generator = std::mt19937{42};
+    auto data = std::string(size, '\0');
+    for(auto& c : data) {
+        c = static_cast<char>(generator());
+    }
+    std::ofstream os{file.string(), std::ios::binary};
+    os << data;
+}
+
+TEST(ImageBroadcastTestGroup, spanningTree) {
+    auto broadcast = ImageBroadcast{makeLocalPeers(7), 0, secret, 2};
+    CHECK(broadcast.getChildren(0) == (std::vector<std::size_t>{1, 2}));
+    CHECK(broadcast.getChildren(1) == (std::vector<std::size_t>{3, 4}));
+    CHECK(broadcast.getChildren(2) == (std::vector<std::size_t>{5, 6}));
+    CHECK(broadcast.getChildren(3).empty());
+
+    auto flat = ImageBroadcast{makeLocalPeers(4), 0, secret, 8};
+    CHECK(flat.getChildren(0) == (std::vector<std::size_t>{1, 2, 3}));
+
+    CHECK_THROWS(common::Error, ImageBroadcast(makeLocalPeers(2), 2, secret, 2));
+    CHECK_THROWS(common::Error, ImageBroadcast(makeLocalPeers(2), 0, secret, 0));
+    CHECK_THROWS(common::Error, ImageBroadcast(makeLocalPeers(2), 0, "", 2));
+}
+
+TEST(ImageBroadcastTestGroup, parsePeers) {
+    auto peers = ImageBroadcast::parsePeers("nid001,nid002:4000\nnid003", 3000);
+    CHECK_EQUAL(peers.size(), 3);
+    CHECK_EQUAL(peers[0].host, std::string{"nid001"});
+    CHECK_EQUAL(peers[0].port, 3000);
+    CHECK_EQUAL(peers[1].host, std::string{"nid002"});
+    CHECK_EQUAL(peers[1].port, 4000);
+    CHECK_EQUAL(peers[2].host, std::string{"nid003"});
+    CHECK_EQUAL(peers[2].port, 3000);
+
+    CHECK_THROWS(common::Error, ImageBroadcast::parsePeers("nid001:port", 3000));
+    CHECK_THROWS(common::Error, ImageBroadcast::parsePeers("nid001:70000", 3000));
+}
+
+TEST(ImageBroadcastTestGroup, broadcastAcrossLocalProcesses) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-broadcast")};
+    common::createFoldersIfNecessary(testDir.getPath());
+
+    auto sourceFile = testDir.getPath() / "image.squashfs";
+    createRandomFile(sourceFile, (10 << 20) + 123);
+    auto expectedDigest = "sha256:" + common::Sha256::digestOfFile(sourceFile);
+
+    const std::size_t numberOfPeers = 6;
+    auto peers = makeLocalPeers(numberOfPeers);
+    auto stagedName = boost::filesystem::path{"docker.io/library/alpine/latest.squashfs"};
+    auto stagingDirOf = [&testDir](std::size_t rank) {
+        return testDir.getPath() / ("node-" + std::to_string(rank));
+    };
+
+    // every process except the current one stands in for a receiving node
+    auto children = std::vector<pid_t>{};
+    for(std::size_t rank=1; rank<numberOfPeers; ++rank) {
+        auto pid = fork();
+        if(pid == 0) {
+            try {
+                auto broadcast = ImageBroadcast{peers, rank, secret, 2};
+                broadcast.setTimeout(std::chrono::seconds{30});
+                broadcast.setChunkSize(1 << 20);
+                common::createFoldersIfNecessary(stagingDirOf(rank));
+                broadcast.receive(stagedName, "image-id", stagingDirOf(rank));
+                _exit(0);
+            }
+            catch(...) {
+                _exit(1);
+            }
+        }
+        children.push_back(pid);
+    }
+
+    auto broadcast = ImageBroadcast{peers, 0, secret, 2};
+    broadcast.setTimeout(std::chrono::seconds{30});
+    broadcast.setChunkSize(1 << 20);
+    common::createFoldersIfNecessary(stagingDirOf(0));
+    auto staged = broadcast.send(sourceFile, stagedName, "image-id", stagingDirOf(0));
+    CHECK_EQUAL(staged.digest, expectedDigest);
+
+    for(auto pid : children) {
+        int status;
+        waitpid(pid, &status, 0);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    for(std::size_t rank=0; rank<numberOfPeers; ++rank) {
+        auto file = ImageBroadcast::findStagedFile(stagingDirOf(rank), stagedName, "image-id", getuid());
+        CHECK(static_cast<bool>(file));
+        CHECK_EQUAL(file->digest, expectedDigest);
+        CHECK_EQUAL(file->size, boost::filesystem::file_size(sourceFile));
+        CHECK_EQUAL("sha256:" + common::Sha256::digestOfFile(file->path), expectedDigest);
+
+        // staged copies of a different image are not picked up
+        CHECK(!ImageBroadcast::findStagedFile(stagingDirOf(rank), stagedName, "other-image-id", getuid()));
+    }
+}
+
+TEST(ImageBroadcastTestGroup, unreachablePeersAreReported) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-broadcast")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto sourceFile = testDir.getPath() / "image.squashfs";
+    createRandomFile(sourceFile, 1024);
+
+    // nobody listens on the port of rank 1
+    auto broadcast = ImageBroadcast{makeLocalPeers(2), 0, secret, 2};
+    broadcast.setTimeout(std::chrono::seconds{1});
+    CHECK_THROWS(common::Error, broadcast.send(sourceFile, "image.squashfs", "image-id", testDir.getPath()));
+}
+
+// forks a receiving peer with rank 1, returns its exit status
+template<class Sender>
+int receiveFromSender(const std::vector<ImageBroadcast::Peer>& peers, const std::string& imageID,
+                      const boost::filesystem::path& stagingDir, Sender sender) {
+    auto pid = fork();
+    if(pid == 0) {
+        try {
+            auto broadcast = ImageBroadcast{peers, 1, secret, 2};
+            broadcast.setTimeout(std::chrono::seconds{3});
+            broadcast.receive("image.squashfs", imageID, stagingDir);
+            _exit(0);
+        }
+        catch(...) {
+            _exit(1);
+        }
+    }
+    sender();
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(ImageBroadcastTestGroup, unauthenticatedStreamsAreRejected) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-broadcast")};
+    common::createFoldersIfNecessary(testDir.getPath() / "source");
+    common::createFoldersIfNecessary(testDir.getPath() / "staging");
+    auto sourceFile = testDir.getPath() / "source/image.squashfs";
+    createRandomFile(sourceFile, 1024);
+    auto peers = makeLocalPeers(2);
+
+    // a sender which doesn't know the secret is dropped and the receiver times out
+    auto status = receiveFromSender(peers, "image-id", testDir.getPath() / "staging", [&]() {
+        auto broadcast = ImageBroadcast{peers, 0, "wrong-secret", 2};
+        broadcast.setTimeout(std::chrono::seconds{3});
+        CHECK_THROWS(common::Error, broadcast.send(sourceFile, "image.squashfs", "image-id", testDir.getPath() / "source"));
+    });
+    CHECK_EQUAL(status, 1);
+    CHECK(boost::filesystem::is_empty(testDir.getPath() / "staging"));
+
+    // a different image than the requested one is not written
+    status = receiveFromSender(peers, "image-id", testDir.getPath() / "staging", [&]() {
+        auto broadcast = ImageBroadcast{peers, 0, secret, 2};
+        broadcast.setTimeout(std::chrono::seconds{3});
+        CHECK_THROWS(common::Error, broadcast.send(sourceFile, "image.squashfs", "other-image-id", testDir.getPath() / "source"));
+    });
+    CHECK_EQUAL(status, 1);
+    CHECK(boost::filesystem::is_empty(testDir.getPath() / "staging"));
+
+    // the secret is all it takes
+    status = receiveFromSender(peers, "image-id", testDir.getPath() / "staging", [&]() {
+        auto broadcast = ImageBroadcast{peers, 0, secret, 2};
+        broadcast.setTimeout(std::chrono::seconds{3});
+        broadcast.send(sourceFile, "image.squashfs", "image-id", testDir.getPath() / "source");
+    });
+    CHECK_EQUAL(status, 0);
+    CHECK(ImageBroadcast::findStagedFile(testDir.getPath() / "staging", "image.squashfs", "image-id", getuid()));
+}
+
+TEST(ImageBroadcastTestGroup, readOrCreateKeyFile) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-broadcast")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto keyFile = testDir.getPath() / "broadcast.key";
+
+    auto key = ImageBroadcast::readOrCreateKeyFile(keyFile, getuid());
+    CHECK_EQUAL(key.size(), 64);
+    CHECK_EQUAL(ImageBroadcast::readOrCreateKeyFile(keyFile, getuid()), key);
+    CHECK_EQUAL(boost::filesystem::status(keyFile).permissions(),
+                boost::filesystem::owner_read | boost::filesystem::owner_write);
+
+    // a key which other users can read, or which belongs to somebody else, is refused
+    CHECK_THROWS(common::Error, ImageBroadcast::readOrCreateKeyFile(keyFile, getuid() + 1));
+    boost::filesystem::permissions(keyFile, boost::filesystem::owner_read | boost::filesystem::group_read);
+    CHECK_THROWS(common::Error, ImageBroadcast::readOrCreateKeyFile(keyFile, getuid()));
+}
+
+}}} // namespace
+
+SARUS_UNITTEST_MAIN_FUNCTION();
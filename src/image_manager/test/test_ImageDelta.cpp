@@ -0,0 +1,128 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "common/ImageFileIndex.hpp"
+#include "common/ImageMetadata.hpp"
+#include "common/PathRAII.hpp"
+#include "common/SarusImage.hpp"
+#include "common/Utility.hpp"
+#include "image_manager/ImageDelta.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(ImageDeltaTestGroup) {
+};
+
+// a file with the fields of the squashfs superblock the index is bound to
+static void writeSquashfsSuperblock(const boost::filesystem::path& file) {
+    char superblock[96] = {};
+    auto magic = std::uint32_t{0x73717368};
+    auto creationTime = std::uint32_t{1600000000};
+    auto bytesUsed = std::uint64_t{sizeof(superblock)};
+    std::memcpy(superblock, &magic, sizeof(magic));
+    std::memcpy(superblock + 8, &creationTime, sizeof(creationTime));
+    std::memcpy(superblock + 40, &bytesUsed, sizeof(bytesUsed));
+    boost::filesystem::ofstream{file, std::ios::binary}.write(superblock, sizeof(superblock));
+}
+
+static common::SarusImage createBaseImage(const boost::filesystem::path& testDir) {
+    auto rootfs = testDir / "base-rootfs";
+    common::createFoldersIfNecessary(rootfs / "usr/lib");
+    common::createFoldersIfNecessary(rootfs / "etc");
+    common::writeTextFile("foo", rootfs / "usr/lib/libfoo.so");
+    common::writeTextFile("bar", rootfs / "etc/bar.conf");
+
+    auto image = common::SarusImage{};
+    image.id = "0123456789abcdef";
+    image.imageFile = testDir / "image.squashfs";
+    writeSquashfsSuperblock(image.imageFile);
+    common::ImageFileIndex::create(rootfs, image.imageFile, common::ImageFileIndex::getFileOfImage(image.imageFile));
+    image.lowerImageFiles = {testDir / "image.fedcba987654.lower.squashfs"};
+    return image;
+}
+
+static common::ImageMetadata createBaseMetadata() {
+    auto metadata = common::ImageMetadata{};
+    metadata.layers = {"sha256:layer0", "sha256:layer1"};
+    return metadata;
+}
+
+TEST(ImageDeltaTestGroup, lowerImageFiles) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-delta")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto baseImage = createBaseImage(testDir.getPath());
+    auto lowerImageFile = testDir.getPath() / "image.0123456789ab.lower.squashfs";
+
+    {
+        auto delta = image_manager::ImageDelta{baseImage, createBaseMetadata(), lowerImageFile};
+        CHECK_EQUAL(delta.getNumberOfBaseLayers(), std::size_t{2});
+        CHECK(boost::filesystem::equivalent(lowerImageFile, baseImage.imageFile));
+        auto expected = std::vector<boost::filesystem::path>{lowerImageFile, baseImage.lowerImageFiles[0]};
+        CHECK(delta.getLowerImageFiles() == expected);
+    }
+    // the hard link to the base image is removed, unless the delta is released
+    CHECK(!boost::filesystem::exists(lowerImageFile));
+    {
+        auto delta = image_manager::ImageDelta{baseImage, createBaseMetadata(), lowerImageFile};
+        delta.release();
+    }
+    CHECK(boost::filesystem::exists(lowerImageFile));
+}
+
+TEST(ImageDeltaTestGroup, placeholders) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-delta")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto baseImage = createBaseImage(testDir.getPath());
+    auto lowerImageFile = testDir.getPath() / "image.0123456789ab.lower.squashfs";
+    auto unpackDir = testDir.getPath() / "unpack";
+    common::createFoldersIfNecessary(unpackDir);
+
+    auto delta = image_manager::ImageDelta{baseImage, createBaseMetadata(), lowerImageFile};
+    delta.createPlaceholders(unpackDir);
+    CHECK(boost::filesystem::is_regular_file(unpackDir / "usr/lib/libfoo.so"));
+    CHECK(boost::filesystem::is_regular_file(unpackDir / "etc/bar.conf"));
+
+    // the new layers add and replace files
+    common::writeTextFile("baz", unpackDir / "usr/lib/libbaz.so");
+    boost::filesystem::remove(unpackDir / "etc/bar.conf");
+    common::writeTextFile("new bar", unpackDir / "etc/bar.conf");
+
+    CHECK(delta.removePlaceholders(unpackDir));
+    CHECK(boost::filesystem::exists(unpackDir / "usr/lib/libbaz.so"));
+    CHECK_EQUAL(common::readFile(unpackDir / "etc/bar.conf"), std::string{"new bar"});
+    CHECK(!boost::filesystem::exists(unpackDir / "usr/lib/libfoo.so"));
+}
+
+TEST(ImageDeltaTestGroup, placeholdersOfRemovedFiles) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-image-delta")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto baseImage = createBaseImage(testDir.getPath());
+    auto lowerImageFile = testDir.getPath() / "image.0123456789ab.lower.squashfs";
+    auto unpackDir = testDir.getPath() / "unpack";
+    common::createFoldersIfNecessary(unpackDir);
+
+    auto delta = image_manager::ImageDelta{baseImage, createBaseMetadata(), lowerImageFile};
+    delta.createPlaceholders(unpackDir);
+
+    // a whiteout of the new layers
+    boost::filesystem::remove(unpackDir / "etc/bar.conf");
+
+    CHECK(!delta.removePlaceholders(unpackDir));
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -8,12 +8,17 @@
  *
  */
 
+#include <fstream>
 #include <memory>
 
+#include <utime.h>
+
 #include <boost/filesystem.hpp>
 #include <rapidjson/document.h>
 
 #include "test_utility/config.hpp"
+#include "test_utility/filesystem.hpp"
+#include "common/PathRAII.hpp"
 #include "common/Utility.hpp"
 #include "image_manager/ImageStore.hpp" 
 #include "test_utility/unittest_main_function.hpp"
@@ -90,6 +95,86 @@ TEST(ImageStoreTestGroup, addListRemove) {
     CHECK(imageStore.listImages().front() == imageVector[1]);
 }
 
+TEST(ImageStoreTestGroup, removeImages) {
+    for (const auto& image : imageVector) {
+        addImageHarness(imageStore, image);
+    }
+
+    // remove some images at once (repeated references are removed once)
+    imageStore.removeImages({refVector[0], refVector[2], refVector[0]});
+    CHECK((imageStore.listImages() == std::vector<common::SarusImage>{imageVector[1], imageVector[3]}));
+    CHECK_FALSE(boost::filesystem::exists(imageVector[0].imageFile));
+    CHECK_FALSE(boost::filesystem::exists(imageVector[2].metadataFile));
+
+    // the available images are removed even if some are missing
+    CHECK_THROWS(common::Error, imageStore.removeImages({refVector[1], refVector[2], refVector[3]}));
+    CHECK(imageStore.listImages().empty());
+    CHECK_THROWS(common::Error, imageStore.removeImage(refVector[0]));
+}
+
+TEST(ImageStoreTestGroup, pruneImages) {
+    auto now = time(nullptr);
+    auto oneHourAgo = now - 3600;
+    auto addImages = [&]() {
+        for (const auto& image : imageVector) {
+            addImageHarness(imageStore, image);
+        }
+    };
+
+    // no criteria
+    addImages();
+    CHECK(imageStore.pruneImages({}).empty());
+    CHECK(imageStore.listImages() == imageVector);
+
+    // by reference pattern (matched against the tag, if any)
+    auto filter = ImageStore::PruneFilter{};
+    filter.referencePattern = std::string{"index.docker.io/library/alpine"};
+    CHECK((imageStore.pruneImages(filter) == std::vector<common::SarusImage>{imageVector[1]}));
+    filter.referencePattern = std::string{"*:latest"};
+    CHECK((imageStore.pruneImages(filter) == std::vector<common::SarusImage>{imageVector[0], imageVector[2]}));
+    CHECK((imageStore.listImages() == std::vector<common::SarusImage>{imageVector[3]}));
+    CHECK_FALSE(boost::filesystem::exists(imageVector[0].imageFile));
+
+    // by last use of the squashfs file
+    addImages();
+    auto times = utimbuf{oneHourAgo - 1, oneHourAgo - 1};
+    CHECK(utime(imageVector[1].imageFile.c_str(), &times) == 0);
+    filter = ImageStore::PruneFilter{};
+    filter.lastUsedBefore = oneHourAgo;
+    CHECK((imageStore.pruneImages(filter) == std::vector<common::SarusImage>{imageVector[1]}));
+
+    // by creation time, together with the reference pattern
+    imageVector[0].created = common::SarusImage::createTimeString(now);
+    addImages();
+    filter = ImageStore::PruneFilter{};
+    filter.createdBefore = oneHourAgo;
+    filter.referencePattern = std::string{"index.docker.io/*"};
+    CHECK((imageStore.pruneImages(filter) == std::vector<common::SarusImage>{imageVector[1], imageVector[2]}));
+    CHECK((imageStore.listImages() == std::vector<common::SarusImage>{imageVector[0], imageVector[3]}));
+}
+
+TEST(ImageStoreTestGroup, removeOrphanedTemporaryFiles) {
+    addImageHarness(imageStore, imageVector[0]);
+    auto orphanedSquashfs = common::makeUniquePathWithRandomSuffix(imageVector[1].imageFile);
+    auto orphanedMetadata = common::makeUniquePathWithRandomSuffix(imageStore.getRepositoryMetadataFile());
+    auto recentSquashfs = common::makeUniquePathWithRandomSuffix(imageVector[2].imageFile);
+    common::createFileIfNecessary(orphanedSquashfs);
+    common::createFileIfNecessary(orphanedMetadata);
+    common::createFileIfNecessary(recentSquashfs);
+
+    auto oneDayAgo = time(nullptr) - 24*3600;
+    for (const auto& path : {orphanedSquashfs, orphanedMetadata, imageVector[0].imageFile}) {
+        boost::filesystem::last_write_time(path, oneDayAgo - 1);
+    }
+
+    auto removed = imageStore.removeOrphanedTemporaryFiles(oneDayAgo);
+    CHECK_EQUAL(removed.size(), std::size_t{2});
+    CHECK_FALSE(boost::filesystem::exists(orphanedSquashfs));
+    CHECK_FALSE(boost::filesystem::exists(orphanedMetadata));
+    CHECK(boost::filesystem::exists(recentSquashfs));
+    CHECK(imageStore.listImages() == std::vector<common::SarusImage>{imageVector[0]});
+}
+
 TEST(ImageStoreTestGroup, getImageID) {
     auto document = rapidjson::Document{};
     auto allocator = document.GetAllocator();
@@ -130,9 +215,232 @@ TEST(ImageStoreTestGroup, findImage) {
     // look an available tagged image by digest
     CHECK_FALSE(imageStore.findImage({"index.docker.io", "library", "alpine", "", "sha256:alpine-latest-digest"}));
 
-    // automatically remove an image without backing file
+    // an image without backing file is not found, its entry is removed when the images are listed
     boost::filesystem::remove(imageVector.back().imageFile);
     CHECK_FALSE(imageStore.findImage(refVector.back()));
+    CHECK(imageStore.listImages().size() == imageVector.size() - 1);
+}
+
+TEST(ImageStoreTestGroup, recordImageFileDigest) {
+    for (const auto& image : imageVector) {
+        addImageHarness(imageStore, image);
+    }
+    CHECK(imageStore.findImage(refVector[0])->imageFileDigest.empty());
+
+    // the digest of a replaced image is not recorded
+    imageStore.recordImageFileDigest(refVector[0], "other-image-id", "sha256:digest");
+    CHECK(imageStore.findImage(refVector[0])->imageFileDigest.empty());
+
+    imageStore.recordImageFileDigest(refVector[0], imageVector[0].id, "sha256:digest");
+    CHECK_EQUAL(imageStore.findImage(refVector[0])->imageFileDigest, std::string{"sha256:digest"});
+    CHECK(imageStore.findImage(refVector[1])->imageFileDigest.empty());
+
+    // the digest is dropped when the image is replaced
+    addImageHarness(imageStore, imageVector[0]);
+    CHECK(imageStore.findImage(refVector[0])->imageFileDigest.empty());
+}
+
+TEST(ImageStoreTestGroup, launchPathIsReadOnly) {
+    for (const auto& image : imageVector) {
+        addImageHarness(imageStore, image);
+    }
+    boost::filesystem::remove(imageVector.back().imageFile);
+    auto& config = *configRAII.config;
+    auto localRepositoryBaseDir = boost::filesystem::path{config.json["localRepositoryBaseDir"].GetString()};
+
+    // the accesses of "sarus run" to the repository: setup of the directories and lookup of the image
+    test_utility::filesystem::MutationCounter mutations{localRepositoryBaseDir};
+    config.directories.initialize(false, config, false);
+    auto launchImageStore = ImageStore{configRAII.config};
+    CHECK(launchImageStore.findImage(refVector[0]).value() == imageVector[0]);
+    CHECK_FALSE(launchImageStore.findImage(refVector.back()));
+    CHECK_FALSE(launchImageStore.findImage({"index.docker.io", "library", "fedora", "35", "sha256:fedora-35-digest"}));
+    CHECK_EQUAL(mutations.count(), 0);
+
+    // the directories of a repository which doesn't exist yet are not created
+    config.directories.initialize(true, config, false);
+    CHECK_FALSE(boost::filesystem::exists(config.directories.repository));
+    CHECK_FALSE(ImageStore{configRAII.config}.findImage(refVector[0]));
+    config.directories.initialize(false, config, false);
+
+    // the counter detects the writes of the commands which update the repository
+    launchImageStore.recordImageAccess(refVector[0]);
+    CHECK(mutations.count() > 0);
+    CHECK(launchImageStore.listImages().size() == imageVector.size() - 1);
+    CHECK(mutations.count() > 0);
+}
+
+TEST(ImageStoreTestGroup, tiers) {
+    auto& json = configRAII.config->json;
+    auto& allocator = json.GetAllocator();
+    auto flashBaseDir = boost::filesystem::path{json["localRepositoryBaseDir"].GetString()} / "flash";
+    auto tier = rapidjson::Value{rapidjson::kObjectType};
+    tier.AddMember("name", rapidjson::Value{"flash", allocator}, allocator);
+    tier.AddMember("localRepositoryBaseDir", rapidjson::Value{flashBaseDir.c_str(), allocator}, allocator);
+    tier.AddMember("maxImageSize", rapidjson::Value{std::uint64_t{1024}}, allocator);
+    tier.AddMember("minPullCount", rapidjson::Value{std::uint64_t{2}}, allocator);
+    auto tiers = rapidjson::Value{rapidjson::kArrayType};
+    tiers.PushBack(tier, allocator);
+    json.AddMember("imageTiers", tiers, allocator);
+
+    auto tieredStore = image_manager::ImageStore{ configRAII.config };
+    CHECK_EQUAL(tieredStore.getTiers().size(), 2);
+    CHECK_EQUAL(tieredStore.getTiers().front().name, std::string{"flash"});
+    CHECK(tieredStore.getTier("default").imagesDirectory == configRAII.config->directories.images);
+    CHECK_THROWS(common::Error, tieredStore.getTier("tape"));
+
+    // placement policy
+    const auto& ref = refVector[0];
+    const auto& image = imageVector[0];
+    CHECK_EQUAL(tieredStore.selectTier(ref, 512).name, std::string{"default"}); // first pull
+    addImageHarness(tieredStore, image);
+    CHECK_EQUAL(tieredStore.selectTier(ref, 512).name, std::string{"flash"}); // second pull
+    CHECK_EQUAL(tieredStore.selectTier(ref, 2048).name, std::string{"default"}); // too large
+
+    // migrate to the flash tier and back
+    const auto& flashTier = tieredStore.getTier("flash");
+    tieredStore.migrateImage(ref, "flash");
+    auto migrated = tieredStore.findImage(ref).value();
+    CHECK(migrated.imageFile == tieredStore.getImageSquashfsFile(ref, flashTier));
+    CHECK(migrated.metadataFile == tieredStore.getImageMetadataFile(ref, flashTier));
+    CHECK(boost::filesystem::exists(migrated.imageFile));
+    CHECK(boost::filesystem::exists(migrated.metadataFile));
+    CHECK_FALSE(boost::filesystem::exists(image.imageFile));
+    CHECK_FALSE(boost::filesystem::exists(image.metadataFile));
+    CHECK_EQUAL(tieredStore.listImages().size(), 1);
+
+    tieredStore.migrateImage(ref, "default");
+    CHECK(tieredStore.findImage(ref).value() == image);
+    CHECK(boost::filesystem::exists(image.imageFile));
+    CHECK_FALSE(boost::filesystem::exists(migrated.imageFile));
+
+    // migrating to the current tier leaves the backing files alone
+    tieredStore.migrateImage(ref, "default");
+    CHECK(tieredStore.findImage(ref).value().imageFile == image.imageFile);
+    CHECK(boost::filesystem::exists(image.imageFile));
+
+    // images not in the repository cannot be migrated
+    CHECK_THROWS(common::Error, tieredStore.migrateImage(refVector[1], "flash"));
+}
+
+TEST(ImageStoreTestGroup, backingFilesOutsideOfTiers) {
+    auto outsideDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-test-imagestore-outside")};
+    common::createFoldersIfNecessary(outsideDir.getPath());
+
+    // a backing file recorded outside of the tiers
+    auto image = imageVector[0];
+    image.imageFile = outsideDir.getPath() / "image.squashfs";
+    addImageHarness(imageStore, image);
+    CHECK_THROWS(common::Error, imageStore.findImage(refVector[0]));
+
+    // a lower image file escaping the tier
+    image = imageVector[0];
+    image.lowerImageFiles = {imageStore.getTier("default").imagesDirectory / ".." / "image.lower.squashfs"};
+    addImageHarness(imageStore, image);
+    CHECK_THROWS(common::Error, imageStore.findImage(refVector[0]));
+
+    // a backing file at the derived path which is a symlink out of the tier
+    image = imageVector[0];
+    addImageHarness(imageStore, image);
+    boost::filesystem::remove(image.imageFile);
+    common::createFileIfNecessary(outsideDir.getPath() / "image.squashfs");
+    boost::filesystem::create_symlink(outsideDir.getPath() / "image.squashfs", image.imageFile);
+    CHECK_THROWS(common::Error, imageStore.findImage(refVector[0]));
+
+    // the regular backing files
+    boost::filesystem::remove(image.imageFile);
+    image.lowerImageFiles = {imageStore.getLowerImageFile(image)};
+    addImageHarness(imageStore, image);
+    common::createFileIfNecessary(image.lowerImageFiles[0]);
+    CHECK(imageStore.findImage(refVector[0]).value() == image);
+}
+
+TEST(ImageStoreTestGroup, accessLog) {
+    for (const auto& image : imageVector) {
+        addImageHarness(imageStore, image);
+    }
+    auto logFile = access_log::getLogFile(imageStore.getRepositoryMetadataFile());
+    auto now = time(nullptr);
+
+    // launches are appended to the log
+    imageStore.recordImageAccess(refVector[0]);
+    imageStore.recordImageAccess(refVector[0]);
+    imageStore.recordImageAccess(refVector[2]);
+    CHECK(boost::filesystem::exists(logFile));
+
+    // a launch on another node, a torn record and a launch of an image not in the repository
+    access_log::appendRecord(logFile, access_log::Record{now - 60, "nid00002", refVector[0].getUniqueKey()});
+    std::ofstream{logFile.string(), std::ios::app} << "sarus-access 1 1000 nid00003\n";
+    access_log::appendRecord(logFile, access_log::Record{now, "nid00003", "index.docker.io/library/fedora/35"});
+
+    // the records are compacted into the statistics of the images when they are listed
+    auto images = imageStore.listImages();
+    CHECK_FALSE(boost::filesystem::exists(logFile));
+    CHECK_EQUAL(images[0].launchCount, 3);
+    CHECK_EQUAL(images[0].numberOfNodes, 2);
+    CHECK(images[0].lastUsed >= now);
+    CHECK_EQUAL(images[1].launchCount, 0);
+    CHECK_EQUAL(images[2].launchCount, 1);
+    CHECK_EQUAL(images[2].numberOfNodes, 1);
+
+    // the statistics are kept across compactions and pulls of the image
+    imageStore.recordImageAccess(refVector[0]);
+    addImageHarness(imageStore, imageVector[0]);
+    images = imageStore.listImages();
+    CHECK(images.back() == imageVector[0]);
+    CHECK_EQUAL(images.back().launchCount, 4);
+    CHECK_EQUAL(images.back().numberOfNodes, 2);
+
+    // the detached log of a compaction interrupted after the update of the statistics
+    // is removed without merging its records again
+    auto compactedLog = std::string{common::readJSON(imageStore.getRepositoryMetadataFile())["compactedAccessLog"].GetString()};
+    auto detachedLogFile = logFile.parent_path() / compactedLog;
+    access_log::appendRecord(detachedLogFile, access_log::Record{now, "nid00001", refVector[0].getUniqueKey()});
+    images = imageStore.listImages();
+    CHECK_FALSE(boost::filesystem::exists(detachedLogFile));
+    CHECK_EQUAL(images.back().launchCount, 4);
+
+    // while the detached log of a compaction interrupted before is merged
+    detachedLogFile = logFile.parent_path() / "access.log.compacting.interrupted";
+    access_log::appendRecord(detachedLogFile, access_log::Record{now, "nid00001", refVector[0].getUniqueKey()});
+    images = imageStore.listImages();
+    CHECK_FALSE(boost::filesystem::exists(detachedLogFile));
+    CHECK_EQUAL(images.back().launchCount, 5);
+
+    // a recorded launch keeps an image from being pruned, even if its squashfs file looks unused
+    auto oneHourAgo = now - 3600;
+    auto times = utimbuf{oneHourAgo - 1, oneHourAgo - 1};
+    CHECK(utime(imageVector[1].imageFile.c_str(), &times) == 0);
+    CHECK(utime(imageVector[2].imageFile.c_str(), &times) == 0);
+    auto filter = ImageStore::PruneFilter{};
+    filter.lastUsedBefore = oneHourAgo;
+    CHECK((imageStore.pruneImages(filter) == std::vector<common::SarusImage>{imageVector[1]}));
+}
+
+TEST(ImageStoreTestGroup, accessLogRecords) {
+    auto record = access_log::Record{1600000000, "nid00001", "index.docker.io/library/alpine/latest"};
+    auto line = access_log::formatRecord(record);
+    CHECK_EQUAL(line, std::string{"sarus-access 1 1600000000 nid00001 index.docker.io/library/alpine/latest"});
+    auto parsed = access_log::parseRecord(line);
+    CHECK(parsed);
+    CHECK_EQUAL(parsed->time, record.time);
+    CHECK_EQUAL(parsed->node, record.node);
+    CHECK_EQUAL(parsed->uniqueKey, record.uniqueKey);
+
+    // torn or interleaved records are skipped
+    CHECK_FALSE(access_log::parseRecord("sarus-access 1 1600000000 nid00001"));
+    CHECK_FALSE(access_log::parseRecord(line + " sarus-access"));
+    CHECK_FALSE(access_log::parseRecord("sarus-trace 1 1600000000 nid00001 index.docker.io/library/alpine/latest"));
+
+    // the nodes saturate at the maximum number of tracked nodes
+    auto usage = access_log::Usage{};
+    for(std::size_t i = 0; i < access_log::maxTrackedNodes + 10; ++i) {
+        access_log::mergeRecord(usage, access_log::Record{time_t(i), "nid" + std::to_string(i), record.uniqueKey});
+        access_log::mergeRecord(usage, access_log::Record{time_t(i), "nid" + std::to_string(i), record.uniqueKey});
+    }
+    CHECK_EQUAL(usage.launchCount, 2*(access_log::maxTrackedNodes + 10));
+    CHECK_EQUAL(usage.nodes.size(), access_log::maxTrackedNodes);
+    CHECK_EQUAL(usage.lastUsed, time_t(access_log::maxTrackedNodes + 9));
 }
 
 }}} // namespace
@@ -8,9 +8,20 @@
  *
  */
 
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include <rapidjson/document.h>
 
 #include "common/Logger.hpp"
+#include "common/PathRAII.hpp"
 #include "common/Utility.hpp"
 #include "image_manager/SkopeoDriver.hpp"
 #include "test_utility/config.hpp"
@@ -23,6 +34,43 @@ namespace test {
 TEST_GROUP(SkopeoDriverTestGroup) {
 };
 
+/**
+ * Joins the thread writing into a named pipe, also when the reader failed (e.g. an exception was
+ * thrown before Skopeo read the whole pipe): the rest of the pipe is drained, so that the writer
+ * is neither blocked in open() nor in write().
+ */
+class WriterJoiner {
+public:
+    WriterJoiner(std::thread& writer, const std::atomic<bool>& writerDone, const boost::filesystem::path& fifo)
+        : writer(writer), writerDone(writerDone), fifo(fifo)
+    {}
+    ~WriterJoiner() {
+        join();
+    }
+    void join() {
+        if(!writer.joinable()) {
+            return;
+        }
+        // opening a FIFO for reading and writing doesn't block on Linux
+        auto fd = open(fifo.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if(fd >= 0) {
+            char buffer[4096];
+            while(!writerDone) {
+                if(read(fd, buffer, sizeof(buffer)) <= 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                }
+            }
+            close(fd);
+        }
+        writer.join();
+    }
+
+private:
+    std::thread& writer;
+    const std::atomic<bool>& writerDone;
+    boost::filesystem::path fifo;
+};
+
 TEST(SkopeoDriverTestGroup, copyToOCIImage) {
     auto configRAII = test_utility::config::makeConfig();
     auto& config = configRAII.config;
@@ -62,6 +110,41 @@ TEST(SkopeoDriverTestGroup, copyToOCIImage) {
         CHECK(boost::filesystem::is_directory(ociImagePath / "blobs"));
         boost::filesystem::remove_all(ociImagePath);
     }
+    // Docker archive streamed through a named pipe
+    {
+        auto archive = boost::filesystem::path{__FILE__}.parent_path() / "saved_image.tar";
+        auto fifo = common::PathRAII{common::makeUniquePathWithRandomSuffix(config->directories.temp / "archive-fifo")};
+        if(mkfifo(fifo.getPath().c_str(), S_IRUSR | S_IWUSR) != 0) {
+            FAIL("Could not create named pipe");
+        }
+
+        // opening the pipe for writing blocks until Skopeo opens it for reading. If Skopeo fails
+        // before reading the whole pipe, the writes fail with EPIPE instead of killing the test.
+        signal(SIGPIPE, SIG_IGN);
+        std::atomic<bool> writerDone{false};
+        auto writer = std::thread{[&archive, &fifo, &writerDone]() {
+            {
+                std::ifstream in{archive.string(), std::ios::binary};
+                std::ofstream out{fifo.getPath().string(), std::ios::binary};
+                out << in.rdbuf();
+            }
+            writerDone = true;
+        }};
+        WriterJoiner writerJoiner{writer, writerDone, fifo.getPath()};
+        auto ociImagePath = driver.copyToOCIImage("docker-archive", fifo.getPath().string());
+        writerJoiner.join();
+
+        auto imageIndex = common::readJSON(ociImagePath / "index.json");
+        std::string imageRef;
+        try {
+            imageRef = imageIndex["manifests"][0]["annotations"]["org.opencontainers.image.ref.name"].GetString();
+        }
+        catch (std::exception& e) {
+            FAIL("Could not find OCI Image ref name inside index.json");
+        }
+        CHECK_EQUAL(imageRef, std::string{"sarus-oci-image"});
+        boost::filesystem::remove_all(ociImagePath);
+    }
 }
 
 TEST(SkopeoDriverTestGroup, inspectRaw) {
@@ -20,6 +20,7 @@
 #include "common/Config.hpp"
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
+#include "common/Metrics.hpp"
 #include "common/Utility.hpp"
 #include "cli/CLI.hpp"
 #include "runtime/SecurityChecks.hpp"
@@ -46,17 +47,26 @@ int main(int argc, char* argv[]) {
     try {
         auto program_start = std::chrono::high_resolution_clock::now();
 
-        // Initialize Config object
+        // Initialize Config object: sarus.json is read, validated and checked only
+        // for the commands which need it (e.g. not for "sarus version" or "sarus help").
+        // The commands which need it get all of it: the sections are not set up per command
         auto sarusInstallationPrefixDir = boost::filesystem::canonical("/proc/self/exe").parent_path().parent_path();
-        auto config = std::make_shared<sarus::common::Config>(sarusInstallationPrefixDir);
+        auto config = std::make_shared<sarus::common::Config>();
         config->program_start = program_start;
-        runtime::SecurityChecks{config}.runSecurityChecks(sarusInstallationPrefixDir);
-        config->commandRun.hostEnvironment = common::parseEnvironmentVariables(environ);
-
+        auto initializeConfig = [&sarusInstallationPrefixDir](const std::shared_ptr<common::Config>& config) {
+            config->json = common::readAndValidateJSON(sarusInstallationPrefixDir / "etc/sarus.json",
+                                                       sarusInstallationPrefixDir / "etc/sarus.schema.json");
+            common::Metrics::getInstance().configure(*config);
+            {
+                auto timer = common::Metrics::ScopedTimer{"sarus_security_checks"};
+                runtime::SecurityChecks{config}.runSecurityChecks(sarusInstallationPrefixDir);
+            }
+            config->commandRun.hostEnvironment = common::parseEnvironmentVariables(environ);
+        };
 
         // Process command
         auto args = common::CLIArguments(argc, argv);
-        auto command = cli::CLI{}.parseCommandLine(args, config);
+        auto command = cli::CLI{initializeConfig}.parseCommandLine(args, config);
         if(!command->requiresRootPrivileges()) {
             dropPrivileges(*config);
         }
@@ -67,15 +77,20 @@ int main(int argc, char* argv[]) {
     }
     catch(const common::Error& e) {
         logger.logErrorTrace(e, "main");
+        common::Metrics::getInstance().incrementCounter("sarus_failures");
+        common::Metrics::getInstance().flush();
         return 1;
     }
     catch(const std::exception& e) {
         auto message = boost::format("Caught exception in main function. No error trace available."
                                      " Exception message: %s") % e.what();
         logger.log(message.str(), "main", common::LogLevel::ERROR);
+        common::Metrics::getInstance().incrementCounter("sarus_failures");
+        common::Metrics::getInstance().flush();
         return 1;
     }
 
+    common::Metrics::getInstance().flush();
     return 0;
 }
 
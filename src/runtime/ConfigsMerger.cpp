@@ -51,6 +51,12 @@ std::unordered_map<std::string, std::string> ConfigsMerger::getEnvironmentInCont
         }
     }
 
+    if (const rapidjson::Value* hugePagesSupport = rapidjson::Pointer("/enableHugePagesSupport").Get(config->json)) {
+        if (hugePagesSupport->GetBool()) {
+            setHugePagesEnvironmentVariables(config->commandRun.hostEnvironment, env);
+        }
+    }
+
     if(config->commandRun.addInitProcess) {
         env["TINI_SUBREAPER"] = "1";
     }
@@ -131,6 +137,16 @@ std::unordered_map<std::string, std::string> ConfigsMerger::getBundleAnnotations
     auto level = static_cast<IntType>(common::Logger::getInstance().getLevel());
     annotations["com.hooks.logging.level"] = std::to_string(level);
 
+    // the hooks open the metrics sinks as root on the host, thus only sarus.json can set them
+    annotations.erase("com.hooks.metrics.textfileDirectory");
+    annotations.erase("com.hooks.metrics.socket");
+    if(const auto* value = rapidjson::Pointer("/metrics/textfileDirectory").Get(config->json)) {
+        annotations["com.hooks.metrics.textfileDirectory"] = value->GetString();
+    }
+    if(const auto* value = rapidjson::Pointer("/metrics/socket").Get(config->json)) {
+        annotations["com.hooks.metrics.socket"] = value->GetString();
+    }
+
     return annotations;
 }
 
@@ -192,6 +208,20 @@ void ConfigsMerger::setNvidiaEnvironmentVariables(const std::unordered_map<std::
     }
 }
 
+/**
+ * Forwards the libhugetlbfs settings of the host (e.g. HUGETLB_DEFAULT_PAGE_SIZE and HUGETLB_MORECORE,
+ * as set by the huge pages modules of HPC programming environments) with precedence over the image.
+ */
+void ConfigsMerger::setHugePagesEnvironmentVariables(const std::unordered_map<std::string, std::string>& hostEnvironment,
+                                                     std::unordered_map<std::string, std::string>& containerEnvironment
+                                                     ) const {
+    for(const auto& variable : hostEnvironment) {
+        if(boost::starts_with(variable.first, "HUGETLB_")) {
+            containerEnvironment[variable.first] = variable.second;
+        }
+    }
+}
+
 void ConfigsMerger::setPMIxMcaEnvironmentVariables(const std::unordered_map<std::string, std::string>& hostEnvironment,
                                                 std::unordered_map<std::string, std::string>& containerEnvironment
                                                 ) const {
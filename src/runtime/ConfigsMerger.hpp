@@ -36,6 +36,7 @@ public:
     std::unordered_map<std::string, std::string> getEnvironmentInContainer() const;
     std::unordered_map<std::string, std::string> getBundleAnnotations() const;
     common::CLIArguments getCommandToExecuteInContainer() const;
+    const boost::optional<common::LibraryCatalogue>& getLibraryCatalogue() const { return metadata.libraryCatalogue; }
 
 private:
     std::shared_ptr<const common::Config> config;
@@ -46,6 +47,9 @@ private:
     void setPMIxMcaEnvironmentVariables(
             const std::unordered_map<std::string, std::string>& hostEnvironment,
             std::unordered_map<std::string, std::string>& containerEnvironment) const;
+    void setHugePagesEnvironmentVariables(
+            const std::unordered_map<std::string, std::string>& hostEnvironment,
+            std::unordered_map<std::string, std::string>& containerEnvironment) const;
 };
 
 }
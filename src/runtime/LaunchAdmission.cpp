@@ -0,0 +1,240 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "LaunchAdmission.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <boost/format.hpp>
+#include <rapidjson/pointer.h>
+
+#include "common/Error.hpp"
+#include "common/Utility.hpp"
+#include "runtime/Utility.hpp"
+
+
+namespace sarus {
+namespace runtime {
+
+static const auto initialMaxDelay = std::chrono::milliseconds{10};
+
+boost::optional<LaunchAdmission::Settings> LaunchAdmission::getSettings(const common::Config& config) {
+    const auto* json = rapidjson::Pointer("/launchAdmission").Get(config.json);
+    if(!json) {
+        return boost::none;
+    }
+    auto settings = Settings{};
+    settings.maxLaunchesPerNode = (*json)["maxConcurrentLaunchesPerNode"].GetUint64();
+    settings.maxLaunchesPerJob = json->HasMember("maxConcurrentLaunchesPerJob")
+        ? (*json)["maxConcurrentLaunchesPerJob"].GetUint64() : 0;
+    if(json->HasMember("jobTokensDirectory")) {
+        settings.jobTokensDirectory = (*json)["jobTokensDirectory"].GetString();
+    }
+    settings.maxJitter = std::chrono::milliseconds{json->HasMember("maxJitterMs")
+        ? (*json)["maxJitterMs"].GetUint64() : 500};
+    settings.timeout = std::chrono::seconds{json->HasMember("timeoutSeconds")
+        ? (*json)["timeoutSeconds"].GetUint64() : 300};
+    return settings;
+}
+
+boost::filesystem::path LaunchAdmission::getSlotsDirectory(const common::Config& config) {
+    return boost::filesystem::path{config.json["OCIBundleDir"].GetString()} / "admission";
+}
+
+LaunchAdmission::LaunchAdmission(std::shared_ptr<const common::Config> config)
+    : LaunchAdmission{std::move(config), utility::getJobIDOfProcess()}
+{}
+
+/**
+ * The job ID is part of the names of the tokens, thus only a numeric ID is used
+ */
+LaunchAdmission::LaunchAdmission(std::shared_ptr<const common::Config> config, const std::string& jobID)
+    : config{std::move(config)}
+    , settings{getSettings(*this->config)}
+{
+    if(!settings) {
+        return;
+    }
+    generator.seed(std::random_device()());
+    auto isNumeric = !jobID.empty() && std::all_of(jobID.cbegin(), jobID.cend(), ::isdigit);
+    admit(isNumeric ? jobID : std::string{});
+}
+
+LaunchAdmission::~LaunchAdmission() {
+    try {
+        release();
+    }
+    catch(const std::exception& e) {
+        utility::logMessage(boost::format("Failed to release launch admission: %s") % e.what(),
+                            common::LogLevel::WARN);
+    }
+}
+
+/**
+ * The job-wide token is requested while holding the node-wide slot, so that the launches
+ * of a node don't compete for the tokens of the shared filesystem all at once
+ */
+void LaunchAdmission::admit(const std::string& jobID) {
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + settings->timeout;
+    auto isJobLimited = settings->maxLaunchesPerJob > 0 && !jobID.empty();
+
+    common::createFoldersIfNecessary(getSlotsDirectory(*config));
+    auto maxDelay = std::min(initialMaxDelay, settings->maxJitter);
+    while(!tryAcquireSlot() && std::chrono::steady_clock::now() < deadline) {
+        waitBeforeNextAttempt(maxDelay);
+    }
+
+    if(isJobLimited) {
+        maxDelay = std::min(initialMaxDelay, settings->maxJitter);
+        while(!tryAcquireToken(jobID) && std::chrono::steady_clock::now() < deadline) {
+            waitBeforeNextAttempt(maxDelay);
+        }
+    }
+
+    waitTime = std::chrono::steady_clock::now() - start;
+    if(!hasSlot() || (isJobLimited && !hasToken())) {
+        auto message = boost::format("Launch was not admitted within %d seconds (node slot: %s, job token: %s),"
+                                     " proceeding anyway")
+            % settings->timeout.count() % (hasSlot() ? "yes" : "no") % (hasToken() ? "yes" : "no");
+        utility::logMessage(message, common::LogLevel::WARN);
+        return;
+    }
+    utility::logMessage(boost::format("Launch admitted after waiting %.3f seconds") % waitTime.count(),
+                        common::LogLevel::INFO);
+}
+
+/**
+ * The slots are tried starting from a random one, so that concurrent launches
+ * don't contend for the first slots
+ */
+bool LaunchAdmission::tryAcquireSlot() {
+    auto slotsDirectory = getSlotsDirectory(*config);
+    auto numberOfSlots = settings->maxLaunchesPerNode;
+    auto offset = std::uniform_int_distribution<std::size_t>{0, numberOfSlots - 1}(generator);
+    for(std::size_t i = 0; i < numberOfSlots; ++i) {
+        auto slot = slotsDirectory / ("slot-" + std::to_string((offset + i) % numberOfSlots));
+        auto fd = open(slot.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, S_IRUSR | S_IWUSR);
+        if(fd < 0) {
+            auto message = boost::format("Failed to open launch admission slot %s: %s") % slot % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        if(flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            slotFd = fd;
+            utility::logMessage(boost::format("Acquired launch admission slot %s") % slot, common::LogLevel::DEBUG);
+            return true;
+        }
+        close(fd);
+    }
+    return false;
+}
+
+/**
+ * Each attempt tries a single random token, thus it costs one or two metadata operations
+ * on the shared filesystem, regardless of the job-wide limit. The tokens are created with
+ * the identity of the user, since root may be squashed on the shared filesystem.
+ */
+bool LaunchAdmission::tryAcquireToken(const std::string& jobID) {
+    auto index = std::uniform_int_distribution<std::size_t>{0, settings->maxLaunchesPerJob - 1}(generator);
+    auto file = settings->jobTokensDirectory / (boost::format("%s.%d.token") % jobID % index).str();
+
+    auto rootIdentity = common::UserIdentity{};
+    common::setFilesystemUid(config->userIdentity);
+    auto fd = open(file.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, S_IRUSR | S_IWUSR);
+    auto openErrno = errno;
+    if(fd >= 0) {
+        auto owner = (boost::format("%s %d\n") % common::getHostname() % getpid()).str();
+        auto written = write(fd, owner.c_str(), owner.size());
+        (void)written; // the owner is informative only
+        close(fd);
+        token = file;
+    }
+    else if(openErrno == EEXIST) {
+        // a token older than the timeout was left over by a launch which died
+        struct stat st;
+        if(fstatat(AT_FDCWD, file.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0
+           && st.st_mtime < time(nullptr) - settings->timeout.count()) {
+            removeStaleToken(file, st);
+        }
+    }
+    common::setFilesystemUid(rootIdentity);
+
+    if(fd < 0 && openErrno != EEXIST) {
+        auto message = boost::format("Failed to create launch admission token %s: %s") % file % strerror(openErrno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    if(token) {
+        utility::logMessage(boost::format("Acquired launch admission token %s") % file, common::LogLevel::DEBUG);
+    }
+    return static_cast<bool>(token);
+}
+
+/**
+ * Another launch may have removed the stale token and created a new one after the token was
+ * found stale, thus the token is first renamed aside, which is atomic, and the file renamed aside
+ * is removed only if it is still the stale one. Otherwise it is linked back to its name, unless
+ * yet another token was created there meanwhile: then one more launch is admitted.
+ */
+void LaunchAdmission::removeStaleToken(const boost::filesystem::path& file, const struct stat& staleStat) const {
+    auto aside = common::makeUniquePathWithRandomSuffix(file.string() + ".stale");
+    if(rename(file.c_str(), aside.c_str()) != 0) {
+        return;
+    }
+    struct stat st;
+    auto isStale = fstatat(AT_FDCWD, aside.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0
+        && st.st_ino == staleStat.st_ino && st.st_dev == staleStat.st_dev
+        && st.st_mtime == staleStat.st_mtime;
+    if(!isStale && link(aside.c_str(), file.c_str()) != 0) {
+        utility::logMessage(boost::format("Failed to restore launch admission token %s: %s") % file % strerror(errno),
+                            common::LogLevel::WARN);
+    }
+    unlink(aside.c_str());
+    if(isStale) {
+        utility::logMessage(boost::format("Removed stale launch admission token %s") % file, common::LogLevel::INFO);
+    }
+}
+
+void LaunchAdmission::waitBeforeNextAttempt(std::chrono::milliseconds& maxDelay) {
+    auto delay = std::uniform_int_distribution<std::chrono::milliseconds::rep>{maxDelay.count() / 2, maxDelay.count()}(generator);
+    std::this_thread::sleep_for(std::chrono::milliseconds{delay});
+    maxDelay = std::min(maxDelay * 2, settings->maxJitter);
+}
+
+void LaunchAdmission::release() {
+    if(token) {
+        auto rootIdentity = common::UserIdentity{};
+        common::setFilesystemUid(config->userIdentity);
+        auto status = unlink(token->c_str());
+        auto unlinkErrno = errno;
+        common::setFilesystemUid(rootIdentity);
+        if(status != 0 && unlinkErrno != ENOENT) {
+            auto message = boost::format("Failed to remove launch admission token %s: %s") % *token % strerror(unlinkErrno);
+            utility::logMessage(message, common::LogLevel::WARN);
+        }
+        token = boost::none;
+    }
+    if(slotFd >= 0) {
+        close(slotFd);
+        slotFd = -1;
+    }
+}
+
+}
+}
@@ -0,0 +1,98 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_runtime_LaunchAdmission_hpp
+#define sarus_runtime_LaunchAdmission_hpp
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common/Config.hpp"
+
+
+namespace sarus {
+namespace runtime {
+
+/**
+ * Admission control of the launches, configured with the "launchAdmission" parameter: limits how
+ * many launches are in their I/O-heavy phases at once (the lookup of the image in the repository
+ * and the setup of the OCI bundle, e.g. the loop mount of the image), so that a launch storm of
+ * thousands of ranks doesn't hit the shared filesystems all at once.
+ *
+ * - The node-wide limit is a semaphore of slot files in a node-local directory: an admitted launch
+ *   holds the lock (flock) of one slot, thus the kernel releases the slot of a launch which died.
+ * - The optional job-wide limit is a set of token files on a shared filesystem, which the launches
+ *   of the same job create atomically (O_CREAT|O_EXCL) and remove when they are released. A token
+ *   older than the timeout is considered left over by a launch which died: it is renamed aside
+ *   (atomically) and removed, or renamed back if it turns out to be a token created meanwhile.
+ *
+ * The attempts of a waiting launch are spaced by a random delay, whose upper bound doubles up to
+ * the configured maximum, so that the waiting launches don't retry in lockstep. A launch which is
+ * not admitted within the timeout proceeds anyway, rather than failing the job.
+ */
+class LaunchAdmission {
+public:
+    struct Settings {
+        std::size_t maxLaunchesPerNode;
+        std::size_t maxLaunchesPerJob; // 0 if there is no job-wide limit
+        boost::filesystem::path jobTokensDirectory;
+        std::chrono::milliseconds maxJitter;
+        std::chrono::seconds timeout;
+    };
+
+public:
+    static boost::optional<Settings> getSettings(const common::Config& config);
+    static boost::filesystem::path getSlotsDirectory(const common::Config& config);
+
+public:
+    // waits until the launch is admitted, or does nothing if admission control is not configured.
+    // The job is the Slurm job whose cgroup contains the process (see utility::getJobIDOfProcess).
+    LaunchAdmission(std::shared_ptr<const common::Config> config);
+    // as above, for the given job ID (empty if the launch is not part of a job)
+    LaunchAdmission(std::shared_ptr<const common::Config> config, const std::string& jobID);
+    LaunchAdmission(const LaunchAdmission&) = delete;
+    LaunchAdmission& operator=(const LaunchAdmission&) = delete;
+    ~LaunchAdmission();
+
+    bool isEnabled() const { return static_cast<bool>(settings); }
+    bool hasSlot() const { return slotFd >= 0; }
+    bool hasToken() const { return static_cast<bool>(token); }
+    // seconds waited for the admission
+    double getWaitTime() const { return waitTime.count(); }
+    void release();
+
+private:
+    void admit(const std::string& jobID);
+    bool tryAcquireSlot();
+    bool tryAcquireToken(const std::string& jobID);
+    void removeStaleToken(const boost::filesystem::path& file, const struct stat& staleStat) const;
+    void waitBeforeNextAttempt(std::chrono::milliseconds& maxDelay);
+
+private:
+    std::shared_ptr<const common::Config> config;
+    boost::optional<Settings> settings;
+    int slotFd = -1;
+    boost::optional<boost::filesystem::path> token;
+    std::chrono::duration<double> waitTime{0};
+    std::mt19937 generator;
+};
+
+}
+}
+
+#endif
@@ -44,7 +44,12 @@ void OCIBundleConfig::generateConfigFile() const {
     common::createFileIfNecessary(configFile);
     boost::filesystem::permissions(configFile, boost::filesystem::perms::owner_read |
                                                boost::filesystem::perms::owner_write);
-    common::writeJSON(*document, configFile);
+    // compact form: the file is only read by the OCI runtime and the hooks
+    common::writeJSON(*document, configFile, false);
+
+    if(const auto& libraryCatalogue = configsMerger.getLibraryCatalogue()) {
+        libraryCatalogue->write(configFile.parent_path() / common::LibraryCatalogue::fileNameInBundle);
+    }
     utility::logMessage("Successfully generated bundle's config file", common::LogLevel::INFO);
 }
 
@@ -150,7 +155,7 @@ rj::Value OCIBundleConfig::makeMemberRoot() const {
                     rj::Value{config->json["rootfsFolder"].GetString(), *allocator},
                     *allocator);
     root.AddMember( "readonly",
-                    rj::Value{false},
+                    rj::Value{config->commandRun.readOnlyRootfs},
                     *allocator);
     return root;
 }
@@ -299,6 +304,12 @@ rj::Value OCIBundleConfig::makeMemberLinux() const {
         auto cpuAffinity = rj::Value{cpus.c_str(), *allocator};
         cpu.AddMember("cpus", cpuAffinity, *allocator);
 
+        // memory nodes local to the CPUs, see Runtime::getMemoryNodes()
+        if(!config->commandRun.memoryNodes.empty()) {
+            auto mems = boost::join(config->commandRun.memoryNodes | intToString, ",");
+            cpu.AddMember("mems", rj::Value{mems.c_str(), *allocator}, *allocator);
+        }
+
         // devices
         auto devices = rj::Value{rj::kArrayType};
         auto denyAllRule = rj::Value{rj::kObjectType};
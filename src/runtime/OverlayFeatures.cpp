@@ -0,0 +1,204 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "OverlayFeatures.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mount.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <rapidjson/document.h>
+
+#include "common/Error.hpp"
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "runtime/Utility.hpp"
+
+
+namespace rj = rapidjson;
+
+namespace sarus {
+namespace runtime {
+
+const std::vector<std::string> OverlayFeatures::probedOptions = {
+    "volatile",
+    "metacopy=on",
+    "redirect_dir=on",
+    "index=off",
+    "xino=off"
+};
+
+OverlayFeatures::OverlayFeatures(const std::string& bootID, const std::vector<std::string>& supportedOptions)
+    : bootID{bootID}
+    , supportedOptions{supportedOptions}
+{}
+
+std::string OverlayFeatures::getBootID() {
+    return boost::algorithm::trim_copy(common::readFile("/proc/sys/kernel/random/boot_id"));
+}
+
+/**
+ * A cache which can't be read (e.g. at the first launch after a boot) or written
+ * (e.g. because of a full filesystem) only costs the probe
+ */
+OverlayFeatures OverlayFeatures::detect(const boost::filesystem::path& cacheFile, const boost::filesystem::path& scratchDir) {
+    auto bootID = getBootID();
+    if(boost::filesystem::exists(cacheFile)) {
+        try {
+            auto cached = readCache(cacheFile);
+            if(cached.bootID == bootID) {
+                utility::logMessage(boost::format("Using OverlayFS features cached in %s") % cacheFile,
+                                    common::LogLevel::DEBUG);
+                return cached;
+            }
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Ignoring cache of OverlayFS features %s: %s") % cacheFile % e.what();
+            utility::logMessage(message, common::LogLevel::INFO);
+        }
+    }
+
+    auto features = probe(scratchDir);
+    try {
+        features.writeCache(cacheFile);
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Failed to cache OverlayFS features in %s: %s") % cacheFile % e.what();
+        utility::logMessage(message, common::LogLevel::WARN);
+    }
+    return features;
+}
+
+static bool isOptionSupported(const boost::filesystem::path& dir, const std::string& option) {
+    for(const auto* subdir : {"lower", "upper", "work", "merged"}) {
+        common::createFoldersIfNecessary(dir / subdir);
+    }
+    auto options = boost::format("lowerdir=%s,upperdir=%s,workdir=%s,%s")
+        % (dir / "lower").string() % (dir / "upper").string() % (dir / "work").string() % option;
+    if(mount("overlay", (dir / "merged").c_str(), "overlay", MS_MGC_VAL, options.str().c_str()) != 0) {
+        auto message = boost::format("OverlayFS option %s is not supported: %s") % option % strerror(errno);
+        utility::logMessage(message, common::LogLevel::DEBUG);
+        return false;
+    }
+    umount2((dir / "merged").c_str(), MNT_DETACH);
+    return true;
+}
+
+/**
+ * Each option is probed on its own overlay, since some options leave state
+ * in the work directory (e.g. the index or the "volatile" marker)
+ */
+OverlayFeatures OverlayFeatures::probe(const boost::filesystem::path& scratchDir) {
+    utility::logMessage("Probing OverlayFS features of the kernel", common::LogLevel::INFO);
+
+    auto scratchDirRAII = common::PathRAII{scratchDir};
+    common::createFoldersIfNecessary(scratchDir);
+    if(mount(NULL, scratchDir.c_str(), "tmpfs", MS_NOSUID | MS_NODEV, "size=1m") != 0) {
+        auto message = boost::format("Failed to mount scratch filesystem for OverlayFS probe on %s: %s")
+            % scratchDir % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto supportedOptions = std::vector<std::string>{};
+    try {
+        for(std::size_t i = 0; i < probedOptions.size(); ++i) {
+            if(isOptionSupported(scratchDir / std::to_string(i), probedOptions[i])) {
+                supportedOptions.push_back(probedOptions[i]);
+            }
+        }
+    }
+    catch(const std::exception& e) {
+        umount2(scratchDir.c_str(), MNT_DETACH);
+        SARUS_RETHROW_ERROR(e, "Failed to probe OverlayFS features");
+    }
+    umount2(scratchDir.c_str(), MNT_DETACH);
+
+    auto message = boost::format("Supported OverlayFS options: %s") % boost::algorithm::join(supportedOptions, ",");
+    utility::logMessage(message, common::LogLevel::INFO);
+    return OverlayFeatures{getBootID(), supportedOptions};
+}
+
+bool OverlayFeatures::isSupported(const std::string& option) const {
+    return std::find(supportedOptions.cbegin(), supportedOptions.cend(), option) != supportedOptions.cend();
+}
+
+/**
+ * The "performance" profile makes the upper layer volatile only when it is discarded at teardown:
+ * a volatile upper layer can't be mounted again after a crash, which would break a persistent layer
+ */
+std::vector<std::string> OverlayFeatures::getMountOptions(const std::string& profile, bool isUpperDirTemporary) const {
+    if(profile == "default") {
+        return {};
+    }
+    if(profile != "performance") {
+        auto message = boost::format("Unknown OverlayFS mount profile '%s'") % profile;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto options = std::vector<std::string>{};
+    if(isUpperDirTemporary && isSupported("volatile")) {
+        options.push_back("volatile");
+    }
+    // a persistent upper layer written with metadata-only copy-ups and redirects would be corrupted
+    // when mounted without them, e.g. by a later launch which falls back to the default options
+    if(isUpperDirTemporary && isSupported("metacopy=on") && isSupported("redirect_dir=on")) {
+        options.push_back("redirect_dir=on");
+        options.push_back("metacopy=on");
+    }
+    for(const auto* option : {"index=off", "xino=off"}) {
+        if(isSupported(option)) {
+            options.push_back(option);
+        }
+    }
+    return options;
+}
+
+/**
+ * The cache is replaced atomically, since concurrent launches may probe and write it
+ */
+void OverlayFeatures::writeCache(const boost::filesystem::path& cacheFile) const {
+    auto json = rj::Document{rj::kObjectType};
+    auto& allocator = json.GetAllocator();
+    json.AddMember("bootID", rj::Value{bootID.c_str(), allocator}, allocator);
+    auto options = rj::Value{rj::kArrayType};
+    for(const auto& option : supportedOptions) {
+        options.PushBack(rj::Value{option.c_str(), allocator}, allocator);
+    }
+    json.AddMember("supportedOptions", options, allocator);
+
+    auto temporaryFile = common::PathRAII{common::makeUniquePathWithRandomSuffix(cacheFile)};
+    common::writeJSON(json, temporaryFile.getPath());
+    boost::filesystem::rename(temporaryFile.getPath(), cacheFile);
+    temporaryFile.release();
+}
+
+OverlayFeatures OverlayFeatures::readCache(const boost::filesystem::path& cacheFile) {
+    auto json = common::readJSON(cacheFile);
+    if(!json.IsObject()
+       || !json.HasMember("bootID") || !json["bootID"].IsString()
+       || !json.HasMember("supportedOptions") || !json["supportedOptions"].IsArray()) {
+        auto message = boost::format("Malformed cache of OverlayFS features %s") % cacheFile;
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto supportedOptions = std::vector<std::string>{};
+    for(const auto& option : json["supportedOptions"].GetArray()) {
+        if(option.IsString()) {
+            supportedOptions.emplace_back(option.GetString());
+        }
+    }
+    return OverlayFeatures{json["bootID"].GetString(), supportedOptions};
+}
+
+}
+}
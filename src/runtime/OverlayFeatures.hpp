@@ -0,0 +1,65 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_runtime_OverlayFeatures_hpp
+#define sarus_runtime_OverlayFeatures_hpp
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+
+namespace sarus {
+namespace runtime {
+
+/**
+ * The OverlayFS mount options supported by the running kernel, among those which reduce the cost
+ * of the writes and copy-ups of the containers:
+ *
+ * - "volatile" (Linux 5.10) skips the syncs of the upper layer, which is discarded at teardown anyway;
+ * - "metacopy=on" (Linux 4.19) copies up only the metadata of the files whose metadata is changed
+ *   (e.g. with chmod or chown), requires "redirect_dir=on", both used only for a temporary upper layer;
+ * - "index=off" and "xino=off" (Linux 4.13 and 4.17) spare the bookkeeping of hard links and
+ *   inode numbers, which the containers don't need.
+ *
+ * The options are probed with test mounts on a scratch RAM filesystem, since the kernel version
+ * doesn't tell which ones are compiled in or backported. The results are cached in a file together
+ * with the boot ID of the kernel, thus they are probed once per boot.
+ */
+class OverlayFeatures {
+public:
+    static const std::vector<std::string> probedOptions;
+
+public:
+    // returns the cached features, or probes them and caches them
+    static OverlayFeatures detect(const boost::filesystem::path& cacheFile, const boost::filesystem::path& scratchDir);
+    static OverlayFeatures probe(const boost::filesystem::path& scratchDir);
+    static std::string getBootID();
+
+    OverlayFeatures(const std::string& bootID, const std::vector<std::string>& supportedOptions);
+
+    bool isSupported(const std::string& option) const;
+    const std::vector<std::string>& getSupportedOptions() const { return supportedOptions; }
+    // the supported options of the given profile ("default" or "performance")
+    std::vector<std::string> getMountOptions(const std::string& profile, bool isUpperDirTemporary) const;
+
+    void writeCache(const boost::filesystem::path& cacheFile) const;
+    static OverlayFeatures readCache(const boost::filesystem::path& cacheFile);
+
+private:
+    std::string bootID;
+    std::vector<std::string> supportedOptions;
+};
+
+}
+}
+
+#endif
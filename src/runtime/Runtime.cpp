@@ -11,24 +11,38 @@
 #include "Runtime.hpp"
 
 #include <type_traits>
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <functional>
+#include <utility>
 #include <sched.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/mount.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 #include <sys/prctl.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/range/adaptor/transformed.hpp>
 
 #include "common/Error.hpp"
+#include "common/FileStore.hpp"
+#include "common/ImageFileIndex.hpp"
+#include "common/ImageMetadata.hpp"
 #include "common/Utility.hpp"
 #include "common/ImageReference.hpp"
 #include "common/CLIArguments.hpp"
+#include "common/Sha256.hpp"
 #include "runtime/Utility.hpp"
+#include "runtime/Mount.hpp"
 #include "runtime/mount_utilities.hpp"
 
 
@@ -46,21 +60,32 @@ Runtime::Runtime(std::shared_ptr<common::Config> config)
 
     auto status = common::readFile("/proc/self/status");
     config->commandRun.cpuAffinity = common::getCpuAffinity();
+    config->commandRun.memoryNodes = getMemoryNodes();
 }
 
 void Runtime::setupOCIBundle() {
     utility::logMessage("Setting up OCI Bundle", common::LogLevel::INFO);
 
     setupMountIsolation();
+    setupTeardownRecord();
+    detectOverlayFeaturesIfNecessary();
     setupRamFilesystem();
     mountImageIntoRootfs();
     setupDevFilesystem();
-    copyEtcFilesIntoRootfs();
+    if(config->commandRun.readOnlyRootfs) {
+        mountEtcFilesIntoRootfs();
+        mountTmpFilesystemIntoRootfs();
+    }
+    else {
+        copyEtcFilesIntoRootfs();
+    }
     mountInitProgramIntoRootfsIfNecessary();
     performCustomMounts();
     performExtraMounts();
     performDeviceMounts();
-    remountRootfsWithNoSuid();
+    if(!config->commandRun.readOnlyRootfs) {
+        remountRootfsWithNoSuid(); // the read-only rootfs is mounted with MS_NOSUID
+    }
     fdHandler.preservePMIFdIfAny();
     fdHandler.passStdoutAndStderrToHooks();
     fdHandler.applyChangesToFdsAndEnvVariablesAndBundleAnnotations();
@@ -69,7 +94,7 @@ void Runtime::setupOCIBundle() {
     utility::logMessage("Successfully set up OCI Bundle", common::LogLevel::INFO);
 }
 
-void Runtime::executeContainer() const {
+void Runtime::executeContainer() {
     auto containerID = "container-" + common::generateRandomString(16);
     utility::logMessage("Executing " + containerID, common::LogLevel::INFO);
 
@@ -102,6 +127,7 @@ void Runtime::executeContainer() const {
     auto status = common::forkExecWait(args,
                                        std::function<void()>{std::bind(setParentDeathSignal, getpid())},
                                        std::function<void(pid_t)>{utility::setupSignalProxying});
+    teardownInBackground();
     if(status != 0) {
         auto message = boost::format("%s exited with code %d") % args % status;
         utility::logMessage(message, common::LogLevel::INFO);
@@ -111,6 +137,99 @@ void Runtime::executeContainer() const {
     utility::logMessage("Successfully executed " + containerID, common::LogLevel::INFO);
 }
 
+/**
+ * Finishes the stale teardowns of previous containers, then records the teardown of this one.
+ * The record is created before the RAM filesystem of the bundle hides the records directory.
+ */
+void Runtime::setupTeardownRecord() {
+    auto recordsDir = TeardownRecord::getRecordsDirectory(*config);
+    TeardownRecord::finishStaleTeardowns(recordsDir, config->json["runcPath"].GetString());
+    teardownRecord.reset(new TeardownRecord{recordsDir});
+}
+
+/**
+ * Starts the container of a session: the container is created through the OCI runtime, but its
+ * process is never started. The container's namespaces and mounts, including the changes of the
+ * hooks, thus persist and "sarus session exec" launches further processes into the container
+ * through the OCI runtime, skipping the setup of the bundle. A detached supervisor creates the
+ * container as a child subreaper, so that the container's init process is reparented to it. When
+ * the init process exits (the session was stopped, or killed together with the job), the
+ * supervisor tears the container down like the reaper of teardownInBackground().
+ * Returns the ID of the session, i.e. of its container.
+ */
+std::string Runtime::startSession() {
+    auto containerID = "session-" + common::generateRandomString(16);
+    utility::logMessage("Starting session " + containerID, common::LogLevel::INFO);
+
+    common::changeDirectory(bundleDir);
+    teardownRecord->setSession({containerID, config->userIdentity.uid, utility::getJobIDOfProcess()});
+
+    int statusPipe[2];
+    if(pipe2(statusPipe, O_CLOEXEC) != 0) {
+        auto message = boost::format("Failed to create pipe to session supervisor: %s") % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto runcPath = std::string{config->json["runcPath"].GetString()};
+    auto pid = fork();
+    if(pid < 0) {
+        auto message = boost::format("Failed to fork session supervisor: %s") % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    if(pid == 0) {
+        close(statusPipe[0]);
+        setsid();
+        auto status = -1;
+        try {
+            if(prctl(PR_SET_CHILD_SUBREAPER, 1) != 0) {
+                SARUS_THROW_ERROR("Failed to make the session supervisor a child subreaper");
+            }
+            auto fdsToKeep = getFileDescriptorsOfTeardown();
+            fdsToKeep.push_back(statusPipe[1]);
+            detachFromCaller(fdsToKeep);
+            status = common::forkExecWait(common::CLIArguments{runcPath, "create", containerID});
+        }
+        catch(...) {}
+        while(write(statusPipe[1], &status, sizeof(status)) < 0 && errno == EINTR) {}
+        close(statusPipe[1]);
+
+        if(status == 0) {
+            // wait for the container's init process, which was reparented to the supervisor
+            while(true) {
+                if(waitpid(-1, nullptr, 0) < 0 && errno != EINTR) {
+                    break;
+                }
+            }
+            try {
+                common::forkExecWait(common::CLIArguments{runcPath, "delete", "--force", containerID});
+            }
+            catch(...) {}
+        }
+        try {
+            common::changeDirectory("/");
+            teardownRecord->setTeardownStarted();
+            teardown();
+        }
+        catch(...) {}
+        _exit(0);
+    }
+
+    close(statusPipe[1]);
+    auto status = -1;
+    while(read(statusPipe[0], &status, sizeof(status)) < 0 && errno == EINTR) {}
+    close(statusPipe[0]);
+    handOverTeardown();
+
+    if(status != 0) {
+        auto message = boost::format("Failed to create the container of session %s (OCI runtime exited with code %d)")
+            % containerID % status;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    utility::logMessage("Successfully started session " + containerID, common::LogLevel::INFO);
+    return containerID;
+}
+
 void Runtime::setupMountIsolation() const {
     utility::logMessage("Setting up mount isolation", common::LogLevel::INFO);
     if(unshare(CLONE_NEWNS) != 0) {
@@ -125,11 +244,40 @@ void Runtime::setupMountIsolation() const {
     utility::logMessage("Successfully set up mount isolation", common::LogLevel::INFO);
 }
 
+/**
+ * Returns the NUMA nodes local to the CPU affinity of the process, if NUMA memory placement
+ * is enabled and the affinity does not span all the nodes. Otherwise returns an empty vector,
+ * i.e. the memory placement is left to the defaults of the kernel.
+ */
+std::vector<int> Runtime::getMemoryNodes() const {
+    const auto* numaMemoryPlacement = rapidjson::Pointer("/enableNumaMemoryPlacement").Get(config->json);
+    if(!numaMemoryPlacement || !numaMemoryPlacement->GetBool()) {
+        return {};
+    }
+
+    auto nodes = common::getNumaNodesOfCpus(config->commandRun.cpuAffinity);
+    if(nodes.empty() || nodes.size() == common::getNumaNodes().size()) {
+        utility::logMessage("CPU affinity spans all NUMA nodes: no memory placement required", common::LogLevel::INFO);
+        return {};
+    }
+    return nodes;
+}
+
 void Runtime::setupRamFilesystem() const {
     utility::logMessage("Setting up RAM filesystem", common::LogLevel::INFO);
     const char* ramFilesystemType = config->json["ramFilesystemType"].GetString();
 
-    if(mount(NULL, bundleDir.c_str(), ramFilesystemType, MS_NOSUID|MS_NODEV, NULL) != 0) {
+    // bind the pages of the bundle to the NUMA nodes of the container's CPUs
+    // (only tmpfs supports memory policies, ramfs pages follow the allocating process)
+    auto mountData = std::string{};
+    if(!config->commandRun.memoryNodes.empty() && std::string{ramFilesystemType} == "tmpfs") {
+        auto intToString = boost::adaptors::transformed([](int i) { return std::to_string(i); });
+        mountData = "mpol=bind:" + boost::join(config->commandRun.memoryNodes | intToString, ",");
+        utility::logMessage(boost::format("Using memory policy %s for RAM filesystem") % mountData, common::LogLevel::DEBUG);
+    }
+
+    if(mount(NULL, bundleDir.c_str(), ramFilesystemType, MS_NOSUID|MS_NODEV,
+             mountData.empty() ? NULL : mountData.c_str()) != 0) {
         auto message = boost::format("Failed to setup %s filesystem on %s: %s")
             % ramFilesystemType
             % bundleDir
@@ -154,23 +302,485 @@ void Runtime::setupRamFilesystem() const {
     utility::logMessage("Successfully set up RAM filesystem", common::LogLevel::INFO);
 }
 
-void Runtime::mountImageIntoRootfs() const {
+/**
+ * The "overlayMountProfile" configuration parameter selects the options of the rootfs' overlay
+ * among those supported by the kernel (see OverlayFeatures). The features are detected before
+ * the RAM filesystem of the bundle hides their cache, which is stored in the OCI bundle directory.
+ * Failing to detect them only leaves the overlay with the default options.
+ */
+void Runtime::detectOverlayFeaturesIfNecessary() {
+    if(config->commandRun.readOnlyRootfs || getOverlayMountProfile() == "default") {
+        return;
+    }
+    try {
+        auto cacheFile = bundleDir / "overlay-features.json";
+        auto scratchDir = common::makeUniquePathWithRandomSuffix(bundleDir / "overlay-probe");
+        overlayFeatures = OverlayFeatures::detect(cacheFile, scratchDir);
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Failed to detect OverlayFS features: %s."
+                                     " Mounting rootfs with the default options") % e.what();
+        utility::logMessage(message, common::LogLevel::WARN);
+    }
+}
+
+std::string Runtime::getOverlayMountProfile() const {
+    const auto* profile = rapidjson::Pointer("/overlayMountProfile").Get(config->json);
+    return profile ? profile->GetString() : "default";
+}
+
+std::vector<std::string> Runtime::getOverlayMountOptions() const {
+    if(!overlayFeatures) {
+        return {};
+    }
+    auto isUpperDirTemporary = persistentWritableLayerLockFd < 0;
+    auto options = overlayFeatures->getMountOptions(getOverlayMountProfile(), isUpperDirTemporary);
+    auto message = boost::format("OverlayFS mount options of profile '%s': %s")
+        % getOverlayMountProfile() % boost::algorithm::join(options, ",");
+    utility::logMessage(message, common::LogLevel::INFO);
+    return options;
+}
+
+void Runtime::mountImageIntoRootfs() {
     utility::logMessage("Mounting image into bundle's rootfs", common::LogLevel::INFO);
 
-    auto lowerDir = bundleDir / "overlay/rootfs-lower";
-    auto upperDir = bundleDir / "overlay/rootfs-upper";
-    auto workDir = bundleDir / "overlay/rootfs-work";
     common::createFoldersIfNecessary(rootfsDir);
-    common::createFoldersIfNecessary(lowerDir);
-    common::createFoldersIfNecessary(upperDir, config->userIdentity.uid, config->userIdentity.gid);
-    common::createFoldersIfNecessary(workDir);
+    if(config->commandRun.readOnlyRootfs) {
+        mountImageReadOnlyIntoRootfs();
+    }
+    else {
+        auto lowerDir = bundleDir / "overlay/rootfs-lower";
+        auto writableLayer = setupWritableLayer();
+        auto upperDir = writableLayer / "rootfs-upper";
+        auto workDir = writableLayer / "rootfs-work";
+        common::createFoldersIfNecessary(lowerDir);
+        if(writableLayerDir) {
+            // on node-local storage, only the upper directory belongs to the user
+            createWritableLayerDirectory(writableLayer, 0, 0, S_IRWXU);
+            createWritableLayerDirectory(upperDir, config->userIdentity.uid, config->userIdentity.gid,
+                                         S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+            createWritableLayerDirectory(workDir, 0, 0, S_IRWXU);
+        }
+        else {
+            common::createFoldersIfNecessary(upperDir, config->userIdentity.uid, config->userIdentity.gid);
+            common::createFoldersIfNecessary(workDir);
+        }
 
-    loopMountSquashfs(config->getImageFile(), lowerDir);
-    mountOverlayfs(lowerDir, upperDir, workDir, rootfsDir);
+        loopMountSquashfs(config->getImageFile(), lowerDir);
+        auto lowerDirs = mountLowerImages();
+        lowerDirs.insert(lowerDirs.begin(), lowerDir);
+        if(auto view = getFileStoreView()) {
+            lowerDirs.insert(lowerDirs.begin(), *view);
+        }
+        auto options = getOverlayMountOptions();
+        try {
+            mountOverlayfs(lowerDirs, upperDir, workDir, rootfsDir, options);
+        }
+        catch(const common::Error& e) {
+            if(options.empty()) {
+                throw;
+            }
+            // e.g. options which the filesystem of a writable layer on node-local storage doesn't support
+            auto message = boost::format("Failed to mount OverlayFS with options %s: %s. Retrying with the default options")
+                % boost::algorithm::join(options, ",") % e.what();
+            utility::logMessage(message, common::LogLevel::WARN);
+            mountOverlayfs(lowerDirs, upperDir, workDir, rootfsDir);
+        }
+    }
+    mountFileStoreIfNecessary();
+    copyImageFileIndexIntoBundle();
 
     utility::logMessage("Successfully mounted image into bundle's rootfs", common::LogLevel::INFO);
 }
 
+/**
+ * The squashfs file of the image is mounted directly as rootfs, sparing the setup of the
+ * overlay and the memory of its writable layer. The image must already contain the mount
+ * points of the container (e.g. /dev, /proc, /sys and the destinations of the custom mounts).
+ * A delta image is stacked on its lower images, and the view of the file store with the
+ * deduplicated files on top of the image, through an overlay without writable layer.
+ */
+void Runtime::mountImageReadOnlyIntoRootfs() const {
+    utility::logMessage("Mounting image as read-only rootfs", common::LogLevel::INFO);
+
+    auto lowerDirs = mountLowerImages();
+    auto view = getFileStoreView();
+    if(lowerDirs.empty() && !view) {
+        loopMountSquashfs(config->getImageFile(), rootfsDir);
+        return;
+    }
+
+    auto lowerDir = bundleDir / "overlay/rootfs-lower";
+    common::createFoldersIfNecessary(lowerDir);
+    loopMountSquashfs(config->getImageFile(), lowerDir);
+    lowerDirs.insert(lowerDirs.begin(), lowerDir);
+    if(view) {
+        lowerDirs.insert(lowerDirs.begin(), *view);
+    }
+    mountOverlayfs(lowerDirs, rootfsDir);
+}
+
+/**
+ * Returns the view of the repository's file store which holds the deduplicated files of the
+ * image at their original paths (see common::FileStore), if the image has one. The view is
+ * stacked as topmost lower layer of the rootfs, on top of the placeholders of the files.
+ */
+boost::optional<boost::filesystem::path> Runtime::getFileStoreView() const {
+    auto metadata = common::ImageMetadata{config->getMetadataFileOfImage(), config->userIdentity};
+    if(!metadata.fileStoreView) {
+        return {};
+    }
+    auto store = common::FileStore{common::FileStore::getDirectory(config->directories.repository), 0};
+    auto view = store.getViewDirectory(*metadata.fileStoreView);
+    if(!boost::filesystem::exists(boost::filesystem::symlink_status(view))) {
+        auto message = boost::format("Failed to find the deduplicated files of the image: %s is missing."
+                                     " Please pull or load the image again") % view;
+        SARUS_THROW_ERROR(message.str());
+    }
+    store.checkViewDirectory(*metadata.fileStoreView);
+    utility::logMessage(boost::format("Stacking view %s of the file store on top of the image") % view,
+                        common::LogLevel::INFO);
+    return view;
+}
+
+/**
+ * Mounts the images stored below a delta image (see image_manager::ImageDelta).
+ * Returns the mount points, topmost first.
+ */
+std::vector<boost::filesystem::path> Runtime::mountLowerImages() const {
+    auto lowerDirs = std::vector<boost::filesystem::path>{};
+    const auto& lowerImageFiles = config->commandRun.lowerImageFiles;
+    for(std::size_t i = 0; i < lowerImageFiles.size(); ++i) {
+        auto dir = bundleDir / ("overlay/rootfs-lower-" + std::to_string(i));
+        common::createFoldersIfNecessary(dir);
+        loopMountSquashfs(lowerImageFiles[i], dir);
+        lowerDirs.push_back(dir);
+    }
+    return lowerDirs;
+}
+
+/**
+ * Returns the directory that holds the upper and work directories of the rootfs' overlay.
+ * By default it is in the bundle's RAM filesystem. With the "writableLayer" configuration
+ * parameter, it is placed on node-local storage, so that the data written by the container
+ * into its rootfs does not consume memory. The layer is temporary, unless "keep" is set:
+ * then it persists after the container exits and is reused by the next container of the same
+ * user running the same image. A persistent layer is used by one container at a time, the
+ * other containers get a temporary layer.
+ */
+boost::filesystem::path Runtime::setupWritableLayer() {
+    const auto* writableLayerConfig = rapidjson::Pointer("/writableLayer").Get(config->json);
+    if(!writableLayerConfig) {
+        return bundleDir / "overlay";
+    }
+
+    auto directory = boost::filesystem::path{(*writableLayerConfig)["directory"].GetString()};
+    auto userDir = directory / std::to_string(config->userIdentity.uid);
+    common::createFoldersIfNecessary(directory);
+    createWritableLayerDirectory(userDir, 0, 0, S_IRWXU);
+
+    if(writableLayerConfig->HasMember("keep") && (*writableLayerConfig)["keep"].GetBool()) {
+        auto layerDir = userDir / getPersistentWritableLayerName();
+        if(tryLockPersistentWritableLayer(layerDir)) {
+            auto message = boost::format("Using persistent writable layer %s") % layerDir;
+            utility::logMessage(message, common::LogLevel::INFO);
+            writableLayerDir = layerDir;
+            return layerDir;
+        }
+        auto message = boost::format("Persistent writable layer %s is in use by another container."
+                                     " Using a temporary writable layer") % layerDir;
+        utility::logMessage(message, common::LogLevel::WARN);
+    }
+
+    auto layerDir = common::makeUniquePathWithRandomSuffix(userDir / "layer");
+    temporaryWritableLayer.reset(new common::PathRAII{layerDir});
+    teardownRecord->addPathToRemove(layerDir);
+    utility::logMessage(boost::format("Using temporary writable layer %s") % layerDir, common::LogLevel::INFO);
+    writableLayerDir = layerDir;
+    return layerDir;
+}
+
+/**
+ * Creates a directory of a writable layer on node-local storage, or validates it if it already exists,
+ * and enforces its owner and mode. The directories of a layer are reused by the next containers
+ * (persistent layer, or the user's directory of layers), thus an existing path which is not a directory
+ * (e.g. a symlink) is refused rather than followed. The parent directory must already be root-owned and
+ * not writable by the user, so that the validated directory cannot be replaced before it is mounted.
+ */
+void Runtime::createWritableLayerDirectory(const boost::filesystem::path& dir, uid_t uid, gid_t gid, mode_t mode) const {
+    if(mkdir(dir.c_str(), mode) != 0 && errno != EEXIST) {
+        auto message = boost::format("Failed to create directory %s: %s") % dir % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    auto fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if(fd < 0) {
+        auto message = boost::format("Failed to open writable layer directory %s: %s"
+                                     " (expected a directory, not a symlink)") % dir % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0
+       || ((st.st_uid != uid || st.st_gid != gid) && fchown(fd, uid, gid) != 0)
+       || ((st.st_mode & 07777) != mode && fchmod(fd, mode) != 0)) {
+        auto message = boost::format("Failed to set owner %d:%d and mode %o of writable layer directory %s: %s")
+            % uid % gid % mode % dir % strerror(errno);
+        close(fd);
+        SARUS_THROW_ERROR(message.str());
+    }
+    close(fd);
+}
+
+/**
+ * A persistent writable layer is locked with flock on its lockfile, which is never removed. The lock
+ * is inherited by the process which tears the container down and is released by the kernel when the
+ * last holder exits, thus a killed teardown doesn't leave the layer locked and no process other than
+ * the holder can release it (e.g. the removal of the leftovers of a stale teardown record).
+ */
+bool Runtime::tryLockPersistentWritableLayer(const boost::filesystem::path& layerDir) {
+    auto lockfile = layerDir.parent_path() / (layerDir.filename().string() + ".lock");
+    auto fd = open(lockfile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, S_IRUSR | S_IWUSR);
+    if(fd < 0) {
+        auto message = boost::format("Failed to open lockfile %s: %s") % lockfile % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    if(flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return false;
+    }
+    persistentWritableLayerLockFd = fd;
+    return true;
+}
+
+/**
+ * The name of a persistent writable layer identifies the image file and its version,
+ * so that a layer is not reused on top of an image which was pulled again in the meantime.
+ */
+std::string Runtime::getPersistentWritableLayerName() const {
+    auto imageFile = config->getImageFile();
+    auto identity = boost::format("%s\n%s\n%d")
+        % config->imageReference.getUniqueKey()
+        % imageFile.string()
+        % boost::filesystem::last_write_time(imageFile);
+    auto sha256 = common::Sha256{};
+    sha256.update(identity.str().data(), identity.str().size());
+    return "image-" + sha256.hexDigest().substr(0, 32);
+}
+
+/**
+ * Hands the teardown of the container over to a detached reaper process, so that Sarus reports
+ * the exit status of the container without waiting for the release of the writable layer, the
+ * overlay, the loop device and the RAM filesystem of the bundle. The reaper shares the mount
+ * namespace of Sarus, thus the kernel releases the mounts when the reaper exits rather than when
+ * Sarus exits. The reaper inherits the lock on the teardown record: "sarus wait-teardowns" waits
+ * for it, and the record's leftovers are removed later should the reaper be killed.
+ * If the reaper cannot be forked, the teardown is performed synchronously.
+ */
+void Runtime::teardownInBackground() {
+    try {
+        teardownRecord->setTeardownStarted();
+    }
+    catch(const common::Error& e) {
+        utility::logMessage(e.what(), common::LogLevel::WARN);
+    }
+
+    // double fork, so that the reaper is detached and reparented to init
+    auto pid = fork();
+    if(pid < 0) {
+        auto message = boost::format("Failed to fork teardown reaper: %s. Tearing down synchronously") % strerror(errno);
+        utility::logMessage(message, common::LogLevel::WARN);
+        teardown();
+        return;
+    }
+    if(pid == 0) {
+        setsid();
+        auto reaperPid = fork();
+        if(reaperPid > 0) {
+            _exit(0);
+        }
+        if(reaperPid == 0) {
+            detachFromCaller(getFileDescriptorsOfTeardown());
+        }
+        // if the reaper could not be forked, tear down from here while Sarus waits
+        try {
+            common::changeDirectory("/");
+            teardown();
+        }
+        catch(...) {}
+        _exit(0);
+    }
+
+    int status;
+    while(waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    handOverTeardown();
+}
+
+/**
+ * The file descriptors held by the process responsible for the teardown of the container
+ */
+std::vector<int> Runtime::getFileDescriptorsOfTeardown() const {
+    auto fds = teardownRecord->getFileDescriptors();
+    if(persistentWritableLayerLockFd >= 0) {
+        fds.push_back(persistentWritableLayerLockFd);
+    }
+    return fds;
+}
+
+/**
+ * Closes the standard streams and the other file descriptors inherited from the caller of Sarus
+ * (e.g. the pipes read by the workload manager until EOF, or the file descriptors passed to the
+ * container), so that a detached process does not hold them.
+ */
+void Runtime::detachFromCaller(const std::vector<int>& fdsToKeep) const {
+    auto fdsToClose = std::vector<int>{};
+    for(const auto& entry : boost::filesystem::directory_iterator{"/proc/self/fd"}) {
+        auto fd = std::stoi(entry.path().filename().string());
+        if(fd > STDERR_FILENO && std::find(fdsToKeep.cbegin(), fdsToKeep.cend(), fd) == fdsToKeep.cend()) {
+            fdsToClose.push_back(fd);
+        }
+    }
+    for(auto fd : fdsToClose) {
+        close(fd);
+    }
+    auto devNull = open("/dev/null", O_RDWR);
+    if(devNull >= 0) {
+        dup2(devNull, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+    }
+}
+
+/**
+ * Gives up the resources of the container after a forked process took over their teardown,
+ * so that they are not released when this process exits.
+ */
+void Runtime::handOverTeardown() {
+    teardownRecord->release();
+    teardownRecord.reset();
+    if(temporaryWritableLayer) {
+        temporaryWritableLayer->release();
+        temporaryWritableLayer.reset();
+    }
+    if(persistentWritableLayerLockFd >= 0) {
+        // the lock is not released, because the new owner holds it through its own file descriptor
+        close(persistentWritableLayerLockFd);
+        persistentWritableLayerLockFd = -1;
+    }
+    writableLayerDir.reset();
+}
+
+/**
+ * Releases the resources of the container, then completes the teardown record.
+ */
+void Runtime::teardown() {
+    teardownWritableLayer();
+    if(umount2(bundleDir.c_str(), MNT_DETACH) != 0) {
+        auto message = boost::format("Failed to unmount %s: %s") % bundleDir % strerror(errno);
+        utility::logMessage(message, common::LogLevel::WARN);
+    }
+    teardownRecord.reset();
+}
+
+/**
+ * Accounts the disk usage of a writable layer on node-local storage, then removes
+ * the layer if temporary or releases it for reuse if persistent. The rootfs is lazily
+ * unmounted first (together with its submounts), now that the container exited.
+ * Errors are logged as warnings and not propagated, because the container already ran.
+ */
+void Runtime::teardownWritableLayer() {
+    if(!writableLayerDir) {
+        return;
+    }
+
+    try {
+        if(umount2(rootfsDir.c_str(), MNT_DETACH) != 0) {
+            auto message = boost::format("Failed to unmount %s: %s") % rootfsDir % strerror(errno);
+            SARUS_THROW_ERROR(message.str());
+        }
+        auto usage = common::getDiskUsage(*writableLayerDir / "rootfs-upper");
+        auto message = boost::format("Writable layer %s uses %d bytes of node-local storage") % *writableLayerDir % usage;
+        utility::logMessage(message, common::LogLevel::INFO);
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Failed to account writable layer %s: %s") % *writableLayerDir % e.what();
+        utility::logMessage(message, common::LogLevel::WARN);
+    }
+
+    try {
+        if(temporaryWritableLayer) {
+            boost::filesystem::remove_all(temporaryWritableLayer->getPath());
+            temporaryWritableLayer.reset();
+        }
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Failed to remove temporary writable layer %s: %s") % *writableLayerDir % e.what();
+        utility::logMessage(message, common::LogLevel::WARN);
+        temporaryWritableLayer->release();
+        temporaryWritableLayer.reset();
+    }
+    if(persistentWritableLayerLockFd >= 0) {
+        close(persistentWritableLayerLockFd);
+        persistentWritableLayerLockFd = -1;
+    }
+    writableLayerDir.reset();
+}
+
+/**
+ * The deduplicated files of the images pulled or loaded by previous versions of Sarus (see
+ * common::FileStore) are symlinks to the file store of the repository, which is mounted read-only
+ * on top of the placeholders left in those images
+ */
+void Runtime::mountFileStoreIfNecessary() const {
+    if(!boost::filesystem::is_directory(rootfsDir / common::FileStore::directoryInImage)) {
+        return;
+    }
+    utility::logMessage("Mounting file store of the repository into rootfs", common::LogLevel::INFO);
+    auto storeDir = common::FileStore::getDirectory(config->directories.repository);
+    auto destination = boost::filesystem::path{"/"} / common::FileStore::directoryInImage;
+    Mount{storeDir, destination, MS_RDONLY, config}.performMount();
+    utility::logMessage("Successfully mounted file store of the repository into rootfs", common::LogLevel::INFO);
+}
+
+/**
+ * Passes the index of the image's files (if the image has a valid one) to the hooks. The hooks
+ * run as root, thus only the index of an image in the centralized repository, written by root,
+ * is trusted: the index of an image in the user's local repository could be rewritten by the user
+ * to redirect the hooks' lookups, so the hooks walk the image's filesystem instead.
+ */
+void Runtime::copyImageFileIndexIntoBundle() const {
+    if(!config->useCentralizedRepository) {
+        utility::logMessage("Not using the index of an image in the local repository", common::LogLevel::INFO);
+        return;
+    }
+
+    auto imageFile = config->getImageFile();
+    auto indexFile = common::ImageFileIndex::getFileOfImage(imageFile);
+
+    try {
+        struct stat sb;
+        if(lstat(indexFile.c_str(), &sb) != 0) {
+            utility::logMessage("Image has no index of its files", common::LogLevel::INFO);
+            return;
+        }
+        if(!S_ISREG(sb.st_mode) || sb.st_uid != 0 || (sb.st_mode & (S_IWGRP | S_IWOTH))) {
+            auto message = boost::format("Ignoring index %s, which is not a regular file writable only by root") % indexFile;
+            utility::logMessage(message, common::LogLevel::WARN);
+            return;
+        }
+
+        auto index = common::ImageFileIndex{indexFile};
+        if(!index.matchesImage(imageFile)) {
+            auto message = boost::format("Ignoring index %s, which doesn't match image %s") % indexFile % imageFile;
+            utility::logMessage(message, common::LogLevel::INFO);
+            return;
+        }
+        index.write(bundleDir / common::ImageFileIndex::fileNameInBundle);
+    }
+    catch(const std::exception& e) {
+        auto message = boost::format("Ignoring index of the image's files: %s") % e.what();
+        utility::logMessage(message, common::LogLevel::WARN);
+    }
+}
+
 void Runtime::setupDevFilesystem() const {
     utility::logMessage("Setting up /dev filesystem", common::LogLevel::INFO);
 
@@ -216,6 +826,65 @@ void Runtime::copyEtcFilesIntoRootfs() const {
     utility::logMessage("Successfully copied /etc files into rootfs", common::LogLevel::INFO);
 }
 
+/**
+ * With a read-only rootfs, the /etc files are copied into the bundle's RAM filesystem and
+ * bind mounted on top of the image's files. The files which the image doesn't have are
+ * skipped, since their mount points can't be created.
+ */
+void Runtime::mountEtcFilesIntoRootfs() const {
+    utility::logMessage("Mounting /etc files into read-only rootfs", common::LogLevel::INFO);
+    auto prefixDir = boost::filesystem::path{config->json["prefixDir"].GetString()};
+    auto etcDir = bundleDir / "etc";
+    common::createFoldersIfNecessary(etcDir);
+
+    auto files = std::vector<std::pair<boost::filesystem::path, std::string>>{
+        {"/etc/hosts", "hosts"},
+        {"/etc/resolv.conf", "resolv.conf"},
+        {prefixDir / "etc/container/nsswitch.conf", "nsswitch.conf"},
+        {prefixDir / "etc/passwd", "passwd"},
+        {prefixDir / "etc/group", "group"}
+    };
+    for(const auto& file : files) {
+        auto pathInContainer = boost::filesystem::path{"/etc"} / file.second;
+        auto destination = rootfsDir / common::realpathWithinRootfs(rootfsDir, pathInContainer);
+        if(!boost::filesystem::is_regular_file(destination)) {
+            auto message = boost::format("Image has no %s: it is left out of the read-only rootfs") % pathInContainer;
+            utility::logMessage(message, common::LogLevel::WARN);
+            continue;
+        }
+        auto copy = etcDir / file.second;
+        common::copyFile(file.first, copy, config->userIdentity.uid, config->userIdentity.gid);
+        bindMount(copy, destination);
+    }
+
+    utility::logMessage("Successfully mounted /etc files into read-only rootfs", common::LogLevel::INFO);
+}
+
+/**
+ * Provides a scratch directory to the programs of a read-only rootfs,
+ * if the image has a /tmp mount point
+ */
+void Runtime::mountTmpFilesystemIntoRootfs() const {
+    auto tmpDir = rootfsDir / "tmp";
+    if(!boost::filesystem::is_directory(boost::filesystem::symlink_status(tmpDir))) {
+        utility::logMessage("Image has no /tmp: not mounting scratch filesystem", common::LogLevel::INFO);
+        return;
+    }
+
+    utility::logMessage("Mounting scratch filesystem on /tmp", common::LogLevel::INFO);
+    const char* ramFilesystemType = config->json["ramFilesystemType"].GetString();
+    auto flags = MS_NOSUID | MS_NODEV;
+    auto* options = "mode=1777";
+    if(mount(NULL, tmpDir.c_str(), ramFilesystemType, flags, options) != 0) {
+        auto message = boost::format("Failed to setup %s filesystem on %s: %s")
+            % ramFilesystemType
+            % tmpDir
+            % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+    utility::logMessage("Successfully mounted scratch filesystem on /tmp", common::LogLevel::INFO);
+}
+
 void Runtime::mountInitProgramIntoRootfsIfNecessary() const {
     if(config->commandRun.addInitProcess) {
         utility::logMessage("Mounting init program into rootfs", common::LogLevel::INFO);
@@ -253,6 +922,20 @@ void Runtime::performExtraMounts() const {
             }
         }
     }
+    if (const rapidjson::Value* hugePagesSupport = rapidjson::Pointer("/enableHugePagesSupport").Get(config->json)) {
+        if (hugePagesSupport->GetBool()) {
+            for(const auto& mount : utility::generateHugetlbfsMounts(config)) {
+                // a hugetlbfs which is not accessible to the user should not prevent the container from running
+                try {
+                    mount->performMount();
+                }
+                catch(const common::Error& e) {
+                    auto message = boost::format("Failed to mount hugetlbfs into the container: %s.\nAttempting to continue...") % e.what();
+                    utility::logMessage(message, common::LogLevel::WARN);
+                }
+            }
+        }
+    }
     utility::logMessage("Successfully performed custom mounts", common::LogLevel::INFO);
 }
 
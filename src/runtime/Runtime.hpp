@@ -12,10 +12,16 @@
 #define sarus_runtime_Runtime_hpp
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
 
 #include "common/Config.hpp"
+#include "common/PathRAII.hpp"
 #include "runtime/OCIBundleConfig.hpp"
+#include "runtime/OverlayFeatures.hpp"
 #include "runtime/FileDescriptorHandler.hpp"
+#include "runtime/TeardownRecord.hpp"
 
 
 namespace sarus {
@@ -25,14 +31,37 @@ class Runtime {
 public:
     Runtime(std::shared_ptr<common::Config>);
     void setupOCIBundle();
-    void executeContainer() const;
+    void executeContainer();
+    std::string startSession();
 
 private:
     void setupMountIsolation() const;
+    void setupTeardownRecord();
+    std::vector<int> getMemoryNodes() const;
     void setupRamFilesystem() const;
-    void mountImageIntoRootfs() const;
+    void detectOverlayFeaturesIfNecessary();
+    std::string getOverlayMountProfile() const;
+    std::vector<std::string> getOverlayMountOptions() const;
+    void mountImageIntoRootfs();
+    void mountImageReadOnlyIntoRootfs() const;
+    std::vector<boost::filesystem::path> mountLowerImages() const;
+    boost::optional<boost::filesystem::path> getFileStoreView() const;
+    boost::filesystem::path setupWritableLayer();
+    void createWritableLayerDirectory(const boost::filesystem::path& dir, uid_t uid, gid_t gid, mode_t mode) const;
+    bool tryLockPersistentWritableLayer(const boost::filesystem::path& layerDir);
+    std::string getPersistentWritableLayerName() const;
+    void teardownInBackground();
+    std::vector<int> getFileDescriptorsOfTeardown() const;
+    void detachFromCaller(const std::vector<int>& fdsToKeep) const;
+    void handOverTeardown();
+    void teardown();
+    void teardownWritableLayer();
+    void copyImageFileIndexIntoBundle() const;
+    void mountFileStoreIfNecessary() const;
     void setupDevFilesystem() const;
     void copyEtcFilesIntoRootfs() const;
+    void mountEtcFilesIntoRootfs() const;
+    void mountTmpFilesystemIntoRootfs() const;
     void mountInitProgramIntoRootfsIfNecessary() const;
     void performCustomMounts() const;
     void performExtraMounts() const;
@@ -46,6 +75,11 @@ private:
     boost::filesystem::path rootfsDir;
     OCIBundleConfig bundleConfig;
     FileDescriptorHandler fdHandler;
+    boost::optional<boost::filesystem::path> writableLayerDir; // set when on node-local storage
+    std::unique_ptr<common::PathRAII> temporaryWritableLayer;
+    int persistentWritableLayerLockFd = -1; // flock released by the kernel when its last holder exits
+    std::unique_ptr<TeardownRecord> teardownRecord;
+    boost::optional<OverlayFeatures> overlayFeatures; // detected with a non-default overlay mount profile
 };
 
 }
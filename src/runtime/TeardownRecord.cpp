@@ -0,0 +1,325 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "TeardownRecord.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "common/CLIArguments.hpp"
+#include "common/Error.hpp"
+#include "common/TreeRemoval.hpp"
+#include "common/Utility.hpp"
+#include "runtime/Utility.hpp"
+
+
+namespace sarus {
+namespace runtime {
+
+namespace {
+
+const std::string recordPrefix = "record-";
+const std::string teardownStarted = "teardown";
+const std::string containerRunning = "running";
+
+std::string readRecord(int fd) {
+    auto content = std::string{};
+    char buffer[4096];
+    auto offset = off_t{0};
+    ssize_t bytes;
+    while((bytes = pread(fd, buffer, sizeof(buffer), offset)) > 0) {
+        content.append(buffer, bytes);
+        offset += bytes;
+    }
+    return content;
+}
+
+// the first line is the state, the others are "<key> <value>"
+struct Contents {
+    bool isTeardownStarted = false;
+    std::vector<boost::filesystem::path> pathsToRemove;
+    std::string containerID;
+    boost::optional<uid_t> owner;
+    std::string jobID;
+};
+
+Contents parseRecord(const std::string& record) {
+    auto lines = std::vector<std::string>{};
+    boost::split(lines, record, boost::is_any_of("\n"));
+
+    auto contents = Contents{};
+    contents.isTeardownStarted = !lines.empty() && lines[0] == teardownStarted;
+    for(std::size_t i=1; i<lines.size(); ++i) {
+        auto separator = lines[i].find(' ');
+        if(separator == std::string::npos) {
+            continue;
+        }
+        auto key = lines[i].substr(0, separator);
+        auto value = lines[i].substr(separator + 1);
+        if(key == "path" && boost::filesystem::path{value}.is_absolute()) {
+            contents.pathsToRemove.push_back(value);
+        }
+        else if(key == "container") {
+            contents.containerID = value;
+        }
+        else if(key == "owner") {
+            try {
+                contents.owner = static_cast<uid_t>(std::stoul(value));
+            }
+            catch(const std::exception&) {}
+        }
+        else if(key == "job") {
+            contents.jobID = value;
+        }
+    }
+    return contents;
+}
+
+}
+
+boost::filesystem::path TeardownRecord::getRecordsDirectory(const common::Config& config) {
+    return boost::filesystem::path{config.json["OCIBundleDir"].GetString()} / "teardowns";
+}
+
+/**
+ * Removes the paths of the records whose teardown process died, without waiting for the
+ * records locked by other processes.
+ */
+void TeardownRecord::finishStaleTeardowns(const boost::filesystem::path& recordsDir, const boost::filesystem::path& runcPath) {
+    auto dirFd = open(recordsDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd < 0) {
+        return;
+    }
+    for(const auto& entry : boost::filesystem::directory_iterator{recordsDir}) {
+        auto name = entry.path().filename().string();
+        if(boost::starts_with(name, recordPrefix)) {
+            finishTeardown(dirFd, name, runcPath, false);
+        }
+    }
+    close(dirFd);
+}
+
+/**
+ * Waits for the outstanding teardowns, i.e. those of the containers which already exited,
+ * and finishes the stale ones. The records of running containers are left untouched.
+ */
+void TeardownRecord::waitForTeardowns(const boost::filesystem::path& recordsDir, const boost::filesystem::path& runcPath) {
+    auto dirFd = open(recordsDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd < 0) {
+        utility::logMessage(boost::format("No teardown records in %s") % recordsDir, common::LogLevel::DEBUG);
+        return;
+    }
+    for(const auto& entry : boost::filesystem::directory_iterator{recordsDir}) {
+        auto name = entry.path().filename().string();
+        if(boost::starts_with(name, recordPrefix)) {
+            finishTeardown(dirFd, name, runcPath, true);
+        }
+    }
+    close(dirFd);
+}
+
+boost::optional<TeardownRecord::Session> TeardownRecord::findSession(const boost::filesystem::path& recordsDir,
+                                                                     const std::string& containerID) {
+    if(!boost::filesystem::is_directory(recordsDir)) {
+        return boost::none;
+    }
+    for(const auto& entry : boost::filesystem::directory_iterator{recordsDir}) {
+        if(!boost::starts_with(entry.path().filename().string(), recordPrefix)) {
+            continue;
+        }
+        auto fd = open(entry.path().c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if(fd < 0) {
+            continue;
+        }
+        auto contents = parseRecord(readRecord(fd));
+        close(fd);
+        if(contents.containerID == containerID && contents.owner && !contents.isTeardownStarted) {
+            return Session{contents.containerID, *contents.owner, contents.jobID};
+        }
+    }
+    return boost::none;
+}
+
+/**
+ * Finds a session which can be used by the user within the job (an empty ID if outside of a job):
+ * the session must have been started by the same user, and within the same job if it was started
+ * within a job. Sessions of other users and jobs are reported as not found.
+ */
+boost::optional<TeardownRecord::Session> TeardownRecord::findSessionOfUser(const boost::filesystem::path& recordsDir,
+                                                                           const std::string& containerID,
+                                                                           uid_t uid,
+                                                                           const std::string& jobID) {
+    auto session = findSession(recordsDir, containerID);
+    if(!session || session->owner != uid || (!session->jobID.empty() && session->jobID != jobID)) {
+        return boost::none;
+    }
+    return session;
+}
+
+TeardownRecord::TeardownRecord(const boost::filesystem::path& recordsDir) {
+    common::createFoldersIfNecessary(recordsDir);
+    dirFd = open(recordsDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd < 0) {
+        auto message = boost::format("Failed to open teardown records directory %s: %s") % recordsDir % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    // the record could be removed as stale between its creation and its locking, then retry
+    while(true) {
+        name = recordPrefix + common::generateRandomString(16);
+        fd = openat(dirFd, name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, S_IRUSR | S_IWUSR);
+        if(fd < 0 || flock(fd, LOCK_EX) != 0) {
+            auto message = boost::format("Failed to create teardown record %s: %s") % (recordsDir / name) % strerror(errno);
+            if(fd >= 0) {
+                unlinkat(dirFd, name.c_str(), 0);
+                close(fd);
+            }
+            close(dirFd);
+            SARUS_THROW_ERROR(message.str());
+        }
+        struct stat st;
+        if(fstat(fd, &st) == 0 && st.st_nlink > 0) {
+            break;
+        }
+        close(fd);
+    }
+
+    try {
+        writeFile();
+    }
+    catch(const common::Error& e) {
+        unlinkat(dirFd, name.c_str(), 0);
+        close(fd);
+        close(dirFd);
+        SARUS_RETHROW_ERROR(e, "Failed to create teardown record");
+    }
+
+    utility::logMessage(boost::format("Created teardown record %s") % (recordsDir / name), common::LogLevel::DEBUG);
+}
+
+TeardownRecord::~TeardownRecord() {
+    if(fd >= 0) {
+        unlinkat(dirFd, name.c_str(), 0);
+        close(fd);
+    }
+    if(dirFd >= 0) {
+        close(dirFd);
+    }
+}
+
+void TeardownRecord::addPathToRemove(const boost::filesystem::path& path) {
+    pathsToRemove.push_back(path);
+    writeFile();
+}
+
+void TeardownRecord::setSession(const Session& session) {
+    this->session = session;
+    writeFile();
+}
+
+void TeardownRecord::setTeardownStarted() {
+    isTeardownStarted = true;
+    writeFile();
+}
+
+void TeardownRecord::release() {
+    close(fd);
+    close(dirFd);
+    fd = -1;
+    dirFd = -1;
+}
+
+std::vector<int> TeardownRecord::getFileDescriptors() const {
+    return {dirFd, fd};
+}
+
+bool TeardownRecord::finishTeardown(int dirFd, const std::string& name, const boost::filesystem::path& runcPath, bool wait) {
+    auto fd = openat(dirFd, name.c_str(), O_RDWR | O_CLOEXEC | O_NOFOLLOW);
+    if(fd < 0) {
+        return true; // completed in the meantime
+    }
+
+    // don't wait for the containers which are still running
+    if(!parseRecord(readRecord(fd)).isTeardownStarted) {
+        wait = false;
+    }
+    else if(wait) {
+        utility::logMessage(boost::format("Waiting for teardown %s") % name, common::LogLevel::INFO);
+    }
+
+    if(flock(fd, wait ? LOCK_EX : LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_nlink == 0) {
+        close(fd);
+        return true; // completed while waiting for the lock
+    }
+
+    auto contents = parseRecord(readRecord(fd));
+    if(!contents.containerID.empty()) {
+        utility::logMessage(boost::format("Deleting container %s of stale session") % contents.containerID,
+                            common::LogLevel::INFO);
+        try {
+            common::forkExecWait(common::CLIArguments{runcPath.string(), "delete", "--force", contents.containerID});
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to delete container %s of stale session: %s") % contents.containerID % e.what();
+            utility::logMessage(message, common::LogLevel::WARN);
+        }
+    }
+    for(const auto& path : contents.pathsToRemove) {
+        utility::logMessage(boost::format("Removing %s left over by stale teardown %s") % path % name,
+                            common::LogLevel::INFO);
+        try {
+            common::removeTree(path);
+        }
+        catch(const std::exception& e) {
+            auto message = boost::format("Failed to remove %s left over by stale teardown %s: %s") % path % name % e.what();
+            utility::logMessage(message, common::LogLevel::WARN);
+        }
+    }
+    unlinkat(dirFd, name.c_str(), 0);
+    close(fd);
+    return true;
+}
+
+void TeardownRecord::writeFile() const {
+    std::stringstream content;
+    content << (isTeardownStarted ? teardownStarted : containerRunning) << "\n";
+    for(const auto& path : pathsToRemove) {
+        content << "path " << path.string() << "\n";
+    }
+    if(session) {
+        content << "container " << session->containerID << "\n";
+        content << "owner " << session->owner << "\n";
+        content << "job " << session->jobID << "\n";
+    }
+    auto data = content.str();
+    if(ftruncate(fd, 0) != 0 || pwrite(fd, data.c_str(), data.size(), 0) != static_cast<ssize_t>(data.size())) {
+        auto message = boost::format("Failed to write teardown record %s: %s") % name % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
+}
+}
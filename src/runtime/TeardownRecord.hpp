@@ -0,0 +1,95 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_runtime_TeardownRecord_hpp
+#define sarus_runtime_TeardownRecord_hpp
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common/Config.hpp"
+
+
+namespace sarus {
+namespace runtime {
+
+/**
+ * Record of the teardown of a container, i.e. a file in the records directory which is locked
+ * (flock) by the process responsible for the teardown and lists the paths to remove once the
+ * container exited (e.g. a temporary writable layer on node-local storage). The record is removed
+ * when the teardown completes, i.e. when the object is destroyed.
+ *
+ * The process responsible for the teardown may be a detached reaper which inherited the lock.
+ * Should it die before completing the teardown (e.g. killed by the workload manager at the end
+ * of the job step), the lock is released and the record becomes stale: the paths it lists are
+ * then removed by the next process which waits for or finishes the outstanding teardowns.
+ * Mounts and loop devices are not recorded, because the kernel releases them together with the
+ * mount namespace of the container.
+ *
+ * The record of a session (see Runtime::startSession) also identifies the session's container and
+ * its owner, so that "sarus session exec/stop" can find it. The container of a stale session is
+ * deleted through the OCI runtime, because its processes keep the container's resources alive.
+ *
+ * The records directory is opened when the record is created, thus the record can be updated and
+ * removed after the directory has been hidden by other mounts (e.g. the RAM filesystem of the bundle).
+ */
+class TeardownRecord {
+public:
+    struct Session {
+        std::string containerID;
+        uid_t owner;
+        std::string jobID; // of the workload manager, from the session's cgroup (see runtime::utility::getJobIDOfProcess),
+                           // empty if started outside of a job
+    };
+
+public:
+    static boost::filesystem::path getRecordsDirectory(const common::Config& config);
+    static void finishStaleTeardowns(const boost::filesystem::path& recordsDir, const boost::filesystem::path& runcPath);
+    static void waitForTeardowns(const boost::filesystem::path& recordsDir, const boost::filesystem::path& runcPath);
+    static boost::optional<Session> findSession(const boost::filesystem::path& recordsDir, const std::string& containerID);
+    static boost::optional<Session> findSessionOfUser(const boost::filesystem::path& recordsDir, const std::string& containerID,
+                                                      uid_t uid, const std::string& jobID);
+
+public:
+    TeardownRecord(const boost::filesystem::path& recordsDir);
+    TeardownRecord(const TeardownRecord&) = delete;
+    TeardownRecord& operator=(const TeardownRecord&) = delete;
+    ~TeardownRecord();
+
+    void addPathToRemove(const boost::filesystem::path& path);
+    void setSession(const Session& session);
+    // marks that the container exited, i.e. the teardown is outstanding
+    void setTeardownStarted();
+    // closes the record without removing it, once another process took over the lock
+    void release();
+    std::vector<int> getFileDescriptors() const;
+
+private:
+    static bool finishTeardown(int dirFd, const std::string& name, const boost::filesystem::path& runcPath, bool wait);
+    void writeFile() const;
+
+private:
+    int dirFd = -1;
+    int fd = -1;
+    std::string name;
+    bool isTeardownStarted = false;
+    std::vector<boost::filesystem::path> pathsToRemove;
+    boost::optional<Session> session;
+};
+
+}
+}
+
+#endif
@@ -10,6 +10,8 @@
 
 #include "Utility.hpp"
 
+#include <algorithm>
+#include <fstream>
 #include <signal.h>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
@@ -181,6 +183,109 @@ std::vector<std::unique_ptr<runtime::Mount>> generatePMIxMounts(std::shared_ptr<
     return mounts;
 }
 
+/**
+ * Returns the mount points of the hugetlbfs filesystems listed in the given mountinfo file,
+ * see proc(5) for the format.
+ */
+std::vector<boost::filesystem::path> getHugetlbfsMountPoints(const boost::filesystem::path& mountinfo) {
+    auto mountPoints = std::vector<boost::filesystem::path>{};
+
+    std::ifstream is{mountinfo.string()};
+    if(!is) {
+        auto message = boost::format("Failed to open %s") % mountinfo;
+        SARUS_THROW_ERROR(message.str());
+    }
+
+    auto line = std::string{};
+    while(std::getline(is, line)) {
+        auto separator = line.find(" - ");
+        if(separator == std::string::npos) {
+            continue;
+        }
+
+        auto fields = std::vector<std::string>{};
+        boost::split(fields, line.substr(0, separator), boost::is_any_of(" "));
+        auto filesystemType = line.substr(separator + 3, line.find(' ', separator + 3) - (separator + 3));
+        if(filesystemType != "hugetlbfs" || fields.size() < 5) {
+            continue;
+        }
+
+        // the kernel escapes spaces, tabs, newlines and backslashes as octal sequences
+        auto mountPoint = std::string{};
+        const auto& escaped = fields[4];
+        for(std::size_t i=0; i<escaped.size(); ++i) {
+            if(escaped[i] == '\\' && i+3 < escaped.size()) {
+                mountPoint += static_cast<char>(std::stoi(escaped.substr(i+1, 3), nullptr, 8));
+                i += 3;
+            }
+            else {
+                mountPoint += escaped[i];
+            }
+        }
+
+        if(std::find(mountPoints.cbegin(), mountPoints.cend(), mountPoint) == mountPoints.cend()) {
+            utility::logMessage(boost::format("Found hugetlbfs mount point %s") % mountPoint, common::LogLevel::DEBUG);
+            mountPoints.push_back(mountPoint);
+        }
+    }
+
+    return mountPoints;
+}
+
+static bool isNumberWithPrefix(const std::string& element, const std::string& prefix) {
+    return element.size() > prefix.size()
+        && element.compare(0, prefix.size(), prefix) == 0
+        && std::all_of(element.cbegin() + prefix.size(), element.cend(), ::isdigit);
+}
+
+/**
+ * Returns the ID of the Slurm job whose cgroup contains the process, or an empty string if the
+ * process is not in the cgroup of a job (e.g. Slurm doesn't confine the jobs with cgroups).
+ * Slurm places the processes of job 123 in cgroups like /slurm/uid_1000/job_123/step_0 (cgroup v1)
+ * or /system.slice/slurmstepd.scope/job_123/step_0/user/task_0 (cgroup v2), see cgroups(7) for
+ * the format of the file. Only these hierarchies, anchored at the root, are matched: with cgroup v2
+ * a user may create cgroups with any name in the subtree delegated to them (e.g. under
+ * /user.slice/user-1000.slice/user@1000.service), but not in the hierarchies managed by Slurm.
+ */
+std::string getJobIDOfProcess(const boost::filesystem::path& cgroupFile) {
+    std::ifstream is{cgroupFile.string()};
+    auto line = std::string{};
+    while(std::getline(is, line)) {
+        auto separator = line.find(':');
+        separator = separator != std::string::npos ? line.find(':', separator + 1) : separator;
+        if(separator == std::string::npos) {
+            continue;
+        }
+
+        // e.g. {"", "slurm", "uid_1000", "job_123", "step_0"}
+        auto elements = std::vector<std::string>{};
+        boost::split(elements, line.substr(separator + 1), boost::is_any_of("/"));
+        if(elements.size() < 4 || !elements[0].empty()) {
+            continue;
+        }
+        auto isSlurmV1 = elements[1] == "slurm" && isNumberWithPrefix(elements[2], "uid_");
+        auto isSlurmV2 = elements[1] == "system.slice" && elements[2] == "slurmstepd.scope";
+        if((isSlurmV1 || isSlurmV2) && isNumberWithPrefix(elements[3], "job_")) {
+            return elements[3].substr(4);
+        }
+    }
+    return std::string{};
+}
+
+/**
+ * Bind mounts the hugetlbfs filesystems of the host into the container at the same paths,
+ * so that applications using explicit huge pages (e.g. through libhugetlbfs) find them
+ * as they would on the host. The huge pages settings in /sys/kernel/mm are already visible
+ * through the sysfs mounted in the container.
+ */
+std::vector<std::unique_ptr<runtime::Mount>> generateHugetlbfsMounts(std::shared_ptr<const common::Config> config) {
+    auto mounts = std::vector<std::unique_ptr<runtime::Mount>>{};
+    for(const auto& mountPoint : getHugetlbfsMountPoints()) {
+        mounts.push_back(std::unique_ptr<runtime::Mount>{new runtime::Mount{mountPoint, mountPoint, MS_REC|MS_PRIVATE, config}});
+    }
+    return mounts;
+}
+
 void logMessage(const boost::format& message, common::LogLevel level,
                 std::ostream& out, std::ostream& err) {
     utility::logMessage(message.str(), level, out, err);
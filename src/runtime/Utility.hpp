@@ -25,6 +25,9 @@ namespace utility {
 
 void setupSignalProxying(const pid_t childPid);
 std::vector<std::unique_ptr<runtime::Mount>> generatePMIxMounts(std::shared_ptr<const common::Config>);
+std::vector<boost::filesystem::path> getHugetlbfsMountPoints(const boost::filesystem::path& mountinfo = "/proc/self/mountinfo");
+std::string getJobIDOfProcess(const boost::filesystem::path& cgroupFile = "/proc/self/cgroup");
+std::vector<std::unique_ptr<runtime::Mount>> generateHugetlbfsMounts(std::shared_ptr<const common::Config>);
 void logMessage(const boost::format&, common::LogLevel,
                 std::ostream& out=std::cout, std::ostream& err=std::cerr);
 void logMessage(const std::string&, common::LogLevel,
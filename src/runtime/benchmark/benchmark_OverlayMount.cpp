@@ -0,0 +1,145 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+/**
+ * Measures the cost of the writes of a container into its rootfs with the OverlayFS mount
+ * options of each profile of the "overlayMountProfile" configuration parameter, on a kernel
+ * whose features are probed as done by the runtime (see runtime::OverlayFeatures):
+ *
+ * - copy-up-heavy: appends a byte to every file of the lower layer, which copies up their data;
+ * - metadata-heavy: changes the mode of every file of the lower layer, which copies up only their
+ *   metadata with "metacopy=on".
+ *
+ * Each iteration mounts the overlay with a new upper layer, which is discarded afterwards.
+ * The layers are created in the given directory (e.g. on the node-local storage of a writable
+ * layer), by default in /tmp. The benchmark has to run as root and works in its own mount
+ * namespace.
+ *
+ * Usage: benchmark_runtime_OverlayMount [DIRECTORY FILES FILE_SIZE_IN_BYTES]
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+
+#include <boost/algorithm/string/join.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "runtime/OverlayFeatures.hpp"
+#include "runtime/mount_utilities.hpp"
+#include "test_utility/Benchmark.hpp"
+
+using namespace sarus;
+
+static void createLowerLayer(const boost::filesystem::path& dir, std::size_t numberOfFiles, std::size_t fileSize) {
+    auto content = std::string(fileSize, 'x');
+    for(std::size_t i = 0; i < numberOfFiles; ++i) {
+        auto file = dir / std::to_string(i % 16) / ("file" + std::to_string(i));
+        common::createFoldersIfNecessary(file.parent_path());
+        std::ofstream{file.string(), std::ios::binary} << content;
+    }
+}
+
+static void appendToFiles(const boost::filesystem::path& dir, std::size_t numberOfFiles) {
+    for(std::size_t i = 0; i < numberOfFiles; ++i) {
+        auto file = dir / std::to_string(i % 16) / ("file" + std::to_string(i));
+        auto fd = open(file.c_str(), O_WRONLY | O_APPEND);
+        if(fd < 0 || write(fd, "y", 1) != 1) {
+            std::cerr << "Failed to append to " << file << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+    }
+}
+
+static void changeModeOfFiles(const boost::filesystem::path& dir, std::size_t numberOfFiles) {
+    for(std::size_t i = 0; i < numberOfFiles; ++i) {
+        auto file = dir / std::to_string(i % 16) / ("file" + std::to_string(i));
+        if(chmod(file.c_str(), 0600) != 0) {
+            std::cerr << "Failed to change mode of " << file << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+template<class Workload>
+static test_utility::benchmark::Result measure(const std::string& name,
+                                               const boost::filesystem::path& testDir,
+                                               const std::vector<std::string>& options,
+                                               Workload&& workload) {
+    auto iterations = test_utility::benchmark::getIterations(20);
+    auto samples = std::vector<double>{};
+    for(std::size_t i = 0; i < iterations; ++i) {
+        auto layerDir = common::PathRAII{testDir / "layer"};
+        auto mergedDir = testDir / "merged";
+        common::createFoldersIfNecessary(layerDir.getPath() / "upper");
+        common::createFoldersIfNecessary(layerDir.getPath() / "work");
+        common::createFoldersIfNecessary(mergedDir);
+        runtime::mountOverlayfs(std::vector<boost::filesystem::path>{testDir / "lower"},
+                                layerDir.getPath() / "upper", layerDir.getPath() / "work", mergedDir, options);
+
+        auto start = std::chrono::steady_clock::now();
+        workload(mergedDir);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double>(end - start).count());
+
+        umount2(mergedDir.c_str(), MNT_DETACH);
+    }
+    return test_utility::benchmark::summarize(name, samples);
+}
+
+int main(int argc, char* argv[]) {
+    auto directory = boost::filesystem::path{argc > 1 ? argv[1] : "/tmp"};
+    auto numberOfFiles = std::size_t{argc > 2 ? std::stoul(argv[2]) : 1000};
+    auto fileSize = std::size_t{argc > 3 ? std::stoul(argv[3]) : 64*1024};
+
+    if(geteuid() != 0) {
+        std::cerr << "The benchmark has to run as root" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(unshare(CLONE_NEWNS) != 0 || mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+        std::cerr << "Failed to create private mount namespace: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix(directory / "sarus-benchmark-overlay")};
+    createLowerLayer(testDir.getPath() / "lower", numberOfFiles, fileSize);
+    auto features = runtime::OverlayFeatures::probe(testDir.getPath() / "probe");
+
+    const auto profiles = {"default", "performance"};
+    std::cout << boost::format("%d files of %d bytes in %s\n") % numberOfFiles % fileSize % directory;
+    for(const auto* profile : profiles) {
+        std::cout << boost::format("options of profile '%s': %s\n")
+            % profile % boost::algorithm::join(features.getMountOptions(profile, true), ",");
+    }
+    test_utility::benchmark::printHeader();
+    for(const auto* profile : profiles) {
+        auto options = features.getMountOptions(profile, true);
+        test_utility::benchmark::print(measure(std::string{"copy-up-heavy, "} + profile, testDir.getPath(), options,
+            [numberOfFiles](const boost::filesystem::path& dir) { appendToFiles(dir, numberOfFiles); }));
+        test_utility::benchmark::print(measure(std::string{"metadata-heavy, "} + profile, testDir.getPath(), options,
+            [numberOfFiles](const boost::filesystem::path& dir) { changeModeOfFiles(dir, numberOfFiles); }));
+    }
+
+    return 0;
+}
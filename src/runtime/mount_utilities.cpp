@@ -17,6 +17,7 @@
 #include <errno.h>
 
 #include <boost/format.hpp>
+#include <boost/algorithm/string/join.hpp>
 
 #include "common/Error.hpp"
 #include "common/Logger.hpp"
@@ -174,23 +175,25 @@ void bindMount(const boost::filesystem::path& from, const boost::filesystem::pat
 
 
 void loopMountSquashfs(const boost::filesystem::path& image, const boost::filesystem::path& mountPoint) {
-    auto command = std::string{"mount"};
-    command += " -n";
-    command += " -o";
-    command += " loop,nosuid,nodev,ro";
-    command += " -t squashfs";
-    command += " " + image.string();
-    command += " " + mountPoint.string();
+    // pass the paths as separate arguments, so that no shell ever interprets them
+    auto args = common::CLIArguments{"mount", "-n", "-o", "loop,nosuid,nodev,ro", "-t", "squashfs",
+                                     image.string(), mountPoint.string()};
 
-    utility::logMessage(boost::format{"Performing loop mount: %s "} % command, common::LogLevel::DEBUG);
+    utility::logMessage(boost::format{"Performing loop mount: %s "} % args, common::LogLevel::DEBUG);
 
+    auto status = int{};
     try {
-        common::executeCommand(command);
+        status = common::forkExecWait(args);
     }
     catch(common::Error& e) {
         auto message = boost::format("Failed to loop mount %s on %s") % image % mountPoint;
         SARUS_RETHROW_ERROR(e, message.str());
     }
+    if(status != 0) {
+        auto message = boost::format("Failed to loop mount %s on %s (mount exited with status %d)")
+            % image % mountPoint % status;
+        SARUS_THROW_ERROR(message.str());
+    }
 }
 
 
@@ -198,10 +201,23 @@ void mountOverlayfs(const boost::filesystem::path& lowerDir,
                     const boost::filesystem::path& upperDir,
                     const boost::filesystem::path& workDir,
                     const boost::filesystem::path& mountPoint) {
-    auto options = boost::format{"lowerdir=%s,upperdir=%s,workdir=%s"}
-        % lowerDir.string()
+    mountOverlayfs(std::vector<boost::filesystem::path>{lowerDir}, upperDir, workDir, mountPoint);
+}
+
+void mountOverlayfs(const std::vector<boost::filesystem::path>& lowerDirs,
+                    const boost::filesystem::path& upperDir,
+                    const boost::filesystem::path& workDir,
+                    const boost::filesystem::path& mountPoint,
+                    const std::vector<std::string>& extraOptions) {
+    auto lowerDirStrings = std::vector<std::string>{};
+    for(const auto& dir : lowerDirs) {
+        lowerDirStrings.push_back(dir.string());
+    }
+    auto options = boost::format{"lowerdir=%s,upperdir=%s,workdir=%s%s"}
+        % boost::algorithm::join(lowerDirStrings, ":")
         % upperDir.string()
-        % workDir.string();
+        % workDir.string()
+        % (extraOptions.empty() ? std::string{} : "," + boost::algorithm::join(extraOptions, ","));
     utility::logMessage(boost::format{"Performing overlay mount to %s "} % mountPoint, common::LogLevel::DEBUG);
     utility::logMessage(boost::format{"Overlay options: %s "} % options.str(), common::LogLevel::DEBUG);
     if(mount("overlay", mountPoint.c_str(), "overlay", MS_MGC_VAL, options.str().c_str()) != 0) {
@@ -211,5 +227,22 @@ void mountOverlayfs(const boost::filesystem::path& lowerDir,
     }
 }
 
+void mountOverlayfs(const std::vector<boost::filesystem::path>& lowerDirs,
+                    const boost::filesystem::path& mountPoint) {
+    auto lowerDirStrings = std::vector<std::string>{};
+    for(const auto& dir : lowerDirs) {
+        lowerDirStrings.push_back(dir.string());
+    }
+    auto options = boost::format{"lowerdir=%s"} % boost::algorithm::join(lowerDirStrings, ":");
+    utility::logMessage(boost::format{"Performing read-only overlay mount to %s "} % mountPoint, common::LogLevel::DEBUG);
+    utility::logMessage(boost::format{"Overlay options: %s "} % options.str(), common::LogLevel::DEBUG);
+    if(mount("overlay", mountPoint.c_str(), "overlay", MS_MGC_VAL | MS_RDONLY | MS_NOSUID | MS_NODEV,
+             options.str().c_str()) != 0) {
+        auto message = boost::format("Failed to mount OverlayFS on %s (options: %s): %s")
+            % mountPoint % options % strerror(errno);
+        SARUS_THROW_ERROR(message.str());
+    }
+}
+
 } // namespace
 } // namespace
@@ -12,6 +12,8 @@
 #define sarus_runtime_mount_utilities_hpp
 
 #include <cstddef>
+#include <string>
+#include <vector>
 #include <sys/stat.h>
 #include <sys/mount.h>
 
@@ -37,6 +39,14 @@ void mountOverlayfs(const boost::filesystem::path& lowerDir,
                     const boost::filesystem::path& upperDir,
                     const boost::filesystem::path& workDir,
                     const boost::filesystem::path& mountPoint);
+void mountOverlayfs(const std::vector<boost::filesystem::path>& lowerDirs, // topmost first
+                    const boost::filesystem::path& upperDir,
+                    const boost::filesystem::path& workDir,
+                    const boost::filesystem::path& mountPoint,
+                    const std::vector<std::string>& extraOptions = {}); // e.g. "metacopy=on"
+// read-only overlay, without upper and work directories
+void mountOverlayfs(const std::vector<boost::filesystem::path>& lowerDirs, // topmost first
+                    const boost::filesystem::path& mountPoint);
 
 }
 }
@@ -292,6 +292,29 @@ TEST(ConfigsMergerTestGroup, pmix_environment) {
     }
 }
 
+TEST(ConfigsMergerTestGroup, huge_pages_environment) {
+    auto configRAII = test_utility::config::makeConfig();
+    auto& config = configRAII.config;
+    auto metadata = common::ImageMetadata{};
+    config->commandRun.hostEnvironment = {{"HUGETLB_DEFAULT_PAGE_SIZE", "2M"}, {"HUGETLB_MORECORE", "yes"}};
+    metadata.env = {{"HUGETLB_DEFAULT_PAGE_SIZE", "1G"}, {"HUGETLB_VERBOSE", "0"}};
+
+    // image variables take precedence if huge pages support is disabled
+    {
+        auto env = ConfigsMerger{config, metadata}.getEnvironmentInContainer();
+        CHECK(env.at("HUGETLB_DEFAULT_PAGE_SIZE") == std::string("1G"));
+    }
+
+    // host variables take precedence if huge pages support is enabled
+    {
+        config->json.AddMember("enableHugePagesSupport", true, config->json.GetAllocator());
+        auto env = ConfigsMerger{config, metadata}.getEnvironmentInContainer();
+        CHECK(env.at("HUGETLB_DEFAULT_PAGE_SIZE") == std::string("2M"));
+        CHECK(env.at("HUGETLB_MORECORE") == std::string("yes"));
+        CHECK(env.at("HUGETLB_VERBOSE") == std::string("0"));
+    }
+}
+
 TEST(ConfigsMergerTestGroup, bundle_annotations) {
     auto metadata = common::ImageMetadata{};
 
@@ -368,6 +391,25 @@ TEST(ConfigsMergerTestGroup, bundle_annotations) {
         auto annot = ConfigsMerger{config, metadata}.getBundleAnnotations();
         CHECK((ConfigsMerger{config, metadata}.getBundleAnnotations() == expectedAnnotations));
     }
+    // Metrics sinks are only taken from the configuration
+    {
+        metadata.labels["com.hooks.metrics.textfileDirectory"] = "/image/textfile";
+        metadata.labels["com.hooks.metrics.socket"] = "/image/socket";
+        auto configRAII = test_utility::config::makeConfig();
+        auto& config = configRAII.config;
+        auto expectedAnnotations = std::unordered_map<std::string, std::string>{
+            {"com.test.dummy_key", "dummy_value"},
+            {"com.hooks.logging.level", "2"},
+        };
+        CHECK((ConfigsMerger{config, metadata}.getBundleAnnotations() == expectedAnnotations));
+
+        auto& allocator = config->json.GetAllocator();
+        auto metrics = rapidjson::Value{rapidjson::kObjectType};
+        metrics.AddMember("textfileDirectory", rapidjson::Value{"/config/textfile", allocator}, allocator);
+        config->json.AddMember("metrics", metrics, allocator);
+        expectedAnnotations["com.hooks.metrics.textfileDirectory"] = "/config/textfile";
+        CHECK((ConfigsMerger{config, metadata}.getBundleAnnotations() == expectedAnnotations));
+    }
 }
 
 TEST(ConfigsMergerTestGroup, command_to_execute) {
@@ -0,0 +1,143 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <cstdint>
+#include <ctime>
+#include <iterator>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <boost/filesystem.hpp>
+#include <rapidjson/document.h>
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "runtime/LaunchAdmission.hpp"
+#include "test_utility/config.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(LaunchAdmissionTestGroup) {
+};
+
+static void configureLaunchAdmission(common::Config& config,
+                                     std::uint64_t maxLaunchesPerNode,
+                                     std::uint64_t maxLaunchesPerJob = 0,
+                                     const boost::filesystem::path& jobTokensDirectory = {}) {
+    auto& allocator = config.json.GetAllocator();
+    auto json = rapidjson::Value{rapidjson::kObjectType};
+    json.AddMember("maxConcurrentLaunchesPerNode", rapidjson::Value{maxLaunchesPerNode}, allocator);
+    if(maxLaunchesPerJob > 0) {
+        json.AddMember("maxConcurrentLaunchesPerJob", rapidjson::Value{maxLaunchesPerJob}, allocator);
+        json.AddMember("jobTokensDirectory", rapidjson::Value{jobTokensDirectory.c_str(), allocator}, allocator);
+    }
+    json.AddMember("maxJitterMs", rapidjson::Value{std::uint64_t{20}}, allocator);
+    json.AddMember("timeoutSeconds", rapidjson::Value{std::uint64_t{1}}, allocator);
+    config.json.AddMember("launchAdmission", json, allocator);
+}
+
+TEST(LaunchAdmissionTestGroup, disabled) {
+    auto configRAII = test_utility::config::makeConfig();
+    runtime::LaunchAdmission admission{configRAII.config};
+    CHECK(!admission.isEnabled());
+    CHECK(!admission.hasSlot());
+    CHECK_EQUAL(admission.getWaitTime(), 0.0);
+}
+
+TEST(LaunchAdmissionTestGroup, nodeSlots) {
+    auto configRAII = test_utility::config::makeConfig();
+    configureLaunchAdmission(*configRAII.config, 2);
+
+    runtime::LaunchAdmission first{configRAII.config};
+    runtime::LaunchAdmission second{configRAII.config};
+    CHECK(first.hasSlot());
+    CHECK(second.hasSlot());
+    {
+        // all the slots are taken: the launch proceeds without a slot after the timeout
+        runtime::LaunchAdmission third{configRAII.config};
+        CHECK(!third.hasSlot());
+        CHECK(third.getWaitTime() >= 1.0);
+    }
+
+    first.release();
+    CHECK(!first.hasSlot());
+    runtime::LaunchAdmission fourth{configRAII.config};
+    CHECK(fourth.hasSlot());
+    CHECK(fourth.getWaitTime() < 1.0);
+}
+
+TEST(LaunchAdmissionTestGroup, slotOfDeadLaunchIsReleased) {
+    auto configRAII = test_utility::config::makeConfig();
+    configureLaunchAdmission(*configRAII.config, 1);
+
+    auto pid = fork();
+    if(pid == 0) {
+        auto* admission = new runtime::LaunchAdmission{configRAII.config};
+        _exit(admission->hasSlot() ? 0 : 1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    runtime::LaunchAdmission admission{configRAII.config};
+    CHECK(admission.hasSlot());
+}
+
+TEST(LaunchAdmissionTestGroup, jobTokens) {
+    auto configRAII = test_utility::config::makeConfig();
+    auto tokensDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-admission-tokens")};
+    common::createFoldersIfNecessary(tokensDir.getPath());
+    configureLaunchAdmission(*configRAII.config, 4, 1, tokensDir.getPath());
+    auto token = tokensDir.getPath() / "1234.0.token";
+
+    // launches outside of a job are only limited per node
+    {
+        runtime::LaunchAdmission admission{configRAII.config, ""};
+        CHECK(admission.hasSlot());
+        CHECK(!admission.hasToken());
+    }
+
+    // a non-numeric job ID is not used in the name of a token
+    {
+        runtime::LaunchAdmission admission{configRAII.config, "../1234"};
+        CHECK(admission.hasSlot());
+        CHECK(!admission.hasToken());
+        CHECK(boost::filesystem::directory_iterator(tokensDir.getPath()) == boost::filesystem::directory_iterator{});
+    }
+
+    {
+        runtime::LaunchAdmission first{configRAII.config, "1234"};
+        CHECK(first.hasToken());
+        CHECK(boost::filesystem::exists(token));
+        {
+            runtime::LaunchAdmission second{configRAII.config, "1234"};
+            CHECK(second.hasSlot());
+            CHECK(!second.hasToken());
+        }
+        CHECK(boost::filesystem::exists(token));
+    }
+    CHECK(!boost::filesystem::exists(token));
+
+    // the token of a launch which died is removed once older than the timeout
+    common::createFileIfNecessary(token);
+    boost::filesystem::last_write_time(token, time(nullptr) - 60);
+    runtime::LaunchAdmission admission{configRAII.config, "1234"};
+    CHECK(admission.hasToken());
+    CHECK(boost::filesystem::last_write_time(token) > time(nullptr) - 60);
+    // the stale token renamed aside was removed
+    auto numberOfFiles = std::distance(boost::filesystem::directory_iterator(tokensDir.getPath()),
+                                       boost::filesystem::directory_iterator{});
+    CHECK_EQUAL(numberOfFiles, 1);
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -208,6 +208,27 @@ TEST(OCIBundleConfigTestGroup, OCIBundleConfig) {
     compareJsonObjects(actualJson, getExpectedJson());
 }
 
+TEST(OCIBundleConfigTestGroup, memory_nodes) {
+    // create test config
+    auto configRAII = test_utility::config::makeConfig();
+    auto& config = configRAII.config;
+    setupTestConfig(config);
+    config->commandRun.memoryNodes = {0, 2};
+
+    auto bundleDir = createTestBundle(config);
+
+    // run
+    runtime::OCIBundleConfig{config}.generateConfigFile();
+
+    auto actualJson = common::readJSON(bundleDir.getPath() / "config.json");
+    sortJsonEnvironmentArray(actualJson);
+
+    auto expectedJson = getExpectedJson();
+    expectedJson["linux"]["resources"]["cpu"].AddMember("mems", rj::Value{"0,2"}, expectedJson.GetAllocator());
+
+    compareJsonObjects(actualJson, expectedJson);
+}
+
 #ifdef ASROOT
 TEST (OCIBundleConfigTestGroup, allowed_devices)  {
 #else
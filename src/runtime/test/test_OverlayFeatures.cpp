@@ -0,0 +1,82 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "runtime/OverlayFeatures.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(OverlayFeaturesTestGroup) {
+};
+
+TEST(OverlayFeaturesTestGroup, getMountOptions) {
+    auto all = runtime::OverlayFeatures{"boot", runtime::OverlayFeatures::probedOptions};
+    CHECK(all.getMountOptions("default", true).empty());
+    CHECK((all.getMountOptions("performance", true)
+           == std::vector<std::string>{"volatile", "redirect_dir=on", "metacopy=on", "index=off", "xino=off"}));
+    // a persistent upper layer is never volatile, nor written with metadata-only copy-ups and
+    // redirects, since it may be mounted again with the default options
+    CHECK((all.getMountOptions("performance", false)
+           == std::vector<std::string>{"index=off", "xino=off"}));
+    CHECK_THROWS(common::Error, all.getMountOptions("unknown", true));
+
+    // metacopy requires redirect_dir
+    auto some = runtime::OverlayFeatures{"boot", {"metacopy=on", "xino=off"}};
+    CHECK((some.getMountOptions("performance", true) == std::vector<std::string>{"xino=off"}));
+}
+
+TEST(OverlayFeaturesTestGroup, cache) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-overlay-features")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto cacheFile = testDir.getPath() / "overlay-features.json";
+
+    auto features = runtime::OverlayFeatures{"boot", {"volatile", "index=off"}};
+    features.writeCache(cacheFile);
+    auto cached = runtime::OverlayFeatures::readCache(cacheFile);
+    CHECK(cached.getSupportedOptions() == features.getSupportedOptions());
+
+    // the cache of the current boot spares the probe
+    auto fake = runtime::OverlayFeatures{runtime::OverlayFeatures::getBootID(), {"fake-option"}};
+    fake.writeCache(cacheFile);
+    auto detected = runtime::OverlayFeatures::detect(cacheFile, testDir.getPath() / "scratch");
+    CHECK(detected.isSupported("fake-option"));
+    CHECK(!boost::filesystem::exists(testDir.getPath() / "scratch"));
+}
+
+TEST(OverlayFeaturesTestGroup, probe) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-overlay-features")};
+    common::createFoldersIfNecessary(testDir.getPath());
+    auto cacheFile = testDir.getPath() / "overlay-features.json";
+    auto scratchDir = testDir.getPath() / "scratch";
+
+    // a cache of a previous boot is probed again
+    runtime::OverlayFeatures{"previous-boot", {"fake-option"}}.writeCache(cacheFile);
+    auto features = runtime::OverlayFeatures::detect(cacheFile, scratchDir);
+    CHECK(!features.isSupported("fake-option"));
+    for(const auto& option : features.getSupportedOptions()) {
+        const auto& probed = runtime::OverlayFeatures::probedOptions;
+        CHECK(std::find(probed.cbegin(), probed.cend(), option) != probed.cend());
+    }
+    CHECK(!boost::filesystem::exists(scratchDir));
+
+    auto cached = runtime::OverlayFeatures::readCache(cacheFile);
+    CHECK(cached.getSupportedOptions() == features.getSupportedOptions());
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -112,4 +112,60 @@ IGNORE_TEST(RuntimeTestGroup, setupOCIBundle) {
     CHECK_EQUAL(umount(bundleDir.c_str()), 0);
 }
 
+#ifdef ASROOT
+TEST(RuntimeTestGroup, writableLayerOnNodeLocalStorage) {
+#else
+IGNORE_TEST(RuntimeTestGroup, writableLayerOnNodeLocalStorage) {
+#endif
+    // configure
+    auto configRAII = test_utility::config::makeConfig();
+    auto& config = configRAII.config;
+    config->commandRun.execArgs = common::CLIArguments{"/bin/bash"};
+    config->directories.images = boost::filesystem::path{__FILE__}.parent_path();
+    config->imageReference = common::ImageReference{"", "", "", "test_image"};
+
+    auto layersDirRAII = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-writable-layers")};
+    auto& allocator = config->json.GetAllocator();
+    auto writableLayer = rapidjson::Value{rapidjson::kObjectType};
+    writableLayer.AddMember("directory", rapidjson::Value{layersDirRAII.getPath().c_str(), allocator}, allocator);
+    writableLayer.AddMember("keep", rapidjson::Value{true}, allocator);
+    config->json.AddMember("writableLayer", writableLayer, allocator);
+
+    auto bundleDir = boost::filesystem::path{config->json["OCIBundleDir"].GetString()};
+    auto overlayfsLowerDir = bundleDir / "overlay/rootfs-lower";
+    auto rootfsDir = bundleDir / boost::filesystem::path{config->json["rootfsFolder"].GetString()};
+    auto prefixDir = boost::filesystem::path{config->json["prefixDir"].GetString()};
+
+    common::createFoldersIfNecessary(bundleDir);
+    common::createFileIfNecessary(prefixDir / "etc/container/nsswitch.conf");
+    common::createFileIfNecessary(prefixDir / "etc/passwd");
+    common::createFileIfNecessary(prefixDir / "etc/group");
+    auto metadataFileRAII = common::PathRAII{boost::filesystem::path(config->directories.images / (config->imageReference.getUniqueKey() + ".meta"))};
+    common::writeTextFile("{}", metadataFileRAII.getPath());
+
+    // run
+    runtime::Runtime{config}.setupOCIBundle();
+
+    // the data written into the rootfs ends up in the persistent layer on node-local storage
+    common::executeCommand("touch " + (rootfsDir / "file_to_create").string());
+    auto userDir = layersDirRAII.getPath() / std::to_string(config->userIdentity.uid);
+    auto layers = std::vector<boost::filesystem::path>{};
+    for(const auto& entry : boost::filesystem::directory_iterator(userDir)) {
+        if(boost::filesystem::is_directory(entry.path())) {
+            layers.push_back(entry.path());
+        }
+    }
+    CHECK_EQUAL(layers.size(), 1);
+    CHECK(layers[0].filename().string().find("image-") == 0);
+    CHECK(boost::filesystem::exists(layers[0] / "rootfs-upper/file_to_create"));
+    CHECK(!boost::filesystem::exists(bundleDir / "overlay/rootfs-upper/file_to_create"));
+    CHECK(common::getDiskUsage(layers[0] / "rootfs-upper") > 0);
+
+    // cleanup
+    CHECK_EQUAL(umount((rootfsDir / "dev").c_str()), 0);
+    CHECK_EQUAL(umount(rootfsDir.c_str()), 0);
+    CHECK_EQUAL(umount(overlayfsLowerDir.c_str()), 0);
+    CHECK_EQUAL(umount(bundleDir.c_str()), 0);
+}
+
 SARUS_UNITTEST_MAIN_FUNCTION();
@@ -0,0 +1,155 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <boost/filesystem.hpp>
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "runtime/TeardownRecord.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+using namespace sarus;
+
+TEST_GROUP(TeardownRecordTestGroup) {
+};
+
+static std::size_t countRecords(const boost::filesystem::path& recordsDir) {
+    auto count = std::size_t{0};
+    for(const auto& entry : boost::filesystem::directory_iterator{recordsDir}) {
+        static_cast<void>(entry);
+        ++count;
+    }
+    return count;
+}
+
+// creates a record in a child process, which exits without completing the teardown
+static void createStaleRecord(const boost::filesystem::path& recordsDir, const boost::filesystem::path& pathToRemove) {
+    auto pid = fork();
+    if(pid == 0) {
+        auto* record = new runtime::TeardownRecord{recordsDir};
+        record->addPathToRemove(pathToRemove);
+        record->setTeardownStarted();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+TEST(TeardownRecordTestGroup, recordIsRemovedWhenTeardownCompletes) {
+    auto recordsDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-teardowns")};
+    {
+        runtime::TeardownRecord record{recordsDir.getPath()};
+        record.addPathToRemove("/tmp/file");
+        CHECK_EQUAL(countRecords(recordsDir.getPath()), std::size_t{1});
+    }
+    CHECK_EQUAL(countRecords(recordsDir.getPath()), std::size_t{0});
+}
+
+TEST(TeardownRecordTestGroup, finishStaleTeardowns) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-teardowns")};
+    auto recordsDir = testDir.getPath() / "records";
+    auto leftover = testDir.getPath() / "layer";
+    common::createFileIfNecessary(leftover / "rootfs-upper/file");
+
+    // the record of a running container is left untouched
+    runtime::TeardownRecord record{recordsDir};
+    record.addPathToRemove(testDir.getPath() / "layer-of-running-container");
+    createStaleRecord(recordsDir, leftover);
+    CHECK_EQUAL(countRecords(recordsDir), std::size_t{2});
+
+    runtime::TeardownRecord::finishStaleTeardowns(recordsDir, "/bin/true");
+    CHECK(!boost::filesystem::exists(leftover));
+    CHECK_EQUAL(countRecords(recordsDir), std::size_t{1});
+}
+
+TEST(TeardownRecordTestGroup, waitForTeardowns) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-teardowns")};
+    auto recordsDir = testDir.getPath() / "records";
+    auto layer = testDir.getPath() / "layer";
+    common::createFileIfNecessary(layer / "rootfs-upper/file");
+
+    int pipefd[2];
+    CHECK_EQUAL(pipe(pipefd), 0);
+
+    // a reaper which removes the layer after a while
+    auto pid = fork();
+    if(pid == 0) {
+        close(pipefd[0]);
+        {
+            runtime::TeardownRecord record{recordsDir};
+            record.addPathToRemove(layer);
+            record.setTeardownStarted();
+            CHECK_EQUAL(write(pipefd[1], "x", 1), 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds{200});
+            boost::filesystem::remove_all(layer);
+        }
+        _exit(0);
+    }
+    close(pipefd[1]);
+    char c;
+    CHECK_EQUAL(read(pipefd[0], &c, 1), 1);
+    close(pipefd[0]);
+
+    runtime::TeardownRecord::waitForTeardowns(recordsDir, "/bin/true");
+    CHECK(!boost::filesystem::exists(layer));
+    CHECK_EQUAL(countRecords(recordsDir), std::size_t{0});
+
+    int status;
+    waitpid(pid, &status, 0);
+}
+
+TEST(TeardownRecordTestGroup, findSession) {
+    auto recordsDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-teardowns")};
+
+    runtime::TeardownRecord record{recordsDir.getPath()};
+    record.addPathToRemove("/tmp/layer");
+    CHECK(!runtime::TeardownRecord::findSession(recordsDir.getPath(), "session-id"));
+
+    record.setSession({"session-id", 1000, "12345"});
+    auto session = runtime::TeardownRecord::findSession(recordsDir.getPath(), "session-id");
+    CHECK(session);
+    CHECK_EQUAL(session->containerID, std::string{"session-id"});
+    CHECK_EQUAL(session->owner, uid_t{1000});
+    CHECK_EQUAL(session->jobID, std::string{"12345"});
+    CHECK(!runtime::TeardownRecord::findSession(recordsDir.getPath(), "other-session-id"));
+
+    // the session can't be used anymore once its teardown started
+    record.setTeardownStarted();
+    CHECK(!runtime::TeardownRecord::findSession(recordsDir.getPath(), "session-id"));
+}
+
+TEST(TeardownRecordTestGroup, findSessionOfUser) {
+    auto recordsDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-teardowns")};
+
+    runtime::TeardownRecord jobSession{recordsDir.getPath()};
+    jobSession.setSession({"job-session-id", 1000, "12345"});
+    CHECK(runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "job-session-id", 1000, "12345"));
+    // sessions of another user or another job are not found
+    CHECK(!runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "job-session-id", 1001, "12345"));
+    CHECK(!runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "job-session-id", 1000, "12346"));
+    CHECK(!runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "job-session-id", 1000, ""));
+
+    // a session started outside of a job is only bound to its user
+    runtime::TeardownRecord session{recordsDir.getPath()};
+    session.setSession({"session-id", 1000, ""});
+    CHECK(runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "session-id", 1000, ""));
+    CHECK(runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "session-id", 1000, "12345"));
+    CHECK(!runtime::TeardownRecord::findSessionOfUser(recordsDir.getPath(), "session-id", 1001, ""));
+}
+
+SARUS_UNITTEST_MAIN_FUNCTION();
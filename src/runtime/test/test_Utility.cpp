@@ -0,0 +1,73 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "common/PathRAII.hpp"
+#include "common/Utility.hpp"
+#include "runtime/Utility.hpp"
+#include "test_utility/unittest_main_function.hpp"
+
+
+namespace sarus {
+namespace runtime {
+namespace test {
+
+TEST_GROUP(RuntimeUtilityTestGroup) {
+};
+
+TEST(RuntimeUtilityTestGroup, getHugetlbfsMountPoints) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-runtime-utility")};
+    auto mountinfo = testDir.getPath() / "mountinfo";
+    common::writeTextFile(
+        "22 1 253:0 / / rw,relatime shared:1 - xfs /dev/mapper/root rw\n"
+        "40 22 0:39 / /dev/hugepages rw,relatime shared:22 - hugetlbfs hugetlbfs rw,pagesize=2M\n"
+        "41 22 0:40 / /mnt/huge\\0401G rw,relatime - hugetlbfs none rw,pagesize=1024M\n"
+        "42 22 0:39 / /dev/hugepages rw,relatime shared:22 - hugetlbfs hugetlbfs rw,pagesize=2M\n"
+        "43 22 0:41 / /hugetlbfs-lookalike rw,relatime - tmpfs hugetlbfs rw\n",
+        mountinfo);
+
+    auto mountPoints = utility::getHugetlbfsMountPoints(mountinfo);
+    CHECK_EQUAL(mountPoints.size(), 2);
+    CHECK_EQUAL(mountPoints[0], boost::filesystem::path{"/dev/hugepages"});
+    CHECK_EQUAL(mountPoints[1], boost::filesystem::path{"/mnt/huge 1G"});
+
+    CHECK_THROWS(common::Error, utility::getHugetlbfsMountPoints(testDir.getPath() / "non-existing"));
+}
+
+TEST(RuntimeUtilityTestGroup, getJobIDOfProcess) {
+    auto testDir = common::PathRAII{common::makeUniquePathWithRandomSuffix("/tmp/sarus-utest-runtime-utility")};
+    auto cgroup = testDir.getPath() / "cgroup";
+
+    common::writeTextFile("0::/system.slice/slurmstepd.scope/job_1234/step_0/user/task_0\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{"1234"});
+
+    common::writeTextFile("12:pids:/user.slice\n"
+                          "4:freezer:/slurm/uid_1000/job_567/step_batch\n"
+                          "1:name=systemd:/user.slice/user-1000.slice/session-1.scope\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{"567"});
+
+    // outside of a job
+    common::writeTextFile("0::/user.slice/user-1000.slice/job_lookalike.scope\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{});
+
+    // cgroups created by the user in the subtree delegated to them are not Slurm's
+    common::writeTextFile("0::/user.slice/user-1000.slice/user@1000.service/job_1234\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{});
+    common::writeTextFile("0::/user.slice/user-1000.slice/user@1000.service/slurmstepd.scope/job_1234\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{});
+    common::writeTextFile("0::/user.slice/slurm/uid_1000/job_1234/step_0\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{});
+    common::writeTextFile("4:freezer:/slurm/uid_1000/job_12ab/step_0\n", cgroup);
+    CHECK_EQUAL(utility::getJobIDOfProcess(cgroup), std::string{});
+    CHECK_EQUAL(utility::getJobIDOfProcess(testDir.getPath() / "non-existing"), std::string{});
+}
+
+}}} // namespace
+
+SARUS_UNITTEST_MAIN_FUNCTION();
@@ -0,0 +1,103 @@
+/*
+ * Sarus
+ *
+ * Copyright (c) 2018-2022, ETH Zurich. All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#ifndef sarus_test_utility_Benchmark_hpp
+#define sarus_test_utility_Benchmark_hpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/format.hpp>
+
+
+namespace test_utility {
+namespace benchmark {
+
+struct Result {
+    std::string name;
+    std::size_t iterations;
+    double min;     // seconds
+    double median;  // seconds
+    double mean;    // seconds
+    double max;     // seconds
+};
+
+/**
+ * Number of iterations of each measurement. Can be overridden with the
+ * SARUS_BENCHMARK_ITERATIONS environment variable, e.g. to get quick
+ * results while developing.
+ */
+inline std::size_t getIterations(std::size_t defaultIterations) {
+    if(const char* value = std::getenv("SARUS_BENCHMARK_ITERATIONS")) {
+        return std::max(std::stoul(value), 1ul);
+    }
+    return defaultIterations;
+}
+
+/**
+ * Statistics of samples measured elsewhere, e.g. the durations of the stages of an
+ * operation reported by the operation itself.
+ */
+inline Result summarize(const std::string& name, std::vector<double> samples) {
+    if(samples.empty()) {
+        return Result{name, 0, 0, 0, 0, 0};
+    }
+    std::sort(samples.begin(), samples.end());
+    auto sum = 0.0;
+    for(auto sample : samples) {
+        sum += sample;
+    }
+    return Result{name, samples.size(), samples.front(), samples[samples.size() / 2], sum / samples.size(), samples.back()};
+}
+
+/**
+ * Runs the given function a number of times (after a few warm-up runs
+ * that are not measured) and returns statistics of the elapsed times.
+ */
+template<class Function>
+Result run(const std::string& name, std::size_t iterations, Function&& function) {
+    iterations = getIterations(iterations);
+    auto warmupIterations = std::min<std::size_t>(iterations / 10 + 1, 10);
+    for(std::size_t i=0; i<warmupIterations; ++i) {
+        function();
+    }
+
+    auto samples = std::vector<double>{};
+    samples.reserve(iterations);
+    for(std::size_t i=0; i<iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double>(end - start).count());
+    }
+
+    return summarize(name, std::move(samples));
+}
+
+inline void printHeader(std::ostream& os = std::cout) {
+    os << boost::format("%-50s %10s %12s %12s %12s %12s\n")
+        % "benchmark" % "iterations" % "min [us]" % "median [us]" % "mean [us]" % "max [us]";
+}
+
+inline void print(const Result& result, std::ostream& os = std::cout) {
+    os << boost::format("%-50s %10d %12.1f %12.1f %12.1f %12.1f\n")
+        % result.name % result.iterations
+        % (result.min * 1e6) % (result.median * 1e6) % (result.mean * 1e6) % (result.max * 1e6);
+}
+
+} // namespace
+} // namespace
+
+#endif
@@ -19,11 +19,14 @@
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
 #include <string.h>
 #include <cstdlib>
 #include <vector>
 #include <string>
 
+#include "common/Error.hpp"
 #include "common/Utility.hpp"
 
 
@@ -188,5 +191,48 @@ void create_test_directory_tree(const std::string& dir) {
     sarus::common::executeCommand("chmod 666 " + dir + "/sub2/f.a");
 }
 
+MutationCounter::MutationCounter(const boost::filesystem::path& root)
+    : fd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+{
+    if(fd < 0) {
+        SARUS_THROW_ERROR("Failed to initialize inotify instance");
+    }
+    const auto mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE
+                    | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    auto addWatch = [&](const boost::filesystem::path& dir) {
+        if(inotify_add_watch(fd, dir.c_str(), mask) < 0) {
+            SARUS_THROW_ERROR("Failed to add inotify watch on " + dir.string());
+        }
+    };
+    addWatch(root);
+    for(auto it = boost::filesystem::recursive_directory_iterator{root};
+        it != boost::filesystem::recursive_directory_iterator{};
+        ++it) {
+        if(boost::filesystem::is_directory(it->symlink_status())) {
+            addWatch(it->path());
+        }
+    }
+}
+
+MutationCounter::~MutationCounter() {
+    close(fd);
+}
+
+std::size_t MutationCounter::count() {
+    alignas(inotify_event) char buffer[4096];
+    std::size_t numberOfMutations = 0;
+    ssize_t length;
+    while((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for(auto* p = buffer; p < buffer + length; ) {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+            if(!(event->mask & IN_IGNORED)) {
+                ++numberOfMutations;
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return numberOfMutations;
+}
+
 } // filesystem
 } // test_utility
@@ -36,6 +36,26 @@ void createBlockDeviceFile(const boost::filesystem::path& path,
                                const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
 void create_test_directory_tree(const std::string& dir);
 
+/**
+ * Counts the mutations (creations, removals, renames, writes and changes of attributes) of the
+ * files and directories within a directory tree, through inotify watches on the directories which
+ * exist at construction. E.g. a lock file which is created and removed counts as two mutations,
+ * while it leaves no trace in the tree.
+ */
+class MutationCounter {
+public:
+    MutationCounter(const boost::filesystem::path& root);
+    MutationCounter(const MutationCounter&) = delete;
+    MutationCounter& operator=(const MutationCounter&) = delete;
+    ~MutationCounter();
+
+    // returns the number of mutations since the previous call (or the construction)
+    std::size_t count();
+
+private:
+    int fd;
+};
+
 }
 }
 